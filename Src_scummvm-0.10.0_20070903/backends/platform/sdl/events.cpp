@@ -226,6 +226,12 @@ bool OSystem_SDL::pollEvent(Common::Event &event) {
 				break;
 			}
 
+			// Alt-V: Start or stop recording the game screen
+			if (b == Common::KBD_ALT && ev.key.keysym.sym == 'v') {
+				toggleVideoCapture();
+				break;
+			}
+
 			// Ctrl-m toggles mouse capture
 			if (b == Common::KBD_CTRL && ev.key.keysym.sym == 'm') {
 				toggleMouseGrab();
@@ -24,11 +24,14 @@
  */
 
 #include "backends/platform/sdl/sdl-common.h"
+#include "common/config-manager.h"
 #include "common/util.h"
 #include "graphics/font.h"
 #include "graphics/fontman.h"
+#include "graphics/framediff.h"
 #include "graphics/scaler.h"
 #include "graphics/surface.h"
+#include "graphics/videocapture.h"
 
 static const OSystem::GraphicsMode s_supportedGraphicsModes[] = {
 	{"1x", "Normal (no scaling)", GFX_NORMAL},
@@ -149,20 +152,24 @@ bool OSystem_SDL::setGraphicsMode(int mode) {
 
 	int newScaleFactor = 1;
 	ScalerProc *newScalerProc;
+	ScalerProc *newScalerProc32 = 0;
 
 	switch(mode) {
 	case GFX_NORMAL:
 		newScaleFactor = 1;
 		newScalerProc = Normal1x;
+		newScalerProc32 = Normal1x_32;
 		break;
 #ifndef DISABLE_SCALERS
 	case GFX_DOUBLESIZE:
 		newScaleFactor = 2;
 		newScalerProc = Normal2x;
+		newScalerProc32 = Normal2x_32;
 		break;
 	case GFX_TRIPLESIZE:
 		newScaleFactor = 3;
 		newScalerProc = Normal3x;
+		newScalerProc32 = Normal3x_32;
 		break;
 
 	case GFX_2XSAI:
@@ -180,10 +187,12 @@ bool OSystem_SDL::setGraphicsMode(int mode) {
 	case GFX_ADVMAME2X:
 		newScaleFactor = 2;
 		newScalerProc = AdvMame2x;
+		newScalerProc32 = AdvMame2x_32;
 		break;
 	case GFX_ADVMAME3X:
 		newScaleFactor = 3;
 		newScalerProc = AdvMame3x;
+		newScalerProc32 = AdvMame3x_32;
 		break;
 #ifndef DISABLE_HQ_SCALERS
 	case GFX_HQ2X:
@@ -212,14 +221,20 @@ bool OSystem_SDL::setGraphicsMode(int mode) {
 
 	_transactionDetails.normal1xScaler = (mode == GFX_NORMAL);
 
+	// The scalers which blend colors only work on 16 bit pixels, so switching
+	// between one of them and a scaler with a 32 bit version changes the
+	// depth of the screen surfaces.
+	const bool depthChanged = (_prefer32bpp && newScalerProc32 != 0) != _use32bpp;
+
 	_mode = mode;
 	_scalerProc = newScalerProc;
+	_scalerProc32 = newScalerProc32;
 
 	if (_transactionMode == kTransactionActive) {
 		_transactionDetails.mode = mode;
 		_transactionDetails.modeChanged = true;
 
-		if (newScaleFactor != _scaleFactor) {
+		if (newScaleFactor != _scaleFactor || depthChanged) {
 			_transactionDetails.needHotswap = true;
 			_scaleFactor = newScaleFactor;
 		}
@@ -237,6 +252,8 @@ bool OSystem_SDL::setGraphicsMode(int mode) {
 
 		_scaleFactor = newScaleFactor;
 		hotswapGFXMode();
+	} else if (depthChanged && _transactionMode != kTransactionCommit) {
+		hotswapGFXMode();
 	}
 
 	// Determine the "scaler type", i.e. essentially an index into the
@@ -283,8 +300,6 @@ void OSystem_SDL::initSize(uint w, uint h) {
 	_screenWidth = w;
 	_screenHeight = h;
 
-	_cksumNum = (_screenWidth * _screenHeight / (8 * 8));
-
 	if (_transactionMode == kTransactionActive) {
 		_transactionDetails.w = w;
 		_transactionDetails.h = h;
@@ -295,8 +310,9 @@ void OSystem_SDL::initSize(uint w, uint h) {
 		return;
 	}
 
-	free(_dirtyChecksums);
-	_dirtyChecksums = (uint32 *)calloc(_cksumNum * 2, sizeof(uint32));
+	free(_dirtyShadow);
+	_dirtyShadow = (byte *)calloc(_screenWidth * _screenHeight, 1);
+	_shadowValid = false;
 
 	if (_transactionMode != kTransactionCommit) {
 		unloadGFXMode();
@@ -339,10 +355,14 @@ void OSystem_SDL::loadGFXMode() {
 		error("allocating _screen failed");
 
 	//
-	// Create the surface that contains the scaled graphics in 16 bit mode
+	// Create the surface that contains the scaled graphics, in 32 bit mode
+	// if both the desktop and the scaler allow it, in 16 bit mode otherwise
 	//
 
-	_hwscreen = SDL_SetVideoMode(hwW, hwH, 16,
+	_use32bpp = _prefer32bpp && _scalerProc32 != 0;
+	const int hwBitsPerPixel = _use32bpp ? 32 : 16;
+
+	_hwscreen = SDL_SetVideoMode(hwW, hwH, hwBitsPerPixel,
 		_fullscreen ? (SDL_FULLSCREEN|SDL_SWSURFACE) : SDL_SWSURFACE
 	);
 	if (_hwscreen == NULL) {
@@ -367,18 +387,34 @@ void OSystem_SDL::loadGFXMode() {
 	}
 
 	//
-	// Create the surface used for the graphics in 16 bit before scaling, and also the overlay
+	// Create the surface used for the graphics before scaling, and also the overlay
 	//
 
-	// Distinguish 555 and 565 mode
-	if (_hwscreen->format->Rmask == 0x7C00)
-		InitScalers(555);
-	else
-		InitScalers(565);
+	// The overlay, the cursor and the OSD always have 16 bit pixels, since
+	// that's what OverlayColor and the cursor code use. In 32 bit mode, SDL
+	// converts them while blitting them onto _hwscreen. The game screen is
+	// converted from 8 bit straight to the _hwscreen format instead.
+	Uint32 rMask16, gMask16, bMask16;
+	if (_use32bpp) {
+		// No HQ scaler can be active, so skip building their tables
+		InitScalers(565, false);
+		rMask16 = 0xF800;
+		gMask16 = 0x07E0;
+		bMask16 = 0x001F;
+	} else {
+		// Distinguish 555 and 565 mode
+		if (_hwscreen->format->Rmask == 0x7C00)
+			InitScalers(555);
+		else
+			InitScalers(565);
+		rMask16 = _hwscreen->format->Rmask;
+		gMask16 = _hwscreen->format->Gmask;
+		bMask16 = _hwscreen->format->Bmask;
+	}
 
 	// Need some extra bytes around when using 2xSaI
 	_tmpscreen = SDL_CreateRGBSurface(SDL_SWSURFACE, _screenWidth + 3, _screenHeight + 3,
-						16,
+						hwBitsPerPixel,
 						_hwscreen->format->Rmask,
 						_hwscreen->format->Gmask,
 						_hwscreen->format->Bmask,
@@ -388,17 +424,13 @@ void OSystem_SDL::loadGFXMode() {
 		error("allocating _tmpscreen failed");
 
 	_overlayscreen = SDL_CreateRGBSurface(SDL_SWSURFACE, _overlayWidth, _overlayHeight,
-						16,
-						_hwscreen->format->Rmask,
-						_hwscreen->format->Gmask,
-						_hwscreen->format->Bmask,
-						_hwscreen->format->Amask);
+						16, rMask16, gMask16, bMask16, 0);
 
 	if (_overlayscreen == NULL)
 		error("allocating _overlayscreen failed");
 
 	_tmpscreen2 = SDL_CreateRGBSurface(SDL_SWSURFACE, _overlayWidth + 3, _overlayHeight + 3,
-						16,
+						hwBitsPerPixel,
 						_hwscreen->format->Rmask,
 						_hwscreen->format->Gmask,
 						_hwscreen->format->Bmask,
@@ -411,11 +443,7 @@ void OSystem_SDL::loadGFXMode() {
 	_osdSurface = SDL_CreateRGBSurface(SDL_SWSURFACE | SDL_RLEACCEL | SDL_SRCCOLORKEY | SDL_SRCALPHA,
 						_hwscreen->w,
 						_hwscreen->h,
-						16,
-						_hwscreen->format->Rmask,
-						_hwscreen->format->Gmask,
-						_hwscreen->format->Bmask,
-						_hwscreen->format->Amask);
+						16, rMask16, gMask16, bMask16, 0);
 	if (_osdSurface == NULL)
 		error("allocating _osdSurface failed");
 	SDL_SetColorKey(_osdSurface, SDL_RLEACCEL | SDL_SRCCOLORKEY | SDL_SRCALPHA, kOSDColorKey);
@@ -511,6 +539,14 @@ void OSystem_SDL::updateScreen() {
 
 	Common::StackLock lock(_graphicsMutex);	// Lock the mutex until this function ends
 
+	// Record the frame if anything changed since the previous one. This
+	// only copies the 8 bit screen; the encoding happens in another thread.
+	if (_videoCapture && _videoCapture->isRecording() && _screen &&
+		(_numDirtyRects > 0 || _forceFull || _paletteDirtyEnd != 0)) {
+		_videoCapture->captureFrame((const byte *)_screen->pixels, _screen->pitch,
+			_screenWidth, _screenHeight, (const byte *)_currentPalette);
+	}
+
 	internUpdateScreen();
 }
 
@@ -577,14 +613,14 @@ void OSystem_SDL::internUpdateScreen() {
 		srcSurf = _tmpscreen;
 		width = _screenWidth;
 		height = _screenHeight;
-		scalerProc = _scalerProc;
+		scalerProc = _use32bpp ? _scalerProc32 : _scalerProc;
 		scale1 = _scaleFactor;
 	} else {
 		origSurf = _overlayscreen;
 		srcSurf = _tmpscreen2;
 		width = _overlayWidth;
 		height = _overlayHeight;
-		scalerProc = Normal1x;
+		scalerProc = _use32bpp ? Normal1x_32 : Normal1x;
 
 		scale1 = 1;
 	}
@@ -606,6 +642,7 @@ void OSystem_SDL::internUpdateScreen() {
 		SDL_Rect dst;
 		uint32 srcPitch, dstPitch;
 		SDL_Rect *lastRect = _dirtyRectList + _numDirtyRects;
+		const int bytesPerPixel = _hwscreen->format->BytesPerPixel;
 
 		if (scalerProc == Normal1x && !_adjustAspectRatio && 0) {
 			for (r = _dirtyRectList; r != lastRect; ++r) {
@@ -628,6 +665,8 @@ void OSystem_SDL::internUpdateScreen() {
 			SDL_LockSurface(srcSurf);
 			SDL_LockSurface(_hwscreen);
 
+			const uint32 scaleStart = getMicros();
+
 			srcPitch = srcSurf->pitch;
 			dstPitch = _hwscreen->pitch;
 
@@ -649,8 +688,8 @@ void OSystem_SDL::internUpdateScreen() {
 						dst_y = real2Aspect(dst_y);
 
 					assert(scalerProc != NULL);
-					scalerProc((byte *)srcSurf->pixels + (r->x * 2 + 2) + (r->y + 1) * srcPitch, srcPitch,
-							   (byte *)_hwscreen->pixels + rx1 * 2 + dst_y * dstPitch, dstPitch, r->w, dst_h);
+					scaleRect(scalerProc, (byte *)srcSurf->pixels + (r->x + 1) * bytesPerPixel + (r->y + 1) * srcPitch, srcPitch,
+							   (byte *)_hwscreen->pixels + rx1 * bytesPerPixel + dst_y * dstPitch, dstPitch, r->w, dst_h, scale1);
 				}
 
 				r->x = rx1;
@@ -659,10 +698,30 @@ void OSystem_SDL::internUpdateScreen() {
 				r->h = dst_h * scale1;
 
 #ifndef DISABLE_SCALERS
-				if (_adjustAspectRatio && orig_dst_y < height && !_overlayVisible)
-					r->h = stretch200To240((uint8 *) _hwscreen->pixels, dstPitch, r->w, r->h, r->x, r->y, orig_dst_y * scale1);
+				if (_adjustAspectRatio && orig_dst_y < height && !_overlayVisible) {
+					if (_use32bpp)
+						r->h = stretch200To240_32((uint8 *) _hwscreen->pixels, dstPitch, r->w, r->h, r->x, r->y, orig_dst_y * scale1);
+					else
+						r->h = stretch200To240((uint8 *) _hwscreen->pixels, dstPitch, r->w, r->h, r->x, r->y, orig_dst_y * scale1);
+				}
 #endif
 			}
+
+			const uint32 scaleTime = getMicros() - scaleStart;
+			_scalerTime += scaleTime;
+			_scalerMaxTime = MAX(_scalerMaxTime, scaleTime);
+			if (++_scalerFrames == kScalerStatsFrames) {
+				debug(2, "Scaler: %d us per frame on average, at most %d us (%d threads)",
+					_scalerTime / kScalerStatsFrames, _scalerMaxTime, _numScalerThreads);
+				debug(2, "Dirty rects: %d submitted, %d merged, %d full updates forced",
+					_dirtyRectsSubmitted, _dirtyRectsMerged, _dirtyRectsForcedFull);
+				debug(2, "Cursor cache: %d hits, %d misses", _cursorCacheHits, _cursorCacheMisses);
+				_scalerTime = _scalerMaxTime = 0;
+				_scalerFrames = 0;
+				_dirtyRectsSubmitted = _dirtyRectsMerged = _dirtyRectsForcedFull = 0;
+				_cursorCacheHits = _cursorCacheMisses = 0;
+			}
+
 			SDL_UnlockSurface(srcSurf);
 			SDL_UnlockSurface(_hwscreen);
 		}
@@ -700,6 +759,44 @@ bool OSystem_SDL::saveScreenshot(const char *filename) {
 	return SDL_SaveBMP(_hwscreen, filename) == 0;
 }
 
+void OSystem_SDL::toggleVideoCapture() {
+	Common::StackLock lock(_graphicsMutex);	// Lock the mutex until this function ends
+
+	if (!_videoCapture)
+		_videoCapture = new Graphics::VideoCapture();
+
+	if (_videoCapture->isRecording()) {
+		_videoCapture->stop();
+		printf("Stopped video capture: %d frames recorded, %d dropped\n",
+			_videoCapture->getFramesWritten(), _videoCapture->getFramesDropped());
+#ifdef USE_OSD
+		displayMessageOnOSD("Video capture stopped");
+#endif
+		return;
+	}
+
+	char filename[20];
+	for (int n = 0;; n++) {
+		SDL_RWops *file;
+
+		sprintf(filename, "scummvm%05d.svr", n);
+		file = SDL_RWFromFile(filename, "r");
+		if (!file)
+			break;
+		SDL_RWclose(file);
+	}
+
+	if (_videoCapture->start(filename)) {
+		printf("Recording to '%s'\n", filename);
+		_forceFull = true;
+#ifdef USE_OSD
+		displayMessageOnOSD("Video capture started");
+#endif
+	} else {
+		printf("Could not start video capture!\n");
+	}
+}
+
 void OSystem_SDL::setFullscreenMode(bool enable) {
 	Common::StackLock lock(_graphicsMutex);
 
@@ -825,7 +922,7 @@ void OSystem_SDL::copyRectToScreen(const byte *src, int pitch, int x, int y, int
 		if (w <= 0 || h <= 0)
 			return;
 
-		_cksumValid = false;
+		_shadowValid = false;
 		addDirtyRect(x, y, w, h);
 	}
 
@@ -869,15 +966,34 @@ bool OSystem_SDL::grabRawScreen(Graphics::Surface *surf) {
 	return true;
 }
 
+/** Get the bounding box of two rects. */
+static SDL_Rect unionRect(const SDL_Rect &a, const SDL_Rect &b) {
+	SDL_Rect r;
+	r.x = MIN(a.x, b.x);
+	r.y = MIN(a.y, b.y);
+	r.w = MAX(a.x + a.w, b.x + b.w) - r.x;
+	r.h = MAX(a.y + a.h, b.y + b.h) - r.y;
+	return r;
+}
+
+/**
+ * Get how much more it costs to update the bounding box of two rects than
+ * to update them separately. Negative if merging them pays off, e.g. because
+ * they overlap or are adjacent.
+ */
+static int mergeCost(const SDL_Rect &a, const SDL_Rect &b, int rectOverhead) {
+	const SDL_Rect u = unionRect(a, b);
+	return u.w * u.h - a.w * a.h - b.w * b.h - rectOverhead;
+}
+
+void OSystem_SDL::removeDirtyRect(int index) {
+	_dirtyRectList[index] = _dirtyRectList[--_numDirtyRects];
+}
+
 void OSystem_SDL::addDirtyRect(int x, int y, int w, int h, bool realCoordinates) {
 	if (_forceFull)
 		return;
 
-	if (_numDirtyRects == NUM_DIRTY_RECT) {
-		_forceFull = true;
-		return;
-	}
-
 	int height, width;
 
 	if (!_overlayVisible && !realCoordinates) {
@@ -927,97 +1043,80 @@ void OSystem_SDL::addDirtyRect(int x, int y, int w, int h, bool realCoordinates)
 		return;
 	}
 
-	if (w > 0 && h > 0) {
-		SDL_Rect *r = &_dirtyRectList[_numDirtyRects++];
+	if (w <= 0 || h <= 0)
+		return;
 
-		r->x = x;
-		r->y = y;
-		r->w = w;
-		r->h = h;
+	_dirtyRectsSubmitted++;
+
+	SDL_Rect r;
+	r.x = x;
+	r.y = y;
+	r.w = w;
+	r.h = h;
+
+	// Merge the new rect with every rect for which that is cheaper than
+	// keeping both. The result may pay off merging with further rects, so
+	// keep going until nothing changes anymore.
+	int i = 0;
+	while (i < _numDirtyRects) {
+		if (mergeCost(r, _dirtyRectList[i], kDirtyRectOverhead) <= 0) {
+			r = unionRect(r, _dirtyRectList[i]);
+			removeDirtyRect(i);
+			_dirtyRectsMerged++;
+			i = 0;
+		} else {
+			i++;
+		}
 	}
-}
 
+	// If the list is full, merge with the rect which costs the least extra
+	if (_numDirtyRects == NUM_DIRTY_RECT) {
+		int best = 0;
+		for (i = 1; i < _numDirtyRects; i++)
+			if (mergeCost(r, _dirtyRectList[i], kDirtyRectOverhead) < mergeCost(r, _dirtyRectList[best], kDirtyRectOverhead))
+				best = i;
+		r = unionRect(r, _dirtyRectList[best]);
+		removeDirtyRect(best);
+		_dirtyRectsMerged++;
+	}
 
-void OSystem_SDL::makeChecksums(const byte *buf) {
-	assert(buf);
-	uint32 *sums = _dirtyChecksums;
-	uint x,y;
-	const uint last_x = (uint)_screenWidth / 8;
-	const uint last_y = (uint)_screenHeight / 8;
-
-	const uint BASE = 65521; /* largest prime smaller than 65536 */
-
-	/* the 8x8 blocks in buf are enumerated starting in the top left corner and
-	 * reading each line at a time from left to right */
-	for (y = 0; y != last_y; y++, buf += _screenWidth * (8 - 1))
-		for (x = 0; x != last_x; x++, buf += 8) {
-			// Adler32 checksum algorithm (from RFC1950, used by gzip and zlib).
-			// This computes the Adler32 checksum of a 8x8 pixel block. Note
-			// that we can do the modulo operation (which is the slowest part)
-			// of the algorithm) at the end, instead of doing each iteration,
-			// since we only have 64 iterations in total - and thus s1 and
-			// s2 can't overflow anyway.
-			uint32 s1 = 1;
-			uint32 s2 = 0;
-			const byte *ptr = buf;
-			for (int subY = 0; subY < 8; subY++) {
-				for (int subX = 0; subX < 8; subX++) {
-					s1 += ptr[subX];
-					s2 += s1;
-				}
-				ptr += _screenWidth;
-			}
-
-			s1 %= BASE;
-			s2 %= BASE;
+	_dirtyRectList[_numDirtyRects++] = r;
 
-			/* output the checksum for this block */
-			*sums++ =  (s2 << 16) + s1;
+	// Switch to a full update once that is cheaper than handling all the
+	// rects. Rects in real coordinates are only added after the screen has
+	// been scaled, when it's too late for that.
+	if (!realCoordinates) {
+		int cost = 0;
+		for (i = 0; i < _numDirtyRects; i++)
+			cost += _dirtyRectList[i].w * _dirtyRectList[i].h + kDirtyRectOverhead;
+		if (cost >= width * height + kDirtyRectOverhead) {
+			_forceFull = true;
+			_dirtyRectsForcedFull++;
+		}
 	}
 }
 
+
 void OSystem_SDL::addDirtyRgnAuto(const byte *buf) {
 	assert(buf);
-	assert(((long)buf & 3) == 0);
 
-	/* generate a table of the checksums */
-	makeChecksums(buf);
-
-	if (!_cksumValid) {
+	if (!_shadowValid) {
 		_forceFull = true;
-		_cksumValid = true;
-	}
-
-	/* go through the checksum list, compare it with the previous checksums,
-		 and add all dirty rectangles to a list. try to combine small rectangles
-		 into bigger ones in a simple way */
-	if (!_forceFull) {
-		int x, y, w;
-		uint32 *ck = _dirtyChecksums;
-
-		for (y = 0; y != _screenHeight / 8; y++) {
-			for (x = 0; x != _screenWidth / 8; x++, ck++) {
-				if (ck[0] != ck[_cksumNum]) {
-					/* found a dirty 8x8 block, now go as far to the right as possible,
-						 and at the same time, unmark the dirty status by setting old to new. */
-					w=0;
-					do {
-						ck[w + _cksumNum] = ck[w];
-						w++;
-					} while (x + w != _screenWidth / 8 && ck[w] != ck[w + _cksumNum]);
-
-					addDirtyRect(x * 8, y * 8, w * 8, 8);
-
-					if (_forceFull)
-						goto get_out;
-				}
-			}
-		}
-	} else {
-		get_out:;
-		/* Copy old checksums to new */
-		memcpy(_dirtyChecksums + _cksumNum, _dirtyChecksums, _cksumNum * sizeof(uint32));
+		_shadowValid = true;
 	}
+
+	if (_forceFull) {
+		memcpy(_dirtyShadow, buf, _screenWidth * _screenHeight);
+		return;
+	}
+
+	// Compare the frame with the previous one and add the areas which
+	// changed. Once addDirtyRect gives up and forces a full update, the
+	// remaining rects don't matter anymore.
+	Common::Array<Common::Rect> rects;
+	Graphics::diffFrame(buf, _dirtyShadow, _screenWidth, _screenHeight, rects);
+	for (uint i = 0; i < rects.size() && !_forceFull; ++i)
+		addDirtyRect(rects[i].left, rects[i].top, rects[i].width(), rects[i].height());
 }
 
 int16 OSystem_SDL::getHeight() {
@@ -1041,13 +1140,21 @@ void OSystem_SDL::setPalette(const byte *colors, uint start, uint num) {
 	const byte *b = colors;
 	uint i;
 	SDL_Color *base = _currentPalette + start;
+	bool changed = false;
 	for (i = 0; i < num; i++) {
+		if (base[i].r != b[0] || base[i].g != b[1] || base[i].b != b[2])
+			changed = true;
 		base[i].r = b[0];
 		base[i].g = b[1];
 		base[i].b = b[2];
 		b += 4;
 	}
 
+	// Many games set the same palette over and over again; that doesn't
+	// make the scaled cursors outdated.
+	if (changed)
+		_paletteVersion++;
+
 	if (start < _paletteDirtyStart)
 		_paletteDirtyStart = start;
 
@@ -1083,6 +1190,7 @@ void OSystem_SDL::setCursorPalette(const byte *colors, uint start, uint num) {
 		b += 4;
 	}
 
+	_cursorPaletteVersion++;
 	_cursorPaletteDisabled = false;
 
 	blitCursor();
@@ -1095,6 +1203,70 @@ void OSystem_SDL::setShakePos(int shake_pos) {
 }
 
 
+#pragma mark -
+#pragma mark --- Scaler threads ---
+#pragma mark -
+
+void OSystem_SDL::initScalerThreads() {
+	_numScalerThreads = ConfMan.getInt("scaler_threads");
+	if (_numScalerThreads <= 0)
+		_numScalerThreads = getNumberOfCPUs();
+	_numScalerThreads = MIN<int>(_numScalerThreads, kMaxScalerThreads);
+
+	_scalerTime = _scalerMaxTime = 0;
+	_scalerFrames = 0;
+	_dirtyRectsSubmitted = _dirtyRectsMerged = _dirtyRectsForcedFull = 0;
+
+	// If some of the threads can't be created, the pool makes do with the others
+	_numScalerThreads = _scalerPool.start(MAX(_numScalerThreads, 1));
+
+	if (_numScalerThreads > 1)
+		debug(1, "Scaling with %d threads", _numScalerThreads);
+}
+
+void OSystem_SDL::deinitScalerThreads() {
+	_scalerPool.stop();
+	_numScalerThreads = 1;
+}
+
+void OSystem_SDL::scalerJobProc(void *param, uint job) {
+	const ScalerJob &j = ((OSystem_SDL *)param)->_scalerJobs[job];
+	j.scalerProc(j.src, j.srcPitch, j.dst, j.dstPitch, j.width, j.height);
+}
+
+void OSystem_SDL::scaleRect(ScalerProc *scalerProc, const byte *src, uint32 srcPitch,
+							byte *dst, uint32 dstPitch, int width, int height, int scale) {
+	int numBands = MIN<int>(height / kMinScalerBandHeight, width * height / kMinScalerBandPixels);
+	numBands = MIN<int>(numBands, _numScalerThreads * 2);
+
+	if (_numScalerThreads <= 1 || numBands <= 1) {
+		scalerProc(src, srcPitch, dst, dstPitch, width, height);
+		return;
+	}
+
+	// Split the rect into horizontal bands. They read the rows around them
+	// straight from the source surface, which is not modified while we scale,
+	// so the rows just outside each band act as its guard rows, and the result
+	// is identical to scaling the rect in one go. The bands have an even
+	// height, so that the DotMatrix pattern does not get out of phase.
+	const int bandHeight = ((height + numBands - 1) / numBands + 1) & ~1;
+
+	uint numJobs = 0;
+	for (int y = 0; y < height; y += bandHeight) {
+		ScalerJob &job = _scalerJobs[numJobs++];
+		job.scalerProc = scalerProc;
+		job.src = src + y * srcPitch;
+		job.srcPitch = srcPitch;
+		job.dst = dst + y * scale * dstPitch;
+		job.dstPitch = dstPitch;
+		job.width = width;
+		job.height = MIN(bandHeight, height - y);
+	}
+
+	_scalerPool.run(scalerJobProc, this, numJobs);
+}
+
+
 #pragma mark -
 #pragma mark --- Overlays ---
 #pragma mark -
@@ -1163,18 +1335,40 @@ void OSystem_SDL::clearOverlay() {
 	if (SDL_BlitSurface(_screen, &src, _tmpscreen, &dst) != 0)
 		error("SDL_BlitSurface failed: %s", SDL_GetError());
 
-	SDL_LockSurface(_tmpscreen);
-	SDL_LockSurface(_overlayscreen);
-	_scalerProc((byte *)(_tmpscreen->pixels) + _tmpscreen->pitch + 2, _tmpscreen->pitch, 
-	(byte *)_overlayscreen->pixels, _overlayscreen->pitch, _screenWidth, _screenHeight);
+	if (_use32bpp) {
+		// Scale into _tmpscreen2, which has the same depth as _tmpscreen, and
+		// let SDL convert the result for the 16 bit overlay.
+		SDL_LockSurface(_tmpscreen);
+		SDL_LockSurface(_tmpscreen2);
+		_scalerProc32((byte *)(_tmpscreen->pixels) + _tmpscreen->pitch + 4, _tmpscreen->pitch,
+			(byte *)_tmpscreen2->pixels, _tmpscreen2->pitch, _screenWidth, _screenHeight);
 
 #ifndef DISABLE_SCALERS
-	if (_adjustAspectRatio)
-		stretch200To240((uint8 *)_overlayscreen->pixels, _overlayscreen->pitch, 
-						_overlayWidth, _screenHeight * _scaleFactor, 0, 0, 0);
+		if (_adjustAspectRatio)
+			stretch200To240_32((uint8 *)_tmpscreen2->pixels, _tmpscreen2->pitch,
+							_overlayWidth, _screenHeight * _scaleFactor, 0, 0, 0);
 #endif
-	SDL_UnlockSurface(_tmpscreen);
-	SDL_UnlockSurface(_overlayscreen);
+		SDL_UnlockSurface(_tmpscreen);
+		SDL_UnlockSurface(_tmpscreen2);
+
+		src.w = _overlayWidth;
+		src.h = _overlayHeight;
+		if (SDL_BlitSurface(_tmpscreen2, &src, _overlayscreen, 0) != 0)
+			error("SDL_BlitSurface failed: %s", SDL_GetError());
+	} else {
+		SDL_LockSurface(_tmpscreen);
+		SDL_LockSurface(_overlayscreen);
+		_scalerProc((byte *)(_tmpscreen->pixels) + _tmpscreen->pitch + 2, _tmpscreen->pitch, 
+		(byte *)_overlayscreen->pixels, _overlayscreen->pitch, _screenWidth, _screenHeight);
+
+#ifndef DISABLE_SCALERS
+		if (_adjustAspectRatio)
+			stretch200To240((uint8 *)_overlayscreen->pixels, _overlayscreen->pitch, 
+							_overlayWidth, _screenHeight * _scaleFactor, 0, 0, 0);
+#endif
+		SDL_UnlockSurface(_tmpscreen);
+		SDL_UnlockSurface(_overlayscreen);
+	}
 
 	_forceFull = true;
 }
@@ -1229,7 +1423,7 @@ void OSystem_SDL::copyRectToOverlay(const OverlayColor *buf, int pitch, int x, i
 		return;
 
 	// Mark the modified region as dirty
-	_cksumValid = false;
+	_shadowValid = false;
 	addDirtyRect(x, y, w, h);
 
 	if (SDL_LockSurface(_overlayscreen) == -1)
@@ -1321,10 +1515,10 @@ void OSystem_SDL::setMouseCursor(const byte *buf, uint w, uint h, int hotspot_x,
  						_mouseCurState.w + 2,
  						_mouseCurState.h + 2,
  						16,
- 						_hwscreen->format->Rmask,
- 						_hwscreen->format->Gmask,
- 						_hwscreen->format->Bmask,
- 						_hwscreen->format->Amask);
+ 						_overlayscreen->format->Rmask,
+ 						_overlayscreen->format->Gmask,
+ 						_overlayscreen->format->Bmask,
+ 						_overlayscreen->format->Amask);
 
  		if (_mouseOrigSurface == NULL)
  			error("allocating _mouseOrigSurface failed");
@@ -1335,6 +1529,12 @@ void OSystem_SDL::setMouseCursor(const byte *buf, uint w, uint h, int hotspot_x,
 
 	_mouseData = (byte *)malloc(w * h);
 	memcpy(_mouseData, buf, w * h);
+
+	// FNV-1a hash of the bitmap, for looking it up in the cursor cache
+	_mouseDataHash = 2166136261U;
+	for (uint i = 0; i < w * h; i++)
+		_mouseDataHash = (_mouseDataHash ^ buf[i]) * 16777619U;
+
 	blitCursor();
 }
 
@@ -1350,40 +1550,6 @@ void OSystem_SDL::blitCursor() {
 	w = _mouseCurState.w;
 	h = _mouseCurState.h;
 
-	SDL_LockSurface(_mouseOrigSurface);
-
-	// Make whole surface transparent
-	for (i = 0; i < h + 2; i++) {
-		dstPtr = (byte *)_mouseOrigSurface->pixels + _mouseOrigSurface->pitch * i;
-		for (j = 0; j < w + 2; j++) {
-			*(uint16 *)dstPtr = kMouseColorKey;
-			dstPtr += 2;
-		}
-	}
-
-	// Draw from [1,1] since AdvMame2x adds artefact at 0,0
-	dstPtr = (byte *)_mouseOrigSurface->pixels + _mouseOrigSurface->pitch + 2;
-
-	SDL_Color *palette;
-
-	if (_cursorPaletteDisabled)
-		palette = _currentPalette;
-	else
-		palette = _cursorPalette;
-	
-	for (i = 0; i < h; i++) {
-		for (j = 0; j < w; j++) {
-			color = *srcPtr;
-			if (color != _mouseKeyColor) {	// transparent, don't draw
-				*(uint16 *)dstPtr = SDL_MapRGB(_mouseOrigSurface->format,
-					palette[color].r, palette[color].g, palette[color].b);
-			}
-			dstPtr += 2;
-			srcPtr++;
-		}
-		dstPtr += _mouseOrigSurface->pitch - w * 2;
-  	}
-
 	int rW, rH;
 
 	if (_cursorTargetScale >= _scaleFactor) {
@@ -1431,29 +1597,8 @@ void OSystem_SDL::blitCursor() {
 		_mouseCurState.rHotY = real2Aspect(_mouseCurState.rHotY);
 	}
 
-	if (_mouseCurState.rW != rW || _mouseCurState.rH != rH) {
-		_mouseCurState.rW = rW;
-		_mouseCurState.rH = rH;
-
-		if (_mouseSurface)
-			SDL_FreeSurface(_mouseSurface);
-
-		_mouseSurface = SDL_CreateRGBSurface(SDL_SWSURFACE | SDL_RLEACCEL | SDL_SRCCOLORKEY | SDL_SRCALPHA,
-						_mouseCurState.rW,
-						_mouseCurState.rH,
-						16,
-						_hwscreen->format->Rmask,
-						_hwscreen->format->Gmask,
-						_hwscreen->format->Bmask,
-						_hwscreen->format->Amask);
-
-		if (_mouseSurface == NULL)
-			error("allocating _mouseSurface failed");
-
-		SDL_SetColorKey(_mouseSurface, SDL_RLEACCEL | SDL_SRCCOLORKEY | SDL_SRCALPHA, kMouseColorKey);
-  	}
-
-	SDL_LockSurface(_mouseSurface);
+	_mouseCurState.rW = rW;
+	_mouseCurState.rH = rH;
 
 	ScalerProc *scalerProc;
 
@@ -1466,6 +1611,108 @@ void OSystem_SDL::blitCursor() {
 	else
 		scalerProc = scalersMagn[_cursorTargetScale - 1][_scaleFactor - 1];
 
+	// Look for the cursor in the cache of scaled cursors first
+	CursorCacheKey key;
+	key.hash = _mouseDataHash;
+	key.w = w;
+	key.h = h;
+	key.keyColor = _mouseKeyColor;
+	key.cursorPalette = !_cursorPaletteDisabled;
+	key.paletteVersion = _cursorPaletteDisabled ? _paletteVersion : _cursorPaletteVersion;
+	key.scaleFactor = _scaleFactor;
+	key.targetScale = _cursorTargetScale;
+	key.aspect = _adjustAspectRatio;
+	key.scalerProc = scalerProc;
+
+	CachedCursor *entry = 0;
+	for (i = 0; i < kCursorCacheSize; i++) {
+		CachedCursor &c = _cursorCache[i];
+		if (c.surface && c.key == key && !memcmp(c.data, _mouseData, w * h)) {
+			entry = &c;
+			break;
+		}
+	}
+
+	if (entry) {
+		_cursorCacheHits++;
+		entry->lastUsed = ++_cursorCacheClock;
+		_mouseSurface = entry->surface;
+		return;
+	}
+	_cursorCacheMisses++;
+
+	// Not cached, so replace the least recently used (or an unused) entry.
+	// That can't be the current cursor, which is always the most recent one.
+	entry = &_cursorCache[0];
+	for (i = 1; i < kCursorCacheSize && entry->surface; i++) {
+		if (!_cursorCache[i].surface || _cursorCache[i].lastUsed < entry->lastUsed)
+			entry = &_cursorCache[i];
+	}
+
+	if (!entry->surface || entry->surface->w != rW || entry->surface->h != rH) {
+		if (entry->surface)
+			SDL_FreeSurface(entry->surface);
+
+		entry->surface = SDL_CreateRGBSurface(SDL_SWSURFACE | SDL_RLEACCEL | SDL_SRCCOLORKEY | SDL_SRCALPHA,
+						rW,
+						rH,
+						16,
+						_overlayscreen->format->Rmask,
+						_overlayscreen->format->Gmask,
+						_overlayscreen->format->Bmask,
+						_overlayscreen->format->Amask);
+
+		if (entry->surface == NULL)
+			error("allocating _mouseSurface failed");
+
+		SDL_SetColorKey(entry->surface, SDL_RLEACCEL | SDL_SRCCOLORKEY | SDL_SRCALPHA, kMouseColorKey);
+	}
+
+	if (!entry->data || entry->key.w * entry->key.h != w * h) {
+		free(entry->data);
+		entry->data = (byte *)malloc(w * h);
+	}
+	memcpy(entry->data, _mouseData, w * h);
+	entry->key = key;
+	entry->lastUsed = ++_cursorCacheClock;
+	_mouseSurface = entry->surface;
+
+	SDL_LockSurface(_mouseOrigSurface);
+
+	// Make whole surface transparent
+	for (i = 0; i < h + 2; i++) {
+		dstPtr = (byte *)_mouseOrigSurface->pixels + _mouseOrigSurface->pitch * i;
+		for (j = 0; j < w + 2; j++) {
+			*(uint16 *)dstPtr = kMouseColorKey;
+			dstPtr += 2;
+		}
+	}
+
+	// Draw from [1,1] since AdvMame2x adds artefact at 0,0
+	dstPtr = (byte *)_mouseOrigSurface->pixels + _mouseOrigSurface->pitch + 2;
+
+	SDL_Color *palette;
+
+	if (_cursorPaletteDisabled)
+		palette = _currentPalette;
+	else
+		palette = _cursorPalette;
+	
+	for (i = 0; i < h; i++) {
+		for (j = 0; j < w; j++) {
+			color = *srcPtr;
+			if (color != _mouseKeyColor) {	// transparent, don't draw
+				*(uint16 *)dstPtr = SDL_MapRGB(_mouseOrigSurface->format,
+					palette[color].r, palette[color].g, palette[color].b);
+			}
+			dstPtr += 2;
+			srcPtr++;
+		}
+		dstPtr += _mouseOrigSurface->pitch - w * 2;
+  	}
+
+	SDL_LockSurface(_mouseSurface);
+
 	scalerProc((byte *)_mouseOrigSurface->pixels + _mouseOrigSurface->pitch + 2,
 		_mouseOrigSurface->pitch, (byte *)_mouseSurface->pixels, _mouseSurface->pitch,
 		_mouseCurState.w, _mouseCurState.h);
@@ -1479,6 +1726,18 @@ void OSystem_SDL::blitCursor() {
 	SDL_UnlockSurface(_mouseOrigSurface);
 }
 
+void OSystem_SDL::clearCursorCache() {
+	for (int i = 0; i < kCursorCacheSize; i++) {
+		CachedCursor &c = _cursorCache[i];
+		if (c.surface)
+			SDL_FreeSurface(c.surface);
+		free(c.data);
+		c.surface = 0;
+		c.data = 0;
+	}
+	_mouseSurface = 0;
+}
+
 #ifndef DISABLE_SCALERS
 // Basically it is kVeryFastAndUglyAspectMode of stretch200To240 from
 // common/scale/aspect.cpp
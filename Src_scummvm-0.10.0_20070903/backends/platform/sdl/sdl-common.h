@@ -31,6 +31,7 @@
 #include "common/stdafx.h"
 #include "common/scummsys.h"
 #include "common/system.h"
+#include "common/thread.h"
 #include "graphics/scaler.h"
 #include "backends/intern.h"
 
@@ -44,6 +45,10 @@ namespace Common {
 	class TimerManager;
 }
 
+namespace Graphics {
+	class VideoCapture;
+}
+
 #if !defined(_WIN32_WCE) && !defined(__SYMBIAN32__)
 // Uncomment this to enable the 'on screen display' code.
 #define USE_OSD	1
@@ -127,6 +132,9 @@ public:
 	// Get the number of milliseconds since the program was started.
 	uint32 getMillis();
 
+	// Get the number of microseconds since the program was started.
+	virtual uint32 getMicros();
+
 	// Delay for a specified amount of milliseconds
 	void delayMillis(uint msecs);
 
@@ -163,6 +171,15 @@ public:
 	void unlockMutex(MutexRef mutex);
 	void deleteMutex(MutexRef mutex);
 
+	// Thread handling
+	ThreadRef createThread(ThreadProc proc, void *param);
+	void joinThread(ThreadRef thread);
+	uint getNumberOfCPUs();
+	SemaphoreRef createSemaphore(uint initialValue);
+	void postSemaphore(SemaphoreRef sem);
+	void waitSemaphore(SemaphoreRef sem);
+	void deleteSemaphore(SemaphoreRef sem);
+
 	// Overlay
 	virtual void showOverlay(); // WinCE FIXME
 	virtual void hideOverlay(); // WinCE FIXME
@@ -269,6 +286,21 @@ protected:
 	/** Force full redraw on next updateScreen */
 	bool _forceFull;
 	ScalerProc *_scalerProc;
+
+	/** Version of _scalerProc for 32 bit pixels, or 0 if there is none */
+	ScalerProc *_scalerProc32;
+
+	/**
+	 * True if the desktop uses 32 bit pixels, so that rendering straight
+	 * into a 32 bit _hwscreen saves SDL from converting every frame.
+	 */
+	bool _prefer32bpp;
+
+	/**
+	 * True if _hwscreen, _tmpscreen and _tmpscreen2 have 32 bit pixels. The
+	 * overlay, cursor and OSD surfaces always have 16 bit pixels.
+	 */
+	bool _use32bpp;
 	int _scalerType;
 	int _scaleFactor;
 	int _mode;
@@ -288,12 +320,55 @@ protected:
 		MAX_SCALING = 3
 	};
 
+	enum {
+		// Cost of handling one more dirty rect (blitting, calling the scaler
+		// and updating the screen), measured in scaled pixels
+		kDirtyRectOverhead = 256
+	};
+
 	// Dirty rect management
 	SDL_Rect _dirtyRectList[NUM_DIRTY_RECT];
 	int _numDirtyRects;
-	uint32 *_dirtyChecksums;
-	bool _cksumValid;
-	int _cksumNum;
+
+	// Dirty rect statistics, reported on the debug channel together with
+	// the scaler time
+	uint _dirtyRectsSubmitted, _dirtyRectsMerged, _dirtyRectsForcedFull;
+
+	// Copy of the last frame passed to addDirtyRgnAuto, which the next one is
+	// compared with
+	byte *_dirtyShadow;
+	bool _shadowValid;
+
+	// Recording of the game screen, toggled with Alt-v; 0 until first used
+	Graphics::VideoCapture *_videoCapture;
+
+	enum {
+		kMaxScalerThreads = 8,
+		kMaxScalerJobs = 2 * kMaxScalerThreads,
+		kMinScalerBandHeight = 16,	// Minimal height of a band, in source rows
+		kMinScalerBandPixels = 4096,	// Minimal number of source pixels in a band
+		kScalerStatsFrames = 100	// Number of frames the scaler time is averaged over
+	};
+
+	/** A horizontal band of a dirty rect, scaled by one of the scaler threads. */
+	struct ScalerJob {
+		ScalerProc *scalerProc;
+		const byte *src;
+		uint32 srcPitch;
+		byte *dst;
+		uint32 dstPitch;
+		int width, height;
+	};
+
+	// Scaler thread pool. The thread running internUpdateScreen always
+	// takes part in the work, so _numScalerThreads includes it.
+	Common::WorkerPool _scalerPool;
+	int _numScalerThreads;
+	ScalerJob _scalerJobs[kMaxScalerJobs];
+
+	// Scaler time statistics, reported on the debug channel
+	uint32 _scalerTime, _scalerMaxTime;
+	int _scalerFrames;
 
 	// Keyboard mouse emulation.  Disabled by fingolfin 2004-12-18.
 	// I am keeping the rest of the code in for now, since the joystick
@@ -340,10 +415,51 @@ protected:
 	bool _cursorPaletteDisabled;
 	SDL_Surface *_mouseOrigSurface;
 	SDL_Surface *_mouseSurface;
+	uint32 _mouseDataHash;
 	enum {
-		kMouseColorKey = 1
+		kMouseColorKey = 1,
+		kCursorCacheSize = 8		// Number of scaled cursors kept around
 	};
 
+	/** Everything the scaled image of a cursor depends on. */
+	struct CursorCacheKey {
+		uint32 hash;				// of the cursor bitmap
+		int w, h;
+		byte keyColor;
+		bool cursorPalette;			// false if the game palette is used
+		uint32 paletteVersion;
+		int scaleFactor;
+		int targetScale;
+		bool aspect;
+		ScalerProc *scalerProc;
+
+		bool operator==(const CursorCacheKey &k) const {
+			return hash == k.hash && w == k.w && h == k.h && keyColor == k.keyColor &&
+				cursorPalette == k.cursorPalette && paletteVersion == k.paletteVersion &&
+				scaleFactor == k.scaleFactor && targetScale == k.targetScale &&
+				aspect == k.aspect && scalerProc == k.scalerProc;
+		}
+	};
+
+	/**
+	 * A cursor scaled and aspect ratio corrected for the screen, so that
+	 * games which keep switching between a few cursors don't have to have
+	 * them scaled again every time. _mouseSurface is one of these surfaces.
+	 */
+	struct CachedCursor {
+		CursorCacheKey key;
+		byte *data;					// copy of the bitmap, to rule out hash collisions
+		SDL_Surface *surface;		// 0 if the entry is unused
+		uint32 lastUsed;
+	};
+	CachedCursor _cursorCache[kCursorCacheSize];
+	uint32 _cursorCacheClock;
+	uint _cursorCacheHits, _cursorCacheMisses;
+
+	// Incremented whenever the game or cursor palette changes, so that the
+	// cursor cache can tell whether a scaled cursor is still up to date
+	uint32 _paletteVersion, _cursorPaletteVersion;
+
 	// joystick
 	SDL_Joystick *_joystick;
 
@@ -374,13 +490,14 @@ protected:
 
 
 	void addDirtyRgnAuto(const byte *buf);
-	void makeChecksums(const byte *buf);
 
 	virtual void addDirtyRect(int x, int y, int w, int h, bool realCoordinates = false); // overloaded by CE backend
+	void removeDirtyRect(int index);
 
 	virtual void drawMouse(); // overloaded by CE backend
 	virtual void undrawMouse(); // overloaded by CE backend (FIXME)
 	virtual void blitCursor(); // overloaded by CE backend (FIXME)
+	void clearCursorCache();
  
 	/** Set the position of the virtual mouse cursor. */
 	void setMousePos(int x, int y);
@@ -389,6 +506,11 @@ protected:
 
 	virtual void internUpdateScreen(); // overloaded by CE backend
 
+	void initScalerThreads();
+	void deinitScalerThreads();
+	static void scalerJobProc(void *param, uint job);
+	void scaleRect(ScalerProc *scalerProc, const byte *src, uint32 srcPitch, byte *dst, uint32 dstPitch, int width, int height, int scale);
+
 	virtual void loadGFXMode(); // overloaded by CE backend
 	virtual void unloadGFXMode(); // overloaded by CE backend
 	virtual void hotswapGFXMode(); // overloaded by CE backend
@@ -397,6 +519,7 @@ protected:
 	void setAspectRatioCorrection(bool enable);
 
 	virtual bool saveScreenshot(const char *filename); // overloaded by CE backend
+	void toggleVideoCapture();
 
 	int effectiveScreenHeight() const {
 		return (_adjustAspectRatio ? real2Aspect(_screenHeight) : _screenHeight) 
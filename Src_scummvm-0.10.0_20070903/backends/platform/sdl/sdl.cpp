@@ -29,11 +29,18 @@
 #undef ARRAYSIZE
 #endif
 
+#if defined(UNIX)
+#include <unistd.h>	// for sysconf
+#include <sys/time.h>	// for gettimeofday
+#include <time.h>	// for clock_gettime
+#endif
+
 #include "backends/platform/sdl/sdl-common.h"
 #include "backends/plugins/sdl/sdl-provider.h"
 #include "common/config-manager.h"
 #include "common/util.h"
 #include "base/main.h"
+#include "graphics/videocapture.h"
 
 #include "backends/saves/default/default-saves.h"
 #include "backends/timer/default/default-timer.h"
@@ -151,23 +158,29 @@ void OSystem_SDL::initBackend() {
 	}
 
 	_graphicsMutex = createMutex();
+	initScalerThreads();
 
 	SDL_ShowCursor(SDL_DISABLE);
 
 	// Enable unicode support if possible
 	SDL_EnableUNICODE(1);
 
-	_cksumValid = false;
+	_shadowValid = false;
 #if !defined(_WIN32_WCE) && !defined(__SYMBIAN32__) && !defined(DISABLE_SCALERS)
 	_mode = GFX_DOUBLESIZE;
 	_scaleFactor = 2;
 	_scalerProc = Normal2x;
+	_scalerProc32 = Normal2x_32;
 	_fullscreen = ConfMan.getBool("fullscreen");
 	_adjustAspectRatio = ConfMan.getBool("aspect_ratio");
+
+	const SDL_VideoInfo *videoInfo = SDL_GetVideoInfo();
+	_prefer32bpp = ConfMan.getBool("output_32bpp") && videoInfo && videoInfo->vfmt->BitsPerPixel == 32;
 #else // for small screen platforms
 	_mode = GFX_NORMAL;
 	_scaleFactor = 1;
 	_scalerProc = Normal1x;
+	_scalerProc32 = Normal1x_32;
 
 #if !defined(_WIN32_WCE) && !defined(__SYMBIAN32__)
 	_fullscreen = ConfMan.getBool("fullscreen");
@@ -215,6 +228,7 @@ void OSystem_SDL::initBackend() {
 		// switched to SDL_AddTimer, each timer might run in a separate thread.
 		// Unfortunately, not all our code is prepared for that, so we can't just
 		// switch. But it's a long term goal to do just that!
+		getMicros();	// Latch the clock origin before the timer thread starts
 		_timer = new DefaultTimerManager();
 		_timerID = SDL_AddTimer(10, &timer_handler, _timer);
 	}
@@ -234,9 +248,13 @@ OSystem_SDL::OSystem_SDL()
 	_overlayVisible(false),
 	_overlayscreen(0), _tmpscreen2(0),
 	_samplesPerSec(0),
-	_cdrom(0), _scalerProc(0), _modeChanged(false), _screenChangeCount(0), _dirtyChecksums(0),
+	_cdrom(0), _scalerProc(0), _scalerProc32(0), _prefer32bpp(false), _use32bpp(false), _modeChanged(false), _screenChangeCount(0), _dirtyShadow(0),
+	_videoCapture(0),
+	_numScalerThreads(1),
 	_mouseVisible(false), _mouseDrawn(false), _mouseData(0), _mouseSurface(0),
 	_mouseOrigSurface(0), _cursorTargetScale(1), _cursorPaletteDisabled(true),
+	_mouseDataHash(0), _cursorCacheClock(0), _cursorCacheHits(0), _cursorCacheMisses(0),
+	_paletteVersion(0), _cursorPaletteVersion(0),
 	_joystick(0),
 	_currentShakePos(0), _newShakePos(0),
 	_paletteDirtyStart(0), _paletteDirtyEnd(0),
@@ -255,6 +273,11 @@ OSystem_SDL::OSystem_SDL()
 	memset(&_km, 0, sizeof(_km));
 	memset(&_mouseCurState, 0, sizeof(_mouseCurState));
 
+	for (int i = 0; i < kCursorCacheSize; i++) {
+		_cursorCache[i].data = 0;
+		_cursorCache[i].surface = 0;
+	}
+
 	_inited = false;
 }
 
@@ -262,7 +285,8 @@ OSystem_SDL::~OSystem_SDL() {
 	SDL_RemoveTimer(_timerID);
 	SDL_CloseAudio();
 
-	free(_dirtyChecksums);
+	delete _videoCapture;
+	free(_dirtyShadow);
 	free(_currentPalette);
 	free(_cursorPalette);
 	free(_mouseData);
@@ -276,6 +300,54 @@ uint32 OSystem_SDL::getMillis() {
 	return SDL_GetTicks();
 }
 
+uint32 OSystem_SDL::getMicros() {
+#if defined(WIN32) && !defined(_WIN32_WCE)
+	static LARGE_INTEGER freq, start;
+	LARGE_INTEGER now;
+	if (freq.QuadPart == 0) {
+		if (!QueryPerformanceFrequency(&freq) || freq.QuadPart == 0)
+			freq.QuadPart = -1;
+		else
+			QueryPerformanceCounter(&start);
+	}
+	if (freq.QuadPart < 0 || !QueryPerformanceCounter(&now))
+		return SDL_GetTicks() * 1000;
+	// Scale whole seconds and the remainder separately, so that
+	// high counter frequencies can't overflow the multiplication.
+	const LONGLONG ticks = now.QuadPart - start.QuadPart;
+	return (uint32)((ticks / freq.QuadPart) * 1000000 + (ticks % freq.QuadPart) * 1000000 / freq.QuadPart);
+#elif defined(UNIX)
+#if defined(_POSIX_MONOTONIC_CLOCK) && _POSIX_MONOTONIC_CLOCK >= 0
+	// The timer manager compares against getMicros() values, so prefer
+	// a clock which doesn't jump when the system time is changed.
+	static struct timespec monoStart;
+	static bool monoChecked = false, monoAvailable = false;
+	struct timespec monoNow;
+	if (!monoChecked) {
+		monoAvailable = (clock_gettime(CLOCK_MONOTONIC, &monoStart) == 0);
+		monoChecked = true;
+	}
+	if (monoAvailable && clock_gettime(CLOCK_MONOTONIC, &monoNow) == 0) {
+		long sec = monoNow.tv_sec - monoStart.tv_sec;
+		long nsec = monoNow.tv_nsec - monoStart.tv_nsec;
+		if (nsec < 0) {
+			--sec;
+			nsec += 1000000000;
+		}
+		return (uint32)sec * 1000000 + (uint32)(nsec / 1000);
+	}
+#endif
+	static struct timeval start;
+	struct timeval now;
+	gettimeofday(&now, 0);
+	if (start.tv_sec == 0 && start.tv_usec == 0)
+		start = now;
+	return (uint32)(now.tv_sec - start.tv_sec) * 1000000 + (uint32)(now.tv_usec - start.tv_usec);
+#else
+	return SDL_GetTicks() * 1000;
+#endif
+}
+
 void OSystem_SDL::delayMillis(uint msecs) {
 	SDL_Delay(msecs);
 }
@@ -346,7 +418,14 @@ void OSystem_SDL::quit() {
 		SDL_CDStop(_cdrom);
 		SDL_CDClose(_cdrom);
 	}
+
+	// Write out the frames which are still queued
+	delete _videoCapture;
+	_videoCapture = 0;
+
 	unloadGFXMode();
+	clearCursorCache();
+	deinitScalerThreads();
 	deleteMutex(_graphicsMutex);
 
 	if (_joystick)
@@ -418,6 +497,43 @@ void OSystem_SDL::deleteMutex(MutexRef mutex) {
 	SDL_DestroyMutex((SDL_mutex *) mutex);
 }
 
+OSystem::ThreadRef OSystem_SDL::createThread(ThreadProc proc, void *param) {
+	return (ThreadRef) SDL_CreateThread(proc, param);
+}
+
+void OSystem_SDL::joinThread(ThreadRef thread) {
+	SDL_WaitThread((SDL_Thread *) thread, NULL);
+}
+
+uint OSystem_SDL::getNumberOfCPUs() {
+#if defined(WIN32) && !defined(_WIN32_WCE)
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return MAX<uint>(info.dwNumberOfProcessors, 1);
+#elif defined(UNIX) && defined(_SC_NPROCESSORS_ONLN)
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	return (cpus > 0) ? (uint)cpus : 1;
+#else
+	return 1;
+#endif
+}
+
+OSystem::SemaphoreRef OSystem_SDL::createSemaphore(uint initialValue) {
+	return (SemaphoreRef) SDL_CreateSemaphore(initialValue);
+}
+
+void OSystem_SDL::postSemaphore(SemaphoreRef sem) {
+	SDL_SemPost((SDL_sem *) sem);
+}
+
+void OSystem_SDL::waitSemaphore(SemaphoreRef sem) {
+	SDL_SemWait((SDL_sem *) sem);
+}
+
+void OSystem_SDL::deleteSemaphore(SemaphoreRef sem) {
+	SDL_DestroySemaphore((SDL_sem *) sem);
+}
+
 #pragma mark -
 #pragma mark --- Audio ---
 #pragma mark -
@@ -1660,7 +1660,7 @@ void OSystem_WINCE3::copyRectToOverlay(const OverlayColor *buf, int pitch, int x
 		return; 
 
 	// Mark the modified region as dirty
-	_cksumValid = false;
+	_shadowValid = false;
 	addDirtyRect(x, y, w, h);
 
 	undrawMouse();
@@ -1718,7 +1718,7 @@ void OSystem_WINCE3::copyRectToScreen(const byte *src, int pitch, int x, int y,
 		if (w <= 0 || h <= 0)
 			return;
 
-		_cksumValid = false;
+		_shadowValid = false;
 		addDirtyRect(x, y, w, h);
 	}
 
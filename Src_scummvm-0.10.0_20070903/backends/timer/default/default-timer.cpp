@@ -34,99 +34,151 @@ struct TimerSlot {
 	void *refCon;
 	uint32 interval;	// in microseconds
 
-	uint32 nextFireTime;	// in milliseconds
-	uint32 nextFireTimeMicro;	// mircoseconds part of nextFire
-	
-	TimerSlot *next;
+	uint32 nextFireTime;	// in microseconds, see OSystem::getMicros()
+	uint32 sequence;	// insertion order, to break ties between equal fire times
+
+	TimerProcStats stats;
 };
 
-void insertPrioQueue(TimerSlot *head, TimerSlot *newSlot) {
-	// The head points to a fake anchor TimerSlot; this common
-	// trick allows us to get rid of many special cases.
-	
-	const uint32 nextFireTime = newSlot->nextFireTime;
-	TimerSlot *slot = head;
-	newSlot->next = 0;
+/*
+ * The installed timers are kept in a binary min-heap ordered by their next
+ * fire time, so that (re)scheduling a timer costs O(log n) instead of a walk
+ * over a sorted list. Fire times are wrapping 32 bit microsecond values, so
+ * they must only be compared via their difference; this is fine as long as
+ * no interval exceeds half the wrap-around period (about 35 minutes).
+ */
+
+bool DefaultTimerManager::firesBefore(const TimerSlot *a, const TimerSlot *b) const {
+	const int32 diff = (int32)(a->nextFireTime - b->nextFireTime);
+	if (diff != 0)
+		return diff < 0;
+	return (int32)(a->sequence - b->sequence) < 0;
+}
+
+void DefaultTimerManager::siftUp(uint pos) {
+	TimerSlot *slot = _heap[pos];
+	while (pos > 0) {
+		const uint parent = (pos - 1) / 2;
+		if (!firesBefore(slot, _heap[parent]))
+			break;
+		_heap[pos] = _heap[parent];
+		pos = parent;
+	}
+	_heap[pos] = slot;
+}
 
-	// Insert the new slot into the sorted list of already scheduled
-	// timers in such a way that the list stays sorted...
+void DefaultTimerManager::siftDown(uint pos) {
+	const uint size = _heap.size();
+	TimerSlot *slot = _heap[pos];
 	while (true) {
-		assert(slot);
-		if (slot->next == 0 || nextFireTime < slot->next->nextFireTime) {
-			newSlot->next = slot->next;
-			slot->next = newSlot;
-			return;
-		}
-		slot = slot->next;
+		uint child = 2 * pos + 1;
+		if (child >= size)
+			break;
+		if (child + 1 < size && firesBefore(_heap[child + 1], _heap[child]))
+			child++;
+		if (!firesBefore(_heap[child], slot))
+			break;
+		_heap[pos] = _heap[child];
+		pos = child;
 	}
+	_heap[pos] = slot;
+}
+
+void DefaultTimerManager::pushSlot(TimerSlot *slot) {
+	slot->sequence = _sequence++;
+	_heap.push_back(slot);
+	siftUp(_heap.size() - 1);
+}
+
+void DefaultTimerManager::printStats(const TimerSlot *slot) const {
+	const TimerProcStats &s = slot->stats;
+	debug(1, "Timer %p (%d us): %d calls, lateness avg %d us max %d us, %d missed periods, %d overruns, max duration %d us",
+		(void *)s.proc, s.interval, s.calls, s.avgLateness, s.maxLateness,
+		s.missedPeriods, s.overruns, s.maxDuration);
 }
 
 
 DefaultTimerManager::DefaultTimerManager() :
 	_timerHandler(0),
-	_head(0) {
-	
-	_head = new TimerSlot();
-	memset(_head, 0, sizeof(TimerSlot));
+	_sequence(0),
+	_currentSlot(0) {
 }
 
 DefaultTimerManager::~DefaultTimerManager() {
 	Common::StackLock lock(_mutex);
-	
-	TimerSlot *slot = _head;
-	while (slot) {
-		TimerSlot *next = slot->next;
-		delete slot;
-		slot = next;
+
+	for (uint i = 0; i < _heap.size(); i++) {
+		printStats(_heap[i]);
+		delete _heap[i];
 	}
-	_head = 0;
+	_heap.clear();
 }
 
 void DefaultTimerManager::handler() {
 	Common::StackLock lock(_mutex);
 
-	const uint32 curTime = g_system->getMillis();
-	
+	// Only fire timers which are due at this point; timers which become due
+	// while the callbacks run are left for the next call, so that a slow
+	// callback can't keep us in here forever.
+	const uint32 curTime = g_system->getMicros();
+	uint32 now = curTime;
+
 	// Repeat as long as there is a TimerSlot that is scheduled to fire.
-	TimerSlot *slot = _head->next;
-	while (slot && slot->nextFireTime < curTime) {
-		// Remove the slot from the priority queue
-		_head->next = slot->next;
-		
-		// Update the fire time and reinsert the TimerSlot into the priority
-		// queue. Has to be done before the timer callback is invoked, in case
-		// the callback wants to remove itself.
+	while (!_heap.empty() && (int32)(curTime - _heap[0]->nextFireTime) >= 0) {
+		TimerSlot *slot = _heap[0];
+		TimerProcStats &stats = slot->stats;
+
+		const uint32 lateness = now - slot->nextFireTime;
+		stats.calls++;
+		stats.avgLateness += (int32)(lateness - stats.avgLateness) / (int32)stats.calls;
+		if (lateness > stats.maxLateness)
+			stats.maxLateness = lateness;
+		if (lateness >= slot->interval)
+			stats.missedPeriods++;
+
+		// Update the fire time and move the TimerSlot to its new place in
+		// the heap. Has to be done before the timer callback is invoked, in
+		// case the callback wants to remove itself.
 		assert(slot->interval > 0);
-		slot->nextFireTime += (slot->interval / 1000);
-		slot->nextFireTimeMicro += (slot->interval % 1000);
-		if (slot->nextFireTimeMicro > 1000) {
-			slot->nextFireTime += slot->nextFireTimeMicro / 1000;
-			slot->nextFireTimeMicro %= 1000;
-		}
-		insertPrioQueue(_head, slot);
+		slot->nextFireTime += slot->interval;
+		slot->sequence = _sequence++;
+		siftDown(0);
 
 		// Invoke the timer callback
 		assert(slot->callback);
+		_currentSlot = slot;
 		slot->callback(slot->refCon);
-		
-		// Look at the next scheduled timer
-		slot = _head->next;
+
+		const uint32 endTime = g_system->getMicros();
+
+		// The callback may have removed its own timer, in which case
+		// removeTimerProc has reset _currentSlot.
+		if (_currentSlot == slot) {
+			const uint32 duration = endTime - now;
+			if (duration > stats.maxDuration)
+				stats.maxDuration = duration;
+			if (duration > slot->interval)
+				stats.overruns++;
+		}
+		_currentSlot = 0;
+		now = endTime;
 	}
 }
 
 bool DefaultTimerManager::installTimerProc(TimerProc callback, int32 interval, void *refCon) {
 	assert(interval > 0);
 	Common::StackLock lock(_mutex);
-	
+
 	TimerSlot *slot = new TimerSlot;
+	memset(slot, 0, sizeof(TimerSlot));
 	slot->callback = callback;
 	slot->refCon = refCon;
 	slot->interval = interval;
-	slot->nextFireTime = g_system->getMillis() + interval / 1000;
-	slot->nextFireTimeMicro = interval % 1000;
-	slot->next = 0;
-	
-	insertPrioQueue(_head, slot);
+	slot->nextFireTime = g_system->getMicros() + interval;
+	slot->stats.proc = callback;
+	slot->stats.interval = interval;
+
+	pushSlot(slot);
 
 	return true;
 }
@@ -134,15 +186,29 @@ bool DefaultTimerManager::installTimerProc(TimerProc callback, int32 interval, v
 void DefaultTimerManager::removeTimerProc(TimerProc callback) {
 	Common::StackLock lock(_mutex);
 
-	TimerSlot *slot = _head;
-	
-	while (slot->next) {
-		if (slot->next->callback == callback) {
-			TimerSlot *next = slot->next->next;
-			delete slot->next;
-			slot->next = next;
+	// Compact the remaining slots and rebuild the heap from scratch
+	uint size = 0;
+	for (uint i = 0; i < _heap.size(); i++) {
+		TimerSlot *slot = _heap[i];
+		if (slot->callback == callback) {
+			printStats(slot);
+			if (slot == _currentSlot)
+				_currentSlot = 0;
+			delete slot;
 		} else {
-			slot = slot->next;
+			_heap[size++] = slot;
 		}
 	}
+	while (_heap.size() > size)
+		_heap.remove_at(_heap.size() - 1);
+	for (uint i = size / 2; i > 0; i--)
+		siftDown(i - 1);
+}
+
+void DefaultTimerManager::getStats(Common::Array<TimerProcStats> &stats) {
+	Common::StackLock lock(_mutex);
+
+	stats.clear();
+	for (uint i = 0; i < _heap.size(); i++)
+		stats.push_back(_heap[i]->stats);
 }
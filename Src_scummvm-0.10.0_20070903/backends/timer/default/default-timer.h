@@ -27,17 +27,48 @@
 
 #include "common/timer.h"
 #include "common/mutex.h"
+#include "common/array.h"
 
 class OSystem;
 
 struct TimerSlot;
-	
+
+/**
+ * Timing statistics of one installed timer callback, as collected by
+ * DefaultTimerManager. All times are in microseconds.
+ */
+struct TimerProcStats {
+	Common::TimerManager::TimerProc proc;
+	uint32 interval;
+
+	uint32 calls;			// number of times the callback has been invoked
+	uint32 avgLateness;		// mean delay between deadline and actual invocation
+	uint32 maxLateness;		// largest such delay
+	uint32 missedPeriods;	// invocations that were at least one full interval late
+	uint32 overruns;		// invocations that took longer than the interval
+	uint32 maxDuration;		// longest time spent in the callback
+};
+
 class DefaultTimerManager : public Common::TimerManager {
 private:
 	Common::Mutex _mutex;
 	void *_timerHandler;
-	TimerSlot *_head;
-	
+
+	/** Binary min-heap of the installed timers, ordered by next deadline. */
+	Common::Array<TimerSlot *> _heap;
+
+	/** Running counter used to keep timers with equal deadlines in FIFO order. */
+	uint32 _sequence;
+
+	/** The slot whose callback is currently executing, if any. */
+	TimerSlot *_currentSlot;
+
+	bool firesBefore(const TimerSlot *a, const TimerSlot *b) const;
+	void siftUp(uint pos);
+	void siftDown(uint pos);
+	void pushSlot(TimerSlot *slot);
+
+	void printStats(const TimerSlot *slot) const;
 
 public:
 	DefaultTimerManager();
@@ -45,6 +76,13 @@ public:
 	bool installTimerProc(TimerProc proc, int32 interval, void *refCon);
 	void removeTimerProc(TimerProc proc);
 
+	/**
+	 * Returns the timing statistics of all currently installed timer
+	 * callbacks. The statistics of a callback are also printed (at debug
+	 * level 1) when it is removed.
+	 */
+	void getStats(Common::Array<TimerProcStats> &stats);
+
 	// Timer callback, to be invoked at regular time intervals by the backend.
 	void handler();
 };
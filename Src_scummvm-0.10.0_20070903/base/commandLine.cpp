@@ -50,6 +50,7 @@
 
 #ifdef DETECTOR_TESTING_HACK
 #include "common/fs.h"
+#include "common/md5cache.h"
 #endif
 
 namespace Base {
@@ -116,6 +117,8 @@ static const char HELP_STRING[] =
 	"  --aspect-ratio           Enable aspect ratio correction\n"
 	"  --render-mode=MODE       Enable additional render modes (cga, ega, hercGreen,\n"
 	"                           hercAmber, amiga)\n"
+	"  --rebuild-md5-cache      Discard the cached MD5 sums of game files and\n"
+	"                           recompute them during detection\n"
 	"\n"
 #if !defined(DISABLE_SKY) || !defined(DISABLE_QUEEN)
 	"  --alt-intro              Use alternative intro for CD versions of Beneath a\n"
@@ -160,6 +163,8 @@ void registerDefaults() {
 	ConfMan.registerDefault("aspect_ratio", false);
 	ConfMan.registerDefault("gfx_mode", "normal");
 	ConfMan.registerDefault("render_mode", "default");
+	ConfMan.registerDefault("scaler_threads", 0);	// 0 = one per CPU
+	ConfMan.registerDefault("output_32bpp", true);
 
 	// Sound & Music
 	ConfMan.registerDefault("music_volume", 192);
@@ -174,6 +179,11 @@ void registerDefaults() {
 	ConfMan.registerDefault("native_mt32", false);
 	ConfMan.registerDefault("enable_gs", false);
 	ConfMan.registerDefault("midi_gain", 100);
+	ConfMan.registerDefault("mt32_threads", 0);	// 0 = one per CPU
+	ConfMan.registerDefault("FM_block_render", true);
+	ConfMan.registerDefault("resampler", "linear");
+	ConfMan.registerDefault("audio_lookahead", 250);
+	ConfMan.registerDefault("sfx_cache_size", 2048);
 //	ConfMan.registerDefault("music_driver", ???);
 
 	ConfMan.registerDefault("cdrom", 0);
@@ -211,6 +221,7 @@ void registerDefaults() {
 	ConfMan.registerDefault("joystick_num", -1);
 	ConfMan.registerDefault("confirm_exit", false);
 	ConfMan.registerDefault("disable_sdl_parachute", false);
+	ConfMan.registerDefault("detection_threads", 0);	// 0 = one per CPU
 #ifdef USE_ALSA
 	ConfMan.registerDefault("alsa_port", "65:0");
 #endif
@@ -472,6 +483,9 @@ Common::String parseCommandLine(Common::StringMap &settings, int argc, char **ar
 			DO_LONG_OPTION("target-md5")
 			END_OPTION
 
+			DO_LONG_OPTION_BOOL("rebuild-md5-cache")
+			END_OPTION
+
 #ifndef DISABLE_SCUMM
 			DO_LONG_OPTION_INT("tempo")
 			END_OPTION
@@ -600,6 +614,8 @@ static void runDetectorTest() {
 				   Common::getPlatformCode(x->platform()));
 		}
 	}
+	MD5Man.flushToDisk();
+
 	int total = domains.size();
 	printf("Detector test run: %d fail, %d success, %d skipped, out of %d\n",
 			failure, success, total - failure - success, total);
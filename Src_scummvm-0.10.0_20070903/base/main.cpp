@@ -40,6 +40,7 @@
 #include "common/config-manager.h"
 #include "common/file.h"
 #include "common/fs.h"
+#include "common/md5cache.h"
 #include "common/system.h"
 #include "gui/newgui.h"
 #include "gui/message.h"
@@ -140,6 +141,8 @@ static int runGame(const Plugin *plugin, OSystem &system, const Common::String &
 	// Create the game engine
 	Engine *engine = 0;
 	PluginError err = plugin->createInstance(&system, &engine);
+	// Persist the MD5 sums the engine's detector computed
+	MD5Man.flushToDisk();
 	if (!engine || err != kNoError) {
 		// TODO: Show an error dialog or so?
 		// TODO: Also take 'err' into consideration...
@@ -251,6 +254,15 @@ extern "C" int scummvm_main(int argc, char *argv[]) {
 	// Update the config file
 	ConfMan.set("versioninfo", gScummVMVersion, Common::ConfigManager::kApplicationDomain);
 
+	// Load the MD5 sums cached by the game detectors, which are stored
+	// next to the config file.
+	MD5Man.loadCacheFile(ConfMan.getConfigFileName() + ".md5");
+	if (settings.contains("rebuild-md5-cache")) {
+		if (settings["rebuild-md5-cache"] == "true")
+			MD5Man.clear();
+		settings.erase("rebuild-md5-cache");	// This option should not be passed to ConfMan.
+	}
+
 
 	// Load and setup the debuglevel and the debug flags. We do this at the
 	// soonest possible moment to ensure debug output starts early on, if 
@@ -24,6 +24,10 @@
  */
 
 #include "base/plugins.h"
+#include "common/config-manager.h"
+#include "common/fs.h"
+#include "common/system.h"
+#include "common/thread.h"
 #include "common/util.h"
 
 
@@ -222,15 +226,61 @@ bool PluginManager::tryLoadPlugin(Plugin *plugin) {
 	}
 }
 
+/**
+ * State of a parallel PluginManager::detectGames run. Every job runs the
+ * detector of one plugin on the shared file list, and stores its findings
+ * in its own result slot.
+ */
+struct DetectionJobs {
+	const PluginList *plugins;
+	const FSList *fslist;
+	Common::Array<GameList> results;
+};
+
+static void detectGamesJob(void *param, uint job) {
+	DetectionJobs *jobs = (DetectionJobs *)param;
+	jobs->results[job] = (*jobs->plugins)[job]->detectGames(*jobs->fslist);
+}
+
 GameList PluginManager::detectGames(const FSList &fslist) const {
 	GameList candidates;
 
-	// Iterate over all known games and for each check if it might be
-	// the game in the presented directory.
-	PluginList::const_iterator iter;
-	for (iter = _plugins.begin(); iter != _plugins.end(); ++iter) {
-		candidates.push_back((*iter)->detectGames(fslist));
+	uint numThreads = MAX(ConfMan.getInt("detection_threads"), 0);
+	if (numThreads == 0)
+		numThreads = g_system->getNumberOfCPUs();
+#ifndef HAVE_ATOMIC_COUNTERS
+	// The detectors copy the nodes and names of the shared file list, whose
+	// reference counts are only thread safe with atomic counters
+	numThreads = 1;
+#endif
+
+	if (numThreads <= 1 || _plugins.size() <= 1) {
+		// Iterate over all known games and for each check if it might be
+		// the game in the presented directory.
+		PluginList::const_iterator iter;
+		for (iter = _plugins.begin(); iter != _plugins.end(); ++iter) {
+			candidates.push_back((*iter)->detectGames(fslist));
+		}
+
+		return candidates;
 	}
 
+	// Run the detectors of all plugins in parallel, all of them reading the
+	// same file list.
+	DetectionJobs jobs;
+	jobs.plugins = &_plugins;
+	jobs.fslist = &fslist;
+	for (uint job = 0; job < _plugins.size(); ++job)
+		jobs.results.push_back(GameList());
+
+	Common::WorkerPool pool;
+	pool.start(MIN<uint>(numThreads, _plugins.size()));
+	pool.run(detectGamesJob, &jobs, _plugins.size());
+
+	// Merge the results in plugin order, so that the candidates always
+	// come out in the same order as with serial detection.
+	for (uint job = 0; job < _plugins.size(); ++job)
+		candidates.push_back(jobs.results[job]);
+
 	return candidates;
 }
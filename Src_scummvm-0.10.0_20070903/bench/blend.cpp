@@ -0,0 +1,199 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+/*
+ * Blend benchmark: checks that the keyed 16 bit row kernels used by the
+ * modern theme produce exactly the same pixels as the per pixel code the
+ * theme used before, for 565 and 555 pixels, and compares their speed.
+ */
+
+#include "common/stdafx.h"
+#include "common/scummsys.h"
+#include "common/util.h"
+#include "graphics/blend.h"
+#include "graphics/colormasks.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <time.h>
+
+using namespace Graphics;
+
+// Replacements for the versions in common/util.cpp, which would pull in the
+// engine and GUI code.
+
+void CDECL error(const char *s, ...) {
+	va_list va;
+
+	va_start(va, s);
+	fprintf(stderr, "ERROR: ");
+	vfprintf(stderr, s, va);
+	fprintf(stderr, "!\n");
+	va_end(va);
+
+	exit(1);
+}
+
+void CDECL warning(const char *s, ...) {
+	va_list va;
+
+	va_start(va, s);
+	fprintf(stderr, "WARNING: ");
+	vfprintf(stderr, s, va);
+	fprintf(stderr, "!\n");
+	va_end(va);
+}
+
+// The per pixel blending of gui/ThemeModern.cpp
+
+template<class T>
+static uint16 getColorAlphaImpl(int16 col1, int16 col2, int alpha) {
+	int output = 0;
+	output |= ((alpha * ((col1 & T::kRedMask) - (col2 & T::kRedMask)) >> 8) + (col2 & T::kRedMask)) & T::kRedMask;
+	output |= ((alpha * ((col1 & T::kGreenMask) - (col2 & T::kGreenMask)) >> 8) + (col2 & T::kGreenMask)) & T::kGreenMask;
+	output |= ((alpha * ((col1 & T::kBlueMask) - (col2 & T::kBlueMask)) >> 8) + (col2 & T::kBlueMask)) & T::kBlueMask;
+	output |= ~(T::kRedMask | T::kGreenMask | T::kBlueMask);
+	return (uint16)output;
+}
+
+template<class T>
+static uint16 getColorAlphaImp2(int16 col1, int16 col2, int alpha) {
+	int output = 0;
+	output |= ((alpha * ((~col1 & T::kRedMask) - (col2 & T::kRedMask)) >> 8) + (col2 & T::kRedMask)) & T::kRedMask;
+	output |= ((alpha * ((~col1 & T::kGreenMask) - (col2 & T::kGreenMask)) >> 8) + (col2 & T::kGreenMask)) & T::kGreenMask;
+	output |= ((alpha * ((~col1 & T::kBlueMask) - (col2 & T::kBlueMask)) >> 8) + (col2 & T::kBlueMask)) & T::kBlueMask;
+	output |= ~(T::kRedMask | T::kGreenMask | T::kBlueMask);
+	return (uint16)output;
+}
+
+static uint16 getColorAlpha(int16 col1, int16 col2, int alpha, int bitFormat) {
+	if (alpha >= 0) {
+		if (bitFormat == 565)
+			return getColorAlphaImpl<ColorMasks<565> >(col1, col2, alpha);
+		else
+			return getColorAlphaImpl<ColorMasks<555> >(col1, col2, alpha);
+	} else {
+		if (bitFormat == 565)
+			return getColorAlphaImp2<ColorMasks<565> >(col1, col2, -alpha - 256);
+		else
+			return getColorAlphaImp2<ColorMasks<555> >(col1, col2, -alpha - 256);
+	}
+}
+
+static void referenceRow(uint16 *dst, const uint16 *src, int width, uint16 key, uint16 mask, int alpha, int bitFormat) {
+	for (int x = 0; x < width; x++) {
+		if (src[x] != key)
+			dst[x] = getColorAlpha((int16)(src[x] & mask), (int16)dst[x], alpha, bitFormat);
+	}
+}
+
+static uint32 _seed = 1;
+
+static uint16 randomPixel() {
+	_seed = _seed * 1103515245 + 12345;
+	return (uint16)(_seed >> 16);
+}
+
+static bool checkKernels() {
+	enum { kWidth = 1027 };	// deliberately not a multiple of the vector size
+	static const int alphas[] = { 0, 1, 8, 16, 32, 64, 96, 128, 192, 255, 256, -256 - 96, -256 - 255 };
+	static const int formats[] = { 565, 555 };
+	uint16 src[kWidth], dst1[kWidth], dst2[kWidth];
+
+	for (int f = 0; f < (int)ARRAYSIZE(formats); f++) {
+		for (int a = 0; a < (int)ARRAYSIZE(alphas); a++) {
+			const uint16 key = randomPixel();
+			const uint16 mask = randomPixel() | 0x8421;
+			for (int x = 0; x < kWidth; x++) {
+				src[x] = (x % 5) ? randomPixel() : key;
+				dst1[x] = dst2[x] = randomPixel();
+			}
+
+			referenceRow(dst1, src, kWidth, key, mask, alphas[a], formats[f]);
+			if (alphas[a] >= 0)
+				blendKeyedRow(dst2, src, kWidth, key, mask, alphas[a], false, formats[f]);
+			else
+				blendKeyedRow(dst2, src, kWidth, key, mask, -alphas[a] - 256, true, formats[f]);
+
+			if (memcmp(dst1, dst2, sizeof(dst1)) != 0) {
+				printf("Mismatch between per pixel and row blending (%d, alpha %d)\n", formats[f], alphas[a]);
+				return false;
+			}
+		}
+
+		// Copying
+		const uint16 key = randomPixel();
+		const uint16 mask = randomPixel();
+		for (int x = 0; x < kWidth; x++) {
+			src[x] = (x % 3) ? randomPixel() : key;
+			dst1[x] = dst2[x] = randomPixel();
+			if (src[x] != key)
+				dst1[x] = src[x] & mask;
+		}
+		copyKeyedRow(dst2, src, kWidth, key, mask);
+		if (memcmp(dst1, dst2, sizeof(dst1)) != 0) {
+			printf("Mismatch in keyed row copying\n");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static double elapsed(clock_t start) {
+	return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static void benchKernels() {
+	enum { kWidth = 960, kRepeats = 50000 };
+	uint16 src[kWidth], dst[kWidth];
+	const uint16 key = 0xF81F;
+
+	for (int x = 0; x < kWidth; x++) {
+		src[x] = randomPixel();
+		dst[x] = randomPixel();
+	}
+
+	clock_t start = clock();
+	for (int n = 0; n < kRepeats; n++)
+		referenceRow(dst, src, kWidth, key, 0xFFFF, 64 + (n & 63), 565);
+	const double scalar = elapsed(start);
+
+	start = clock();
+	for (int n = 0; n < kRepeats; n++)
+		blendKeyedRow(dst, src, kWidth, key, 0xFFFF, 64 + (n & 63), false, 565);
+	const double rows = elapsed(start);
+
+	printf("Blending %d rows of %d pixels: per pixel %.3f s, row kernel %.3f s (%.1fx)\n",
+		kRepeats, kWidth, scalar, rows, scalar / rows);
+}
+
+int main(int argc, char *argv[]) {
+	if (!checkKernels())
+		return 1;
+
+	benchKernels();
+	return 0;
+}
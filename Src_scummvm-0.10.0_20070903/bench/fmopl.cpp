@@ -0,0 +1,370 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+/*
+ * FM-OPL benchmark: plays the same pseudo-random AdLib music on two
+ * emulated YM3812 chips, one using the original rendering core and one the
+ * block core, checks that both produce exactly the same samples with each of
+ * the FMOPL_ENV_BITS_HQ/MQ/LQ quality levels, and reports how much CPU time
+ * each core needs per second of output of one chip. The same is done for
+ * OPL3 music on a YMF262, which also has to play AdLib music in OPL2 mode
+ * exactly like a YM3812 on both outputs. Finally, the memory used per chip
+ * is reported.
+ */
+
+#include "common/stdafx.h"
+#include "common/scummsys.h"
+#include "common/util.h"
+#include "sound/fmopl.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Replacements for the versions in common/util.cpp, which would pull in the
+// engine and GUI code. The config manager, which makeAdlibOPL uses, needs
+// debug() as well.
+
+void CDECL error(const char *s, ...) {
+	va_list va;
+
+	va_start(va, s);
+	fprintf(stderr, "ERROR: ");
+	vfprintf(stderr, s, va);
+	fprintf(stderr, "!\n");
+	va_end(va);
+
+	exit(1);
+}
+
+void CDECL warning(const char *s, ...) {
+	va_list va;
+
+	va_start(va, s);
+	fprintf(stderr, "WARNING: ");
+	vfprintf(stderr, s, va);
+	fprintf(stderr, "!\n");
+	va_end(va);
+}
+
+void CDECL debug(int level, const char *s, ...) {
+}
+
+enum {
+	kSampleRate = 44100,
+	kCheckSeconds = 30,
+	kBenchSeconds = 60,
+	kBenchRuns = 5
+};
+
+static uint32 _seed;
+
+static uint32 randomNumber(uint32 range) {
+	_seed = _seed * 1103515245 + 12345;
+	return (_seed >> 16) % range;
+}
+
+/* Register offsets of the two operators of each channel */
+static const int _operators[9] = { 0, 1, 2, 8, 9, 10, 16, 17, 18 };
+
+/**
+ * Channel registers of the first register array for channels 0-8, of the
+ * second one (OPL3 only) for channels 9-17.
+ */
+static void writeChannelReg(FM_OPL *opl, int channel, int reg, int value) {
+	OPLWriteReg(opl, (channel / 9) * 0x100 + reg, value);
+}
+
+static void setInstrument(FM_OPL *opl, int channel, bool opl3) {
+	for (int op = 0; op < 2; op++) {
+		const int slot = _operators[channel % 9] + op * 3;
+		writeChannelReg(opl, channel, 0x20 + slot, (int)randomNumber(256));
+		writeChannelReg(opl, channel, 0x40 + slot, (int)((randomNumber(4) << 6) | randomNumber(op ? 24 : 64)));
+		writeChannelReg(opl, channel, 0x60 + slot, (int)randomNumber(256));
+		writeChannelReg(opl, channel, 0x80 + slot, (int)randomNumber(256));
+		writeChannelReg(opl, channel, 0xE0 + slot, (int)randomNumber(opl3 ? 8 : 4));
+	}
+	// OPL3: mostly to both outputs
+	const int pan = opl3 ? (int)(randomNumber(4) ? 3 : randomNumber(4)) << 4 : 0;
+	writeChannelReg(opl, channel, 0xC0 + channel % 9, (int)randomNumber(16) | pan);
+}
+
+/**
+ * Writes a few pseudo-random registers, the way an AdLib music driver does:
+ * mostly notes, with the occasional instrument and volume change, changes to
+ * the rythm mode and the waveform select enable. OPL3 music uses all 18
+ * channels and changes the 4-op connections instead of the waveform select
+ * enable. Returns the number of samples to render before the next events.
+ */
+static int playEvents(FM_OPL *opl, bool opl3) {
+	const uint32 numEvents = randomNumber(4);
+	for (uint32 i = 0; i < numEvents; i++) {
+		const int channel = (int)randomNumber(opl3 ? 18 : 9);
+		switch (randomNumber(32)) {
+		case 0:
+		case 1:
+			setInstrument(opl, channel, opl3);
+			break;
+		case 2:
+			writeChannelReg(opl, channel, 0x40 + _operators[channel % 9] + 3, (int)randomNumber(64));
+			break;
+		case 3:
+			// Rythm mode on or off, drums and AM/VIB depth
+			OPLWriteReg(opl, 0xBD, (int)(randomNumber(4) ? randomNumber(256) & ~0x20 : randomNumber(256)));
+			break;
+		case 4:
+			if (opl3)
+				OPLWriteReg(opl, 0x104, (int)randomNumber(64));
+			else
+				OPLWriteReg(opl, 0x01, randomNumber(8) ? 0x20 : 0);
+			break;
+		case 5:
+		case 6:
+		case 7:
+		case 8:
+		case 9:
+		case 10:
+			writeChannelReg(opl, channel, 0xB0 + channel % 9, (int)randomNumber(32));
+			break;
+		default:
+			writeChannelReg(opl, channel, 0xA0 + channel % 9, (int)randomNumber(256));
+			writeChannelReg(opl, channel, 0xB0 + channel % 9, (int)(0x20 | randomNumber(32)));
+			break;
+		}
+	}
+
+	return randomNumber(4) == 0 ? 1 + (int)randomNumber(1200) : 3 + (int)randomNumber(600);
+}
+
+/**
+ * Creates a YM3812, or a YMF262 if type is OPL_TYPE_YMF262, and sets up
+ * the instruments of the music. OPL3 music switches the YMF262 to OPL3 mode.
+ */
+static FM_OPL *createChip(int envBits, int egEnt, int core, int type, bool opl3) {
+	OPLBuildTables(envBits, egEnt);
+	FM_OPL *opl = type == OPL_TYPE_YMF262 ? OPLCreate(type, 14318180, kSampleRate) : OPLCreate(type, 3579545, kSampleRate);
+	OPLSetCore(opl, core);
+
+	if (opl3)
+		OPLWriteReg(opl, 0x105, 1);
+	for (int channel = 0; channel < (opl3 ? 18 : 9); channel++)
+		setInstrument(opl, channel, opl3);
+	return opl;
+}
+
+/**
+ * Plays the music on the chip into buf, or into a small buffer over and
+ * over if buf is NULL. A YMF262 renders interleaved stereo samples.
+ * Returns the CPU time used.
+ */
+static double play(FM_OPL *opl, int16 *buf, int numSamples, uint32 seed, bool opl3) {
+	int16 chunk[2 * 1200];
+	const bool stereo = (opl->type & OPL_TYPE_OPL3) != 0;
+
+	_seed = seed;
+	OPLSetNoiseSeed(opl, seed);
+	const clock_t start = clock();
+	for (int samples = 0; samples < numSamples; ) {
+		const int len = MIN(playEvents(opl, opl3), numSamples - samples);
+		if (stereo)
+			YMF262UpdateOne(opl, buf ? buf + 2 * samples : chunk, len);
+		else
+			YM3812UpdateOne(opl, buf ? buf + samples : chunk, len);
+		samples += len;
+	}
+	return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+struct Quality {
+	const char *name;
+	int envBits;
+	int egEnt;
+};
+
+static const Quality _qualities[] = {
+	{ "HQ", FMOPL_ENV_BITS_HQ, FMOPL_EG_ENT_HQ },
+	{ "MQ", FMOPL_ENV_BITS_MQ, FMOPL_EG_ENT_MQ },
+	{ "LQ", FMOPL_ENV_BITS_LQ, FMOPL_EG_ENT_LQ }
+};
+
+static bool checkCores(const Quality &q) {
+	const int numSamples = kCheckSeconds * kSampleRate;
+	int16 *reference = new int16[numSamples];
+	int16 *buf = new int16[numSamples];
+	bool ok = true;
+
+	// The chips are created one after another, so that the tables are
+	// rebuilt for each quality level when the previous chip is destroyed
+	_seed = 1;
+	FM_OPL *opl = createChip(q.envBits, q.egEnt, FMOPL_CORE_SAMPLE, OPL_TYPE_YM3812, false);
+	play(opl, reference, numSamples, 2, false);
+	OPLDestroy(opl);
+
+	_seed = 1;
+	opl = createChip(q.envBits, q.egEnt, FMOPL_CORE_BLOCK, OPL_TYPE_YM3812, false);
+	play(opl, buf, numSamples, 2, false);
+	OPLDestroy(opl);
+
+	for (int i = 0; i < numSamples && ok; i++) {
+		if (reference[i] != buf[i]) {
+			printf("%s: mismatch between the sample and block cores after %d samples\n", q.name, i);
+			ok = false;
+		}
+	}
+
+	bool silent = true;
+	for (int i = 0; i < numSamples && silent; i++)
+		silent = reference[i] == 0;
+	if (silent) {
+		printf("%s: no output rendered\n", q.name);
+		ok = false;
+	}
+
+	delete[] buf;
+
+	// A YMF262 in OPL2 mode plays the same on both outputs
+	buf = new int16[2 * numSamples];
+	for (int core = FMOPL_CORE_SAMPLE; core <= FMOPL_CORE_BLOCK && ok; core++) {
+		_seed = 1;
+		opl = createChip(q.envBits, q.egEnt, core, OPL_TYPE_YMF262, false);
+		play(opl, buf, numSamples, 2, false);
+		OPLDestroy(opl);
+
+		for (int i = 0; i < numSamples && ok; i++) {
+			if (reference[i] != buf[2 * i] || reference[i] != buf[2 * i + 1]) {
+				printf("%s: the YMF262 in OPL2 mode differs from the YM3812 after %d samples\n", q.name, i);
+				ok = false;
+			}
+		}
+	}
+
+	delete[] reference;
+	delete[] buf;
+	return ok;
+}
+
+static bool checkOPL3Cores(const Quality &q) {
+	const int numSamples = kCheckSeconds * kSampleRate;
+	int16 *reference = new int16[2 * numSamples];
+	int16 *buf = new int16[2 * numSamples];
+	bool ok = true;
+
+	_seed = 1;
+	FM_OPL *opl = createChip(q.envBits, q.egEnt, FMOPL_CORE_SAMPLE, OPL_TYPE_YMF262, true);
+	play(opl, reference, numSamples, 2, true);
+	OPLDestroy(opl);
+
+	_seed = 1;
+	opl = createChip(q.envBits, q.egEnt, FMOPL_CORE_BLOCK, OPL_TYPE_YMF262, true);
+	play(opl, buf, numSamples, 2, true);
+	OPLDestroy(opl);
+
+	for (int i = 0; i < 2 * numSamples && ok; i++) {
+		if (reference[i] != buf[i]) {
+			printf("%s: mismatch between the OPL3 sample and block cores after %d samples\n", q.name, i / 2);
+			ok = false;
+		}
+	}
+
+	bool silent = true, mono = true;
+	for (int i = 0; i < numSamples; i++) {
+		silent = silent && reference[2 * i] == 0 && reference[2 * i + 1] == 0;
+		mono = mono && reference[2 * i] == reference[2 * i + 1];
+	}
+	if (silent || mono) {
+		printf("%s: no %s OPL3 output rendered\n", q.name, silent ? "" : "stereo");
+		ok = false;
+	}
+
+	delete[] reference;
+	delete[] buf;
+	return ok;
+}
+
+/**
+ * Returns the CPU time the core needs for kBenchSeconds of music, the best
+ * of a few runs, so that other processes don't skew the comparison.
+ */
+static double benchCore(const Quality &q, int core, int type, bool opl3) {
+	double best = 0;
+	for (int run = 0; run < kBenchRuns; run++) {
+		_seed = 1;
+		FM_OPL *opl = createChip(q.envBits, q.egEnt, core, type, opl3);
+		const double time = play(opl, NULL, kBenchSeconds * kSampleRate, 3, opl3);
+		OPLDestroy(opl);
+		if (run == 0 || time < best)
+			best = time;
+	}
+	return best;
+}
+
+/**
+ * Prints the memory used by each of numChips chips of the given type, and
+ * by the tables they share.
+ */
+static void printMemory(const Quality &q, const char *name, int type, int numChips) {
+	FM_OPL *opl[2];
+	int chipBytes, sharedBytes;
+
+	OPLBuildTables(q.envBits, q.egEnt);
+	for (int i = 0; i < numChips; i++)
+		opl[i] = type == OPL_TYPE_YMF262 ? OPLCreate(type, 14318180, kSampleRate) : OPLCreate(type, 3579545, kSampleRate);
+	OPLGetMemoryUsage(opl[0], &chipBytes, &sharedBytes);
+	for (int i = 0; i < numChips; i++)
+		OPLDestroy(opl[i]);
+
+	printf("%s, %d x %s: %d bytes per chip, %d bytes of shared tables, %d bytes in all\n",
+		q.name, numChips, name, chipBytes, sharedBytes, numChips * chipBytes + sharedBytes);
+}
+
+int main(int argc, char *argv[]) {
+	for (int i = 0; i < (int)ARRAYSIZE(_qualities); i++) {
+		if (!checkCores(_qualities[i]) || !checkOPL3Cores(_qualities[i]))
+			return 1;
+	}
+
+	for (int i = 0; i < (int)ARRAYSIZE(_qualities); i++) {
+		const double sample = benchCore(_qualities[i], FMOPL_CORE_SAMPLE, OPL_TYPE_YM3812, false);
+		const double block = benchCore(_qualities[i], FMOPL_CORE_BLOCK, OPL_TYPE_YM3812, false);
+		printf("%s, %d Hz: %.2f ms of CPU time per chip-second with the sample core, %.2f ms with the block core (%.1fx)\n",
+			_qualities[i].name, kSampleRate, sample * 1000 / kBenchSeconds, block * 1000 / kBenchSeconds, sample / block);
+	}
+
+	for (int i = 0; i < (int)ARRAYSIZE(_qualities); i++) {
+		const double sample = benchCore(_qualities[i], FMOPL_CORE_SAMPLE, OPL_TYPE_YMF262, true);
+		const double block = benchCore(_qualities[i], FMOPL_CORE_BLOCK, OPL_TYPE_YMF262, true);
+		printf("%s, %d Hz, YMF262 in OPL3 mode: %.2f ms of CPU time per chip-second with the sample core, %.2f ms with the block core (%.1fx)\n",
+			_qualities[i].name, kSampleRate, sample * 1000 / kBenchSeconds, block * 1000 / kBenchSeconds, sample / block);
+	}
+
+	for (int i = 0; i < (int)ARRAYSIZE(_qualities); i++) {
+		printMemory(_qualities[i], "YM3812", OPL_TYPE_YM3812, 1);
+		printMemory(_qualities[i], "YM3812", OPL_TYPE_YM3812, 2);
+		printMemory(_qualities[i], "YMF262", OPL_TYPE_YMF262, 1);
+	}
+	return 0;
+}
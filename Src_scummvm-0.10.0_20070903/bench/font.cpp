@@ -0,0 +1,233 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+/*
+ * Font benchmark: draws strings with the built-in fonts, checks that the
+ * glyph span and text run caches of Graphics::NewFont produce exactly the
+ * same pixels as drawing the glyph bitmaps bit by bit (also when the text
+ * is clipped by the surface or by the width passed to drawString), and
+ * compares the speed of both.
+ */
+
+#include "common/stdafx.h"
+#include "common/scummsys.h"
+#include "common/endian.h"
+#include "graphics/font.h"
+#include "graphics/surface.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <time.h>
+
+using namespace Graphics;
+
+// Replacements for the versions in common/util.cpp, which would pull in the
+// engine and GUI code. NewFont can load fonts from files, so debug() is
+// needed as well.
+
+void CDECL error(const char *s, ...) {
+	va_list va;
+
+	va_start(va, s);
+	fprintf(stderr, "ERROR: ");
+	vfprintf(stderr, s, va);
+	fprintf(stderr, "!\n");
+	va_end(va);
+
+	exit(1);
+}
+
+void CDECL warning(const char *s, ...) {
+	va_list va;
+
+	va_start(va, s);
+	fprintf(stderr, "WARNING: ");
+	vfprintf(stderr, s, va);
+	fprintf(stderr, "!\n");
+	va_end(va);
+}
+
+void CDECL debug(int level, const char *s, ...) {
+}
+
+namespace Graphics {
+extern const NewFont g_sysfont;
+extern const NewFont g_consolefont;
+}
+
+/**
+ * A copy of a font which draws its glyphs bit by bit, the way NewFont did
+ * before it had its caches. It has to be created before the original font
+ * is first drawn with, since it shares the cache pointer otherwise.
+ */
+class ReferenceFont : public NewFont {
+public:
+	ReferenceFont(const NewFont &original) : NewFont(original) {
+		assert(_cache == 0);
+	}
+
+	void drawChar(Surface *dst, byte chr, int tx, int ty, uint32 color) const {
+		if (chr < desc.firstchar || chr >= desc.firstchar + desc.size) {
+			chr = (byte)desc.defaultchar;
+		}
+
+		chr = (byte)(chr - desc.firstchar);
+
+		int bbw, bbh, bbx, bby;
+
+		if (!desc.bbx) {
+			bbw = desc.fbbw;
+			bbh = desc.fbbh;
+			bbx = desc.fbbx;
+			bby = desc.fbby;
+		} else {
+			bbw = desc.bbx[chr].w;
+			bbh = desc.bbx[chr].h;
+			bbx = desc.bbx[chr].x;
+			bby = desc.bbx[chr].y;
+		}
+
+		const bitmap_t *tmp = desc.bits + (desc.offset ? desc.offset[chr] : (chr * desc.fbbh));
+
+		for (int y = 0; y < bbh; y++) {
+			const bitmap_t buffer = READ_UINT16(tmp);
+			tmp++;
+			bitmap_t mask = 0x8000;
+			const int py = ty + desc.ascent - bby - bbh + y;
+			if (py < 0 || py >= dst->h)
+				continue;
+
+			for (int x = 0; x < bbw; x++, mask >>= 1) {
+				const int px = tx + bbx + x;
+				if (px < 0 || px >= dst->w)
+					continue;
+				if ((buffer & mask) != 0) {
+					byte *ptr = (byte *)dst->getBasePtr(px, py);
+					if (dst->bytesPerPixel == 1)
+						*ptr = (byte)color;
+					else
+						*(uint16 *)ptr = (uint16)color;
+				}
+			}
+		}
+	}
+
+	void drawUnclippedString(Surface *dst, const Common::String &str, int x, int y, uint32 color) const {
+		Font::drawUnclippedString(dst, str, x, y, color);
+	}
+};
+
+static const char *const _strings[] = {
+	"Load",
+	"Save",
+	"Options...",
+	"Return to Launcher",
+	"Add Game...",
+	"The quick brown fox jumps over the lazy dog",
+	"Monkey Island 2: LeChuck's Revenge (DOS/English)",
+	"ScummVM 0.10.0 (Sep  3 2007 12:00:00)",
+	"Features compiled in: Vorbis FLAC MP3 RGB zLib",
+	"\x01\x7f\xa0\xff control and high characters"
+};
+
+static bool compareFonts(const char *name, const NewFont &font, const ReferenceFont &reference) {
+	enum { kWidth = 200, kHeight = 40 };
+	bool ok = true;
+
+	for (int bpp = 1; bpp <= 2 && ok; bpp++) {
+		Surface s1, s2;
+		s1.create(kWidth, kHeight, (uint8)bpp);
+		s2.create(kWidth, kHeight, (uint8)bpp);
+
+		for (uint i = 0; i < ARRAYSIZE(_strings) && ok; i++) {
+			for (int pos = -12; pos < kWidth && ok; pos += 7) {
+				const int y = (pos / 7) % kHeight - 8;
+				const int w = (i & 1) ? kWidth : kWidth / 2;
+				const uint32 color = (uint32)(pos & 0xFF) * 0x101;
+
+				memset(s1.pixels, 0, kWidth * kHeight * bpp);
+				memset(s2.pixels, 0, kWidth * kHeight * bpp);
+
+				// Draw twice, so that the cached text run is used as well
+				for (int n = 0; n < 2; n++) {
+					font.drawString(&s1, _strings[i], pos, y, w, color, kTextAlignLeft, 0, false);
+					reference.drawString(&s2, _strings[i], pos, y, w, color, kTextAlignLeft, 0, false);
+				}
+				font.drawChar(&s1, _strings[i][0], kWidth - pos, kHeight - y - 8, color);
+				reference.drawChar(&s2, _strings[i][0], kWidth - pos, kHeight - y - 8, color);
+
+				if (memcmp(s1.pixels, s2.pixels, kWidth * kHeight * bpp) != 0) {
+					printf("Mismatch drawing \"%s\" with %s at %d,%d, %d bytes per pixel\n", _strings[i], name, pos, y, bpp);
+					ok = false;
+				}
+			}
+		}
+
+		s1.free();
+		s2.free();
+	}
+
+	return ok;
+}
+
+static double elapsed(clock_t start) {
+	return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static void benchFont(const char *name, const NewFont &font, const ReferenceFont &reference) {
+	enum { kRepeats = 20000 };
+	Surface s;
+	s.create(640, 400, 2);
+
+	clock_t start = clock();
+	for (int n = 0; n < kRepeats; n++)
+		for (uint i = 0; i < ARRAYSIZE(_strings); i++)
+			reference.drawString(&s, _strings[i], 10, (int)i * 20, 600, 0xFFFF);
+	const double bitwise = elapsed(start);
+
+	start = clock();
+	for (int n = 0; n < kRepeats; n++)
+		for (uint i = 0; i < ARRAYSIZE(_strings); i++)
+			font.drawString(&s, _strings[i], 10, (int)i * 20, 600, 0xFFFF);
+	const double cached = elapsed(start);
+
+	printf("%s: %d strings drawn bit by bit in %.3f s, from the text run cache in %.3f s (%.1fx)\n",
+		name, kRepeats * (int)ARRAYSIZE(_strings), bitwise, cached, bitwise / cached);
+
+	s.free();
+}
+
+int main(int argc, char *argv[]) {
+	const ReferenceFont sysfont(g_sysfont);
+	const ReferenceFont consolefont(g_consolefont);
+
+	if (!compareFonts("the GUI font", g_sysfont, sysfont) ||
+	    !compareFonts("the console font", g_consolefont, consolefont))
+		return 1;
+
+	benchFont("GUI font", g_sysfont, sysfont);
+	benchFont("Console font", g_consolefont, consolefont);
+	return 0;
+}
@@ -0,0 +1,207 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+/*
+ * Frame diff benchmark: compares how long it takes to find the dirty areas
+ * of 320x200 and 640x480 frames with Graphics::diffFrame, which compares
+ * against a shadow copy of the previous frame, and with the Adler32 block
+ * checksums the SDL backend used before. It also checks that the rects
+ * diffFrame reports cover every pixel which changed.
+ */
+
+#include "common/stdafx.h"
+#include "common/scummsys.h"
+#include "graphics/framediff.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <time.h>
+
+// Replacements for the versions in common/util.cpp, which would pull in the
+// engine and GUI code.
+
+void CDECL error(const char *s, ...) {
+	va_list va;
+
+	va_start(va, s);
+	fprintf(stderr, "ERROR: ");
+	vfprintf(stderr, s, va);
+	fprintf(stderr, "!\n");
+	va_end(va);
+
+	exit(1);
+}
+
+void CDECL warning(const char *s, ...) {
+	va_list va;
+
+	va_start(va, s);
+	fprintf(stderr, "WARNING: ");
+	vfprintf(stderr, s, va);
+	fprintf(stderr, "!\n");
+	va_end(va);
+}
+
+enum {
+	kFrames = 2000,
+	kNumSprites = 12,
+	kSpriteWidth = 24,
+	kSpriteHeight = 40
+};
+
+static uint32 _seed = 1;
+
+static uint32 randomNumber() {
+	_seed = _seed * 1103515245 + 12345;
+	return _seed >> 16;
+}
+
+static double elapsed(clock_t start) {
+	return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+/** The checksum based dirty area detection the SDL backend used to do. */
+static int checksumDiff(const byte *buf, uint32 *sums, int width, int height) {
+	const int numSums = (width / 8) * (height / 8);
+	uint32 *s = sums;
+	int dirty = 0;
+
+	for (int y = 0; y != height / 8; y++, buf += width * (8 - 1)) {
+		for (int x = 0; x != width / 8; x++, buf += 8) {
+			uint32 s1 = 1;
+			uint32 s2 = 0;
+			const byte *ptr = buf;
+			for (int subY = 0; subY < 8; subY++) {
+				for (int subX = 0; subX < 8; subX++) {
+					s1 += ptr[subX];
+					s2 += s1;
+				}
+				ptr += width;
+			}
+			*s++ = ((s2 % 65521) << 16) + (s1 % 65521);
+		}
+	}
+
+	for (int i = 0; i < numSums; i++) {
+		if (sums[i] != sums[i + numSums]) {
+			sums[i + numSums] = sums[i];
+			dirty++;
+		}
+	}
+	return dirty;
+}
+
+/** Draw some sprites at positions depending on the frame number. */
+static void drawFrame(byte *frame, const byte *background, int width, int height, int n, bool sprites) {
+	memcpy(frame, background, width * height);
+	if (!sprites)
+		return;
+
+	for (int i = 0; i < kNumSprites; i++) {
+		const int x = (i * 53 + n * (i % 3 + 1)) % (width - kSpriteWidth);
+		const int y = (i * 31 + n / 2) % (height - kSpriteHeight);
+		for (int j = 0; j < kSpriteHeight; j++)
+			memset(frame + (y + j) * width + x, 16 + i, kSpriteWidth);
+	}
+}
+
+static bool checkCoverage(const byte *frame, const byte *prev, int width, int height, const Common::Array<Common::Rect> &rects) {
+	for (int16 y = 0; y < height; y++) {
+		for (int16 x = 0; x < width; x++) {
+			if (frame[y * width + x] == prev[y * width + x])
+				continue;
+			bool covered = false;
+			for (uint i = 0; i < rects.size() && !covered; i++)
+				covered = rects[i].contains(x, y);
+			if (!covered) {
+				printf("Changed pixel (%d, %d) not covered by any rect\n", x, y);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+static bool benchResolution(int width, int height, bool sprites) {
+	byte *background = new byte[width * height];
+	byte *frame = new byte[width * height];
+	byte *shadow = new byte[width * height];
+	byte *prev = new byte[width * height];
+	uint32 *sums = new uint32[(width / 8) * (height / 8) * 2];
+
+	for (int i = 0; i < width * height; i++)
+		background[i] = (byte)(randomNumber() & 15);
+	memcpy(shadow, background, width * height);
+
+	// Check that the result is right for a few frames first
+	bool ok = true;
+	Common::Array<Common::Rect> rects;
+	for (int n = 0; n < 50 && ok; n++) {
+		memcpy(prev, shadow, width * height);
+		drawFrame(frame, background, width, height, n, sprites);
+		rects.clear();
+		Graphics::diffFrame(frame, shadow, width, height, rects);
+		ok = checkCoverage(frame, prev, width, height, rects) && memcmp(frame, shadow, width * height) == 0;
+	}
+
+	if (ok) {
+		uint numRects = 0;
+		clock_t start = clock();
+		for (int n = 0; n < kFrames; n++) {
+			drawFrame(frame, background, width, height, n, sprites);
+			rects.clear();
+			Graphics::diffFrame(frame, shadow, width, height, rects);
+			numRects += rects.size();
+		}
+		const double shadowTime = elapsed(start);
+
+		start = clock();
+		for (int n = 0; n < kFrames; n++) {
+			drawFrame(frame, background, width, height, n, sprites);
+			checksumDiff(frame, sums, width, height);
+		}
+		const double checksumTime = elapsed(start);
+
+		printf("%dx%d, %s: shadow diff %.1f us/frame (%.1f rects), checksums %.1f us/frame (%.1fx)\n",
+			width, height, sprites ? "moving sprites" : "static", shadowTime * 1000000 / kFrames,
+			(double)numRects / kFrames, checksumTime * 1000000 / kFrames, checksumTime / shadowTime);
+	}
+
+	delete[] background;
+	delete[] frame;
+	delete[] shadow;
+	delete[] prev;
+	delete[] sums;
+	return ok;
+}
+
+int main(int argc, char *argv[]) {
+	if (!benchResolution(320, 200, false) ||
+		!benchResolution(320, 200, true) ||
+		!benchResolution(640, 480, false) ||
+		!benchResolution(640, 480, true))
+		return 1;
+	return 0;
+}
@@ -0,0 +1,482 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+/*
+ * MIDI parser benchmark: plays pseudo-random SMF and XMIDI songs with two
+ * parsers in lockstep, one of them with the mpIndexEvents property set, and
+ * makes both jump around in the songs. Jumps must leave both parsers in the
+ * same state, so that they go on to send exactly the same events. Jumps that
+ * fire events must leave the driver with the same channel state, notes and
+ * SysEx/META events. Finally, it compares the speed of both kinds of jumps.
+ */
+
+#include "common/stdafx.h"
+#include "common/scummsys.h"
+#include "common/util.h"
+#include "sound/mididrv.h"
+#include "sound/midiparser.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Replacements for the versions in common/util.cpp, which would pull in the
+// engine and GUI code. Jumping around as often as this benchmark does soon
+// uses up the hanging note slots with smart jumps, so those warnings are
+// left out.
+
+void CDECL error(const char *s, ...) {
+	va_list va;
+
+	va_start(va, s);
+	fprintf(stderr, "ERROR: ");
+	vfprintf(stderr, s, va);
+	fprintf(stderr, "!\n");
+	va_end(va);
+
+	exit(1);
+}
+
+void CDECL warning(const char *s, ...) {
+	va_list va;
+
+	if (!strncmp(s, "MidiParser::hangingNote", 23))
+		return;
+
+	va_start(va, s);
+	fprintf(stderr, "WARNING: ");
+	vfprintf(stderr, s, va);
+	fprintf(stderr, "!\n");
+	va_end(va);
+}
+
+void CDECL debug(int level, const char *s, ...) {
+}
+
+enum {
+	kSongEvents = 40000,
+	kSongBufferSize = kSongEvents * 16 + 1024,
+	kCheckSteps = 5000,
+	kBenchJumps = 2000
+};
+
+static uint32 _seed;
+
+static uint32 rnd(uint32 range) {
+	_seed = _seed * 1103515245 + 12345;
+	return ((_seed >> 8) & 0xFFFFFF) % range;
+}
+
+// Controllers whose value is all that matters after a jump, like in
+// MidiParser. Everything else has to arrive in the same order.
+static bool isStateController(byte controller) {
+	return !(controller == 0 || controller == 6 || controller == 32 || controller == 38 ||
+	         (controller >= 96 && controller <= 101) || controller >= 110);
+}
+
+static const byte _controllers[] = { 0, 1, 6, 7, 10, 11, 32, 38, 64, 91, 93, 100, 101, 116, 121, 123 };
+
+/**
+ * Keeps a checksum of everything sent to it, and the state of the channels
+ * and notes on top of that.
+ */
+class RecordingDriver : public MidiDriver {
+public:
+	uint32 _events;     // Checksum of all events, in order
+	uint32 _fixed;      // Checksum of the events that aren't channel state, in order
+	uint16 _notes[128];
+	byte _program[16];
+	byte _pressure[16];
+	uint16 _bend[16];
+	byte _controller[16][128];
+	bool _check;        // Whether to update the checksums and state at all
+
+	RecordingDriver() : _events(0), _fixed(0), _check(true) {
+		memset(_notes, 0, sizeof(_notes));
+		memset(_program, 0, sizeof(_program));
+		memset(_pressure, 0, sizeof(_pressure));
+		memset(_bend, 0, sizeof(_bend));
+		memset(_controller, 0, sizeof(_controller));
+	}
+
+	bool sameState(const RecordingDriver &other) const {
+		return _fixed == other._fixed &&
+			!memcmp(_notes, other._notes, sizeof(_notes)) &&
+			!memcmp(_program, other._program, sizeof(_program)) &&
+			!memcmp(_pressure, other._pressure, sizeof(_pressure)) &&
+			!memcmp(_bend, other._bend, sizeof(_bend)) &&
+			!memcmp(_controller, other._controller, sizeof(_controller));
+	}
+
+	int open() { return 0; }
+	void close() { }
+
+	void send(uint32 b) {
+		if (!_check)
+			return;
+
+		const byte channel = (byte)(b & 0x0F);
+		const byte param1 = (byte)((b >> 8) & 0x7F);
+		const byte param2 = (byte)((b >> 16) & 0x7F);
+
+		record(_events, b);
+		switch ((b >> 4) & 0x0F) {
+		case 0x8:
+			_notes[param1] &= (uint16)~(1 << channel);
+			break;
+		case 0x9:
+			if (param2)
+				_notes[param1] |= (1 << channel);
+			else
+				_notes[param1] &= (uint16)~(1 << channel);
+			break;
+		case 0xB:
+			if (isStateController(param1))
+				_controller[channel][param1] = param2;
+			else
+				record(_fixed, b);
+			break;
+		case 0xC:
+			_program[channel] = param1;
+			break;
+		case 0xD:
+			_pressure[channel] = param1;
+			break;
+		case 0xE:
+			_bend[channel] = (uint16)(param2 << 7 | param1);
+			break;
+		default:
+			record(_fixed, b);
+		}
+	}
+
+	void sysEx(const byte *msg, uint16 length) {
+		if (!_check)
+			return;
+		for (uint16 i = 0; i < length; ++i) {
+			record(_events, msg[i]);
+			record(_fixed, msg[i]);
+		}
+		record(_events, 0xF0);
+		record(_fixed, 0xF0);
+	}
+
+	void metaEvent(byte type, byte *data, uint16 length) {
+		if (!_check)
+			return;
+		for (uint16 i = 0; i < length; ++i) {
+			record(_events, data[i]);
+			record(_fixed, data[i]);
+		}
+		record(_events, 0xFF00 | type);
+		record(_fixed, 0xFF00 | type);
+	}
+
+	void setTimerCallback(void *timer_param, Common::TimerManager::TimerProc timer_proc) { }
+	uint32 getBaseTempo() { return 4000; }
+	MidiChannel *allocateChannel() { return 0; }
+	MidiChannel *getPercussionChannel() { return 0; }
+
+private:
+	static void record(uint32 &sum, uint32 value) {
+		sum = (sum ^ value) * 16777619;
+	}
+};
+
+static byte *writeVLQ(byte *pos, uint32 value) {
+	byte buf[4];
+	int count = 0;
+
+	do {
+		buf[count++] = (byte)(value & 0x7F);
+		value >>= 7;
+	} while (value);
+	while (count > 1)
+		*pos++ = buf[--count] | 0x80;
+	*pos++ = buf[0];
+	return pos;
+}
+
+static void writeBE32(byte *pos, uint32 value) {
+	pos[0] = (byte)(value >> 24);
+	pos[1] = (byte)(value >> 16);
+	pos[2] = (byte)(value >> 8);
+	pos[3] = (byte)value;
+}
+
+/**
+ * Writes the events of a pseudo-random song, either as an SMF track with
+ * running status, or as an XMIDI track, where Note On events carry the
+ * length of the note. Returns the end of the track, and the length of the
+ * song in ticks in \a ticks.
+ */
+static byte *writeTrack(byte *pos, bool xmidi, uint32 &ticks) {
+	uint16 sounding[8]; // Channel and note of up to 8 notes that are on
+	byte status = 0;
+
+	memset(sounding, 0xFF, sizeof(sounding));
+	ticks = 0;
+
+	for (int n = 0; n < kSongEvents; ++n) {
+		const uint32 delta = rnd(3) ? 0 : rnd(200);
+		const byte channel = (byte)rnd(16);
+		const uint32 kind = rnd(100);
+		byte event, param1, param2 = 0;
+		bool twoParams = true;
+
+		ticks += delta;
+		if (xmidi) {
+			uint32 left = delta;
+			for (; left > 127; left -= 127)
+				*pos++ = 127;
+			if (left)
+				*pos++ = (byte)left;
+		} else {
+			pos = writeVLQ(pos, delta);
+		}
+
+		if (kind < 55) {
+			const uint32 slot = rnd(ARRAYSIZE(sounding));
+			param1 = (byte)(36 + rnd(24));
+			if (xmidi) {
+				event = 0x90 | channel;
+				param2 = (byte)(rnd(20) ? 1 + rnd(127) : 0);
+			} else if (sounding[slot] != 0xFFFF) {
+				// Note Off, or Note On with velocity 0
+				event = (byte)((rnd(2) ? 0x80 : 0x90) | (sounding[slot] >> 8));
+				param1 = (byte)sounding[slot];
+				param2 = (event & 0x10) ? 0 : (byte)rnd(128);
+				sounding[slot] = 0xFFFF;
+			} else {
+				event = 0x90 | channel;
+				param2 = (byte)(1 + rnd(127));
+				sounding[slot] = (uint16)(channel << 8 | param1);
+			}
+		} else if (kind < 75) {
+			event = 0xB0 | channel;
+			param1 = _controllers[rnd(ARRAYSIZE(_controllers))];
+			param2 = (byte)rnd(128);
+		} else if (kind < 80) {
+			event = 0xC0 | channel;
+			param1 = (byte)rnd(128);
+			twoParams = false;
+		} else if (kind < 84) {
+			event = 0xD0 | channel;
+			param1 = (byte)rnd(128);
+			twoParams = false;
+		} else if (kind < 92) {
+			event = 0xE0 | channel;
+			param1 = (byte)rnd(128);
+			param2 = (byte)rnd(128);
+		} else if (kind < 93) {
+			event = 0xA0 | channel;
+			param1 = (byte)rnd(128);
+			param2 = (byte)rnd(128);
+		} else {
+			// SysEx, tempo and text events
+			status = 0;
+			if (kind < 96) {
+				const uint32 length = 2 + rnd(8);
+				*pos++ = 0xF0;
+				pos = writeVLQ(pos, length);
+				for (uint32 i = 0; i < length - 1; ++i)
+					*pos++ = (byte)rnd(128);
+				*pos++ = 0xF7;
+			} else if (kind < 98) {
+				const uint32 tempo = 250000 + rnd(750000);
+				*pos++ = 0xFF;
+				*pos++ = 0x51;
+				*pos++ = 3;
+				*pos++ = (byte)(tempo >> 16);
+				*pos++ = (byte)(tempo >> 8);
+				*pos++ = (byte)tempo;
+			} else {
+				const uint32 length = rnd(12);
+				*pos++ = 0xFF;
+				*pos++ = 0x01;
+				pos = writeVLQ(pos, length);
+				for (uint32 i = 0; i < length; ++i)
+					*pos++ = (byte)('a' + rnd(26));
+			}
+			continue;
+		}
+
+		if (xmidi || event != status || rnd(2))
+			*pos++ = event;
+		status = event;
+		*pos++ = param1;
+		if (twoParams)
+			*pos++ = param2;
+		if (xmidi && (event & 0xF0) == 0x90)
+			pos = writeVLQ(pos, 1 + rnd(150));
+	}
+
+	if (!xmidi)
+		*pos++ = 0;
+	*pos++ = 0xFF;
+	*pos++ = 0x2F;
+	*pos++ = 0;
+	return pos;
+}
+
+static uint32 makeSMF(byte *buf, uint32 &ticks) {
+	static const byte header[] = {
+		'M', 'T', 'h', 'd', 0, 0, 0, 6, 0, 0, 0, 1, 0, 96,
+		'M', 'T', 'r', 'k', 0, 0, 0, 0
+	};
+
+	memcpy(buf, header, sizeof(header));
+	byte *end = writeTrack(buf + sizeof(header), false, ticks);
+	writeBE32(buf + sizeof(header) - 4, (uint32)(end - buf - sizeof(header)));
+	return (uint32)(end - buf);
+}
+
+static uint32 makeXMIDI(byte *buf, uint32 &ticks) {
+	static const byte header[] = {
+		'F', 'O', 'R', 'M', 0, 0, 0, 14, 'X', 'D', 'I', 'R',
+		'I', 'N', 'F', 'O', 0, 0, 0, 2, 1, 0,
+		'C', 'A', 'T', ' ', 0, 0, 0, 0, 'X', 'M', 'I', 'D',
+		'F', 'O', 'R', 'M', 0, 0, 0, 0, 'X', 'M', 'I', 'D',
+		'E', 'V', 'N', 'T', 0, 0, 0, 0
+	};
+
+	memcpy(buf, header, sizeof(header));
+	byte *end = writeTrack(buf + sizeof(header), true, ticks);
+	const uint32 length = (uint32)(end - buf - sizeof(header));
+	writeBE32(buf + sizeof(header) - 4, length);
+	writeBE32(buf + sizeof(header) - 16, length + 12);
+	writeBE32(buf + sizeof(header) - 28, length + 24);
+	if (length & 1)
+		*end++ = 0;
+	return (uint32)(end - buf);
+}
+
+static MidiParser *createParser(bool xmidi, RecordingDriver *driver, bool index, bool smartJump, byte *data, uint32 size) {
+	MidiParser *parser = xmidi ? MidiParser::createParser_XMIDI() : MidiParser::createParser_SMF();
+	parser->setMidiDriver(driver);
+	parser->setTimerRate(driver->getBaseTempo());
+	parser->property(MidiParser::mpSmartJump, smartJump);
+	parser->property(MidiParser::mpIndexEvents, index);
+	if (!parser->loadMusic(data, size))
+		error("Failed to load the %s song", xmidi ? "XMIDI" : "SMF");
+	return parser;
+}
+
+static bool compareJumps(const char *name, bool xmidi, bool smartJump, byte *data, uint32 size, uint32 ticks) {
+	RecordingDriver linearDriver, indexedDriver;
+	MidiParser *linear = createParser(xmidi, &linearDriver, false, smartJump, data, size);
+	MidiParser *indexed = createParser(xmidi, &indexedDriver, true, smartJump, data, size);
+	bool ok = true;
+
+	for (int step = 0; step < kCheckSteps && ok; ++step) {
+		const uint32 op = rnd(10);
+
+		if (op < 6) {
+			for (uint32 n = rnd(50); n; --n) {
+				linear->onTimer();
+				indexed->onTimer();
+			}
+		} else {
+			const uint32 tick = rnd(ticks + ticks / 16 + 1);
+			const bool fire = (op == 9);
+			const bool linearResult = linear->jumpToTick(tick, fire);
+			const bool indexedResult = indexed->jumpToTick(tick, fire);
+
+			if (linearResult != indexedResult) {
+				printf("%s: jump to tick %d returned %d without and %d with the index\n", name, tick, linearResult, indexedResult);
+				ok = false;
+			}
+			if (fire) {
+				if (!linearDriver.sameState(indexedDriver)) {
+					printf("%s: jump to tick %d left the driver in a different state with the index\n", name, tick);
+					ok = false;
+				}
+				indexedDriver._events = linearDriver._events;
+			}
+		}
+
+		if (linearDriver._events != indexedDriver._events || linear->getTick() != indexed->getTick()) {
+			printf("%s: parsers went out of sync after step %d\n", name, step);
+			ok = false;
+		}
+	}
+
+	delete linear;
+	delete indexed;
+	return ok;
+}
+
+static double elapsed(clock_t start) {
+	return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static void benchJumps(const char *name, bool xmidi, byte *data, uint32 size, uint32 ticks) {
+	RecordingDriver driver;
+	driver._check = false;
+	double seconds[2][2];
+
+	for (int index = 0; index < 2; ++index) {
+		MidiParser *parser = createParser(xmidi, &driver, index != 0, false, data, size);
+		parser->jumpToTick(1);
+
+		for (int fire = 0; fire < 2; ++fire) {
+			_seed = 1;
+			clock_t start = clock();
+			for (int n = 0; n < kBenchJumps; ++n)
+				parser->jumpToTick(1 + rnd(ticks), fire != 0);
+			seconds[index][fire] = elapsed(start);
+		}
+		delete parser;
+	}
+
+	printf("%s: %d jumps by parsing in %.3f s, with the index in %.3f s (%.0fx); firing events %.3f s, %.3f s (%.0fx)\n",
+		name, kBenchJumps, seconds[0][0], seconds[1][0], seconds[0][0] / seconds[1][0],
+		seconds[0][1], seconds[1][1], seconds[0][1] / seconds[1][1]);
+}
+
+int main(int argc, char *argv[]) {
+	byte *smf = (byte *)malloc(kSongBufferSize);
+	byte *xmidi = (byte *)malloc(kSongBufferSize);
+	uint32 smfTicks, xmidiTicks;
+
+	_seed = 1;
+	const uint32 smfSize = makeSMF(smf, smfTicks);
+	const uint32 xmidiSize = makeXMIDI(xmidi, xmidiTicks);
+
+	if (!compareJumps("SMF", false, false, smf, smfSize, smfTicks) ||
+	    !compareJumps("SMF with smart jumps", false, true, smf, smfSize, smfTicks) ||
+	    !compareJumps("XMIDI", true, false, xmidi, xmidiSize, xmidiTicks) ||
+	    !compareJumps("XMIDI with smart jumps", true, true, xmidi, xmidiSize, xmidiTicks))
+		return 1;
+
+	benchJumps("SMF", false, smf, smfSize, smfTicks);
+	benchJumps("XMIDI", true, xmidi, xmidiSize, xmidiTicks);
+
+	free(smf);
+	free(xmidi);
+	return 0;
+}
@@ -0,0 +1,308 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+/*
+ * Mixer benchmark: mixes 16 channels with various sample rates, channel
+ * layouts and volumes through the rate converters, the same way
+ * Audio::Mixer::mix does, and reports how much faster than realtime this
+ * runs for an output rate of 44.1 and 48 kHz, with both the linear and the
+ * windowed sinc rate converters. It also checks that the vectorized mixing
+ * kernels produce exactly the same output as the scalar reference code, and
+ * compares their speed.
+ */
+
+#include "common/stdafx.h"
+#include "common/scummsys.h"
+#include "sound/audiostream.h"
+#include "sound/mixer.h"
+#include "sound/rate.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <time.h>
+
+using namespace Audio;
+
+// Replacements for the versions in common/util.cpp, which would pull in the
+// engine and GUI code.
+
+void CDECL error(const char *s, ...) {
+	va_list va;
+
+	va_start(va, s);
+	fprintf(stderr, "ERROR: ");
+	vfprintf(stderr, s, va);
+	fprintf(stderr, "!\n");
+	va_end(va);
+
+	exit(1);
+}
+
+void CDECL warning(const char *s, ...) {
+	va_list va;
+
+	va_start(va, s);
+	fprintf(stderr, "WARNING: ");
+	vfprintf(stderr, s, va);
+	fprintf(stderr, "!\n");
+	va_end(va);
+}
+
+// The rate converters only use the OSystem to lock their filter banks once
+// the Mixer has set up the lock, which this benchmark never does.
+OSystem *g_system = 0;
+
+enum {
+	kNumChannels = 16,
+	kSecondsPerRun = 60,
+	kFramesPerCallback = 1024
+};
+
+static uint32 _seed = 1;
+
+static int16 randomSample() {
+	_seed = _seed * 1103515245 + 12345;
+	return (int16)(_seed >> 16);
+}
+
+enum {
+	kNoiseSize = 65536
+};
+
+static int16 _noise[kNoiseSize];
+
+/**
+ * An endless stream of noise, read from a pregenerated table so that the
+ * benchmark measures the mixing and not the noise generation.
+ */
+class NoiseStream : public Audio::AudioStream {
+	int _rate;
+	bool _stereo;
+	int _pos;
+public:
+	NoiseStream(int rate, bool stereo) : _rate(rate), _stereo(stereo), _pos(0) {}
+
+	int readBuffer(int16 *buffer, const int numSamples) {
+		int samples = numSamples;
+		while (samples > 0) {
+			const int len = MIN(samples, kNoiseSize - _pos);
+			memcpy(buffer, _noise + _pos, len * sizeof(int16));
+			buffer += len;
+			samples -= len;
+			_pos = (_pos + len) % kNoiseSize;
+		}
+		return numSamples;
+	}
+	bool isStereo() const { return _stereo; }
+	bool endOfData() const { return false; }
+	int getRate() const { return _rate; }
+};
+
+/**
+ * A short stream of constant samples.
+ */
+class ConstantStream : public Audio::AudioStream {
+	int _rate;
+	int _left;
+public:
+	ConstantStream(int rate, int numSamples) : _rate(rate), _left(numSamples) {}
+
+	int readBuffer(int16 *buffer, const int numSamples) {
+		const int len = MIN(numSamples, _left);
+		for (int i = 0; i < len; i++)
+			buffer[i] = 16384;
+		_left -= len;
+		return len;
+	}
+	bool isStereo() const { return false; }
+	bool endOfData() const { return _left == 0; }
+	int getRate() const { return _rate; }
+};
+
+static double elapsed(clock_t start) {
+	return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static void benchMixing(st_rate_t outputRate, RateConverterType type) {
+	static const st_rate_t rates[] = { 11025, 22050, 44100, 48000 };
+
+	NoiseStream *streams[kNumChannels];
+	RateConverter *converters[kNumChannels];
+	st_volume_t volumes[kNumChannels][2];
+
+	setRateConverterType(type);
+	for (int i = 0; i < kNumChannels; i++) {
+		const bool stereo = (i % 3) == 0;
+		streams[i] = new NoiseStream(rates[i % ARRAYSIZE(rates)], stereo);
+		converters[i] = makeRateConverter(streams[i]->getRate(), outputRate, stereo, stereo && (i & 4));
+		volumes[i][0] = (st_volume_t)(Mixer::kMaxMixerVolume - i * 7);
+		volumes[i][1] = (st_volume_t)(Mixer::kMaxMixerVolume - i * 11);
+	}
+
+	int16 *buf = new int16[kFramesPerCallback * 2];
+	const int callbacks = kSecondsPerRun * outputRate / kFramesPerCallback;
+
+	const clock_t start = clock();
+	for (int n = 0; n < callbacks; n++) {
+		memset(buf, 0, kFramesPerCallback * 2 * sizeof(int16));
+		for (int i = 0; i < kNumChannels; i++)
+			converters[i]->flow(*streams[i], buf, kFramesPerCallback, volumes[i][0], volumes[i][1]);
+	}
+	const double secs = elapsed(start);
+
+	printf("%d channels at %d Hz, %s: %d s of audio mixed in %.3f s (%.1fx realtime)\n",
+		kNumChannels, outputRate, (type == kSincRateConverter) ? "sinc" : "linear",
+		kSecondsPerRun, secs, kSecondsPerRun / secs);
+
+	delete[] buf;
+	for (int i = 0; i < kNumChannels; i++) {
+		delete converters[i];
+		delete streams[i];
+	}
+}
+
+static bool checkKernels() {
+	enum { kFrames = 4099 };	// deliberately not a multiple of the vector size
+	int16 *in = new int16[kFrames * 2];
+	int16 *out1 = new int16[kFrames * 2];
+	int16 *out2 = new int16[kFrames * 2];
+	bool ok = true;
+
+	for (int vol = 0; vol <= Mixer::kMaxMixerVolume && ok; vol += 32) {
+		const st_volume_t vol_l = (st_volume_t)vol;
+		const st_volume_t vol_r = (st_volume_t)(Mixer::kMaxMixerVolume - vol);
+
+		for (int mode = 0; mode < 3 && ok; mode++) {
+			for (int i = 0; i < kFrames * 2; i++) {
+				in[i] = randomSample();
+				out1[i] = out2[i] = randomSample();
+			}
+			// Make sure the extreme values are covered, too
+			in[0] = out1[0] = out2[0] = -32768;
+			in[3] = out1[3] = out2[3] = 32767;
+
+			if (mode == 2) {
+				mixMonoSamplesScalar(out1, in, kFrames, vol_l, vol_r);
+				mixMonoSamples(out2, in, kFrames, vol_l, vol_r);
+			} else {
+				mixStereoFramesScalar(out1, in, kFrames, vol_l, vol_r, mode == 1);
+				mixStereoFrames(out2, in, kFrames, vol_l, vol_r, mode == 1);
+			}
+
+			if (memcmp(out1, out2, kFrames * 2 * sizeof(int16)) != 0) {
+				printf("Mismatch between scalar and vectorized mixing (volume %d/%d, mode %d)\n", vol_l, vol_r, mode);
+				ok = false;
+			}
+		}
+	}
+
+	delete[] in;
+	delete[] out1;
+	delete[] out2;
+	return ok;
+}
+
+/**
+ * Feed a short stream through a rate converter the way Channel::mix does,
+ * including draining it at the end, and check that none of its end is lost.
+ */
+static bool checkDrain(RateConverterType type) {
+	enum { kSamples = 10000, kInputRate = 22050, kOutputRate = 44100, kFrames = 256 };
+	const int expected = kSamples * (kOutputRate / kInputRate);
+	const int size = expected + 4 * kFrames;
+
+	setRateConverterType(type);
+	ConstantStream stream(kInputRate, kSamples);
+	RateConverter *converter = makeRateConverter(kInputRate, kOutputRate, false);
+	int16 *buf = new int16[size * 2];
+	memset(buf, 0, size * 2 * sizeof(int16));
+
+	int pos = 0;
+	while (pos + kFrames <= size && !(stream.endOfStream() && !converter->needsDrain())) {
+		if (!stream.endOfData())
+			converter->flow(stream, buf + pos * 2, kFrames, Mixer::kMaxMixerVolume, Mixer::kMaxMixerVolume);
+		else
+			converter->drain(buf + pos * 2, kFrames, Mixer::kMaxMixerVolume, Mixer::kMaxMixerVolume);
+		pos += kFrames;
+	}
+
+	// The output of a constant stream is at full level until the last input
+	// sample, where the filter starts fading it out.
+	int last = size - 1;
+	while (last >= 0 && buf[last * 2] < 16384 / 2)
+		last--;
+
+	delete[] buf;
+	delete converter;
+
+	const char *name = (type == kSincRateConverter) ? "sinc" : "linear";
+	if (last < expected - 4) {
+		printf("The %s rate converter lost the end of the stream: %d of %d frames\n", name, last + 1, expected);
+		return false;
+	}
+	printf("The %s rate converter produced %d of %d frames\n", name, last + 1, expected);
+	return true;
+}
+
+static void benchKernels() {
+	enum { kFrames = 4096, kRepeats = 20000 };
+	int16 *in = new int16[kFrames * 2];
+	int16 *out = new int16[kFrames * 2];
+
+	for (int i = 0; i < kFrames * 2; i++)
+		in[i] = out[i] = randomSample();
+
+	clock_t start = clock();
+	for (int n = 0; n < kRepeats; n++)
+		mixStereoFramesScalar(out, in, kFrames, 200, 100);
+	const double scalar = elapsed(start);
+
+	start = clock();
+	for (int n = 0; n < kRepeats; n++)
+		mixStereoFrames(out, in, kFrames, 200, 100);
+	const double simd = elapsed(start);
+
+	printf("Stereo mixing kernel: scalar %.3f s, vectorized %.3f s (%.1fx)\n", scalar, simd, scalar / simd);
+
+	delete[] in;
+	delete[] out;
+}
+
+int main(int argc, char *argv[]) {
+	for (int i = 0; i < kNoiseSize; i++)
+		_noise[i] = randomSample();
+
+	if (!checkKernels())
+		return 1;
+	if (!checkDrain(kLinearRateConverter) || !checkDrain(kSincRateConverter))
+		return 1;
+
+	benchKernels();
+	benchMixing(44100, kLinearRateConverter);
+	benchMixing(44100, kSincRateConverter);
+	benchMixing(48000, kLinearRateConverter);
+	benchMixing(48000, kSincRateConverter);
+	return 0;
+}
@@ -0,0 +1,61 @@
+######################################################################
+# Micro benchmarks for performance critical code.
+# Use the 'bench' target to build and run them.
+# Edit BENCHMARKS to add more benchmarks.
+#
+######################################################################
+
+BENCHMARKS   := \
+	bench/blend$(EXEEXT) \
+	bench/fmopl$(EXEEXT) \
+	bench/font$(EXEEXT) \
+	bench/framediff$(EXEEXT) \
+	bench/midiparser$(EXEEXT) \
+	bench/mixer$(EXEEXT) \
+	bench/scaler$(EXEEXT) \
+	bench/theme$(EXEEXT)
+
+ifdef USE_MT32EMU
+BENCHMARKS += bench/mt32$(EXEEXT)
+endif
+
+#
+BENCH_LDFLAGS :=
+
+
+bench: $(BENCHMARKS) themebundles
+	for b in $(BENCHMARKS); do ./$$b || exit 1; done
+
+bench/blend$(EXEEXT): bench/blend.cpp graphics/libgraphics.a common/libcommon.a
+	$(CXX) $(CXXFLAGS) $(CPPFLAGS) $(BENCH_LDFLAGS) -o $@ $+
+
+bench/fmopl$(EXEEXT): bench/fmopl.cpp sound/libsound.a common/libcommon.a backends/libbackends.a
+	$(CXX) $(CXXFLAGS) $(CPPFLAGS) $(BENCH_LDFLAGS) -o $@ $+
+
+bench/font$(EXEEXT): bench/font.cpp graphics/libgraphics.a common/libcommon.a backends/libbackends.a
+	$(CXX) $(CXXFLAGS) $(CPPFLAGS) $(BENCH_LDFLAGS) -o $@ $+
+
+bench/framediff$(EXEEXT): bench/framediff.cpp graphics/libgraphics.a common/libcommon.a
+	$(CXX) $(CXXFLAGS) $(CPPFLAGS) $(BENCH_LDFLAGS) -o $@ $+
+
+bench/midiparser$(EXEEXT): bench/midiparser.cpp sound/libsound.a common/libcommon.a backends/libbackends.a
+	$(CXX) $(CXXFLAGS) $(CPPFLAGS) $(BENCH_LDFLAGS) -o $@ $+
+
+bench/mixer$(EXEEXT): bench/mixer.cpp sound/libsound.a common/libcommon.a
+	$(CXX) $(CXXFLAGS) $(CPPFLAGS) $(BENCH_LDFLAGS) -o $@ $+
+
+bench/scaler$(EXEEXT): bench/scaler.cpp graphics/libgraphics.a common/libcommon.a
+	$(CXX) $(CXXFLAGS) $(CPPFLAGS) $(BENCH_LDFLAGS) -o $@ $+
+
+bench/theme$(EXEEXT): bench/theme.cpp gui/theme-bundle.o graphics/libgraphics.a common/libcommon.a backends/libbackends.a
+	$(CXX) $(CXXFLAGS) $(CPPFLAGS) $(BENCH_LDFLAGS) -o $@ $+ $(LIBS)
+
+bench/mt32$(EXEEXT): bench/mt32.cpp sound/softsynth/mt32/libmt32.a
+	$(CXX) $(CXXFLAGS) $(CPPFLAGS) $(BENCH_LDFLAGS) -o $@ $+ $(LIBS)
+
+
+clean: clean-bench
+clean-bench:
+	-$(RM) $(BENCHMARKS)
+
+.PHONY: bench clean-bench
@@ -0,0 +1,591 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+/*
+ * MT-32 benchmark: first checks that each of the vector kernels of the
+ * MT-32 emulator (see sound/softsynth/mt32/simd.h) produces the same
+ * samples as the loop it stands in for, with every instruction set the CPU
+ * supports, and compares their speed. Then it plays the same pseudo-random
+ * music on two instances of the emulator, one rendering its partials
+ * serially and one rendering the parts in parallel, checks that both
+ * produce exactly the same samples (also when the parallel jobs are run in
+ * reverse order), and reports how much faster than realtime either renders.
+ *
+ * The emulator needs the MT-32 ROMs (MT32_CONTROL.ROM and MT32_PCM.ROM, or
+ * the CM-32L ones). They are looked for in the directory given as the first
+ * argument, or in the current one; the benchmark is skipped if they can't
+ * be found (the kernel checks don't need them). The second argument sets the number of threads, which defaults
+ * to one per CPU.
+ */
+
+#include "common/stdafx.h"
+#include "common/scummsys.h"
+#include "common/util.h"
+#include "sound/softsynth/mt32/mt32emu.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef UNIX
+#include <pthread.h>
+#include <semaphore.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+using namespace MT32Emu;
+
+enum {
+	kSampleRate = 32000,
+	kMaxThreads = 16,
+	kCheckSeconds = 20,
+	kBenchSeconds = 20
+};
+
+static uint32 _seed;
+
+static uint32 randomNumber(uint32 range) {
+	_seed = _seed * 1103515245 + 12345;
+	return (_seed >> 16) % range;
+}
+
+static void printDebug(void *userData, const char *fmt, va_list list) {
+}
+
+static int report(void *userData, ReportType type, const void *reportData) {
+	return 0;
+}
+
+/**
+ * Runs the jobs one after another in reverse order. The output must not
+ * depend on the order in which the parts are rendered.
+ */
+static void runReversed(void *userData, ParallelJobProc job, void *jobParam, unsigned int numJobs) {
+	while (numJobs > 0)
+		job(jobParam, --numJobs);
+}
+
+static double wallClock() {
+#ifdef UNIX
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (double)tv.tv_sec + (double)tv.tv_usec / 1000000.0;
+#else
+	return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+enum Kernel {
+	kMixBuffers,
+	kMixBuffersRingMix,
+	kMixBuffersRing,
+	kPartialProductOutput,
+	kProduceOutput1,
+	kConvertToFloat,
+	kConvertFromFloat,
+	kNumKernels
+};
+
+static const char *const _kernelNames[kNumKernels] = {
+	"mixBuffers",
+	"mixBuffersRingMix",
+	"mixBuffersRing",
+	"partialProductOutput",
+	"produceOutput1",
+	"convertToFloat",
+	"convertFromFloat"
+};
+
+enum {
+	kKernelMaxLen = 4096,
+	kKernelBufferSize = (kKernelMaxLen + 8) * 2
+};
+
+static Bit16s _src1[kKernelBufferSize], _src2[kKernelBufferSize], _dst[kKernelBufferSize];
+static float _srcLeft[kKernelBufferSize], _srcRight[kKernelBufferSize];
+static float _dstLeft[kKernelBufferSize], _dstRight[kKernelBufferSize];
+static Bit16s _volume1, _volume2;
+
+static Bit16s randomSample() {
+	switch (randomNumber(8)) {
+	case 0:
+		return -32768;
+	case 1:
+		return 32767;
+	case 2:
+		return (Bit16s)(randomNumber(16385) - 8192);
+	default:
+		return (Bit16s)(randomNumber(65536) - 32768);
+	}
+}
+
+static float randomFloat() {
+	switch (randomNumber(8)) {
+	case 0:
+		return 1.0f;
+	case 1:
+		return -1.0f;
+	case 2:
+		// Outside of the 16-bit range after the conversion, where it wraps around
+		return (float)((int)randomNumber(98304) - 49152) / 32767.0f;
+	default:
+		return (float)((int)randomNumber(65536) - 32768) / 32767.0f;
+	}
+}
+
+/**
+ * The ring modulation of Partial::mixBuffersRingMix() and mixBuffersRing().
+ */
+static Bit16s ringMod(Bit16s x1, Bit16s x2, bool withSignal) {
+	float a, b;
+	a = ((float)x1) / 8192.0f;
+	b = ((float)x2) / 8192.0f;
+	if (withSignal)
+		a = (a * b) + a;
+	else
+		a *= b;
+	if (a>1.0)
+		a = 1.0;
+	if (a<-1.0)
+		a = -1.0;
+	return (Bit16s)(a * 8192.0f);
+}
+
+/**
+ * Runs a kernel on the buffers at the given offset, which makes them
+ * unaligned, followed by the plain loop for whatever it leaves, like the
+ * emulator does. With vector set to false, only the loop is run.
+ */
+static void runKernel(Kernel kernel, bool vector, int len, int offset) {
+	Bit16s *dst = _dst + offset;
+	const Bit16s *src1 = _src1 + offset, *src2 = _src2 + offset;
+	int i = 0;
+
+	switch (kernel) {
+	case kMixBuffers:
+		if (vector)
+			i = simd_mixBuffers(dst, src2, len);
+		for (; i < len; i++)
+			dst[i] = (Bit16s)(dst[i] + src2[i]);
+		break;
+	case kMixBuffersRingMix:
+		if (vector)
+			i = simd_mixBuffersRingMix(dst, src2, len);
+		for (; i < len; i++)
+			dst[i] = ringMod(dst[i], src2[i], true);
+		break;
+	case kMixBuffersRing:
+		if (vector)
+			i = simd_mixBuffersRing(dst, src2, len);
+		for (; i < len; i++)
+			dst[i] = ringMod(dst[i], src2[i], false);
+		break;
+	case kPartialProductOutput:
+		if (vector)
+			i = simd_partialProductOutput(len, _volume1, _volume2, dst, src1);
+		for (; i < len; i++) {
+			dst[i * 2] = (Bit16s)(((Bit32s)src1[i] * (Bit32s)_volume1) >> 16);
+			dst[i * 2 + 1] = (Bit16s)(((Bit32s)src1[i] * (Bit32s)_volume2) >> 16);
+		}
+		break;
+	case kProduceOutput1:
+		if (vector)
+			i = simd_produceOutput1(src2, dst, (Bit32u)len, _volume1);
+		for (i *= 2; i < len * 2; i++)
+			dst[i] = (Bit16s)(dst[i] + (Bit16s)(((Bit32s)src2[i] * (Bit32s)_volume1) >> 15));
+		break;
+	case kConvertToFloat:
+		if (vector)
+			i = simd_convertToFloat(src1, _dstLeft + offset, _dstRight + offset, (Bit32u)len);
+		for (; i < len; i++) {
+			_dstLeft[offset + i] = (float)src1[i * 2] / 32767.0f;
+			_dstRight[offset + i] = (float)src1[i * 2 + 1] / 32767.0f;
+		}
+		break;
+	case kConvertFromFloat:
+		if (vector)
+			i = simd_convertFromFloat(_srcLeft + offset, _srcRight + offset, dst, (Bit32u)len);
+		for (; i < len; i++) {
+			dst[i * 2] = (Bit16s)(_srcLeft[offset + i] * 32767.0f);
+			dst[i * 2 + 1] = (Bit16s)(_srcRight[offset + i] * 32767.0f);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+static void resetKernelOutput() {
+	memcpy(_dst, _src1, sizeof(_dst));
+	memset(_dstLeft, 0, sizeof(_dstLeft));
+	memset(_dstRight, 0, sizeof(_dstRight));
+}
+
+/**
+ * The ring modulation kernels do the float math in a fixed way, which the
+ * compiler may not do for the plain loop: with the x87 FPU, or when it fuses
+ * the multiply and add. They may differ by one then.
+ */
+static int kernelTolerance(Kernel kernel) {
+#if (defined(__SSE2_MATH__) || defined(_M_X64)) && !defined(__FMA__)
+	if (GetSIMDType() != SIMDType_NEON)
+		return 0;
+#endif
+	return kernel == kMixBuffersRingMix || kernel == kMixBuffersRing ? 1 : 0;
+}
+
+static bool checkKernel(Kernel kernel) {
+	static const int lengths[] = { 0, 1, 3, 7, 8, 9, 15, 16, 17, 31, 33, 100, 255, 256, 1000, kKernelMaxLen };
+	Bit16s reference[kKernelBufferSize];
+	float referenceLeft[kKernelBufferSize], referenceRight[kKernelBufferSize];
+	const int tolerance = kernelTolerance(kernel);
+
+	for (int n = 0; n < ARRAYSIZE(lengths); n++) {
+		for (int offset = 0; offset < 4; offset++) {
+			for (int i = 0; i < kKernelBufferSize; i++) {
+				_src1[i] = randomSample();
+				_src2[i] = randomSample();
+				_srcLeft[i] = randomFloat();
+				_srcRight[i] = randomFloat();
+			}
+			_volume1 = randomSample();
+			_volume2 = randomSample();
+
+			resetKernelOutput();
+			runKernel(kernel, false, lengths[n], offset);
+			memcpy(reference, _dst, sizeof(reference));
+			memcpy(referenceLeft, _dstLeft, sizeof(referenceLeft));
+			memcpy(referenceRight, _dstRight, sizeof(referenceRight));
+
+			resetKernelOutput();
+			runKernel(kernel, true, lengths[n], offset);
+
+			bool ok = memcmp(referenceLeft, _dstLeft, sizeof(referenceLeft)) == 0 &&
+			          memcmp(referenceRight, _dstRight, sizeof(referenceRight)) == 0;
+			for (int i = 0; i < kKernelBufferSize && ok; i++)
+				ok = ABS(reference[i] - _dst[i]) <= tolerance;
+			if (!ok) {
+				printf("Mismatch in %s with %s, %d samples at offset %d\n",
+					_kernelNames[kernel], GetSIMDTypeName(GetSIMDType()), lengths[n], offset);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+static double timeKernel(Kernel kernel, bool vector) {
+	enum { kRepeats = 2000 };
+
+	resetKernelOutput();
+	const double start = wallClock();
+	for (int n = 0; n < kRepeats; n++)
+		runKernel(kernel, vector, kKernelMaxLen, 0);
+	return wallClock() - start;
+}
+
+/**
+ * Checks the kernels with every instruction set the CPU supports, and
+ * prints how long each takes compared to the plain loop.
+ */
+static bool checkKernels() {
+	static const SIMDType types[] = { SIMDType_SSE2, SIMDType_AVX2, SIMDType_NEON };
+	double times[kNumKernels][ARRAYSIZE(types)];
+	bool found = false;
+
+	_seed = 3;
+	for (int t = 0; t < ARRAYSIZE(types); t++) {
+		if (!IsSIMDTypeSupported(types[t]))
+			continue;
+		found = true;
+		SetSIMDType(types[t]);
+		for (int k = 0; k < kNumKernels; k++) {
+			if (!checkKernel((Kernel)k))
+				return false;
+			times[k][t] = timeKernel((Kernel)k, true);
+		}
+	}
+	SetSIMDType(DetectSIMDType());
+
+	if (!found) {
+		printf("No vector kernels in this build or for this CPU, skipping the kernel checks\n");
+		return true;
+	}
+
+	for (int k = 0; k < kNumKernels; k++) {
+		const double scalar = timeKernel((Kernel)k, false);
+		printf("%s: plain loop %.3f s", _kernelNames[k], scalar);
+		for (int t = 0; t < ARRAYSIZE(types); t++) {
+			if (IsSIMDTypeSupported(types[t]))
+				printf(", %s %.3f s (%.1fx)", GetSIMDTypeName(types[t]), times[k][t], scalar / times[k][t]);
+		}
+		printf("\n");
+	}
+	return true;
+}
+
+#ifdef UNIX
+
+static unsigned int _numThreads = 1;
+
+/**
+ * The equivalent of Common::WorkerPool, which the MT-32 driver uses: the
+ * threads are created once and wait on a semaphore between renders.
+ */
+static pthread_t _threads[kMaxThreads];
+static sem_t _startSem, _doneSem;
+static pthread_mutex_t _jobMutex = PTHREAD_MUTEX_INITIALIZER;
+static ParallelJobProc _job;
+static void *_jobParam;
+static unsigned int _numJobs, _nextJob;
+static bool _quit;
+
+static void runJobs() {
+	while (true) {
+		pthread_mutex_lock(&_jobMutex);
+		const unsigned int n = _nextJob;
+		if (n < _numJobs)
+			_nextJob++;
+		pthread_mutex_unlock(&_jobMutex);
+
+		if (n >= _numJobs)
+			break;
+		_job(_jobParam, n);
+	}
+}
+
+static void *threadProc(void *param) {
+	while (true) {
+		sem_wait(&_startSem);
+		if (_quit)
+			break;
+		runJobs();
+		sem_post(&_doneSem);
+	}
+	return NULL;
+}
+
+static void startThreads() {
+	sem_init(&_startSem, 0, 0);
+	sem_init(&_doneSem, 0, 0);
+
+	unsigned int i;
+	for (i = 1; i < _numThreads; i++) {
+		if (pthread_create(&_threads[i], NULL, threadProc, NULL) != 0)
+			break;
+	}
+	_numThreads = i;
+}
+
+static void stopThreads() {
+	_quit = true;
+	for (unsigned int i = 1; i < _numThreads; i++)
+		sem_post(&_startSem);
+	for (unsigned int i = 1; i < _numThreads; i++)
+		pthread_join(_threads[i], NULL);
+	sem_destroy(&_startSem);
+	sem_destroy(&_doneSem);
+}
+
+static void runThreaded(void *userData, ParallelJobProc job, void *jobParam, unsigned int numJobs) {
+	const unsigned int numHelpers = (numJobs > 0) ? MIN(_numThreads, numJobs) - 1 : 0;
+
+	_job = job;
+	_jobParam = jobParam;
+	_numJobs = numJobs;
+	_nextJob = 0;
+
+	for (unsigned int i = 0; i < numHelpers; i++)
+		sem_post(&_startSem);
+	runJobs();
+	for (unsigned int i = 0; i < numHelpers; i++)
+		sem_wait(&_doneSem);
+}
+
+#else
+
+static unsigned int _numThreads = 1;
+#define runThreaded runReversed
+static void startThreads() {}
+static void stopThreads() {}
+
+#endif
+
+static Synth *openSynth(const char *romDir, void (*runParallel)(void *, ParallelJobProc, void *, unsigned int)) {
+	SynthProperties prop;
+	memset(&prop, 0, sizeof(prop));
+	prop.sampleRate = kSampleRate;
+	prop.useReverb = true;
+	prop.useDefaultReverb = false;
+	prop.reverbType = 0;
+	prop.reverbTime = 5;
+	prop.reverbLevel = 3;
+	prop.baseDir = const_cast<char *>(romDir);
+	prop.printDebug = printDebug;
+	prop.report = report;
+	prop.runParallel = runParallel;
+
+	// The emulator fills its noise table with rand(), so without this the
+	// synths would produce different output whenever noise is used
+	srand(1);
+
+	Synth *synth = new Synth();
+	if (!synth->open(prop)) {
+		delete synth;
+		return NULL;
+	}
+	return synth;
+}
+
+/**
+ * Generates a few milliseconds of pseudo-random music: notes on the eight
+ * melodic parts and the rhythm part, with the occasional program change,
+ * pitch bend and volume change. Returns the number of samples to render
+ * before the next events, in the range the MT-32 driver renders between
+ * MIDI events and mixer callbacks.
+ */
+static uint32 playEvents(Synth **synths, int numSynths) {
+	const uint32 numEvents = randomNumber(4);
+	for (uint32 i = 0; i < numEvents; i++) {
+		const uint32 channel = 1 + randomNumber(9);
+		uint32 msg;
+		switch (randomNumber(16)) {
+		case 0:
+			msg = 0xC0 | channel | (randomNumber(128) << 8);
+			break;
+		case 1:
+			msg = 0xE0 | channel | (randomNumber(128) << 8) | (randomNumber(128) << 16);
+			break;
+		case 2:
+			msg = 0xB0 | channel | (7 << 8) | ((64 + randomNumber(64)) << 16);
+			break;
+		case 3:
+		case 4:
+		case 5:
+		case 6:
+			msg = 0x80 | channel | ((36 + randomNumber(48)) << 8);
+			break;
+		default:
+			msg = 0x90 | channel | ((36 + randomNumber(48)) << 8) | ((32 + randomNumber(96)) << 16);
+			break;
+		}
+		for (int n = 0; n < numSynths; n++)
+			synths[n]->playMsg(msg);
+	}
+
+	return randomNumber(4) == 0 ? 1 + randomNumber(1200) : 3 + randomNumber(600);
+}
+
+static bool checkSynths(Synth **synths, const char *const *names, int numSynths) {
+	enum { kMaxChunk = 2048 };
+	Bit16s reference[kMaxChunk * 2], buf[kMaxChunk * 2];
+	bool silent = true;
+
+	_seed = 1;
+	for (uint32 samples = 0; samples < kCheckSeconds * kSampleRate; ) {
+		const uint32 len = MIN<uint32>(playEvents(synths, numSynths), kMaxChunk);
+		synths[0]->render(reference, len);
+		for (int n = 1; n < numSynths; n++) {
+			synths[n]->render(buf, len);
+			if (memcmp(reference, buf, len * 4) != 0) {
+				printf("Mismatch between serial and %s rendering after %u samples\n", names[n], samples);
+				return false;
+			}
+		}
+		for (uint32 i = 0; i < len * 2 && silent; i++)
+			silent = reference[i] == 0;
+		samples += len;
+	}
+
+	if (silent) {
+		printf("No output rendered, check the ROMs\n");
+		return false;
+	}
+	return true;
+}
+
+static void benchSynth(Synth *synth, const char *name, uint32 chunk) {
+	Bit16s buf[4096 * 2];
+
+	_seed = 2;
+	const double start = wallClock();
+	for (uint32 samples = 0; samples < kBenchSeconds * kSampleRate; samples += chunk) {
+		playEvents(&synth, 1);
+		synth->render(buf, chunk);
+	}
+	const double time = wallClock() - start;
+
+	printf("%s, %u samples per render: %d s of music rendered in %.3f s (%.1fx realtime)\n",
+		name, chunk, kBenchSeconds, time, kBenchSeconds / time);
+}
+
+int main(int argc, char *argv[]) {
+	const char *romDir = argc > 1 ? argv[1] : "";
+	char romPath[1024];
+	if (*romDir && romDir[strlen(romDir) - 1] != '/') {
+		snprintf(romPath, sizeof(romPath), "%s/", romDir);
+		romDir = romPath;
+	}
+
+#ifdef UNIX
+	long threads = argc > 2 ? atol(argv[2]) : sysconf(_SC_NPROCESSORS_ONLN);
+	_numThreads = (unsigned int)CLIP<long>(threads, 1, kMaxThreads);
+#endif
+
+	if (!checkKernels())
+		return 1;
+
+	Synth *serial = openSynth(romDir, NULL);
+	if (!serial) {
+		printf("MT-32 ROMs not found, skipping the MT-32 benchmark\n");
+		return 0;
+	}
+	startThreads();
+	Synth *reversed = openSynth(romDir, runReversed);
+	Synth *threaded = openSynth(romDir, runThreaded);
+	if (!reversed || !threaded)
+		return 1;
+
+	Synth *synths[3] = { serial, reversed, threaded };
+	static const char *const names[3] = { "serial", "reverse order", "threaded" };
+	if (!checkSynths(synths, names, 3))
+		return 1;
+
+	char name[64];
+	snprintf(name, sizeof(name), "Parts rendered by %u threads", _numThreads);
+	for (uint32 chunk = 256; chunk <= 4096; chunk *= 4) {
+		benchSynth(serial, "Partials rendered serially", chunk);
+		benchSynth(threaded, name, chunk);
+	}
+
+	delete serial;
+	delete reversed;
+	delete threaded;
+	stopThreads();
+	return 0;
+}
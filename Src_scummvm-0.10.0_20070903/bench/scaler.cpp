@@ -0,0 +1,239 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+/*
+ * Scaler benchmark: checks that the HQ2x and HQ3x scalers produce exactly
+ * the same output with and without the help of the vector unit, in both
+ * 555 and 565 mode, and compares their speed on a 320x200 screen. It also
+ * checks that the 32 bit versions of the normal and AdvMame scalers match
+ * their 16 bit counterparts, and compares them against scaling in 16 bit
+ * followed by the conversion to 32 bit that SDL would otherwise perform.
+ */
+
+#include "common/stdafx.h"
+#include "common/scummsys.h"
+#include "graphics/scaler.h"
+#include "graphics/scaler/intern.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <time.h>
+
+// Replacements for the versions in common/util.cpp, which would pull in the
+// engine and GUI code.
+
+void CDECL error(const char *s, ...) {
+	va_list va;
+
+	va_start(va, s);
+	fprintf(stderr, "ERROR: ");
+	vfprintf(stderr, s, va);
+	fprintf(stderr, "!\n");
+	va_end(va);
+
+	exit(1);
+}
+
+void CDECL warning(const char *s, ...) {
+	va_list va;
+
+	va_start(va, s);
+	fprintf(stderr, "WARNING: ");
+	vfprintf(stderr, s, va);
+	fprintf(stderr, "!\n");
+	va_end(va);
+}
+
+enum {
+	kWidth = 320,
+	kHeight = 200,
+	// The scalers read one pixel beyond each edge of the source
+	kSrcPitch = (kWidth + 2) * 2,
+	kRepeats = 200
+};
+
+static uint32 _seed = 1;
+
+static uint16 randomPixel() {
+	_seed = _seed * 1103515245 + 12345;
+	return (uint16)(_seed >> 16);
+}
+
+static double elapsed(clock_t start) {
+	return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+/**
+ * Fill the source with something resembling a game screen: blocks of a few
+ * similar colours, so that all the YUV thresholds are exercised, sprinkled
+ * with noise.
+ */
+static void fillSource(uint16 *src) {
+	uint16 palette[16];
+	for (int i = 0; i < 16; i += 4) {
+		palette[i] = randomPixel();
+		for (int j = 1; j < 4; j++)
+			palette[i + j] = palette[i] ^ (randomPixel() & 0x0C63);
+	}
+
+	for (int y = 0; y < kHeight + 2; y++) {
+		for (int x = 0; x < kWidth + 2; x++) {
+			uint16 &pixel = src[y * (kWidth + 2) + x];
+			const int block = ((y / 4) * 7 + (x / 4) * 3) & 15;
+			if ((randomPixel() & 7) == 0)
+				pixel = randomPixel();
+			else
+				pixel = palette[(block & 12) | (randomPixel() & 3)];
+		}
+	}
+}
+
+static double runScaler(ScalerProc *scaler, int factor, const uint16 *src, uint16 *dst, bool vector, int repeats) {
+	gHQUseVectorUnit = vector;
+
+	const uint8 *srcPtr = (const uint8 *)(src + kWidth + 2 + 1);
+	const clock_t start = clock();
+	for (int n = 0; n < repeats; n++)
+		scaler(srcPtr, kSrcPitch, (uint8 *)dst, kWidth * factor * 2, kWidth, kHeight);
+	return elapsed(start);
+}
+
+static bool benchScaler(const char *name, ScalerProc *scaler, int factor, int bitFormat, bool haveVectorUnit) {
+	const int dstSize = kWidth * factor * kHeight * factor;
+	uint16 *src = new uint16[(kWidth + 2) * (kHeight + 2)];
+	uint16 *dst1 = new uint16[dstSize];
+	uint16 *dst2 = new uint16[dstSize];
+	bool ok = true;
+
+	InitScalers(bitFormat);
+	for (int i = 0; i < 4 && ok; i++) {
+		fillSource(src);
+		runScaler(scaler, factor, src, dst1, false, 1);
+		runScaler(scaler, factor, src, dst2, true, 1);
+		if (memcmp(dst1, dst2, dstSize * sizeof(uint16)) != 0) {
+			printf("%s (%d): output differs with and without the vector unit\n", name, bitFormat);
+			ok = false;
+		}
+	}
+
+	if (ok) {
+		const double scalar = runScaler(scaler, factor, src, dst1, false, kRepeats);
+		if (haveVectorUnit) {
+			const double vector = runScaler(scaler, factor, src, dst2, true, kRepeats);
+			printf("%s (%d): %d frames in %.3f s, with vector unit %.3f s (%.1fx)\n",
+				name, bitFormat, kRepeats, scalar, vector, scalar / vector);
+		} else {
+			printf("%s (%d): %d frames in %.3f s, no vector unit\n", name, bitFormat, kRepeats, scalar);
+		}
+	}
+
+	delete[] src;
+	delete[] dst1;
+	delete[] dst2;
+	return ok;
+}
+
+static uint32 convert565To32(uint16 color) {
+	const uint32 r = (color >> 11) & 0x1F;
+	const uint32 g = (color >> 5) & 0x3F;
+	const uint32 b = color & 0x1F;
+	return ((r << 3 | r >> 2) << 16) | ((g << 2 | g >> 4) << 8) | (b << 3 | b >> 2);
+}
+
+static void convertSurface(const uint16 *src, uint32 *dst, int count) {
+	while (count--)
+		*dst++ = convert565To32(*src++);
+}
+
+static bool bench32bpp(const char *name, ScalerProc *scaler16, ScalerProc *scaler32, int factor) {
+	const int srcSize = (kWidth + 2) * (kHeight + 2);
+	const int dstSize = kWidth * factor * kHeight * factor;
+	uint16 *src16 = new uint16[srcSize];
+	uint32 *src32 = new uint32[srcSize];
+	uint16 *dst16 = new uint16[dstSize];
+	uint32 *dst32 = new uint32[dstSize];
+	uint32 *converted = new uint32[dstSize];
+	bool ok = true;
+
+	fillSource(src16);
+	convertSurface(src16, src32, srcSize);
+
+	const uint8 *srcPtr16 = (const uint8 *)(src16 + kWidth + 2 + 1);
+	const uint8 *srcPtr32 = (const uint8 *)(src32 + kWidth + 2 + 1);
+	scaler16(srcPtr16, kSrcPitch, (uint8 *)dst16, kWidth * factor * 2, kWidth, kHeight);
+	scaler32(srcPtr32, kSrcPitch * 2, (uint8 *)dst32, kWidth * factor * 4, kWidth, kHeight);
+	convertSurface(dst16, converted, dstSize);
+	if (memcmp(dst32, converted, dstSize * sizeof(uint32)) != 0) {
+		printf("%s: 32 bit output differs from the 16 bit output\n", name);
+		ok = false;
+	}
+
+	if (ok) {
+		clock_t start = clock();
+		for (int n = 0; n < kRepeats; n++) {
+			scaler16(srcPtr16, kSrcPitch, (uint8 *)dst16, kWidth * factor * 2, kWidth, kHeight);
+			convertSurface(dst16, converted, dstSize);
+		}
+		const double twoPass = elapsed(start);
+
+		start = clock();
+		for (int n = 0; n < kRepeats; n++)
+			scaler32(srcPtr32, kSrcPitch * 2, (uint8 *)dst32, kWidth * factor * 4, kWidth, kHeight);
+		const double direct = elapsed(start);
+
+		printf("%s: %d frames in 16 bit plus conversion %.3f s, in 32 bit %.3f s (%.1fx)\n",
+			name, kRepeats, twoPass, direct, twoPass / direct);
+	}
+
+	delete[] src16;
+	delete[] src32;
+	delete[] dst16;
+	delete[] dst32;
+	delete[] converted;
+	return ok;
+}
+
+int main(int argc, char *argv[]) {
+	InitScalers(565, false);
+	if (!bench32bpp("Normal1x", Normal1x, Normal1x_32, 1) ||
+		!bench32bpp("Normal2x", Normal2x, Normal2x_32, 2) ||
+		!bench32bpp("Normal3x", Normal3x, Normal3x_32, 3) ||
+		!bench32bpp("AdvMame2x", AdvMame2x, AdvMame2x_32, 2) ||
+		!bench32bpp("AdvMame3x", AdvMame3x, AdvMame3x_32, 3))
+		return 1;
+
+
+#ifndef DISABLE_HQ_SCALERS
+	InitScalers(565);
+	const bool haveVectorUnit = gHQUseVectorUnit;
+
+	if (!benchScaler("HQ2x", HQ2x, 2, 565, haveVectorUnit) ||
+		!benchScaler("HQ2x", HQ2x, 2, 555, haveVectorUnit) ||
+		!benchScaler("HQ3x", HQ3x, 3, 565, haveVectorUnit) ||
+		!benchScaler("HQ3x", HQ3x, 3, 555, haveVectorUnit))
+		return 1;
+#endif
+	return 0;
+}
@@ -0,0 +1,175 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+/*
+ * Theme startup benchmark: measures how long it takes to get at the config
+ * and the files of the modern theme, from its .ini and .zip file and from
+ * its precompiled bundle, with the bundle read into memory (as before) and
+ * memory mapped. Run "make themebundles" first; the theme directory can be
+ * given on the command line and defaults to gui/themes.
+ */
+
+#include "common/stdafx.h"
+#include "common/scummsys.h"
+#include "common/config-file.h"
+#include "common/file.h"
+#include "common/system.h"
+#include "common/unzip.h"
+#include "gui/theme-bundle.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <time.h>
+
+// Replacements for the versions in common/util.cpp, which would pull in the
+// engine and GUI code. Common::File uses debug(), so it is needed as well.
+
+void CDECL error(const char *s, ...) {
+	va_list va;
+
+	va_start(va, s);
+	fprintf(stderr, "ERROR: ");
+	vfprintf(stderr, s, va);
+	fprintf(stderr, "!\n");
+	va_end(va);
+
+	exit(1);
+}
+
+void CDECL warning(const char *s, ...) {
+	va_list va;
+
+	va_start(va, s);
+	fprintf(stderr, "WARNING: ");
+	vfprintf(stderr, s, va);
+	fprintf(stderr, "!\n");
+	va_end(va);
+}
+
+void CDECL debug(int level, const char *s, ...) {
+}
+
+// ConfigFile can save to save files, which would pull in common/system.cpp
+// and with it the GUI code, too. There is no OSystem in this benchmark.
+OSystem *g_system = 0;
+
+enum {
+	kRepeats = 200
+};
+
+static double elapsed(clock_t start) {
+	return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+/**
+ * Reads the theme config and unpacks all files of the theme archive, like
+ * Theme::loadConfigFile and the ImageManager do without a bundle.
+ */
+static uint32 loadSources() {
+	Common::ConfigFile cfg;
+	if (!cfg.loadFromFile("modern.ini"))
+		error("Could not load modern.ini");
+
+	uint32 bytes = 0;
+#ifdef USE_ZLIB
+	unzFile zipFile = unzOpen("modern.zip");
+	if (!zipFile)
+		error("Could not open modern.zip");
+
+	for (int err = unzGoToFirstFile(zipFile); err == UNZ_OK; err = unzGoToNextFile(zipFile)) {
+		unz_file_info fileInfo;
+		unzGetCurrentFileInfo(zipFile, &fileInfo, NULL, 0, NULL, 0, NULL, 0);
+		byte *buffer = new byte[fileInfo.uncompressed_size];
+		unzOpenCurrentFile(zipFile);
+		bytes += (uint32)unzReadCurrentFile(zipFile, buffer, fileInfo.uncompressed_size);
+		unzCloseCurrentFile(zipFile);
+		delete[] buffer;
+	}
+	unzClose(zipFile);
+#endif
+
+	return bytes;
+}
+
+/**
+ * Opens the bundle and reads its config and the font caches in it, like
+ * Theme::loadConfigFile and Theme::loadFont do.
+ */
+static uint32 loadBundle(bool map) {
+	GUI::ThemeBundle bundle;
+	Common::ConfigFile cfg;
+
+	if (!bundle.open("modern.thb", map) || !bundle.getConfig(cfg))
+		error("Could not load modern.thb");
+
+	uint32 bytes = 0;
+	const Common::ConfigFile::SectionList sections = cfg.getSections();
+	for (Common::ConfigFile::SectionList::const_iterator i = sections.begin(); i != sections.end(); ++i) {
+		for (Common::ConfigFile::SectionKeyList::const_iterator j = i->keys.begin(); j != i->keys.end(); ++j) {
+			Common::String name(j->value);
+			if (name.size() < 4 || scumm_stricmp(name.c_str() + name.size() - 4, ".bdf"))
+				continue;
+			name.deleteLastChar();
+			name.deleteLastChar();
+			name.deleteLastChar();
+
+			Common::SeekableReadStream *stream = bundle.openFile(name + "fcc");
+			if (!stream)
+				continue;
+			byte buf[4096];
+			uint32 len;
+			while ((len = stream->read(buf, sizeof(buf))) > 0)
+				bytes += len;
+			delete stream;
+		}
+	}
+
+	return bytes;
+}
+
+int main(int argc, char *argv[]) {
+	Common::File::addDefaultDirectory(argc > 1 ? argv[1] : "gui/themes");
+
+	clock_t start = clock();
+	uint32 bytes = 0;
+	for (int n = 0; n < kRepeats; n++)
+		bytes = loadSources();
+	const double sources = elapsed(start) / kRepeats;
+	printf(".ini and .zip:         %.3f ms per load (%u bytes unpacked)\n", sources * 1000, bytes);
+
+	start = clock();
+	for (int n = 0; n < kRepeats; n++)
+		bytes = loadBundle(false);
+	const double copied = elapsed(start) / kRepeats;
+	printf("Bundle read to memory: %.3f ms per load (%u bytes of font caches)\n", copied * 1000, bytes);
+
+	start = clock();
+	for (int n = 0; n < kRepeats; n++)
+		bytes = loadBundle(true);
+	const double mapped = elapsed(start) / kRepeats;
+	printf("Bundle memory mapped:  %.3f ms per load (%.1fx faster than reading it)\n", mapped * 1000, copied / mapped);
+
+	return 0;
+}
@@ -31,6 +31,7 @@
 #include "common/hash-str.h"
 #include "common/file.h"
 #include "common/md5.h"
+#include "common/md5cache.h"
 #include "common/advancedDetector.h"
 #include "common/config-manager.h"
 
@@ -303,7 +304,7 @@ static ADGameDescList detectGame(const FSList *fslist, const Common::ADParams &p
 
 			if (!filesList.contains(tstr)) continue;
 
-			if (!md5_file_string(*file, md5str, params.md5Bytes))
+			if (!MD5Man.md5FileString(*file, md5str, params.md5Bytes))
 				continue;
 			filesMD5[tstr] = md5str;
 
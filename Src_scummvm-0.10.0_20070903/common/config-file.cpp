@@ -234,6 +234,11 @@ void ConfigFile::removeSection(const String &section) {
 	}
 }
 
+void ConfigFile::addSection(const Section &section) {
+	assert(isValidName(section.name));
+	_sections.push_back(section);
+}
+
 bool ConfigFile::hasSection(const String &section) const {
 	assert(isValidName(section));
 	const Section *s = getSection(section);
@@ -112,6 +112,14 @@ public:
 	void	removeSection(const String &section);
 	void	renameSection(const String &oldName, const String &newName);
 
+	/**
+	 * Append a complete section. Unlike setKey, this does not look for an
+	 * existing section or key of the same name, so it is only meant for
+	 * filling a config file from a source which is known to be free of
+	 * duplicates, like a precompiled theme bundle.
+	 */
+	void	addSection(const Section &section);
+
 	bool	hasKey(const String &key, const String &section) const;
 	bool	getKey(const String &key, const String &section, String &value) const;
 	void	setKey(const String &key, const String &section, const String &value);
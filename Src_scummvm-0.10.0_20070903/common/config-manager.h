@@ -132,6 +132,7 @@ public:
 	void				registerDefault(const String &key, bool value);
 
 	void				flushToDisk();
+	const String &		getConfigFileName() const { return _filename; }
 
 	void				setActiveDomain(const String &domName);
 	Domain *			getActiveDomain() { return _activeDomain; }
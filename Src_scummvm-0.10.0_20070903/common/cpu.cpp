@@ -0,0 +1,69 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+#include "common/stdafx.h"
+#include "common/cpu.h"
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#include <cpuid.h>
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <intrin.h>
+#endif
+
+namespace Common {
+
+static uint32 detectCPUFeatures() {
+	uint32 features = 0;
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	// The compiler may use SSE2 anywhere already, but check the CPU anyway
+	// in case somebody runs such a build on an old machine.
+#if defined(__GNUC__)
+	unsigned int eax, ebx, ecx, edx;
+	if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (edx & (1 << 26)))
+		features |= kCPUFeatureSSE2;
+#elif defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	if (info[3] & (1 << 26))
+		features |= kCPUFeatureSSE2;
+#endif
+#endif
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+	// NEON is mandatory on AArch64. On 32-bit ARM there is no portable way
+	// to ask for it, so trust the compiler flags the build was made with.
+	features |= kCPUFeatureNEON;
+#endif
+
+	return features;
+}
+
+bool hasCPUFeature(CPUFeature feature) {
+	static uint32 features = detectCPUFeatures();
+	return (features & feature) != 0;
+}
+
+}	// End of namespace Common
@@ -0,0 +1,50 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+#ifndef COMMON_CPU_H
+#define COMMON_CPU_H
+
+#include "common/stdafx.h"
+#include "common/scummsys.h"
+
+namespace Common {
+
+/** Vector instruction sets which code in ScummVM can make use of. */
+enum CPUFeature {
+	kCPUFeatureSSE2 = 1 << 0,
+	kCPUFeatureNEON = 1 << 1
+};
+
+/**
+ * Check whether the CPU ScummVM is running on supports the given feature.
+ * Only features the compiler was told to generate code for are reported,
+ * so code using them has to be guarded by the matching compiler macros,
+ * too (e.g. __SSE2__ or __ARM_NEON__).
+ */
+bool hasCPUFeature(CPUFeature feature);
+
+}	// End of namespace Common
+
+#endif
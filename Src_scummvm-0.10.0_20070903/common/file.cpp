@@ -24,6 +24,7 @@
  */
 
 #include "common/file.h"
+#include "common/array.h"
 #include "common/fs.h"
 #include "common/hashmap.h"
 #include "common/util.h"
@@ -33,6 +34,19 @@
 #include "CoreFoundation/CoreFoundation.h"
 #endif
 
+#if defined(UNIX) && !defined(__SYMBIAN32__) && !defined(__DS__) && !defined(__PLAYSTATION2__)
+#define HAVE_MMAP
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif
+
+#if defined(HAVE_MMAP) || (defined(WIN32) && !defined(_WIN32_WCE))
+#define HAVE_FILE_MTIME
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif
+
 #ifdef __PLAYSTATION2__
 	// for those replaced fopen/fread/etc functions
 	typedef unsigned long	uint64;
@@ -135,15 +149,126 @@ namespace Common {
 
 typedef HashMap<String, int, CaseSensitiveString_Hash, CaseSensitiveString_EqualTo> StringIntMap;
 
-// The following two objects could be turned into static members of class
+// The following objects could be turned into static members of class
 // File. However, then we would be forced to #include hashmap in file.h
 // which seems to be a high price just for a simple beautification...
 static StringIntMap *_defaultDirectories;
 static StringMap *_filesMap;
 
+struct DirectoryEntry {
+	String path;
+	int level;
+	String prefix;
+};
+
+// Directories as they were passed to addDefaultDirectory(Recursive), in
+// registration order. Used to rebuild the index in rescanDefaultDirectories().
+static Array<DirectoryEntry> *_rootDirectories;
+
+/**
+ * Checks whether a file name can be resolved through _filesMap alone. That
+ * is the case for plain file names, which are indexed for every default
+ * directory. Names containing a path, or 'invisible' names (which the
+ * filesystem backends don't list), still have to be probed with fopen.
+ */
+static bool isIndexedName(const String &filename) {
+	if (filename.empty() || filename[0] == '.')
+		return false;
+	for (uint i = 0; i < filename.size(); ++i) {
+		const char c = filename[i];
+		if (c == '/' || c == '\\' || c == ':')
+			return false;
+	}
+	return true;
+}
+
+static void indexDirectory(const FilesystemNode &dir, int level, const String &prefix) {
+	if (level <= 0)
+		return;
+
+	FSList fslist;
+	if (!dir.listDir(fslist, FilesystemNode::kListAll)) {
+		// Failed listing the contents of this node, so it is either not a 
+		// directory, or just doesn't exist at all.
+		return;
+	}
+
+	if (!_defaultDirectories)
+		_defaultDirectories = new StringIntMap;
+
+	// Do not add directories multiple times, unless this time they are added
+	// with a bigger depth.
+	const String &directory(dir.path());
+	if (_defaultDirectories->contains(directory) && (*_defaultDirectories)[directory] >= level)
+		return;
+	(*_defaultDirectories)[directory] = level;
+
+	if (!_filesMap)
+		_filesMap = new StringMap;
+
+	// Index all files of this directory, both by their path relative to the
+	// registered root (prefix + name) and by their plain name. The latter is
+	// what the fopenNoCase probing over _defaultDirectories used to find,
+	// so a miss on a plain name means the file isn't in any default
+	// directory. Files are indexed before descending into subdirectories,
+	// so that a directory's own files take precedence over deeper ones.
+	FSList::const_iterator file;
+	for (file = fslist.begin(); file != fslist.end(); ++file) {
+		if (file->isDirectory())
+			continue;
+
+		String name(file->name());
+		name.toLowercase();
+
+		String lfn(prefix);
+		lfn += name;
+		lfn.toLowercase();
+		if (!_filesMap->contains(lfn))
+			(*_filesMap)[lfn] = file->path();
+		if (!prefix.empty() && !_filesMap->contains(name))
+			(*_filesMap)[name] = file->path();
+	}
+
+	for (file = fslist.begin(); file != fslist.end(); ++file) {
+		if (file->isDirectory())
+			indexDirectory(*file, level - 1, prefix + file->name() + "/");
+	}
+}
+
+/**
+ * Add a file which File::open just created in the current directory to the
+ * index, if the current directory is one of the registered directories.
+ * Other directories can't have changed, so there is no need to rescan them.
+ */
+static void indexNewFile(const String &filename) {
+	const FilesystemNode dir(".");
+	const String directory(dir.path());
+
+	String name(filename);
+	name.toLowercase();
+
+	Array<DirectoryEntry>::const_iterator root;
+	for (root = _rootDirectories->begin(); root != _rootDirectories->end(); ++root) {
+		if (root->path != directory)
+			continue;
+
+		const String path(dir.getChild(filename).path());
+		String lfn(root->prefix);
+		lfn += name;
+		lfn.toLowercase();
+		if (!_filesMap->contains(lfn))
+			(*_filesMap)[lfn] = path;
+		if (!root->prefix.empty() && !_filesMap->contains(name))
+			(*_filesMap)[name] = path;
+	}
+}
+
 static FILE *fopenNoCase(const String &filename, const String &directory, const char *mode) {
 	FILE *file;
-	String buf(directory);
+	// Deliberately don't share the (refcounted) storage of directory, which
+	// usually is a key of _defaultDirectories: files may be opened from
+	// several threads at once, e.g. during parallel game detection.
+	String buf(directory.c_str());
 	uint i;
 
 #if !defined(__GP32__) && !defined(PALMOS_MODE)
@@ -225,46 +350,43 @@ void File::addDefaultDirectoryRecursive(const FilesystemNode &dir, int level, co
 	if (level <= 0)
 		return;
 
-	FSList fslist;
-	if (!dir.listDir(fslist, FilesystemNode::kListAll)) {
-		// Failed listing the contents of this node, so it is either not a 
-		// directory, or just doesn't exist at all.
-		return;
-	}
+	if (!_rootDirectories)
+		_rootDirectories = new Array<DirectoryEntry>;
 
-	if (!_defaultDirectories)
-		_defaultDirectories = new StringIntMap;
+	// Remember the registration itself, so that rescanDefaultDirectories()
+	// can rebuild the index with the original depth and prefix.
+	DirectoryEntry entry;
+	entry.path = dir.path();
+	entry.level = level;
+	entry.prefix = prefix;
+	_rootDirectories->push_back(entry);
 
-	// Do not add directories multiple times, unless this time they are added
-	// with a bigger depth.
-	const String &directory(dir.path());
-	if (_defaultDirectories->contains(directory) && (*_defaultDirectories)[directory] >= level)
-		return;
-	(*_defaultDirectories)[directory] = level;
+	indexDirectory(dir, level, prefix);
+}
 
-	if (!_filesMap)
-		_filesMap = new StringMap;
+void File::resetDefaultDirectories() {
+	delete _defaultDirectories;
+	delete _filesMap;
+	delete _rootDirectories;
 
-	for (FSList::const_iterator file = fslist.begin(); file != fslist.end(); ++file) {
-		if (file->isDirectory()) {
-			addDefaultDirectoryRecursive(file->path(), level - 1, prefix + file->name() + "/");
-		} else {
-			String lfn(prefix);
-			lfn += file->name();
-			lfn.toLowercase();
-			if (!_filesMap->contains(lfn)) {
-				(*_filesMap)[lfn] = file->path();
-			}
-		}
-	}
+	_defaultDirectories = 0;
+	_filesMap = 0;
+	_rootDirectories = 0;
 }
 
-void File::resetDefaultDirectories() {
+void File::rescanDefaultDirectories() {
+	if (!_rootDirectories)
+		return;
+
+	Array<DirectoryEntry> roots(*_rootDirectories);
+
 	delete _defaultDirectories;
 	delete _filesMap;
-	
 	_defaultDirectories = 0;
 	_filesMap = 0;
+
+	for (Array<DirectoryEntry>::const_iterator root = roots.begin(); root != roots.end(); ++root)
+		indexDirectory(FilesystemNode(root->path), root->level, root->prefix);
 }
 
 File::File()
@@ -302,18 +424,21 @@ bool File::open(const String &filename, AccessMode mode) {
 	if (mode == kFileWriteMode) {
 		_handle = fopenNoCase(filename, "", modeStr);
 	} else if (_filesMap && _filesMap->contains(fname)) {
-		fname = (*_filesMap)[fname];
+		fname = (*_filesMap)[fname].c_str();	// don't share storage, see fopenNoCase
 		debug(3, "Opening hashed: %s", fname.c_str());
 		_handle = fopen(fname.c_str(), modeStr);
 	} else if (_filesMap && _filesMap->contains(fname + ".")) {
 		// WORKAROUND: Bug #1458388: "SIMON1: Game Detection fails"
 		// sometimes instead of "GAMEPC" we get "GAMEPC." (note trailing dot)
-		fname = (*_filesMap)[fname + "."];
+		fname = (*_filesMap)[fname + "."].c_str();
 		debug(3, "Opening hashed: %s", fname.c_str());
 		_handle = fopen(fname.c_str(), modeStr);
 	} else {
 
-		if (_defaultDirectories) {
+		// Plain file names are fully covered by the directory index, so
+		// only names with a path component need to be probed in each
+		// default directory.
+		if (_defaultDirectories && !isIndexedName(filename)) {
 			// Try all default directories
 			StringIntMap::const_iterator x(_defaultDirectories->begin());
 			for (; _handle == NULL && x != _defaultDirectories->end(); ++x) {
@@ -354,6 +479,11 @@ bool File::open(const String &filename, AccessMode mode) {
 
 	_name = filename;
 
+	// Files are always created in the current directory. If that is one of
+	// the default directories, the index doesn't know the new file yet.
+	if (mode == kFileWriteMode && _filesMap && _rootDirectories && isIndexedName(filename) && !_filesMap->contains(fname))
+		indexNewFile(filename);
+
 #ifdef DEBUG_FILE_REFCOUNT
 	warning("File::open on file '%s'", _name.c_str());
 #endif
@@ -486,6 +616,23 @@ uint32 File::size() const {
 	return length;
 }
 
+bool File::getModificationTime(uint32 &mtime) const {
+	if (_handle == NULL) {
+		error("File::getModificationTime: File is not open!");
+		return false;
+	}
+
+#ifdef HAVE_FILE_MTIME
+	struct stat st;
+	if (fstat(fileno((FILE *)_handle), &st) != 0)
+		return false;
+	mtime = (uint32)st.st_mtime;
+	return true;
+#else
+	return false;
+#endif
+}
+
 void File::seek(int32 offs, int whence) {
 	if (_handle == NULL) {
 		error("File::seek: File is not open!");
@@ -532,4 +679,157 @@ uint32 File::write(const void *ptr, uint32 len) {
 	return len;
 }
 
+
+MappedFile::MappedFile()
+	: _data(0), _mappedSize(0), _mappedPos(0), _mappedEOF(false) {
+}
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+bool MappedFile::open(const String &filename, AccessMode mode) {
+	if (!File::open(filename, mode))
+		return false;
+	if (mode == kFileReadMode)
+		map();
+	return true;
+}
+
+bool MappedFile::open(const FilesystemNode &node, AccessMode mode) {
+	if (!File::open(node, mode))
+		return false;
+	if (mode == kFileReadMode)
+		map();
+	return true;
+}
+
+void MappedFile::close() {
+	unmap();
+	File::close();
+}
+
+void MappedFile::map() {
+	assert(_handle && !_data);
+
+#ifdef HAVE_MMAP
+	const int fd = fileno((FILE *)_handle);
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0)
+		return;
+
+	void *addr = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (addr == MAP_FAILED) {
+		debug(3, "MappedFile: mmap of '%s' failed, falling back to buffered reads", _name.c_str());
+		return;
+	}
+
+	_data = (const byte *)addr;
+	_mappedSize = (uint32)st.st_size;
+	_mappedPos = 0;
+	_mappedEOF = false;
+#endif
+}
+
+void MappedFile::unmap() {
+#ifdef HAVE_MMAP
+	if (_data)
+		munmap(const_cast<byte *>(_data), _mappedSize);
+#endif
+	_data = 0;
+	_mappedSize = 0;
+	_mappedPos = 0;
+	_mappedEOF = false;
+}
+
+const byte *MappedFile::getData(uint32 offset, uint32 len) const {
+	if (!_data || offset > _mappedSize || len > _mappedSize - offset)
+		return 0;
+	return _data + offset;
+}
+
+MemoryReadStream *MappedFile::readStreamAt(uint32 offset, uint32 len) {
+	if (_data) {
+		const byte *ptr = getData(offset, len);
+		return ptr ? new MemoryReadStream(ptr, len) : 0;
+	}
+
+	if (!isOpen() || offset > size() || len > size() - offset)
+		return 0;
+
+	byte *buf = (byte *)malloc(len);
+	seek(offset);
+	if (read(buf, len) != len) {
+		free(buf);
+		return 0;
+	}
+	return new MemoryReadStream(buf, len, true);
+}
+
+bool MappedFile::eof() const {
+	if (!_data)
+		return File::eof();
+	return _mappedEOF;
+}
+
+uint32 MappedFile::pos() const {
+	if (!_data)
+		return File::pos();
+	return _mappedPos;
+}
+
+uint32 MappedFile::size() const {
+	if (!_data)
+		return File::size();
+	return _mappedSize;
+}
+
+void MappedFile::seek(int32 offs, int whence) {
+	if (!_data) {
+		File::seek(offs, whence);
+		return;
+	}
+
+	int32 newPos;
+	switch (whence) {
+	case SEEK_END:
+		newPos = _mappedSize + offs;
+		break;
+	case SEEK_CUR:
+		newPos = _mappedPos + offs;
+		break;
+	case SEEK_SET:
+	default:
+		newPos = offs;
+		break;
+	}
+
+	// Like fseek, ignore seeks before the start of the file, but allow
+	// seeking past its end.
+	if (newPos >= 0)
+		_mappedPos = newPos;
+	_mappedEOF = false;
+}
+
+uint32 MappedFile::read(void *ptr, uint32 len) {
+	if (!_data)
+		return File::read(ptr, len);
+
+	if (len == 0)
+		return 0;
+
+	uint32 avail = (_mappedPos < _mappedSize) ? _mappedSize - _mappedPos : 0;
+	if (len > avail) {
+		len = avail;
+		_ioFailed = true;
+		_mappedEOF = true;
+		if (len == 0)
+			return 0;
+	}
+
+	memcpy(ptr, _data + _mappedPos, len);
+	_mappedPos += len;
+	return len;
+}
+
 }	// End of namespace Common
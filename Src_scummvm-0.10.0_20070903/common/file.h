@@ -68,6 +68,15 @@ public:
 
 	static void resetDefaultDirectories();
 
+	/**
+	 * Rebuilds the case-insensitive index of all default directories.
+	 * Plain file names are looked up in this index only, so it must be
+	 * called whenever files are added to or removed from one of these
+	 * directories behind File's back. Files created by open() are added
+	 * to the index without a rescan.
+	 */
+	static void rescanDefaultDirectories();
+
 	File();
 	virtual ~File();
 
@@ -116,6 +125,89 @@ public:
 	void seek(int32 offs, int whence = SEEK_SET);
 	uint32 read(void *dataPtr, uint32 dataSize);
 	uint32 write(const void *dataPtr, uint32 dataSize);
+
+	/**
+	 * Gets the time the opened file was last modified, in seconds since
+	 * the epoch.
+	 *
+	 * @return: false if the platform can't tell
+	 */
+	bool getModificationTime(uint32 &mtime) const;
+};
+
+/**
+ * A read-only File which, where the platform supports it, maps the whole
+ * file into memory instead of going through stdio. Read-only game data
+ * opened this way is shared via the page cache between all running
+ * instances, and callers can get direct pointers into it with getData()
+ * instead of copying the data into their own buffers.
+ *
+ * If a file can't be mapped (unsupported platform, empty file, mmap
+ * failure or write mode), MappedFile transparently falls back to the
+ * buffered behaviour of File; getData() then returns 0, so callers must
+ * always be prepared to read() the data instead.
+ */
+class MappedFile : public File {
+protected:
+	/** Start of the mapped file contents; 0 if the file is not mapped. */
+	const byte *_data;
+
+	/** Size of the mapping, i.e. of the file. */
+	uint32 _mappedSize;
+
+	/** Current read position inside the mapping. */
+	uint32 _mappedPos;
+
+	/** Set if a read hit the end of the mapping, like feof(). */
+	bool _mappedEOF;
+
+	void map();
+	void unmap();
+
+public:
+	MappedFile();
+	virtual ~MappedFile();
+
+	virtual bool open(const String &filename, AccessMode mode = kFileReadMode);
+	virtual bool open(const FilesystemNode &node, AccessMode mode = kFileReadMode);
+
+	virtual void close();
+
+	/**
+	 * Checks if the file contents are memory mapped.
+	 *
+	 * @return: true if getData() can be used, false if the file fell back to buffered I/O.
+	 */
+	bool isMapped() const { return _data != 0; }
+
+	/**
+	 * Returns a direct pointer to the given range of the file. The pointer
+	 * stays valid until the file is closed.
+	 *
+	 * @param offset: start of the range, relative to the start of the file
+	 * @param len: length of the range in bytes
+	 * @return: pointer to the data, or 0 if the file is not mapped or the
+	 *          range exceeds the end of the file
+	 */
+	const byte *getData(uint32 offset, uint32 len) const;
+
+	/**
+	 * Creates a MemoryReadStream over the given range of the file. If the
+	 * file is mapped, the stream directly references the mapping and must
+	 * not outlive this MappedFile. Otherwise the range is read into a
+	 * malloc'ed buffer which is owned by the returned stream.
+	 *
+	 * @return: the new stream, or 0 if the range could not be read
+	 */
+	MemoryReadStream *readStreamAt(uint32 offset, uint32 len);
+
+	bool eos() const { return eof(); }
+	bool eof() const;
+
+	uint32 pos() const;
+	uint32 size() const;
+	void seek(int32 offs, int whence = SEEK_SET);
+	uint32 read(void *dataPtr, uint32 dataSize);
 };
 
 } // End of namespace Common
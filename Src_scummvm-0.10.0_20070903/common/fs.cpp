@@ -25,6 +25,7 @@
 #include "common/stdafx.h"
 
 #include "backends/fs/abstract-fs.h"
+#include "common/thread.h"
 #include "common/util.h"
 
 
@@ -42,7 +43,7 @@ FilesystemNode::FilesystemNode(const FilesystemNode &node) {
 	_realNode = node._realNode;
 	_refCount = node._refCount;
 	if (_refCount)
-		++(*_refCount);
+		Common::atomicIncrement(_refCount);
 }
 
 FilesystemNode::FilesystemNode(const Common::String &p) {
@@ -59,9 +60,9 @@ FilesystemNode::~FilesystemNode() {
 
 void FilesystemNode::decRefCount() {
 	if (_refCount) {
-		assert(*_refCount > 0);
-		--(*_refCount);
-		if (*_refCount == 0) {
+		const int refCount = Common::atomicDecrement(_refCount);
+		assert(refCount >= 0);
+		if (refCount == 0) {
 			delete _refCount;
 			delete _realNode;
 		}
@@ -70,7 +71,7 @@ void FilesystemNode::decRefCount() {
 
 FilesystemNode &FilesystemNode::operator  =(const FilesystemNode &node) {
 	if (node._refCount)
-		++(*node._refCount);
+		Common::atomicIncrement(node._refCount);
 
 	decRefCount();
 
@@ -61,15 +61,45 @@
 
 namespace Common { 
 
-// The table sizes ideally are primes. We use a helper function to find
-// suitable table sizes.
-uint nextTableSize(uint x);
+// The table sizes are powers of two, so the bucket of a hash value is simply
+// (hash & _mask). To make up for hash functions whose lower bits are not well
+// distributed, the higher bits of the hash are shifted into the probe
+// sequence ("perturbation", the scheme used by Python's dict).
+enum {
+	HASHMAP_PERTURB_SHIFT = 5,
+	HASHMAP_MIN_CAPACITY = 16,
+
+	// Default and allowed range of the maximal load factor, in percent.
+	HASHMAP_DEFAULT_LOAD_FACTOR = 75,
+	HASHMAP_MIN_LOAD_FACTOR = 10,
+	HASHMAP_MAX_LOAD_FACTOR = 90,
+
+	HASHMAP_PROBE_HISTOGRAM_SIZE = 8
+};
 
+// Marks a bucket whose node was erased (a "tombstone"). Lookups have to
+// continue probing past it, while insertions may reuse it.
+#define HASHMAP_DUMMY_NODE	((Node *)1)
 
-// Enable the following #define if you want to check how many collisions the
-// code produces (many collisions indicate either a bad hash function, or a
-// hash table that is too small).
-//#define DEBUG_HASH_COLLISIONS
+/**
+ * Runtime statistics of a HashMap, as filled in by HashMap::getStats().
+ */
+struct HashMapStats {
+	uint capacity;		///< number of buckets
+	uint size;			///< number of elements
+	uint deleted;		///< number of buckets holding a tombstone
+	uint load;			///< used buckets (elements and tombstones), in percent of capacity
+	uint maxLoad;		///< load which triggers a rehash, in percent of capacity
+	uint memoryUsage;	///< bytes allocated for the bucket array and all nodes
+
+	/**
+	 * Probe length histogram: probeHistogram[i] counts the elements which
+	 * are found with i+1 probes. The last entry also counts all elements
+	 * needing more probes than that.
+	 */
+	uint probeHistogram[HASHMAP_PROBE_HISTOGRAM_SIZE];
+	uint maxProbeLength;	///< longest probe sequence of any element
+};
 
 /**
  * HashMap<Key,Val> maps objects of type Key to objects of type Val.
@@ -83,6 +113,12 @@ uint nextTableSize(uint x);
  * referenced, for a new key. If the object is const, then an assertion is
  * triggered instead. Hence if you are not sure whether a key is contained in
  * the map, use contains() first to check for its presence.
+ *
+ * The map uses open addressing with a power of two table size. Erased
+ * elements leave a tombstone behind, so erase() never has to move other
+ * elements; tombstones are purged whenever the table is rehashed, which
+ * happens once elements plus tombstones exceed the maximal load factor
+ * (see setMaxLoadFactor()).
  */ 
 template <class Key, class Val, class HashFunc = Hash<Key>, class EqualFunc = EqualTo<Key> >
 class HashMap {
@@ -100,23 +136,28 @@ public:
 		Node(const Key &key) : _key(key) {}
 	};
 
-	Node **_arr;	// hashtable of size arrsize.
-	uint _arrsize, _nele;
+	Node **_arr;	// hashtable of size _mask + 1.
+	uint _mask, _nele, _deleted;
+	uint _maxLoadFactor;
 	
 	HashFunc _hash;
 	EqualFunc _equal;
 	
 	// Default value, returned by the const getVal.
 	const Val _defaultVal;
-	
-#ifdef DEBUG_HASH_COLLISIONS
-	mutable int _collisions, _lookups;
-#endif
+
+	static bool isLive(const Node *node) {
+		return node != NULL && node != HASHMAP_DUMMY_NODE;
+	}
 
 	void assign(const HM_t& map);
 	int lookup(const Key &key) const;
 	int lookupAndCreateIfMissing(const Key &key);
-	void expand_array(uint newsize);
+	void allocArray(uint capacity);
+	void rehash(uint newCapacity);
+	bool needsRehash() const {
+		return (_nele + _deleted) * 100 > (_mask + 1) * _maxLoadFactor;
+	}
 
 public:
 	class const_iterator {
@@ -130,7 +171,7 @@ public:
 		const Node *deref() const {
 			assert(_hashmap != 0);
 			Node *node = _hashmap->_arr[_idx];
-			assert(node != 0);
+			assert(isLive(node));
 			return node;
 		}
 
@@ -145,8 +186,8 @@ public:
 			assert(_hashmap);
 			do {
 				_idx++;
-			} while (_idx < _hashmap->_arrsize && _hashmap->_arr[_idx] == 0);
-			if (_idx >= _hashmap->_arrsize)
+			} while (_idx <= _hashmap->_mask && !isLive(_hashmap->_arr[_idx]));
+			if (_idx > _hashmap->_mask)
 				_idx = (uint)-1;
 			
 			return *this;
@@ -184,10 +225,25 @@ public:
 
 	uint size() const { return _nele; }
 
+	/**
+	 * Set the load factor (in percent of the table size) above which the
+	 * table is rehashed. Lower values trade memory for shorter probe
+	 * sequences. The value is clipped to the range
+	 * [HASHMAP_MIN_LOAD_FACTOR, HASHMAP_MAX_LOAD_FACTOR].
+	 */
+	void setMaxLoadFactor(uint percent);
+	uint getMaxLoadFactor() const { return _maxLoadFactor; }
+
+	/**
+	 * Fill in statistics about the current state of the table. This walks
+	 * the whole table, so it is meant for debugging and tuning only.
+	 */
+	void getStats(HashMapStats &stats) const;
+
 	const_iterator	begin() const {
 		// Find and return the first non-empty entry
-		for (uint ctr = 0; ctr < _arrsize; ++ctr) {
-			if (_arr[ctr])
+		for (uint ctr = 0; ctr <= _mask; ++ctr) {
+			if (isLive(_arr[ctr]))
 				return const_iterator(ctr, this);
 		}
 		return end();
@@ -218,18 +274,10 @@ public:
  */
 template <class Key, class Val, class HashFunc, class EqualFunc>
 HashMap<Key, Val, HashFunc, EqualFunc>::HashMap()
-	: _defaultVal() {
-	_arrsize = nextTableSize(0);
-	_arr = new Node *[_arrsize];
-	assert(_arr != NULL);
-	memset(_arr, 0, _arrsize * sizeof(Node *));
-
+	: _maxLoadFactor(HASHMAP_DEFAULT_LOAD_FACTOR), _defaultVal() {
+	allocArray(HASHMAP_MIN_CAPACITY);
 	_nele = 0;
-	
-#ifdef DEBUG_HASH_COLLISIONS
-	_collisions = 0;
-	_lookups = 0;
-#endif
+	_deleted = 0;
 }
 
 /**
@@ -248,13 +296,29 @@ HashMap<Key, Val, HashFunc, EqualFunc>::HashMap(const HM_t& map)
  */
 template <class Key, class Val, class HashFunc, class EqualFunc>
 HashMap<Key, Val, HashFunc, EqualFunc>::~HashMap() {
-	for (uint ctr = 0; ctr < _arrsize; ++ctr)
-		if (_arr[ctr] != NULL)
+	for (uint ctr = 0; ctr <= _mask; ++ctr)
+		if (isLive(_arr[ctr]))
 			delete _arr[ctr];
 
 	delete[] _arr;
 }
 
+/**
+ * Internal method for allocating an empty bucket array with the given
+ * capacity, which must be a power of two.
+ *
+ * @note We do *not* deallocate the previous storage here -- the caller is
+ *       responsible for doing that!
+ */
+template <class Key, class Val, class HashFunc, class EqualFunc>
+void HashMap<Key, Val, HashFunc, EqualFunc>::allocArray(uint capacity) {
+	assert(capacity >= HASHMAP_MIN_CAPACITY && (capacity & (capacity - 1)) == 0);
+	_mask = capacity - 1;
+	_arr = new Node *[capacity];
+	assert(_arr != NULL);
+	memset(_arr, 0, capacity * sizeof(Node *));
+}
+
 /**
  * Internal method for assigning the content of another HashMap
  * to this one.
@@ -264,73 +328,73 @@ HashMap<Key, Val, HashFunc, EqualFunc>::~HashMap() {
  */
 template <class Key, class Val, class HashFunc, class EqualFunc>
 void HashMap<Key, Val, HashFunc, EqualFunc>::assign(const HM_t& map) {
-	_arrsize = map._arrsize;
-	_arr = new Node *[_arrsize];
-	assert(_arr != NULL);
-	memset(_arr, 0, _arrsize * sizeof(Node *));
+	allocArray(map._mask + 1);
+	_maxLoadFactor = map._maxLoadFactor;
 
-	// Simply clone the map given to us, one by one.
+	// Simply clone the map given to us, one by one. Tombstones have to be
+	// kept, as they may be part of the probe sequence of other elements.
 	_nele = 0;
-	for (uint ctr = 0; ctr < _arrsize; ++ctr) {
-		if (map._arr[ctr] != NULL) {
+	_deleted = 0;
+	for (uint ctr = 0; ctr <= _mask; ++ctr) {
+		if (map._arr[ctr] == HASHMAP_DUMMY_NODE) {
+			_arr[ctr] = HASHMAP_DUMMY_NODE;
+			_deleted++;
+		} else if (map._arr[ctr] != NULL) {
 			_arr[ctr] = new Node(*map._arr[ctr]);
 			_nele++;
 		}
 	}
 	// Perform a sanity check (to help track down hashmap corruption)
 	assert(_nele == map._nele);
+	assert(_deleted == map._deleted);
 }
 
 
 template <class Key, class Val, class HashFunc, class EqualFunc>
 void HashMap<Key, Val, HashFunc, EqualFunc>::clear(bool shrinkArray) {
-	for (uint ctr = 0; ctr < _arrsize; ++ctr) {
-		if (_arr[ctr] != NULL) {
+	for (uint ctr = 0; ctr <= _mask; ++ctr) {
+		if (isLive(_arr[ctr]))
 			delete _arr[ctr];
-			_arr[ctr] = NULL;
-		}
+		_arr[ctr] = NULL;
 	}
 
-	if (shrinkArray && _arrsize > nextTableSize(0)) {
+	if (shrinkArray && _mask + 1 > HASHMAP_MIN_CAPACITY) {
 		delete[] _arr;
-
-		_arrsize = nextTableSize(0);
-		_arr = new Node *[_arrsize];
-		assert(_arr != NULL);
-		memset(_arr, 0, _arrsize * sizeof(Node *));
+		allocArray(HASHMAP_MIN_CAPACITY);
 	}
 
 	_nele = 0;
+	_deleted = 0;
 }
 
 template <class Key, class Val, class HashFunc, class EqualFunc>
-void HashMap<Key, Val, HashFunc, EqualFunc>::expand_array(uint newsize) {
-	assert(newsize > _arrsize);
-	uint ctr, dex;
+void HashMap<Key, Val, HashFunc, EqualFunc>::rehash(uint newCapacity) {
+	assert(newCapacity > _nele);
+	uint ctr, dex, perturb;
 
 	const uint old_nele = _nele;
-	const uint old_arrsize = _arrsize;
+	const uint old_capacity = _mask + 1;
 	Node **old_arr = _arr;
 
 	// allocate a new array 
+	allocArray(newCapacity);
 	_nele = 0;
-	_arrsize = newsize;
-	_arr = new Node *[_arrsize];
-	assert(_arr != NULL);
-	memset(_arr, 0, _arrsize * sizeof(Node *));
+	_deleted = 0;
 
-	// rehash all the old elements
-	for (ctr = 0; ctr < old_arrsize; ++ctr) {
-		if (old_arr[ctr] == NULL)
+	// rehash all the old elements, dropping any tombstones
+	for (ctr = 0; ctr < old_capacity; ++ctr) {
+		if (!isLive(old_arr[ctr]))
 			continue;
 
 		// Insert the element from the old table into the new table.
-		// Since we know that no key exists twice in the old table, we
-		// can do this slightly better than by calling lookup, since we
-		// don't have to call _equal().
-		dex = _hash(old_arr[ctr]->_key) % _arrsize;
-		while (_arr[dex] != NULL) {
-			dex = (dex + 1) % _arrsize;
+		// Since we know that no key exists twice in the old table, and
+		// that the new one has no tombstones, we can do this slightly
+		// better than by calling lookup, since we don't have to call
+		// _equal().
+		const uint hash = _hash(old_arr[ctr]->_key);
+		dex = hash & _mask;
+		for (perturb = hash; _arr[dex] != NULL; perturb >>= HASHMAP_PERTURB_SHIFT) {
+			dex = (5 * dex + perturb + 1) & _mask;
 		}
 
 		_arr[dex] = old_arr[ctr];
@@ -348,39 +412,58 @@ void HashMap<Key, Val, HashFunc, EqualFunc>::expand_array(uint newsize) {
 
 template <class Key, class Val, class HashFunc, class EqualFunc>
 int HashMap<Key, Val, HashFunc, EqualFunc>::lookup(const Key &key) const {
-	uint ctr = _hash(key) % _arrsize;
+	const uint hash = _hash(key);
+	uint ctr = hash & _mask;
 
-	while (_arr[ctr] != NULL && !_equal(_arr[ctr]->_key, key)) {
-		ctr = (ctr + 1) % _arrsize;
+	// The load factor guarantees that there is at least one empty bucket,
+	// so this loop always terminates.
+	for (uint perturb = hash; _arr[ctr] != NULL; perturb >>= HASHMAP_PERTURB_SHIFT) {
+		if (_arr[ctr] != HASHMAP_DUMMY_NODE && _equal(_arr[ctr]->_key, key))
+			break;
 
-#ifdef DEBUG_HASH_COLLISIONS
-		_collisions++;
-#endif
+		ctr = (5 * ctr + perturb + 1) & _mask;
 	}
-	
-#ifdef DEBUG_HASH_COLLISIONS
-	_lookups++;
-	fprintf(stderr, "collisions %d, lookups %d, ratio %f in HashMap %p; size %d num elements %d\n",
-		_collisions, _lookups, ((double) _collisions / (double)_lookups),
-		(const void *)this, _arrsize, _nele);
-#endif
 
 	return ctr;
 }
 
 template <class Key, class Val, class HashFunc, class EqualFunc>
 int HashMap<Key, Val, HashFunc, EqualFunc>::lookupAndCreateIfMissing(const Key &key) {
-	uint ctr = lookup(key);
+	const uint hash = _hash(key);
+	const uint NONE_FOUND = _mask + 1;
+	uint ctr = hash & _mask;
+	uint firstFree = NONE_FOUND;
+
+	for (uint perturb = hash; _arr[ctr] != NULL; perturb >>= HASHMAP_PERTURB_SHIFT) {
+		if (_arr[ctr] == HASHMAP_DUMMY_NODE) {
+			if (firstFree == NONE_FOUND)
+				firstFree = ctr;
+		} else if (_equal(_arr[ctr]->_key, key)) {
+			return ctr;
+		}
 
-	if (_arr[ctr] == NULL) {
-		_arr[ctr] = new Node(key);
-		_nele++;
+		ctr = (5 * ctr + perturb + 1) & _mask;
+	}
 
-		// Keep the load factor below 75%.
-		if (_nele > _arrsize * 75 / 100) {
-			expand_array(nextTableSize(_arrsize));
-			ctr = lookup(key);
-		}
+	// The key is not present yet. Reuse the first tombstone we passed, if
+	// any, otherwise the empty bucket which ended the probe sequence.
+	if (firstFree != NONE_FOUND) {
+		ctr = firstFree;
+		_deleted--;
+	}
+
+	_arr[ctr] = new Node(key);
+	_nele++;
+
+	if (needsRehash()) {
+		// Grow the table if it is filled mostly with actual elements;
+		// otherwise rehashing at the current size gets rid of enough
+		// tombstones.
+		uint capacity = _mask + 1;
+		if (_nele * 100 * 2 > capacity * _maxLoadFactor)
+			capacity *= 2;
+		rehash(capacity);
+		ctr = lookup(key);
 	}
 
 	return ctr;
@@ -406,7 +489,7 @@ const Val &HashMap<Key, Val, HashFunc, EqualFunc>::operator [](const Key &key) c
 template <class Key, class Val, class HashFunc, class EqualFunc>
 Val &HashMap<Key, Val, HashFunc, EqualFunc>::getVal(const Key &key) {
 	uint ctr = lookupAndCreateIfMissing(key);
-	assert(_arr[ctr] != NULL);
+	assert(isLive(_arr[ctr]));
 	return _arr[ctr]->_value;
 }
 
@@ -422,40 +505,68 @@ const Val &HashMap<Key, Val, HashFunc, EqualFunc>::getVal(const Key &key) const
 template <class Key, class Val, class HashFunc, class EqualFunc>
 void HashMap<Key, Val, HashFunc, EqualFunc>::setVal(const Key &key, const Val &val) {
 	uint ctr = lookupAndCreateIfMissing(key);
-	assert(_arr[ctr] != NULL);
+	assert(isLive(_arr[ctr]));
 	_arr[ctr]->_value = val;
 }
 
 template <class Key, class Val, class HashFunc, class EqualFunc>
 void HashMap<Key, Val, HashFunc, EqualFunc>::erase(const Key &key) {
-	// This is based on code in the Wikipedia article on Hash tables.
-	uint i = lookup(key);
-	if (_arr[i] == NULL)
+	uint ctr = lookup(key);
+	if (_arr[ctr] == NULL)
 		return; // key wasn't present, so no work has to be done
-	// If we remove a key, we must check all subsequent keys and possibly
-	// reinsert them.
-	uint j = i;
-	delete _arr[i];
-	_arr[i] = NULL;
-	while (true) {
-		// Look at the next table slot
-		j = (j + 1) % _arrsize;
-		// If the next slot is empty, we are done
-		if (_arr[j] == NULL)
-			break;
-		// Compute the slot where the content of the next slot should normally be,
-		// assuming an empty table, and check whether we have to move it.
-		uint k = _hash(_arr[j]->_key) % _arrsize;
-		if ((j > i && (k <= i || k > j)) ||
-		    (j < i && (k <= i && k > j)) ) {
-			_arr[i] = _arr[j];
-			i = j;
+
+	// Leave a tombstone behind, so that the probe sequences of the
+	// elements following this one stay intact.
+	delete _arr[ctr];
+	_arr[ctr] = HASHMAP_DUMMY_NODE;
+	_nele--;
+	_deleted++;
+}
+
+template <class Key, class Val, class HashFunc, class EqualFunc>
+void HashMap<Key, Val, HashFunc, EqualFunc>::setMaxLoadFactor(uint percent) {
+	_maxLoadFactor = CLIP<uint>(percent, HASHMAP_MIN_LOAD_FACTOR, HASHMAP_MAX_LOAD_FACTOR);
+
+	if (needsRehash()) {
+		uint capacity = _mask + 1;
+		while (_nele * 100 * 2 > capacity * _maxLoadFactor)
+			capacity *= 2;
+		rehash(capacity);
+	}
+}
+
+template <class Key, class Val, class HashFunc, class EqualFunc>
+void HashMap<Key, Val, HashFunc, EqualFunc>::getStats(HashMapStats &stats) const {
+	memset(&stats, 0, sizeof(stats));
+
+	stats.capacity = _mask + 1;
+	stats.size = _nele;
+	stats.deleted = _deleted;
+	stats.load = (_nele + _deleted) * 100 / stats.capacity;
+	stats.maxLoad = _maxLoadFactor;
+	stats.memoryUsage = (uint)(sizeof(*this) + stats.capacity * sizeof(Node *) + _nele * sizeof(Node));
+
+	for (uint ctr = 0; ctr <= _mask; ++ctr) {
+		if (!isLive(_arr[ctr]))
+			continue;
+
+		// Replay the probe sequence of this element to measure its length.
+		const uint hash = _hash(_arr[ctr]->_key);
+		uint dex = hash & _mask;
+		uint probes = 1;
+		for (uint perturb = hash; dex != ctr; perturb >>= HASHMAP_PERTURB_SHIFT) {
+			dex = (5 * dex + perturb + 1) & _mask;
+			probes++;
 		}
+
+		stats.probeHistogram[MIN<uint>(probes, HASHMAP_PROBE_HISTOGRAM_SIZE) - 1]++;
+		if (probes > stats.maxProbeLength)
+			stats.maxProbeLength = probes;
 	}
-	_arr[i] = NULL;
-	return;
 }
 
 }	// End of namespace Common
 
+#undef HASHMAP_DUMMY_NODE
+
 #endif
@@ -254,7 +254,15 @@ bool md5_file(const FilesystemNode &file, uint8 digest[16], uint32 length) {
 		return false;
 	}
 
-	return md5_file(file.path().c_str(), digest, length);
+	// Open the node directly, instead of searching for its path in the
+	// default directories.
+	File f;
+	if (!f.open(file)) {
+		warning("md5_file couldn't open '%s'", file.path().c_str());
+		return false;
+	}
+
+	return md5_file(f, digest, length);
 }
 
 bool md5_file(const char *name, uint8 digest[16], uint32 length) {
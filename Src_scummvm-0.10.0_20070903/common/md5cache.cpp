@@ -0,0 +1,184 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+#include "common/stdafx.h"
+
+#include "common/md5cache.h"
+#include "common/file.h"
+#include "common/md5.h"
+#include "common/util.h"
+
+#if defined(UNIX) || (defined(WIN32) && !defined(_WIN32_WCE))
+#define HAVE_FILE_MTIME
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif
+
+DECLARE_SINGLETON(Common::MD5Cache);
+
+#define MAXLINELEN 1024
+
+namespace Common {
+
+static const char *const kCacheHeader = "# ScummVM MD5 cache v1";
+
+static bool getFileStamp(const String &path, uint32 &size, uint32 &mtime) {
+#ifdef HAVE_FILE_MTIME
+	struct stat st;
+	if (stat(path.c_str(), &st) != 0)
+		return false;
+	size = (uint32)st.st_size;
+	mtime = (uint32)st.st_mtime;
+	return true;
+#else
+	return false;
+#endif
+}
+
+static String makeKey(const String &path, uint32 length) {
+	char buf[16];
+	snprintf(buf, sizeof(buf), "%u\t", length);
+	return String(buf) + path;
+}
+
+MD5Cache::MD5Cache()
+	: _dirty(false), _hits(0), _misses(0) {
+}
+
+void MD5Cache::loadCacheFile(const String &filename) {
+	StackLock lock(_mutex);
+
+	_entries.clear();
+	_filename = filename;
+	_dirty = false;
+
+	File file;
+	if (!file.open(filename))
+		return;
+
+	char buf[MAXLINELEN];
+	if (!file.readLine(buf, MAXLINELEN) || strcmp(buf, kCacheHeader) != 0) {
+		warning("Ignoring MD5 cache '%s' with unknown format", filename.c_str());
+		_dirty = true;
+		return;
+	}
+
+	// Each line has the form "<length> <size> <mtime> <md5> <path>", with
+	// the fields separated by tabs. The path comes last, so that it may
+	// contain any character but a line break.
+	while (!file.eof() && file.readLine(buf, MAXLINELEN)) {
+		char md5[32 + 1];
+		unsigned int length, size, mtime;
+		int pathOffset = 0;
+
+		if (sscanf(buf, "%u\t%u\t%u\t%32s\t%n", &length, &size, &mtime, md5, &pathOffset) != 4 ||
+				pathOffset == 0 || strlen(md5) != 32) {
+			debug(2, "MD5Cache: skipping malformed line '%s'", buf);
+			continue;
+		}
+
+		Entry entry;
+		entry.size = size;
+		entry.mtime = mtime;
+		entry.md5 = md5;
+		_entries[makeKey(buf + pathOffset, length)] = entry;
+	}
+}
+
+void MD5Cache::flushToDisk() {
+	StackLock lock(_mutex);
+
+	if (!_dirty || _filename.empty())
+		return;
+
+	File file;
+	if (!file.open(_filename, File::kFileWriteMode)) {
+		warning("Unable to write MD5 cache file: %s", _filename.c_str());
+		return;
+	}
+
+	file.writeString(kCacheHeader);
+	file.writeByte('\n');
+
+	char buf[64];
+	for (EntryMap::const_iterator i = _entries.begin(); i != _entries.end(); ++i) {
+		// The key already is "<length>\t<path>".
+		const char *key = i->_key.c_str();
+		const char *path = strchr(key, '\t') + 1;
+
+		snprintf(buf, sizeof(buf), "%.*s%u\t%u\t%s\t", (int)(path - key), key,
+				i->_value.size, i->_value.mtime, i->_value.md5.c_str());
+		file.writeString(buf);
+		file.writeString(path);
+		file.writeByte('\n');
+	}
+
+	_dirty = false;
+}
+
+void MD5Cache::clear() {
+	StackLock lock(_mutex);
+
+	_entries.clear();
+	_dirty = true;
+}
+
+bool MD5Cache::md5FileString(const FilesystemNode &file, char *md5str, uint32 length) {
+	const String path(file.path());
+	uint32 size, mtime;
+
+	if (!getFileStamp(path, size, mtime))
+		return md5_file_string(file, md5str, length);
+
+	const String key(makeKey(path, length));
+	{
+		StackLock lock(_mutex);
+		if (_entries.contains(key)) {
+			const Entry &entry = _entries[key];
+			if (entry.size == size && entry.mtime == mtime) {
+				strcpy(md5str, entry.md5.c_str());
+				_hits++;
+				return true;
+			}
+		}
+		_misses++;
+	}
+
+	// Hash the file without holding the lock, so other threads can use
+	// the cache in the meantime.
+	if (!md5_file_string(file, md5str, length))
+		return false;
+
+	StackLock lock(_mutex);
+	Entry &entry = _entries[key];
+	entry.size = size;
+	entry.mtime = mtime;
+	entry.md5 = md5str;
+	_dirty = true;
+
+	return true;
+}
+
+}	// End of namespace Common
@@ -0,0 +1,101 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+#ifndef COMMON_MD5CACHE_H
+#define COMMON_MD5CACHE_H
+
+#include "common/stdafx.h"
+#include "common/scummsys.h"
+#include "common/fs.h"
+#include "common/hashmap.h"
+#include "common/hash-str.h"
+#include "common/mutex.h"
+#include "common/singleton.h"
+#include "common/str.h"
+
+namespace Common {
+
+/**
+ * Persistent cache of file MD5 sums, used by the game detectors.
+ *
+ * Entries are keyed by the full path of a file and the number of bytes
+ * hashed, and are only considered valid while the size and modification
+ * time of the file match the recorded ones. On platforms where the
+ * modification time of a file can't be queried, the cache is bypassed
+ * and every MD5 is computed from scratch.
+ *
+ * md5FileString() may be called from several threads at once, e.g. by
+ * game detectors running in parallel.
+ */
+class MD5Cache : public Singleton<MD5Cache> {
+public:
+	/**
+	 * Load the cache from the given file. Any entries loaded before are
+	 * discarded. A missing or unreadable file simply results in an empty
+	 * cache.
+	 */
+	void loadCacheFile(const String &filename);
+
+	/** Write the cache back to disk, if any entry changed since loading. */
+	void flushToDisk();
+
+	/** Forget all cached sums, forcing them to be recomputed. */
+	void clear();
+
+	/**
+	 * Works like md5_file_string(), but takes the result from the cache if
+	 * the file did not change since it was hashed, and records newly
+	 * computed sums.
+	 */
+	bool md5FileString(const FilesystemNode &file, char *md5str, uint32 length = 0);
+
+	uint getHits() const { return _hits; }
+	uint getMisses() const { return _misses; }
+
+private:
+	friend class Singleton<SingletonBaseType>;
+	MD5Cache();
+
+	struct Entry {
+		uint32 size;
+		uint32 mtime;
+		String md5;
+	};
+
+	typedef HashMap<String, Entry, CaseSensitiveString_Hash, CaseSensitiveString_EqualTo> EntryMap;
+
+	EntryMap _entries;
+	Mutex _mutex;
+	String _filename;
+	bool _dirty;
+	uint _hits, _misses;
+};
+
+}	// End of namespace Common
+
+/** Shortcut for accessing the MD5 cache. */
+#define MD5Man		Common::MD5Cache::instance()
+
+#endif
@@ -4,15 +4,19 @@ MODULE_OBJS := \
 	advancedDetector.o \
 	config-file.o \
 	config-manager.o \
+	cpu.o \
 	file.o \
 	fs.o \
 	hashmap.o \
 	md5.o \
+	md5cache.o \
 	mutex.o \
+	packbits.o \
 	str.o \
 	stream.o \
 	util.o \
 	system.o \
+	thread.o \
 	unzip.o
 
 # Include common rules 
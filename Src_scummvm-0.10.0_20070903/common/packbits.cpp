@@ -0,0 +1,62 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+#include "common/stdafx.h"
+#include "common/packbits.h"
+
+namespace Common {
+
+uint32 packBits(const byte *src, uint32 size, byte *dst) {
+	byte *out = dst;
+	uint32 i = 0;
+
+	while (i < size) {
+		uint32 run = 1;
+		while (i + run < size && run < 128 && src[i + run] == src[i])
+			run++;
+
+		if (run >= 3) {
+			*out++ = (byte)(257 - run);
+			*out++ = src[i];
+			i += run;
+			continue;
+		}
+
+		// Copy literally up to the start of the next run worth encoding
+		const uint32 start = i;
+		while (i < size && i - start < 128) {
+			if (i + 2 < size && src[i] == src[i + 1] && src[i] == src[i + 2])
+				break;
+			i++;
+		}
+		*out++ = (byte)(i - start - 1);
+		memcpy(out, src + start, i - start);
+		out += i - start;
+	}
+
+	return (uint32)(out - dst);
+}
+
+} // End of namespace Common
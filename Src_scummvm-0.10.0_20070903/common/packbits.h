@@ -0,0 +1,47 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+#ifndef COMMON_PACKBITS_H
+#define COMMON_PACKBITS_H
+
+#include "common/scummsys.h"
+
+namespace Common {
+
+/**
+ * Compress data with PackBits: a control byte c in [0, 127] is followed by
+ * c + 1 literal bytes; c in [129, 255] is followed by a byte that is
+ * repeated 257 - c times. The control byte 128 is never written. Runs of
+ * at least three equal bytes are stored as runs, everything else literally.
+ *
+ * @param dst	the output buffer, which must hold at least
+ *				size + (size + 127) / 128 bytes
+ * @return the size of the compressed data
+ */
+uint32 packBits(const byte *src, uint32 size, byte *dst);
+
+} // End of namespace Common
+
+#endif
@@ -26,6 +26,7 @@
 
 #include "common/str.h"
 #include "common/hash-str.h"
+#include "common/thread.h"
 #include "common/util.h"
 
 namespace Common {
@@ -102,21 +103,22 @@ String::~String() {
 
 void String::incRefCount() const {
 	assert(!isStorageIntern());
-	if (_extern._refCount == 0) {
-		_extern._refCount = new int(2);
-	} else {
-		++(*_extern._refCount);
+	if (atomicLoad(&_extern._refCount) == 0) {
+		// If another thread copies this string at the same time and
+		// allocates the count first, share that one instead
+		int *refCount = new int(2);
+		if (atomicCompareAndSwap(&_extern._refCount, 0, refCount))
+			return;
+		delete refCount;
 	}
+	atomicIncrement(atomicLoad(&_extern._refCount));
 }
 
 void String::decRefCount(int *oldRefCount) {
 	if (isStorageIntern())
 		return;
 
-	if (oldRefCount) {
-		--(*oldRefCount);
-	}
-	if (!oldRefCount || *oldRefCount <= 0) {
+	if (!oldRefCount || atomicDecrement(oldRefCount) <= 0) {
 		// The ref count reached zero, so we free the string storage
 		// and the ref count storage.
 		delete oldRefCount;
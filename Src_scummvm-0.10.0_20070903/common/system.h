@@ -28,6 +28,7 @@
 
 #include "common/scummsys.h"
 #include "common/mutex.h"
+#include "common/thread.h"
 #include "common/noncopyable.h"
 #include "common/rect.h"
 
@@ -708,6 +709,15 @@ public:
 	/** Get the number of milliseconds since the program was started. */
 	virtual uint32 getMillis() = 0;
 
+	/**
+	 * Get the number of microseconds since the program was started. The
+	 * value wraps around after about 71 minutes, so only differences
+	 * between two values are meaningful. The default implementation is
+	 * based on getMillis(); backends with access to a finer clock should
+	 * override it.
+	 */
+	virtual uint32 getMicros() { return getMillis() * 1000; }
+
 	/** Delay/sleep for the specified amount of milliseconds. */
 	virtual void delayMillis(uint msecs) = 0;
 
@@ -774,6 +784,66 @@ public:
 
 
 
+	/**
+	 * @name Threads
+	 * Optional support for running work on additional threads. It is only
+	 * used to speed up batches of independent jobs (see Common::WorkerPool),
+	 * which fall back to running on the calling thread if the backend does
+	 * not provide threads or semaphores. Hence
+	 * backends are free to keep the default implementations below.
+	 */
+	//@{
+
+	typedef Common::ThreadRef	ThreadRef;
+	typedef Common::ThreadProc	ThreadProc;
+	typedef Common::SemaphoreRef	SemaphoreRef;
+
+	/**
+	 * Create a new thread, which immediately starts running proc(param).
+	 * @return the new thread, or 0 if threads are not supported or an error occured.
+	 */
+	virtual ThreadRef createThread(ThreadProc proc, void *param) { return 0; }
+
+	/**
+	 * Wait for the given thread to finish, and free its resources.
+	 * @param thread	a thread returned by createThread.
+	 */
+	virtual void joinThread(ThreadRef thread) {}
+
+	/**
+	 * Return the number of CPUs (cores) available for running threads.
+	 */
+	virtual uint getNumberOfCPUs() { return 1; }
+
+	/**
+	 * Create a new semaphore.
+	 * @param initialValue	the initial value of the semaphore
+	 * @return the new semaphore, or 0 if semaphores are not supported or an error occured.
+	 */
+	virtual SemaphoreRef createSemaphore(uint initialValue) { return 0; }
+
+	/**
+	 * Increment the value of the given semaphore, waking up a thread waiting for it.
+	 * @param sem	a semaphore returned by createSemaphore.
+	 */
+	virtual void postSemaphore(SemaphoreRef sem) {}
+
+	/**
+	 * Wait until the value of the given semaphore is greater than zero, then decrement it.
+	 * @param sem	a semaphore returned by createSemaphore.
+	 */
+	virtual void waitSemaphore(SemaphoreRef sem) {}
+
+	/**
+	 * Delete the given semaphore. No thread may be waiting for it.
+	 * @param sem	a semaphore returned by createSemaphore.
+	 */
+	virtual void deleteSemaphore(SemaphoreRef sem) {}
+
+	//@}
+
+
+
 	/** @name Sound */
 	//@{
 
@@ -0,0 +1,141 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+#include "common/stdafx.h"
+#include "common/thread.h"
+#include "common/system.h"
+#include "common/util.h"
+
+namespace Common {
+
+WorkerPool::WorkerPool()
+	: _numThreads(1), _startSem(0), _doneSem(0), _jobMutex(0),
+	_jobProc(0), _jobParam(0), _numJobs(0), _nextJob(0), _quit(false) {
+}
+
+WorkerPool::~WorkerPool() {
+	stop();
+}
+
+uint WorkerPool::start(uint maxThreads) {
+	stop();
+
+	if (maxThreads == 0)
+		maxThreads = g_system->getNumberOfCPUs();
+	maxThreads = MIN<uint>(maxThreads, kMaxThreads);
+	if (maxThreads <= 1)
+		return _numThreads;
+
+	_startSem = g_system->createSemaphore(0);
+	_doneSem = g_system->createSemaphore(0);
+	_jobMutex = g_system->createMutex();
+	if (!_startSem || !_doneSem || !_jobMutex) {
+		stop();
+		return _numThreads;
+	}
+
+	// If the backend fails to create (some of) the threads, make do with
+	// the others, and in the worst case with the calling thread alone.
+	_quit = false;
+	while (_numThreads < maxThreads) {
+		_threads[_numThreads] = g_system->createThread(threadProc, this);
+		if (!_threads[_numThreads])
+			break;
+		_numThreads++;
+	}
+
+	return _numThreads;
+}
+
+void WorkerPool::stop() {
+	_quit = true;
+	for (uint i = 1; i < _numThreads; ++i)
+		g_system->postSemaphore(_startSem);
+	for (uint i = 1; i < _numThreads; ++i)
+		g_system->joinThread(_threads[i]);
+	_numThreads = 1;
+
+	if (_startSem)
+		g_system->deleteSemaphore(_startSem);
+	if (_doneSem)
+		g_system->deleteSemaphore(_doneSem);
+	if (_jobMutex)
+		g_system->deleteMutex(_jobMutex);
+	_startSem = _doneSem = 0;
+	_jobMutex = 0;
+}
+
+int WorkerPool::threadProc(void *param) {
+	WorkerPool *pool = (WorkerPool *)param;
+
+	while (true) {
+		g_system->waitSemaphore(pool->_startSem);
+		if (pool->_quit)
+			break;
+		pool->runJobs();
+		g_system->postSemaphore(pool->_doneSem);
+	}
+
+	return 0;
+}
+
+void WorkerPool::runJobs() {
+	while (true) {
+		g_system->lockMutex(_jobMutex);
+		const uint job = _nextJob;
+		if (job < _numJobs)
+			_nextJob++;
+		g_system->unlockMutex(_jobMutex);
+
+		if (job >= _numJobs)
+			break;
+		_jobProc(_jobParam, job);
+	}
+}
+
+void WorkerPool::run(JobProc jobProc, void *param, uint numJobs) {
+	const uint numHelpers = (numJobs > 0) ? MIN<uint>(_numThreads, numJobs) - 1 : 0;
+
+	if (numHelpers == 0) {
+		for (uint job = 0; job < numJobs; ++job)
+			jobProc(param, job);
+		return;
+	}
+
+	// The semaphores make the job description visible to the helpers, and
+	// their work visible to us
+	_jobProc = jobProc;
+	_jobParam = param;
+	_numJobs = numJobs;
+	_nextJob = 0;
+
+	for (uint i = 0; i < numHelpers; ++i)
+		g_system->postSemaphore(_startSem);
+	runJobs();
+	for (uint i = 0; i < numHelpers; ++i)
+		g_system->waitSemaphore(_doneSem);
+}
+
+}	// End of namespace Common
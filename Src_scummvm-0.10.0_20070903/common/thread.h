@@ -0,0 +1,189 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+#ifndef COMMON_THREAD_H
+#define COMMON_THREAD_H
+
+#include "common/scummsys.h"
+#include "common/mutex.h"
+
+namespace Common {
+
+/**
+ * An pseudo-opaque thread type. See OSystem::createThread etc. for more details.
+ */
+typedef struct OpaqueThread *ThreadRef;
+
+/**
+ * An pseudo-opaque semaphore type. See OSystem::createSemaphore etc. for more details.
+ */
+typedef struct OpaqueSemaphore *SemaphoreRef;
+
+/**
+ * Entry point of a thread created via OSystem::createThread.
+ */
+typedef int (*ThreadProc)(void *param);
+
+/**
+ * A job run by WorkerPool::run(). It is called once for every job index.
+ */
+typedef void (*JobProc)(void *param, uint job);
+
+/**
+ * A pool of threads which runs batches of independent jobs. The threads are
+ * created only once, in start(); in between batches they wait on a
+ * semaphore. This suits code which runs small batches very often, or which
+ * must not wait for threads to be created, like the audio code, and it is
+ * just as good for running a single batch.
+ *
+ * If the backend can't create threads or semaphores, or if only one thread
+ * is to be used, run() simply runs the jobs one after another, in order, on
+ * the calling thread.
+ */
+class WorkerPool {
+public:
+	enum {
+		kMaxThreads = 16
+	};
+
+	WorkerPool();
+	~WorkerPool();
+
+	/**
+	 * Create the threads of the pool.
+	 *
+	 * @param maxThreads	the maximal number of threads to use, including the
+	 *						one calling run(); 0 means one per CPU
+	 * @return the number of threads run() will use, including the calling one
+	 */
+	uint start(uint maxThreads = 0);
+
+	/**
+	 * Stop the threads of the pool and wait for them to end. Afterwards,
+	 * run() works on the calling thread alone, until start() is called again.
+	 */
+	void stop();
+
+	/** Get the number of threads run() uses, including the calling one. */
+	uint getNumThreads() const { return _numThreads; }
+
+	/**
+	 * Run a batch of jobs: jobProc is called with every index in the range
+	 * [0, numJobs) exactly once, in no particular order and possibly from
+	 * different threads at the same time. The calling thread takes part in
+	 * the work; run() only returns once all jobs have been completed. Only
+	 * one thread at a time may call run().
+	 */
+	void run(JobProc jobProc, void *param, uint numJobs);
+
+private:
+	static int threadProc(void *param);
+	void runJobs();
+
+	uint _numThreads;
+	ThreadRef _threads[kMaxThreads];
+	SemaphoreRef _startSem, _doneSem;
+	MutexRef _jobMutex;
+
+	JobProc _jobProc;
+	void *_jobParam;
+	uint _numJobs, _nextJob;
+	bool _quit;
+};
+
+/**
+ * Full memory barrier: no memory access after it is performed before the
+ * memory accesses preceding it are complete. This is what lock-free data
+ * shared between two threads needs in addition to volatile variables.
+ * HAVE_MEMORY_BARRIER is only defined if the compiler provides a barrier;
+ * code relying on it must fall back to locking or a single thread otherwise.
+ */
+#if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1))
+#define HAVE_MEMORY_BARRIER
+inline void memoryBarrier() { __sync_synchronize(); }
+#elif defined(_MSC_VER) && _MSC_VER >= 1400 && (defined(_M_IX86) || defined(_M_X64))
+// x86 does not reorder stores with other stores, nor loads with other
+// loads, so preventing the compiler from reordering is sufficient.
+#define HAVE_MEMORY_BARRIER
+extern "C" void _ReadWriteBarrier();
+#pragma intrinsic(_ReadWriteBarrier)
+inline void memoryBarrier() { _ReadWriteBarrier(); }
+#else
+inline void memoryBarrier() {}
+#endif
+
+/**
+ * Atomic updates of reference counts, which make it safe to copy objects
+ * sharing one count (like String and FilesystemNode) on several threads at
+ * once. atomicIncrement and atomicDecrement return the new value.
+ * atomicLoad reads a pointer to a count which another thread may have set
+ * with atomicCompareAndSwap, which sets *ptr to newVal if it equals oldVal
+ * and returns whether it did. HAVE_ATOMIC_COUNTERS is only defined if the
+ * compiler provides atomic operations; otherwise these are plain accesses,
+ * which are only safe on a single thread.
+ */
+#if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1))
+#define HAVE_ATOMIC_COUNTERS
+inline int atomicIncrement(int *count) { return __sync_add_and_fetch(count, 1); }
+inline int atomicDecrement(int *count) { return __sync_sub_and_fetch(count, 1); }
+inline bool atomicCompareAndSwap(int **ptr, int *oldVal, int *newVal) { return __sync_bool_compare_and_swap(ptr, oldVal, newVal); }
+#if __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7)
+inline int *atomicLoad(int *const *ptr) { return __atomic_load_n(ptr, __ATOMIC_ACQUIRE); }
+#else
+inline int *atomicLoad(int *const *ptr) { int *val = *(int *const volatile *)ptr; __sync_synchronize(); return val; }
+#endif
+#elif defined(_MSC_VER) && _MSC_VER >= 1400 && (defined(_M_IX86) || defined(_M_X64))
+#define HAVE_ATOMIC_COUNTERS
+extern "C" long _InterlockedIncrement(long volatile *);
+extern "C" long _InterlockedDecrement(long volatile *);
+#pragma intrinsic(_InterlockedIncrement, _InterlockedDecrement)
+inline int atomicIncrement(int *count) { return (int)_InterlockedIncrement((long volatile *)count); }
+inline int atomicDecrement(int *count) { return (int)_InterlockedDecrement((long volatile *)count); }
+#if defined(_M_X64)
+extern "C" void *_InterlockedCompareExchangePointer(void *volatile *, void *, void *);
+#pragma intrinsic(_InterlockedCompareExchangePointer)
+inline bool atomicCompareAndSwap(int **ptr, int *oldVal, int *newVal) { return _InterlockedCompareExchangePointer((void *volatile *)ptr, newVal, oldVal) == oldVal; }
+#else
+extern "C" long _InterlockedCompareExchange(long volatile *, long, long);
+#pragma intrinsic(_InterlockedCompareExchange)
+inline bool atomicCompareAndSwap(int **ptr, int *oldVal, int *newVal) { return _InterlockedCompareExchange((long volatile *)ptr, (long)newVal, (long)oldVal) == (long)oldVal; }
+#endif
+// Volatile reads have acquire semantics with MSVC
+inline int *atomicLoad(int *const *ptr) { return *(int *const volatile *)ptr; }
+#else
+inline int atomicIncrement(int *count) { return ++*count; }
+inline int atomicDecrement(int *count) { return --*count; }
+inline bool atomicCompareAndSwap(int **ptr, int *oldVal, int *newVal) {
+	if (*ptr != oldVal)
+		return false;
+	*ptr = newVal;
+	return true;
+}
+inline int *atomicLoad(int *const *ptr) { return *ptr; }
+#endif
+
+}	// End of namespace Common
+
+#endif
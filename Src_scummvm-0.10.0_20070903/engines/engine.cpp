@@ -37,7 +37,10 @@
 #include "common/savefile.h"
 #include "common/system.h"
 #include "gui/message.h"
+#include "sound/decodethread.h"
 #include "sound/mixer.h"
+#include "sound/rate.h"
+#include "sound/soundcache.h"
 
 #ifdef _WIN32_WCE
 extern bool isSmartphone(void);
@@ -58,11 +61,19 @@ Engine::Engine(OSystem *syst)
 
 	g_engine = this;
 	_autosavePeriod = ConfMan.getInt("autosave_period");
+
+	// Set up how the sounds this engine plays are decoded and resampled
+	Audio::setRateConverterType(Audio::parseRateConverterType(ConfMan.get("resampler").c_str()));
+	Audio::setDecodeLookahead(ConfMan.getInt("audio_lookahead"));
+	SoundCache.setMemoryBudget(ConfMan.getInt("sfx_cache_size") * 1024);
 }
 
 Engine::~Engine() {
 	_mixer->stopAll();
 
+	// The next game may use files with the same names
+	SoundCache.clear();
+
 	g_engine = NULL;
 }
 
@@ -31,6 +31,7 @@
 #include "common/fs.h"
 #include "common/list.h"
 #include "common/md5.h"
+#include "common/md5cache.h"
 
 #include "scumm/detection.h"
 #include "scumm/detection_tables.h"
@@ -372,7 +373,7 @@ static void detectGames(const FSList &fslist, Common::List<DetectorResult> &resu
 		//
 		DetectorDesc &d = fileMD5Map[file];
 		if (d.md5.empty()) {
-			if (Common::md5_file_string(d.node, md5str, kMD5FileSizeLimit)) {
+			if (MD5Man.md5FileString(d.node, md5str, kMD5FileSizeLimit)) {
 
 				d.md5 = md5str;
 				d.md5Entry = findInMD5Table(md5str);
@@ -198,9 +198,11 @@ int Player::start_seq_sound(int sound, bool reset_vars) {
 	} else if (!memcmp(ptr, "FORM", 4)) {
 		// Humongous Games XMIDI resource
 		_parser = MidiParser::createParser_XMIDI();
+		_parser->property(MidiParser::mpIndexEvents, 1);
 	} else {
 		// SCUMM SMF resource
 		_parser = MidiParser::createParser_SMF();
+		_parser->property(MidiParser::mpIndexEvents, 1);
 	}
 
 	_parser->setMidiDriver(this);
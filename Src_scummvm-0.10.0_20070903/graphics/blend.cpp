@@ -0,0 +1,202 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+#include "common/stdafx.h"
+#include "graphics/blend.h"
+#include "graphics/colormasks.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USE_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define USE_NEON
+#include <arm_neon.h>
+#endif
+
+namespace Graphics {
+
+void copyKeyedRow(uint16 *dst, const uint16 *src, int width, uint16 key, uint16 mask) {
+	int x = 0;
+
+#if defined(USE_SSE2)
+	const __m128i vkey = _mm_set1_epi16((int16)key);
+	const __m128i vmask = _mm_set1_epi16((int16)mask);
+	for (; x + 8 <= width; x += 8) {
+		const __m128i s = _mm_loadu_si128((const __m128i *)(src + x));
+		const __m128i d = _mm_loadu_si128((const __m128i *)(dst + x));
+		const __m128i keep = _mm_cmpeq_epi16(s, vkey);
+		const __m128i out = _mm_and_si128(s, vmask);
+		_mm_storeu_si128((__m128i *)(dst + x), _mm_or_si128(_mm_and_si128(keep, d), _mm_andnot_si128(keep, out)));
+	}
+#elif defined(USE_NEON)
+	const uint16x8_t vkey = vdupq_n_u16(key);
+	const uint16x8_t vmask = vdupq_n_u16(mask);
+	for (; x + 8 <= width; x += 8) {
+		const uint16x8_t s = vld1q_u16(src + x);
+		const uint16x8_t keep = vceqq_u16(s, vkey);
+		vst1q_u16(dst + x, vbslq_u16(keep, vld1q_u16(dst + x), vandq_u16(s, vmask)));
+	}
+#endif
+
+	for (; x < width; x++) {
+		if (src[x] != key)
+			dst[x] = src[x] & mask;
+	}
+}
+
+/**
+ * Blend a single pixel. The channels are blended in place, without being
+ * shifted down; this gives the same result as blending the channel values,
+ * since the bits below each channel are masked away.
+ */
+template<class T>
+static inline uint16 blendPixel(uint16 col1, uint16 col2, int alpha) {
+	int output = 0;
+	output |= ((alpha * ((col1 & T::kRedMask) - (col2 & T::kRedMask)) >> 8) + (col2 & T::kRedMask)) & T::kRedMask;
+	output |= ((alpha * ((col1 & T::kGreenMask) - (col2 & T::kGreenMask)) >> 8) + (col2 & T::kGreenMask)) & T::kGreenMask;
+	output |= ((alpha * ((col1 & T::kBlueMask) - (col2 & T::kBlueMask)) >> 8) + (col2 & T::kBlueMask)) & T::kBlueMask;
+	output |= ~(T::kRedMask | T::kGreenMask | T::kBlueMask);
+	return (uint16)output;
+}
+
+template<class T>
+static void blendKeyedRowImpl(uint16 *dst, const uint16 *src, int width, uint16 key, uint16 mask, int alpha, bool invert) {
+	const uint16 invertBits = invert ? 0xFFFF : 0;
+	int x = 0;
+
+	// In the vector loops, the channels are shifted down, so that the
+	// products of 8 bit alpha values and 6 bit channels fit into 16 bits.
+	// For alpha in [0, 256], alpha * (a - b) / 256 + b rounded down is the
+	// same as (alpha * a + (256 - alpha) * b) / 256 rounded down.
+#if defined(USE_SSE2)
+	const __m128i vkey = _mm_set1_epi16((int16)key);
+	const __m128i vmask = _mm_set1_epi16((int16)mask);
+	const __m128i vinvert = _mm_set1_epi16((int16)invertBits);
+	const __m128i valpha = _mm_set1_epi16((int16)alpha);
+	const __m128i vbeta = _mm_set1_epi16((int16)(256 - alpha));
+	const __m128i redMax = _mm_set1_epi16((1 << T::kRedBits) - 1);
+	const __m128i greenMax = _mm_set1_epi16((1 << T::kGreenBits) - 1);
+	const __m128i blueMax = _mm_set1_epi16((1 << T::kBlueBits) - 1);
+	const __m128i extra = _mm_set1_epi16((int16)(uint16)~(T::kRedMask | T::kGreenMask | T::kBlueMask));
+	for (; x + 8 <= width; x += 8) {
+		const __m128i s = _mm_loadu_si128((const __m128i *)(src + x));
+		const __m128i d = _mm_loadu_si128((const __m128i *)(dst + x));
+		const __m128i keep = _mm_cmpeq_epi16(s, vkey);
+		const __m128i a = _mm_xor_si128(_mm_and_si128(s, vmask), vinvert);
+
+#define BLEND_CHANNEL(shift, max) \
+		_mm_srli_epi16(_mm_add_epi16( \
+			_mm_mullo_epi16(_mm_and_si128(_mm_srli_epi16(a, shift), max), valpha), \
+			_mm_mullo_epi16(_mm_and_si128(_mm_srli_epi16(d, shift), max), vbeta)), 8)
+
+		__m128i out = _mm_slli_epi16(BLEND_CHANNEL(T::kRedShift, redMax), T::kRedShift);
+		out = _mm_or_si128(out, _mm_slli_epi16(BLEND_CHANNEL(T::kGreenShift, greenMax), T::kGreenShift));
+		out = _mm_or_si128(out, BLEND_CHANNEL(T::kBlueShift, blueMax));
+		out = _mm_or_si128(out, extra);
+#undef BLEND_CHANNEL
+
+		_mm_storeu_si128((__m128i *)(dst + x), _mm_or_si128(_mm_and_si128(keep, d), _mm_andnot_si128(keep, out)));
+	}
+#elif defined(USE_NEON)
+	const uint16x8_t vkey = vdupq_n_u16(key);
+	const uint16x8_t vmask = vdupq_n_u16(mask);
+	const uint16x8_t vinvert = vdupq_n_u16(invertBits);
+	const uint16x8_t valpha = vdupq_n_u16((uint16)alpha);
+	const uint16x8_t vbeta = vdupq_n_u16((uint16)(256 - alpha));
+	const uint16x8_t redMax = vdupq_n_u16((1 << T::kRedBits) - 1);
+	const uint16x8_t greenMax = vdupq_n_u16((1 << T::kGreenBits) - 1);
+	const uint16x8_t blueMax = vdupq_n_u16((1 << T::kBlueBits) - 1);
+	const uint16x8_t extra = vdupq_n_u16((uint16)~(T::kRedMask | T::kGreenMask | T::kBlueMask));
+	for (; x + 8 <= width; x += 8) {
+		const uint16x8_t s = vld1q_u16(src + x);
+		const uint16x8_t d = vld1q_u16(dst + x);
+		const uint16x8_t keep = vceqq_u16(s, vkey);
+		const uint16x8_t a = veorq_u16(vandq_u16(s, vmask), vinvert);
+
+#define BLEND_CHANNEL(ca, cd) \
+		vshrq_n_u16(vmlaq_u16(vmulq_u16(ca, valpha), cd, vbeta), 8)
+
+		uint16x8_t out = vshlq_n_u16(BLEND_CHANNEL(vandq_u16(vshrq_n_u16(a, T::kRedShift), redMax),
+			vandq_u16(vshrq_n_u16(d, T::kRedShift), redMax)), T::kRedShift);
+		out = vorrq_u16(out, vshlq_n_u16(BLEND_CHANNEL(vandq_u16(vshrq_n_u16(a, T::kGreenShift), greenMax),
+			vandq_u16(vshrq_n_u16(d, T::kGreenShift), greenMax)), T::kGreenShift));
+		out = vorrq_u16(out, BLEND_CHANNEL(vandq_u16(a, blueMax), vandq_u16(d, blueMax)));
+		out = vorrq_u16(out, extra);
+#undef BLEND_CHANNEL
+
+		vst1q_u16(dst + x, vbslq_u16(keep, d, out));
+	}
+#endif
+
+	for (; x < width; x++) {
+		if (src[x] != key)
+			dst[x] = blendPixel<T>((uint16)((src[x] & mask) ^ invertBits), dst[x], alpha);
+	}
+}
+
+void blendKeyedRow(uint16 *dst, const uint16 *src, int width, uint16 key, uint16 mask, int alpha, bool invert, int bitFormat) {
+	assert(alpha >= 0 && alpha <= 256);
+	if (bitFormat == 565)
+		blendKeyedRowImpl<ColorMasks<565> >(dst, src, width, key, mask, alpha, invert);
+	else
+		blendKeyedRowImpl<ColorMasks<555> >(dst, src, width, key, mask, alpha, invert);
+}
+
+template<class T>
+static inline uint16 mapPixel(uint16 color, const ChannelMap &map) {
+	return map.red[(color & T::kRedMask) >> T::kRedShift] |
+		map.green[(color & T::kGreenMask) >> T::kGreenShift] |
+		map.blue[(color & T::kBlueMask) >> T::kBlueShift];
+}
+
+template<class T>
+static void mapKeyedRowImpl(uint16 *dst, const uint16 *src, int width, uint16 key, uint16 mask, const ChannelMap &map) {
+	for (int x = 0; x < width; x++) {
+		if (src[x] != key)
+			dst[x] = mapPixel<T>(src[x] & mask, map);
+	}
+}
+
+void mapKeyedRow(uint16 *dst, const uint16 *src, int width, uint16 key, uint16 mask, const ChannelMap &map) {
+	if (map.bitFormat == 565)
+		mapKeyedRowImpl<ColorMasks<565> >(dst, src, width, key, mask, map);
+	else
+		mapKeyedRowImpl<ColorMasks<555> >(dst, src, width, key, mask, map);
+}
+
+template<class T>
+static void mapRowImpl(uint16 *dst, const uint16 *src, int width, const ChannelMap &map) {
+	for (int x = 0; x < width; x++)
+		dst[x] = mapPixel<T>(src[x], map);
+}
+
+void mapRow(uint16 *dst, const uint16 *src, int width, const ChannelMap &map) {
+	if (map.bitFormat == 565)
+		mapRowImpl<ColorMasks<565> >(dst, src, width, map);
+	else
+		mapRowImpl<ColorMasks<555> >(dst, src, width, map);
+}
+
+} // End of namespace Graphics
@@ -0,0 +1,80 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+#ifndef GRAPHICS_BLEND_H
+#define GRAPHICS_BLEND_H
+
+#include "common/scummsys.h"
+
+namespace Graphics {
+
+/**
+ * Row kernels for drawing keyed 16 bit images, as used by the modern GUI
+ * theme. All of them skip the source pixels which have the color key, and
+ * AND the other ones with a mask first, which is how the theme tints its
+ * (white) images with a gradient color. They use SSE2 or NEON if available.
+ * The pixel format is given by bitFormat, which has to be 565 or 555.
+ */
+
+/**
+ * Copy a row of pixels.
+ */
+void copyKeyedRow(uint16 *dst, const uint16 *src, int width, uint16 key, uint16 mask);
+
+/**
+ * Alpha blend a row of pixels onto dst. Each channel of the result is
+ * (alpha * src + (256 - alpha) * dst) >> 8, rounded down. If invert is
+ * set, the masked source pixels are inverted before blending.
+ *
+ * @param alpha	the opacity of the source, from 0 to 256
+ */
+void blendKeyedRow(uint16 *dst, const uint16 *src, int width, uint16 key, uint16 mask, int alpha, bool invert, int bitFormat);
+
+/**
+ * Lookup tables for a color transformation which treats each channel
+ * independently, like dimming. The result for a pixel is the OR of the
+ * table entries for its channels.
+ */
+struct ChannelMap {
+	int bitFormat;
+	uint16 red[64];
+	uint16 green[64];
+	uint16 blue[64];
+};
+
+/**
+ * Map a row of pixels through the given tables.
+ */
+void mapKeyedRow(uint16 *dst, const uint16 *src, int width, uint16 key, uint16 mask, const ChannelMap &map);
+
+/**
+ * Map a row of pixels through the given tables, without a color key or
+ * mask. src and dst may be the same.
+ */
+void mapRow(uint16 *dst, const uint16 *src, int width, const ChannelMap &map);
+
+} // End of namespace Graphics
+
+#endif
@@ -26,13 +26,60 @@
 #include "common/stream.h"
 #include "common/file.h"
 #include "common/endian.h"
+#include "common/hashmap.h"
+#include "common/hash-str.h"
 #include "graphics/font.h"
 
 namespace Graphics {
 
 void free_font(NewFontData* pf);
 
+enum {
+	/** Number of strings NewFont keeps the runs of */
+	kMaxCachedTextRuns = 512
+};
+
+/**
+ * A horizontal run of set pixels in a glyph or a string, relative to the
+ * position the glyph or string is drawn at.
+ */
+struct FontSpan {
+	int16 x, y;
+	int16 len;
+};
+
+typedef Common::Array<FontSpan> SpanList;
+
+struct NewFontCache {
+	/**
+	 * The spans of all glyphs, ordered by row within each glyph. The spans
+	 * of glyph i are spans[glyphStart[i]] to spans[glyphStart[i + 1] - 1].
+	 */
+	SpanList spans;
+	Common::Array<uint> glyphStart;
+
+	/**
+	 * The spans of recently drawn strings, ordered by row, with the spans of
+	 * adjacent characters joined. Unlike a pre-rendered bitmap they do not
+	 * depend on the color or depth of the surface. Once there are
+	 * kMaxCachedTextRuns strings, the cache is emptied and starts over.
+	 */
+	typedef Common::HashMap<Common::String, SpanList *, Common::CaseSensitiveString_Hash, Common::CaseSensitiveString_EqualTo> TextRunMap;
+	TextRunMap textRuns;
+
+	~NewFontCache() {
+		clearTextRuns();
+	}
+
+	void clearTextRuns() {
+		for (TextRunMap::const_iterator i = textRuns.begin(); i != textRuns.end(); ++i)
+			delete i->_value;
+		textRuns.clear();
+	}
+};
+
 NewFont::~NewFont() {
+	delete _cache;
 	if (font) {
 		free_font(font);
 	}
@@ -49,10 +96,86 @@ int NewFont::getCharWidth(byte chr) const {
 	return desc.width[chr - desc.firstchar];
 }
 
-void NewFont::drawChar(Surface *dst, byte chr, int tx, int ty, uint32 color) const {
-	assert(dst != 0);
+NewFontCache *NewFont::getCache() const {
+	if (_cache)
+		return _cache;
 
 	assert(desc.bits != 0 && desc.maxwidth <= 17);
+
+	// Convert the bitmap of each glyph into runs of set pixels
+	_cache = new NewFontCache;
+	for (int chr = 0; chr < desc.size; chr++) {
+		_cache->glyphStart.push_back(_cache->spans.size());
+
+		int bbw, bbh, bbx, bby;
+
+		// Get the bounding box of the character
+		if (!desc.bbx) {
+			bbw = desc.fbbw;
+			bbh = desc.fbbh;
+			bbx = desc.fbbx;
+			bby = desc.fbby;
+		} else {
+			bbw = desc.bbx[chr].w;
+			bbh = desc.bbx[chr].h;
+			bbx = desc.bbx[chr].x;
+			bby = desc.bbx[chr].y;
+		}
+
+		const bitmap_t *tmp = desc.bits + (desc.offset ? desc.offset[chr] : (chr * desc.fbbh));
+
+		for (int y = 0; y < bbh; y++) {
+			const bitmap_t buffer = READ_UINT16(tmp);
+			tmp++;
+			bitmap_t mask = 0x8000;
+
+			FontSpan span;
+			span.y = (int16)(desc.ascent - bby - bbh + y);
+			span.len = 0;
+			for (int x = 0; x < bbw; x++, mask >>= 1) {
+				if ((buffer & mask) != 0) {
+					if (span.len == 0)
+						span.x = (int16)(bbx + x);
+					span.len++;
+				} else if (span.len != 0) {
+					_cache->spans.push_back(span);
+					span.len = 0;
+				}
+			}
+			if (span.len != 0)
+				_cache->spans.push_back(span);
+		}
+	}
+	_cache->glyphStart.push_back(_cache->spans.size());
+
+	return _cache;
+}
+
+/** Fill the given spans, moved by (tx, ty), clipped to the surface. */
+static void drawSpans(Surface *dst, const FontSpan *span, const FontSpan *end, int tx, int ty, uint32 color) {
+	for (; span != end; ++span) {
+		const int y = ty + span->y;
+		if (y < 0 || y >= dst->h)
+			continue;
+
+		const int x1 = MAX<int>(tx + span->x, 0);
+		const int x2 = MIN<int>(tx + span->x + span->len, dst->w);
+		if (x1 >= x2)
+			continue;
+
+		byte *ptr = (byte *)dst->getBasePtr(x1, y);
+		if (dst->bytesPerPixel == 1) {
+			memset(ptr, color, x2 - x1);
+		} else {
+			uint16 *ptr16 = (uint16 *)ptr;
+			for (int x = x1; x < x2; x++)
+				*ptr16++ = (uint16)color;
+		}
+	}
+}
+
+void NewFont::drawChar(Surface *dst, byte chr, int tx, int ty, uint32 color) const {
+	assert(dst != 0);
 	assert(dst->bytesPerPixel == 1 || dst->bytesPerPixel == 2);
 
 	// If this character is not included in the font, use the default char.
@@ -62,44 +185,73 @@ void NewFont::drawChar(Surface *dst, byte chr, int tx, int ty, uint32 color) con
 
 	chr -= desc.firstchar;
 
-	int bbw, bbh, bbx, bby;
+	const NewFontCache *cache = getCache();
+	const FontSpan *spans = cache->spans.begin();
+	drawSpans(dst, spans + cache->glyphStart[chr], spans + cache->glyphStart[chr + 1], tx, ty, color);
+}
 
-	// Get the bounding box of the character
-	if (!desc.bbx) {
-		bbw = desc.fbbw;
-		bbh = desc.fbbh;
-		bbx = desc.fbbx;
-		bby = desc.fbby;
-	} else {
-		bbw = desc.bbx[chr].w;
-		bbh = desc.bbx[chr].h;
-		bbx = desc.bbx[chr].x;
-		bby = desc.bbx[chr].y;
-	}
+void NewFont::drawUnclippedString(Surface *dst, const Common::String &str, int x, int y, uint32 color) const {
+	assert(dst != 0);
+	assert(dst->bytesPerPixel == 1 || dst->bytesPerPixel == 2);
 
-	byte *ptr = (byte *)dst->getBasePtr(tx + bbx, ty + desc.ascent - bby - bbh);
+	NewFontCache *cache = getCache();
 
-	const bitmap_t *tmp = desc.bits + (desc.offset ? desc.offset[chr] : (chr * desc.fbbh));
+	NewFontCache::TextRunMap::const_iterator i = cache->textRuns.find(str);
+	if (i != cache->textRuns.end()) {
+		drawSpans(dst, i->_value->begin(), i->_value->end(), x, y, color);
+		return;
+	}
 
-	for (int y = 0; y < bbh; y++, ptr += dst->pitch) {
-		const bitmap_t buffer = READ_UINT16(tmp);
-		tmp++;
-		bitmap_t mask = 0x8000;
-		if (ty + desc.ascent - bby - bbh + y < 0 ||
-		    ty + desc.ascent - bby - bbh + y >= dst->h)
-			continue;
+	if (cache->textRuns.size() >= kMaxCachedTextRuns)
+		cache->clearTextRuns();
+
+	// Merge the spans of all characters, row by row. For each character,
+	// keep track of its first span which has not been merged yet.
+	const FontSpan *spans = cache->spans.begin();
+	Common::Array<uint> next, end;
+	Common::Array<int> offset;
+	int minY = 0, maxY = -1;
+	int charX = 0;
+	for (uint n = 0; n < str.size(); n++) {
+		int chr = (byte)str[n];
+		if (chr < desc.firstchar || chr >= desc.firstchar + desc.size)
+			chr = desc.defaultchar;
+		chr -= desc.firstchar;
+
+		next.push_back(cache->glyphStart[chr]);
+		end.push_back(cache->glyphStart[chr + 1]);
+		offset.push_back(charX);
+		charX += getCharWidth(str[n]);
+
+		if (next[n] != end[n]) {
+			if (minY > maxY) {
+				minY = spans[next[n]].y;
+				maxY = spans[end[n] - 1].y;
+			} else {
+				minY = MIN<int>(minY, spans[next[n]].y);
+				maxY = MAX<int>(maxY, spans[end[n] - 1].y);
+			}
+		}
+	}
 
-		for (int x = 0; x < bbw; x++, mask >>= 1) {
-			if (tx + bbx + x < 0 || tx + bbx + x >= dst->w)
-				continue;
-			if ((buffer & mask) != 0) {
-				if (dst->bytesPerPixel == 1)
-					ptr[x] = color;
-				else if (dst->bytesPerPixel == 2)
-					((uint16 *)ptr)[x] = color;
+	SpanList *run = new SpanList;
+	for (int row = minY; row <= maxY; row++) {
+		for (uint n = 0; n < str.size(); n++) {
+			while (next[n] < end[n] && spans[next[n]].y == row) {
+				FontSpan span = spans[next[n]++];
+				span.x = (int16)(span.x + offset[n]);
+
+				FontSpan *last = run->empty() ? 0 : &(*run)[run->size() - 1];
+				if (last && last->y == span.y && last->x + last->len == span.x)
+					last->len = (int16)(last->len + span.len);
+				else
+					run->push_back(span);
 			}
 		}
 	}
+
+	cache->textRuns[str] = run;
+	drawSpans(dst, run->begin(), run->end(), x, y, color);
 }
 
 
@@ -819,6 +971,12 @@ void Font::drawString(Surface *dst, const Common::String &s, int x, int y, int w
 	x += deltax;
 
 
+	// The common case: the whole string fits
+	if (x >= leftX && x + width <= rightX) {
+		drawUnclippedString(dst, str, x, y, color);
+		return;
+	}
+
 	for (i = 0; i < str.size(); ++i) {
 		w = getCharWidth(str[i]);
 		if (x+w > rightX)
@@ -829,6 +987,13 @@ void Font::drawString(Surface *dst, const Common::String &s, int x, int y, int w
 	}
 }
 
+void Font::drawUnclippedString(Surface *dst, const Common::String &str, int x, int y, uint32 color) const {
+	for (uint i = 0; i < str.size(); ++i) {
+		drawChar(dst, str[i], x, y, color);
+		x += getCharWidth(str[i]);
+	}
+}
+
 
 struct WordWrapper {
 	Common::StringList &lines;
@@ -59,6 +59,13 @@ public:
 
 	void drawString(Surface *dst, const Common::String &str, int x, int y, int w, uint32 color, TextAlignment align = kTextAlignLeft, int deltax = 0, bool useEllipsis = true) const;
 
+	/**
+	 * Draw a string which fits into the area drawString() was asked to draw
+	 * into, so that it only has to be clipped to the surface. The default
+	 * implementation draws it character by character.
+	 */
+	virtual void drawUnclippedString(Surface *dst, const Common::String &str, int x, int y, uint32 color) const;
+
 	/**
 	 * Compute and return the width the string str has when rendered using this font.
 	 */
@@ -118,14 +125,23 @@ struct FontDesc {
 };
 
 struct NewFontData;
+struct NewFontCache;
 
 class NewFont : public Font {
 protected:
 	FontDesc desc;
 	NewFontData *font;
 
+	/**
+	 * The glyphs converted to runs of set pixels, and the runs of recently
+	 * drawn strings; created when the font is first drawn with.
+	 */
+	mutable NewFontCache *_cache;
+
+	NewFontCache *getCache() const;
+
 public:
-	NewFont(const FontDesc &d, NewFontData *font_ = 0) : desc(d), font(font_) {}
+	NewFont(const FontDesc &d, NewFontData *font_ = 0) : desc(d), font(font_), _cache(0) {}
 	~NewFont();
 
 	virtual int getFontHeight() const { return desc.height; }
@@ -133,6 +149,7 @@ public:
 
 	virtual int getCharWidth(byte chr) const;
 	virtual void drawChar(Surface *dst, byte chr, int x, int y, uint32 color) const;
+	virtual void drawUnclippedString(Surface *dst, const Common::String &str, int x, int y, uint32 color) const;
 
 	static NewFont *loadFont(Common::SeekableReadStream &stream);
 	static bool cacheFontData(const NewFont &font, const Common::String &filename);
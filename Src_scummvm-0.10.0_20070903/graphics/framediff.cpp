@@ -0,0 +1,148 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+#include "common/stdafx.h"
+#include "common/endian.h"
+#include "common/util.h"
+#include "graphics/framediff.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USE_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define USE_NEON
+#include <arm_neon.h>
+#endif
+
+namespace Graphics {
+
+/**
+ * Compare one scanline of two frames and set dirty[i] for every block i in
+ * which they differ.
+ */
+static void markDirtyBlocks(const byte *a, const byte *b, int width, byte *dirty) {
+	int x = 0;
+
+#if defined(USE_SSE2)
+	for (; x + 16 <= width; x += 16) {
+		const __m128i equal = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(a + x)), _mm_loadu_si128((const __m128i *)(b + x)));
+		const int mask = _mm_movemask_epi8(equal);
+		if (mask != 0xFFFF) {
+			dirty[x / kDiffBlockSize] |= (mask & 0xFF) != 0xFF;
+			dirty[x / kDiffBlockSize + 1] |= (mask >> 8) != 0xFF;
+		}
+	}
+#elif defined(USE_NEON)
+	for (; x + 16 <= width; x += 16) {
+		const uint8x16_t differ = veorq_u8(vld1q_u8(a + x), vld1q_u8(b + x));
+		const uint64x2_t blocks = vreinterpretq_u64_u8(differ);
+		dirty[x / kDiffBlockSize] |= vgetq_lane_u64(blocks, 0) != 0;
+		dirty[x / kDiffBlockSize + 1] |= vgetq_lane_u64(blocks, 1) != 0;
+	}
+#endif
+
+	for (; x + kDiffBlockSize <= width; x += kDiffBlockSize) {
+		if (READ_UINT32(a + x) != READ_UINT32(b + x) || READ_UINT32(a + x + 4) != READ_UINT32(b + x + 4))
+			dirty[x / kDiffBlockSize] = 1;
+	}
+
+	// The last block may be narrower than the others
+	if (x < width && memcmp(a + x, b + x, width - x) != 0)
+		dirty[x / kDiffBlockSize] = 1;
+}
+
+/** A horizontal run of dirty blocks, which may extend over several block rows. */
+struct DirtyRun {
+	int16 left, right;	// in pixels
+	int16 top;
+};
+
+void diffFrame(const byte *frame, byte *shadow, int width, int height, Common::Array<Common::Rect> &rects) {
+	// Screen coordinates fit Common::Rect's int16 fields
+	const int16 frameWidth = (int16)width;
+	const int16 frameHeight = (int16)height;
+	const int blocksX = (width + kDiffBlockSize - 1) / kDiffBlockSize;
+
+	byte *dirty = new byte[blocksX];
+	// Each block row has at most (blocksX + 1) / 2 runs
+	DirtyRun *openRuns = new DirtyRun[blocksX];
+	DirtyRun *newRuns = new DirtyRun[blocksX];
+	int numOpenRuns = 0;
+
+	for (int16 y = 0; y < frameHeight; y += kDiffBlockSize) {
+		const int h = MIN<int>(kDiffBlockSize, height - y);
+		const byte *src = frame + y * width;
+		byte *dst = shadow + y * width;
+
+		memset(dirty, 0, blocksX);
+		for (int i = 0; i < h; i++)
+			markDirtyBlocks(src + i * width, dst + i * width, width, dirty);
+
+		// Collect the runs of dirty blocks in this block row, and continue the
+		// runs of the rows above which cover exactly the same columns.
+		int numNewRuns = 0;
+		int open = 0;
+		for (int16 x = 0; x < blocksX; x++) {
+			if (!dirty[x])
+				continue;
+
+			DirtyRun &run = newRuns[numNewRuns++];
+			run.left = x * kDiffBlockSize;
+			while (x < blocksX && dirty[x])
+				x++;
+			run.right = MIN<int16>(x * kDiffBlockSize, frameWidth);
+			run.top = y;
+
+			// Close the runs further left, which did not continue
+			while (open < numOpenRuns && openRuns[open].left < run.left) {
+				const DirtyRun &old = openRuns[open++];
+				rects.push_back(Common::Rect(old.left, old.top, old.right, y));
+			}
+			if (open < numOpenRuns && openRuns[open].left == run.left && openRuns[open].right == run.right)
+				run.top = openRuns[open++].top;
+		}
+		while (open < numOpenRuns) {
+			const DirtyRun &old = openRuns[open++];
+			rects.push_back(Common::Rect(old.left, old.top, old.right, y));
+		}
+
+		if (numNewRuns)
+			memcpy(dst, src, h * width);
+
+		SWAP(openRuns, newRuns);
+		numOpenRuns = numNewRuns;
+	}
+
+	for (int i = 0; i < numOpenRuns; i++) {
+		const DirtyRun &old = openRuns[i];
+		rects.push_back(Common::Rect(old.left, old.top, old.right, frameHeight));
+	}
+
+	delete[] dirty;
+	delete[] openRuns;
+	delete[] newRuns;
+}
+
+} // End of namespace Graphics
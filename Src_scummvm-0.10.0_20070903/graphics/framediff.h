@@ -0,0 +1,58 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+#ifndef GRAPHICS_FRAMEDIFF_H
+#define GRAPHICS_FRAMEDIFF_H
+
+#include "common/scummsys.h"
+#include "common/array.h"
+#include "common/rect.h"
+
+namespace Graphics {
+
+enum {
+	/** Width and height of the blocks diffFrame() compares. */
+	kDiffBlockSize = 8
+};
+
+/**
+ * Find the parts of an 8 bit frame which differ from a shadow copy of the
+ * previous frame, and bring the shadow copy up to date. The frames are
+ * compared in blocks of kDiffBlockSize x kDiffBlockSize pixels; unlike a
+ * checksum, the comparison is exact. Horizontally adjacent dirty blocks are
+ * joined into runs, and runs covering the same columns in consecutive block
+ * rows are joined into a single rectangle.
+ *
+ * @param frame		the new frame, with a pitch of width bytes
+ * @param shadow	the previous frame, in the same layout; updated to match frame
+ * @param width		the width of the frames, in pixels
+ * @param height	the height of the frames, in pixels
+ * @param rects		the rectangles which changed are appended to this list
+ */
+void diffFrame(const byte *frame, byte *shadow, int width, int height, Common::Array<Common::Rect> &rects);
+
+} // End of namespace Graphics
+
+#endif
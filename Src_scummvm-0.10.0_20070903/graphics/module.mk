@@ -1,6 +1,7 @@
 MODULE := graphics
 
 MODULE_OBJS := \
+	blend.o \
 	cursorman.o \
 	dxa_player.o \
 	font.o \
@@ -9,6 +10,7 @@ MODULE_OBJS := \
 	fonts/newfont_big.o \
 	fonts/newfont.o \
 	fonts/scummfont.o \
+	framediff.o \
 	iff.o \
 	imagedec.o \
 	imageman.o \
@@ -16,7 +18,8 @@ MODULE_OBJS := \
 	primitives.o \
 	scaler.o \
 	scaler/thumbnail.o \
-	surface.o
+	surface.o \
+	videocapture.o
 
 ifndef DISABLE_SCALERS
 MODULE_OBJS += \
@@ -29,7 +32,8 @@ MODULE_OBJS += \
 ifndef DISABLE_HQ_SCALERS
 MODULE_OBJS += \
 	scaler/hq2x.o \
-	scaler/hq3x.o
+	scaler/hq3x.o \
+	scaler/hqpatterns.o
 
 ifdef HAVE_NASM
 MODULE_OBJS += \
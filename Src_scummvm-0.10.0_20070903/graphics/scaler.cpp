@@ -25,10 +25,12 @@
 
 #include "graphics/scaler/intern.h"
 #include "graphics/scaler/scalebit.h"
+#include "common/cpu.h"
 #include "common/util.h"
 
 
 int gBitFormat = 565;
+bool gHQUseVectorUnit = false;
 
 #ifndef DISABLE_HQ_SCALERS
 // RGB-to-YUV lookup table
@@ -102,9 +104,15 @@ void InitLUT() {
 #endif
 
 
-void InitScalers(uint32 BitFormat) {
+void InitScalers(uint32 BitFormat, bool initHQTables) {
 	gBitFormat = BitFormat;
 #ifndef DISABLE_HQ_SCALERS
+	gHQUseVectorUnit = Common::hasCPUFeature(Common::kCPUFeatureSSE2) ||
+		Common::hasCPUFeature(Common::kCPUFeatureNEON);
+
+	if (!initHQTables)
+		return;
+
 	if (gBitFormat == 555)
 		InitLUT<ColorMasks<555> >();
 	if (gBitFormat == 565)
@@ -117,69 +125,96 @@ void InitScalers(uint32 BitFormat) {
  * Trivial 'scaler' - in fact it doesn't do any scaling but just copies the
  * source to the destionation.
  */
-void Normal1x(const uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch,
+template<typename Pixel>
+void Normal1xTemplate(const uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch,
 							int width, int height) {
 	while (height--) {
-		memcpy(dstPtr, srcPtr, 2 * width);
+		memcpy(dstPtr, srcPtr, sizeof(Pixel) * width);
 		srcPtr += srcPitch;
 		dstPtr += dstPitch;
 	}
 }
 
+void Normal1x(const uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch,
+							int width, int height) {
+	Normal1xTemplate<uint16>(srcPtr, srcPitch, dstPtr, dstPitch, width, height);
+}
+
+void Normal1x_32(const uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch,
+							int width, int height) {
+	Normal1xTemplate<uint32>(srcPtr, srcPitch, dstPtr, dstPitch, width, height);
+}
+
 #ifndef DISABLE_SCALERS
 /**
  * Trivial nearest-neighbour 2x scaler.
  */
-void Normal2x(const uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch,
+template<typename Pixel>
+void Normal2xTemplate(const uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch,
 							int width, int height) {
 	uint8 *r;
 
-	assert(((long)dstPtr & 3) == 0);
+	assert(((long)dstPtr & (sizeof(Pixel) - 1)) == 0);
 	while (height--) {
 		r = dstPtr;
-		for (int i = 0; i < width; ++i, r += 4) {
-			uint32 color = *(((const uint16 *)srcPtr) + i);
-
-			color |= color << 16;
+		for (int i = 0; i < width; ++i, r += 2 * sizeof(Pixel)) {
+			const Pixel color = *(((const Pixel *)srcPtr) + i);
 
-			*(uint32 *)(r) = color;
-			*(uint32 *)(r + dstPitch) = color;
+			Pixel *q = (Pixel *)r;
+			q[0] = q[1] = color;
+			q = (Pixel *)(r + dstPitch);
+			q[0] = q[1] = color;
 		}
 		srcPtr += srcPitch;
 		dstPtr += dstPitch << 1;
 	}
 }
 
+void Normal2x(const uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch,
+							int width, int height) {
+	Normal2xTemplate<uint16>(srcPtr, srcPitch, dstPtr, dstPitch, width, height);
+}
+
+void Normal2x_32(const uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch,
+							int width, int height) {
+	Normal2xTemplate<uint32>(srcPtr, srcPitch, dstPtr, dstPitch, width, height);
+}
+
 /**
  * Trivial nearest-neighbour 3x scaler.
  */
-void Normal3x(const uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch,
+template<typename Pixel>
+void Normal3xTemplate(const uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch,
 							int width, int height) {
 	uint8 *r;
-	const uint32 dstPitch2 = dstPitch * 2;
 	const uint32 dstPitch3 = dstPitch * 3;
 
-	assert(((long)dstPtr & 1) == 0);
+	assert(((long)dstPtr & (sizeof(Pixel) - 1)) == 0);
 	while (height--) {
 		r = dstPtr;
-		for (int i = 0; i < width; ++i, r += 6) {
-			uint16 color = *(((const uint16 *)srcPtr) + i);
-
-			*(uint16 *)(r + 0) = color;
-			*(uint16 *)(r + 2) = color;
-			*(uint16 *)(r + 4) = color;
-			*(uint16 *)(r + 0 + dstPitch) = color;
-			*(uint16 *)(r + 2 + dstPitch) = color;
-			*(uint16 *)(r + 4 + dstPitch) = color;
-			*(uint16 *)(r + 0 + dstPitch2) = color;
-			*(uint16 *)(r + 2 + dstPitch2) = color;
-			*(uint16 *)(r + 4 + dstPitch2) = color;
+		for (int i = 0; i < width; ++i, r += 3 * sizeof(Pixel)) {
+			const Pixel color = *(((const Pixel *)srcPtr) + i);
+
+			for (int j = 0; j < 3; ++j) {
+				Pixel *q = (Pixel *)(r + j * dstPitch);
+				q[0] = q[1] = q[2] = color;
+			}
 		}
 		srcPtr += srcPitch;
 		dstPtr += dstPitch3;
 	}
 }
 
+void Normal3x(const uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch,
+							int width, int height) {
+	Normal3xTemplate<uint16>(srcPtr, srcPitch, dstPtr, dstPitch, width, height);
+}
+
+void Normal3x_32(const uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch,
+							int width, int height) {
+	Normal3xTemplate<uint32>(srcPtr, srcPitch, dstPtr, dstPitch, width, height);
+}
+
 #define interpolate32_1_1		interpolate32_1_1<bitFormat>
 #define interpolate32_1_1_1_1	interpolate32_1_1_1_1<bitFormat>
 
@@ -238,6 +273,16 @@ void AdvMame3x(const uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPi
 	scale(3, dstPtr, dstPitch, srcPtr - srcPitch, srcPitch, 2, width, height);
 }
 
+void AdvMame2x_32(const uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch,
+							 int width, int height) {
+	scale(2, dstPtr, dstPitch, srcPtr - srcPitch, srcPitch, 4, width, height);
+}
+
+void AdvMame3x_32(const uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch,
+							 int width, int height) {
+	scale(3, dstPtr, dstPitch, srcPtr - srcPitch, srcPitch, 4, width, height);
+}
+
 template<int bitFormat>
 void TV2xTemplate(const uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch,
 					int width, int height) {
@@ -29,7 +29,12 @@
 #include "common/scummsys.h"
 #include "graphics/surface.h"
 
-extern void InitScalers(uint32 BitFormat);
+/**
+ * Set up the scalers for 16 bit pixels in the given format (555 or 565).
+ * Unless initHQTables is false, this also builds the 512 KB of lookup tables
+ * the HQ scalers need; that can be skipped if they won't be used.
+ */
+extern void InitScalers(uint32 BitFormat, bool initHQTables = true);
 
 typedef void ScalerProc(const uint8 *srcPtr, uint32 srcPitch,
 							uint8 *dstPtr, uint32 dstPitch, int width, int height);
@@ -50,6 +55,14 @@ DECLARE_SCALER(Normal1o5x);
 DECLARE_SCALER(TV2x);
 DECLARE_SCALER(DotMatrix);
 
+// Versions of the scalers which do not mix colors, for 32 bit pixels in any
+// channel order.
+DECLARE_SCALER(Normal1x_32);
+DECLARE_SCALER(Normal2x_32);
+DECLARE_SCALER(Normal3x_32);
+DECLARE_SCALER(AdvMame2x_32);
+DECLARE_SCALER(AdvMame3x_32);
+
 #ifndef DISABLE_HQ_SCALERS
 DECLARE_SCALER(HQ2x);
 DECLARE_SCALER(HQ3x);
@@ -66,6 +79,7 @@ FORCEINLINE int aspect2Real(int y) {
 extern void makeRectStretchable(int &x, int &y, int &w, int &h);
 
 extern int stretch200To240(uint8 *buf, uint32 pitch, int width, int height, int srcX, int srcY, int origSrcY);
+extern int stretch200To240_32(uint8 *buf, uint32 pitch, int width, int height, int srcX, int srcY, int origSrcY);
 
 // creates a 160x100 thumbnail for 320x200 games
 // and 160x120 thumbnail for 320x240 and 640x480 games
@@ -175,6 +175,68 @@ int stretch200To240(uint8 *buf, uint32 pitch, int width, int height, int srcX, i
 	return 1 + maxDstY - srcY;
 }
 
+/**
+ * Blend two 32 bit pixels, channel by channel, in the same ratios as the 16 bit
+ * code: 1 : 3 for scale 1 and 1 : 1 for scale 2, approximating scale : 5 - scale.
+ */
+template<int scale>
+static inline uint32 interpolate5_32(uint32 A, uint32 B) {
+	if (scale == 1) {
+		const uint32 even = (((A & 0x00FF00FF) + (B & 0x00FF00FF) * 3) >> 2) & 0x00FF00FF;
+		const uint32 odd = ((((A >> 8) & 0x00FF00FF) + ((B >> 8) & 0x00FF00FF) * 3) << 6) & 0xFF00FF00;
+		return even | odd;
+	} else {
+		return ((A & 0xFEFEFEFE) >> 1) + ((B & 0xFEFEFEFE) >> 1) + (A & B & 0x01010101);
+	}
+}
+
+template<int scale>
+static inline void interpolate5Line_32(uint32 *dst, const uint32 *srcA, const uint32 *srcB, int width) {
+	while (width--) {
+		*dst++ = interpolate5_32<scale>(*srcA++, *srcB++);
+	}
+}
+
+int stretch200To240_32(uint8 *buf, uint32 pitch, int width, int height, int srcX, int srcY, int origSrcY) {
+	int maxDstY = real2Aspect(origSrcY + height - 1);
+	int y;
+	const uint8 *startSrcPtr = buf + srcX * 4 + (srcY - origSrcY) * pitch;
+	uint8 *dstPtr = buf + srcX * 4 + maxDstY * pitch;
+
+	for (y = maxDstY; y >= srcY; y--) {
+		const uint8 *srcPtr = startSrcPtr + aspect2Real(y) * pitch;
+
+#if ASPECT_MODE == kVeryFastAndUglyAspectMode
+		if (srcPtr == dstPtr)
+			break;
+		memcpy(dstPtr, srcPtr, width * 4);
+#else
+		switch (y % 6) {
+		case 0:
+		case 5:
+			if (srcPtr != dstPtr)
+				memcpy(dstPtr, srcPtr, width * 4);
+			break;
+		case 1:
+			interpolate5Line_32<1>((uint32 *)dstPtr, (const uint32 *)(srcPtr - pitch), (const uint32 *)srcPtr, width);
+			break;
+		case 2:
+			interpolate5Line_32<2>((uint32 *)dstPtr, (const uint32 *)(srcPtr - pitch), (const uint32 *)srcPtr, width);
+			break;
+		case 3:
+			interpolate5Line_32<2>((uint32 *)dstPtr, (const uint32 *)srcPtr, (const uint32 *)(srcPtr - pitch), width);
+			break;
+		case 4:
+			interpolate5Line_32<1>((uint32 *)dstPtr, (const uint32 *)srcPtr, (const uint32 *)(srcPtr - pitch), width);
+			break;
+		}
+#endif
+		dstPtr -= pitch;
+	}
+
+	return 1 + maxDstY - srcY;
+}
+
 int stretch200To240(uint8 *buf, uint32 pitch, int width, int height, int srcX, int srcY, int origSrcY) {
 	if (gBitFormat == 565)
 		return stretch200To240<565>(buf, pitch, width, height, srcX, srcY, origSrcY);
@@ -37,6 +37,10 @@
 	const uint32 nextlineDst = dstPitch / sizeof(uint16);
 	uint16 *q = (uint16 *)dstPtr;
 
+#ifdef HQ_VECTOR_PATTERNS
+	uint8 patterns[kHQPatternChunk];
+#endif
+
 	//	 +----+----+----+
 	//	 |    |    |    |
 	//	 | w1 | w2 | w3 |
@@ -58,6 +62,9 @@
 		w8 = *(p + nextlineSrc);
 
 		int tmpWidth = width;
+#ifdef HQ_VECTOR_PATTERNS
+		const uint8 *pat = patterns, *patEnd = patterns;
+#endif
 		while (tmpWidth--) {
 			p++;
 
@@ -65,6 +72,15 @@
 			w6 = *(p);
 			w9 = *(p + nextlineSrc);
 
+#ifdef HQ_VECTOR_PATTERNS
+			if (pat == patEnd) {
+				const int n = MIN<int>(tmpWidth + 1, kHQPatternChunk);
+				hqComputePatterns<bitFormat>(p - 1, nextlineSrc, n, patterns);
+				pat = patterns;
+				patEnd = patterns + n;
+			}
+			const int pattern = *pat++;
+#else
 			int pattern = 0;
 			const int yuv5 = YUV(5);
 			if (w5 != w1 && diffYUV(yuv5, YUV(1))) pattern |= 0x0001;
@@ -75,6 +91,7 @@
 			if (w5 != w7 && diffYUV(yuv5, YUV(7))) pattern |= 0x0020;
 			if (w5 != w8 && diffYUV(yuv5, YUV(8))) pattern |= 0x0040;
 			if (w5 != w9 && diffYUV(yuv5, YUV(9))) pattern |= 0x0080;
+#endif
 
 			switch (pattern) {
 			case 0:
@@ -24,6 +24,8 @@
  */
 
 #include "graphics/scaler/intern.h"
+#include "graphics/scaler/hqpatterns.h"
+#include "common/util.h"
 
 #ifdef USE_NASM
 // Assembly version of HQ3x
@@ -114,8 +116,38 @@ void HQ3x_555(const uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPit
 }
 #undef bitFormat
 
+#ifdef USE_HQ_VECTOR_PATTERNS
+// Variants which let the vector unit classify the source pixels
+
+#define HQ_VECTOR_PATTERNS
+
+#define bitFormat 565
+static void HQ3x_565_vector(const uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch, int width, int height) {
+	#include "graphics/scaler/hq3x.h"
+}
+#undef bitFormat
+
+#define bitFormat 555
+static void HQ3x_555_vector(const uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch, int width, int height) {
+	#include "graphics/scaler/hq3x.h"
+}
+#undef bitFormat
+
+#undef HQ_VECTOR_PATTERNS
+#endif
+
 
 void HQ3x(const uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch, int width, int height) {
+#ifdef USE_HQ_VECTOR_PATTERNS
+	if (gHQUseVectorUnit) {
+		if (gBitFormat == 565)
+			HQ3x_565_vector(srcPtr, srcPitch, dstPtr, dstPitch, width, height);
+		else
+			HQ3x_555_vector(srcPtr, srcPitch, dstPtr, dstPitch, width, height);
+		return;
+	}
+#endif
+
 	if (gBitFormat == 565)
 		HQ3x_565(srcPtr, srcPitch, dstPtr, dstPitch, width, height);
 	else
@@ -0,0 +1,179 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+#include "graphics/scaler/hqpatterns.h"
+
+#ifdef USE_HQ_VECTOR_PATTERNS
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#else
+#include <emmintrin.h>
+#endif
+
+/** Classify a single pixel, the same way hq2x.h and hq3x.h do. */
+static inline uint8 hqPattern(const uint16 *p, uint32 nextlineSrc) {
+	const int w5 = *p;
+	const int yuv5 = RGBtoYUV[w5];
+	const int w[8] = {
+		*(p - 1 - nextlineSrc), *(p - nextlineSrc), *(p + 1 - nextlineSrc),
+		*(p - 1),                                   *(p + 1),
+		*(p - 1 + nextlineSrc), *(p + nextlineSrc), *(p + 1 + nextlineSrc)
+	};
+
+	uint8 pattern = 0;
+	for (int i = 0; i < 8; i++)
+		if (w5 != w[i] && diffYUV(yuv5, RGBtoYUV[w[i]]))
+			pattern |= 1 << i;
+	return pattern;
+}
+
+// Like the table set up by InitLUT(), the code below first expands each
+// colour component to 8 bits and then computes
+//   Y = (r + g + b) >> 2
+//   U = (r - b) >> 2
+//   V = (2 * g - r - b) >> 3
+// The offset of 128 the table adds to U and V cancels out in the
+// differences, and none of the values overflows 16 bits.
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+
+static inline uint16x8_t component(uint16x8_t c, int mask, int shift, int bits) {
+	// Shift left by a negative amount to shift right
+	return vshlq_u16(vandq_u16(c, vdupq_n_u16((uint16)mask)), vdupq_n_s16((int16)(8 - bits - shift)));
+}
+
+template<int bitFormat>
+static inline void toYUV(const uint16 *p, int16x8_t &y, int16x8_t &u, int16x8_t &v) {
+	typedef ColorMasks<bitFormat> T;
+	const uint16x8_t c = vld1q_u16(p);
+	const int16x8_t r = vreinterpretq_s16_u16(component(c, T::kRedMask, T::kRedShift, T::kRedBits));
+	const int16x8_t g = vreinterpretq_s16_u16(component(c, T::kGreenMask, T::kGreenShift, T::kGreenBits));
+	const int16x8_t b = vreinterpretq_s16_u16(component(c, T::kBlueMask, T::kBlueShift, T::kBlueBits));
+
+	y = vshrq_n_s16(vaddq_s16(vaddq_s16(r, g), b), 2);
+	u = vshrq_n_s16(vsubq_s16(r, b), 2);
+	v = vshrq_n_s16(vsubq_s16(vsubq_s16(vshlq_n_s16(g, 1), r), b), 3);
+}
+
+template<int bitFormat>
+static inline uint16x8_t differs(int16x8_t y5, int16x8_t u5, int16x8_t v5, const uint16 *p, uint16 bit) {
+	int16x8_t y, u, v;
+	toYUV<bitFormat>(p, y, u, v);
+
+	uint16x8_t diff = vcgtq_s16(vabdq_s16(y5, y), vdupq_n_s16(0x30));
+	diff = vorrq_u16(diff, vcgtq_s16(vabdq_s16(u5, u), vdupq_n_s16(7)));
+	diff = vorrq_u16(diff, vcgtq_s16(vabdq_s16(v5, v), vdupq_n_s16(6)));
+	return vandq_u16(diff, vdupq_n_u16(bit));
+}
+
+template<int bitFormat>
+static inline void classify8(const uint16 *p, uint32 nextlineSrc, uint8 *patterns) {
+	int16x8_t y5, u5, v5;
+	toYUV<bitFormat>(p, y5, u5, v5);
+
+	// Identical pixels have identical YUV values, so unlike the scalar code
+	// there is no need to compare the pixels themselves first.
+	uint16x8_t pattern = differs<bitFormat>(y5, u5, v5, p - 1 - nextlineSrc, 0x01);
+	pattern = vorrq_u16(pattern, differs<bitFormat>(y5, u5, v5, p - nextlineSrc, 0x02));
+	pattern = vorrq_u16(pattern, differs<bitFormat>(y5, u5, v5, p + 1 - nextlineSrc, 0x04));
+	pattern = vorrq_u16(pattern, differs<bitFormat>(y5, u5, v5, p - 1, 0x08));
+	pattern = vorrq_u16(pattern, differs<bitFormat>(y5, u5, v5, p + 1, 0x10));
+	pattern = vorrq_u16(pattern, differs<bitFormat>(y5, u5, v5, p - 1 + nextlineSrc, 0x20));
+	pattern = vorrq_u16(pattern, differs<bitFormat>(y5, u5, v5, p + nextlineSrc, 0x40));
+	pattern = vorrq_u16(pattern, differs<bitFormat>(y5, u5, v5, p + 1 + nextlineSrc, 0x80));
+
+	vst1_u8(patterns, vmovn_u16(pattern));
+}
+
+#else
+
+static inline __m128i component(__m128i c, int mask, int shift, int bits) {
+	return _mm_slli_epi16(_mm_srli_epi16(_mm_and_si128(c, _mm_set1_epi16((int16)mask)), shift), 8 - bits);
+}
+
+template<int bitFormat>
+static inline void toYUV(const uint16 *p, __m128i &y, __m128i &u, __m128i &v) {
+	typedef ColorMasks<bitFormat> T;
+	const __m128i c = _mm_loadu_si128((const __m128i *)p);
+	const __m128i r = component(c, T::kRedMask, T::kRedShift, T::kRedBits);
+	const __m128i g = component(c, T::kGreenMask, T::kGreenShift, T::kGreenBits);
+	const __m128i b = component(c, T::kBlueMask, T::kBlueShift, T::kBlueBits);
+
+	y = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(r, g), b), 2);
+	u = _mm_srai_epi16(_mm_sub_epi16(r, b), 2);
+	v = _mm_srai_epi16(_mm_sub_epi16(_mm_sub_epi16(_mm_slli_epi16(g, 1), r), b), 3);
+}
+
+static inline __m128i absDiff(__m128i a, __m128i b) {
+	const __m128i d = _mm_sub_epi16(a, b);
+	return _mm_max_epi16(d, _mm_sub_epi16(_mm_setzero_si128(), d));
+}
+
+template<int bitFormat>
+static inline __m128i differs(__m128i y5, __m128i u5, __m128i v5, const uint16 *p, uint16 bit) {
+	__m128i y, u, v;
+	toYUV<bitFormat>(p, y, u, v);
+
+	__m128i diff = _mm_cmpgt_epi16(absDiff(y5, y), _mm_set1_epi16(0x30));
+	diff = _mm_or_si128(diff, _mm_cmpgt_epi16(absDiff(u5, u), _mm_set1_epi16(7)));
+	diff = _mm_or_si128(diff, _mm_cmpgt_epi16(absDiff(v5, v), _mm_set1_epi16(6)));
+	return _mm_and_si128(diff, _mm_set1_epi16(bit));
+}
+
+template<int bitFormat>
+static inline void classify8(const uint16 *p, uint32 nextlineSrc, uint8 *patterns) {
+	__m128i y5, u5, v5;
+	toYUV<bitFormat>(p, y5, u5, v5);
+
+	// Identical pixels have identical YUV values, so unlike the scalar code
+	// there is no need to compare the pixels themselves first.
+	__m128i pattern = differs<bitFormat>(y5, u5, v5, p - 1 - nextlineSrc, 0x01);
+	pattern = _mm_or_si128(pattern, differs<bitFormat>(y5, u5, v5, p - nextlineSrc, 0x02));
+	pattern = _mm_or_si128(pattern, differs<bitFormat>(y5, u5, v5, p + 1 - nextlineSrc, 0x04));
+	pattern = _mm_or_si128(pattern, differs<bitFormat>(y5, u5, v5, p - 1, 0x08));
+	pattern = _mm_or_si128(pattern, differs<bitFormat>(y5, u5, v5, p + 1, 0x10));
+	pattern = _mm_or_si128(pattern, differs<bitFormat>(y5, u5, v5, p - 1 + nextlineSrc, 0x20));
+	pattern = _mm_or_si128(pattern, differs<bitFormat>(y5, u5, v5, p + nextlineSrc, 0x40));
+	pattern = _mm_or_si128(pattern, differs<bitFormat>(y5, u5, v5, p + 1 + nextlineSrc, 0x80));
+
+	_mm_storel_epi64((__m128i *)patterns, _mm_packus_epi16(pattern, pattern));
+}
+
+#endif
+
+template<int bitFormat>
+void hqComputePatterns(const uint16 *p, uint32 nextlineSrc, int width, uint8 *patterns) {
+	int i = 0;
+	for (; i + 8 <= width; i += 8)
+		classify8<bitFormat>(p + i, nextlineSrc, patterns + i);
+	for (; i < width; i++)
+		patterns[i] = hqPattern(p + i, nextlineSrc);
+}
+
+template void hqComputePatterns<565>(const uint16 *p, uint32 nextlineSrc, int width, uint8 *patterns);
+template void hqComputePatterns<555>(const uint16 *p, uint32 nextlineSrc, int width, uint8 *patterns);
+
+#endif
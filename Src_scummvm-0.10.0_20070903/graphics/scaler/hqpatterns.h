@@ -0,0 +1,56 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+#ifndef GRAPHICS_SCALER_HQPATTERNS_H
+#define GRAPHICS_SCALER_HQPATTERNS_H
+
+#include "graphics/scaler/intern.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || \
+	defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define USE_HQ_VECTOR_PATTERNS
+#endif
+
+#ifdef USE_HQ_VECTOR_PATTERNS
+
+enum {
+	/** Number of pixels the hq scalers classify in one go. */
+	kHQPatternChunk = 256
+};
+
+/**
+ * Compute the neighbour pattern which the hq scaler family switches on for
+ * width consecutive source pixels, starting at p, using the vector unit of
+ * the CPU. Instead of looking up RGBtoYUV for each of the nine pixels
+ * involved, the YUV values are computed on the fly, eight pixels at a time.
+ * The result for p[i] is stored in patterns[i] and is exactly what the
+ * YUV(x) based code in hq2x.h and hq3x.h computes.
+ */
+template<int bitFormat>
+void hqComputePatterns(const uint16 *p, uint32 nextlineSrc, int width, uint8 *patterns);
+
+#endif
+
+#endif
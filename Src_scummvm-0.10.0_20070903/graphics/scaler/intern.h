@@ -158,4 +158,10 @@ extern "C" uint32   *RGBtoYUV;
 /** Specifies the currently active 16bit pixel format, 555 or 565. */
 extern int gBitFormat;
 
+/**
+ * Whether the hq scaler family may use the vector unit of the CPU. Set up
+ * by InitScalers() according to the capabilities of the CPU.
+ */
+extern bool gHQUseVectorUnit;
+
 #endif
@@ -0,0 +1,199 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+#include "common/stdafx.h"
+#include "common/packbits.h"
+#include "common/util.h"
+#include "graphics/videocapture.h"
+
+namespace Graphics {
+
+enum {
+	/** How long the encoder sleeps when there is nothing to do, in ms */
+	kEncoderIdleDelay = 10
+};
+
+static const byte kCaptureVersion = 1;
+
+VideoCapture::VideoCapture()
+	: _head(0), _tail(0), _thread(0), _quit(false), _startTime(0), _havePalette(false),
+	  _packBuffer(0), _packBufferSize(0), _framesWritten(0), _framesDropped(0) {
+	for (int i = 0; i < kNumFrames; i++) {
+		_frames[i].pixels = 0;
+		_frames[i].capacity = 0;
+	}
+}
+
+VideoCapture::~VideoCapture() {
+	stop();
+	for (int i = 0; i < kNumFrames; i++)
+		free(_frames[i].pixels);
+	free(_packBuffer);
+}
+
+bool VideoCapture::start(const Common::String &filename) {
+	stop();
+
+	if (!_file.open(filename, Common::File::kFileWriteMode)) {
+		warning("Could not create video capture file '%s'", filename.c_str());
+		return false;
+	}
+
+	_file.write("SVMR", 4);
+	_file.writeByte(kCaptureVersion);
+	_file.writeByte(0);
+	_file.writeUint16LE(0);
+
+	_head = _tail = 0;
+	_havePalette = false;
+	_framesWritten = _framesDropped = 0;
+	_startTime = g_system->getMillis();
+
+	// Without threads, captureFrame() encodes the frames itself.
+	_quit = false;
+	_thread = g_system->createThread(encoderThreadProc, this);
+
+	return true;
+}
+
+void VideoCapture::stop() {
+	if (!isRecording())
+		return;
+
+	if (_thread) {
+		_quit = true;
+		g_system->joinThread(_thread);
+		_thread = 0;
+	}
+	encodeQueuedFrames();
+
+	_file.close();
+	debug(1, "Video capture: %d frames written, %d dropped", _framesWritten, _framesDropped);
+}
+
+void VideoCapture::captureFrame(const byte *pixels, int pitch, int width, int height, const byte *palette) {
+	if (!isRecording())
+		return;
+
+	bool full;
+	{
+		Common::StackLock lock(_mutex);
+		full = (_head - _tail == kNumFrames);
+	}
+	if (full) {
+		_framesDropped++;
+		return;
+	}
+
+	// The encoder doesn't touch this frame until _head is advanced past it.
+	Frame &frame = _frames[_head % kNumFrames];
+	const uint32 size = width * height;
+	if (frame.capacity < size) {
+		free(frame.pixels);
+		frame.pixels = (byte *)malloc(size);
+		frame.capacity = size;
+	}
+
+	byte *dst = frame.pixels;
+	for (int y = 0; y < height; y++) {
+		memcpy(dst, pixels, width);
+		dst += width;
+		pixels += pitch;
+	}
+
+	for (int i = 0; i < 256; i++) {
+		frame.palette[i * 3 + 0] = palette[i * 4 + 0];
+		frame.palette[i * 3 + 1] = palette[i * 4 + 1];
+		frame.palette[i * 3 + 2] = palette[i * 4 + 2];
+	}
+
+	frame.width = width;
+	frame.height = height;
+	frame.timestamp = g_system->getMillis() - _startTime;
+
+	{
+		Common::StackLock lock(_mutex);
+		_head++;
+	}
+
+	if (!_thread)
+		encodeQueuedFrames();
+}
+
+int VideoCapture::encoderThreadProc(void *param) {
+	VideoCapture *capture = (VideoCapture *)param;
+
+	while (!capture->_quit) {
+		capture->encodeQueuedFrames();
+		g_system->delayMillis(kEncoderIdleDelay);
+	}
+
+	return 0;
+}
+
+void VideoCapture::encodeQueuedFrames() {
+	while (true) {
+		{
+			Common::StackLock lock(_mutex);
+			if (_tail == _head)
+				return;
+		}
+
+		writeFrame(_frames[_tail % kNumFrames]);
+
+		Common::StackLock lock(_mutex);
+		_tail++;
+	}
+}
+
+void VideoCapture::writeFrame(const Frame &frame) {
+	const bool newPalette = !_havePalette || memcmp(_lastPalette, frame.palette, sizeof(_lastPalette)) != 0;
+
+	_file.writeUint32LE(frame.timestamp);
+	_file.writeUint16LE((uint16)frame.width);
+	_file.writeUint16LE((uint16)frame.height);
+	_file.writeByte(newPalette ? 1 : 0);
+	if (newPalette) {
+		_file.write(frame.palette, sizeof(frame.palette));
+		memcpy(_lastPalette, frame.palette, sizeof(_lastPalette));
+		_havePalette = true;
+	}
+
+	const uint32 size = frame.width * frame.height;
+	const uint32 maxPackedSize = size + (size + 127) / 128;
+	if (_packBufferSize < maxPackedSize) {
+		free(_packBuffer);
+		_packBuffer = (byte *)malloc(maxPackedSize);
+		_packBufferSize = maxPackedSize;
+	}
+
+	const uint32 packedSize = Common::packBits(frame.pixels, size, _packBuffer);
+	_file.writeUint32LE(packedSize);
+	_file.write(_packBuffer, packedSize);
+
+	_framesWritten++;
+}
+
+} // End of namespace Graphics
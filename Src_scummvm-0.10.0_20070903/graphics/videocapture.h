@@ -0,0 +1,141 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+#ifndef GRAPHICS_VIDEOCAPTURE_H
+#define GRAPHICS_VIDEOCAPTURE_H
+
+#include "common/scummsys.h"
+#include "common/file.h"
+#include "common/mutex.h"
+#include "common/str.h"
+#include "common/system.h"
+
+namespace Graphics {
+
+/**
+ * Records the unscaled 8 bit game screen to a file, so that a session can
+ * be looked at frame by frame afterwards, e.g. to track down a performance
+ * regression, without running a screen recorder next to ScummVM.
+ *
+ * captureFrame() only copies the screen and the palette into a ring of
+ * kNumFrames buffers. A separate thread compresses the frames and writes
+ * them out. If it falls behind and the ring is full, new frames are dropped,
+ * so that the caller never has to wait for the encoder.
+ *
+ * The recordings are written to .svr files. Everything is little endian:
+ *
+ *   4 bytes    'SVMR'
+ *   byte       version (1)
+ *   3 bytes    padding, 0
+ *   then for each recorded frame:
+ *   uint32     the time it was captured, in ms since the recording started
+ *   uint16     width, in pixels
+ *   uint16     height, in pixels
+ *   byte       flags; bit 0 means that a palette follows
+ *   768 bytes  the palette as 256 RGB triplets, only if it changed since
+ *              the previous frame (always present in the first frame)
+ *   uint32     size of the compressed pixels
+ *   size bytes the width * height pixels, row by row without padding,
+ *              compressed with Common::packBits (see common/packbits.h)
+ *
+ * The dropped frames are simply missing; the timestamps tell how long each
+ * recorded frame stayed on screen. The file ends after the last frame.
+ */
+class VideoCapture {
+public:
+	enum {
+		/** Number of frames that can wait for the encoder */
+		kNumFrames = 8
+	};
+
+	VideoCapture();
+	~VideoCapture();
+
+	/**
+	 * Start recording into the given file. A recording in progress is
+	 * stopped first.
+	 * @return false if the file could not be created
+	 */
+	bool start(const Common::String &filename);
+
+	/** Stop recording, after writing out all frames that were captured. */
+	void stop();
+
+	bool isRecording() const { return _file.isOpen(); }
+
+	/**
+	 * Queue a frame for recording, unless the ring of frames is full, in
+	 * which case the frame is dropped.
+	 * @param pixels	the 8 bit screen
+	 * @param pitch		the pitch of the screen, in bytes
+	 * @param width		the width of the screen, in pixels
+	 * @param height	the height of the screen, in pixels
+	 * @param palette	the palette, in the format of OSystem::setPalette
+	 */
+	void captureFrame(const byte *pixels, int pitch, int width, int height, const byte *palette);
+
+	uint getFramesWritten() const { return _framesWritten; }
+	uint getFramesDropped() const { return _framesDropped; }
+
+private:
+	struct Frame {
+		byte *pixels;
+		uint32 capacity;
+		int width, height;
+		byte palette[256 * 3];
+		uint32 timestamp;
+	};
+
+	Frame _frames[kNumFrames];
+
+	/** Index of the next frame captureFrame() fills, modulo kNumFrames. */
+	uint _head;
+	/** Index of the next frame the encoder writes, modulo kNumFrames. */
+	uint _tail;
+	Common::Mutex _mutex;
+
+	OSystem::ThreadRef _thread;
+	volatile bool _quit;
+
+	Common::File _file;
+	uint32 _startTime;
+	byte _lastPalette[256 * 3];
+	bool _havePalette;
+	byte *_packBuffer;
+	uint32 _packBufferSize;
+
+	uint _framesWritten;
+	uint _framesDropped;
+
+	static int encoderThreadProc(void *param);
+
+	/** Write out all queued frames; returns once the ring is empty. */
+	void encodeQueuedFrames();
+	void writeFrame(const Frame &frame);
+};
+
+} // End of namespace Graphics
+
+#endif
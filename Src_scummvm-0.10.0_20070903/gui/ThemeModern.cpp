@@ -56,7 +56,8 @@ OverlayColor calcGradient(OverlayColor start, OverlayColor end, int pos, int max
 #pragma mark -
 
 ThemeModern::ThemeModern(OSystem *system, const Common::String &stylefile, const Common::ConfigFile *cfg) : Theme(), _system(system), _screen(), _initOk(false),
-_forceRedraw(false), _lastUsedBitMask(0), _fonts(), _cursor(0), _imageHandles(), _images(0), _colors(), _gradientFactors() {
+_forceRedraw(false), _lastUsedBitMask(0), _fonts(), _cursor(0), _imageHandles(), _images(0), _colors(), _gradientFactors(),
+_rowBuffer(0), _rowBufferSize(0), _dimMapValue(-1), _widgetCache(), _widgetCacheClock(0), _widgetCachePixels(0) {
 	_stylefile = stylefile;
 	_initOk = false;
 	_enabled = false;
@@ -65,6 +66,7 @@ _forceRedraw(false), _lastUsedBitMask(0), _fonts(), _cursor(0), _imageHandles(),
 	memset(&_dialog, 0, sizeof(_dialog));
 	memset(&_colors, 0, sizeof(_colors));
 	memset(&_gradientFactors, 0, sizeof(_gradientFactors));
+	memset(&_dimMap, 0, sizeof(_dimMap));
 
 	_screen.create(_system->getOverlayWidth(), _system->getOverlayHeight(), sizeof(OverlayColor));
 	if (_screen.pixels) {
@@ -74,6 +76,7 @@ _forceRedraw(false), _lastUsedBitMask(0), _fonts(), _cursor(0), _imageHandles(),
 
 	if (cfg) {
 		_configFile = *cfg;
+		_bundle.open(stylefile + ".thb");
 	} else {
 		if (!loadConfigFile(stylefile)) {
 			warning("Can not find theme config file '%s'", (stylefile + ".ini").c_str());
@@ -81,6 +84,8 @@ _forceRedraw(false), _lastUsedBitMask(0), _fonts(), _cursor(0), _imageHandles(),
 		}
 	}
 
+	// Even a precompiled theme, which contains the images already, may lack
+	// one which the ImageManager can still load from the theme archive
 	ImageMan.addArchive(stylefile + ".zip");
 
 	Common::String temp;
@@ -114,6 +119,7 @@ ThemeModern::~ThemeModern() {
 	deinit();
 	delete [] _images;
 	delete [] _cursor;
+	delete [] _rowBuffer;
 	_images = 0;
 	for (int i = 0; i < kImageHandlesMax; ++i) {
 		ImageMan.unregisterSurface(_imageHandles[i]);
@@ -150,6 +156,7 @@ bool ThemeModern::init() {
 }
 
 void ThemeModern::deinit() {
+	clearWidgetCache();
 	if (_initOk) {
 		_system->hideOverlay();
 		_screen.free();
@@ -195,7 +202,14 @@ void ThemeModern::openDialog(bool topDialog) {
 		_dialog->screen.create(_screen.w, _screen.h, sizeof(OverlayColor));
 	}
 	
-	if (_dialogShadingCallback && topDialog) {
+	if (_dialogShadingCallback == &ThemeModern::calcDimColor && topDialog) {
+		const Graphics::ChannelMap &map = getDimMap(_dimPercentValue);
+		OverlayColor *col = (OverlayColor*)_screen.pixels;
+		for (int y = 0; y < _screen.h; ++y) {
+			Graphics::mapRow((uint16 *)col, (const uint16 *)col, _screen.w, map);
+			col += _screen.w;
+		}
+	} else if (_dialogShadingCallback && topDialog) {
 		OverlayColor *col = (OverlayColor*)_screen.pixels;
 		for (int y = 0; y < _screen.h; ++y) {
 			for (int x = 0; x < _screen.w; ++x) {
@@ -836,6 +850,80 @@ void ThemeModern::drawRect(const Common::Rect &r, const Surface *corner, const S
 void ThemeModern::drawRectMasked(const Common::Rect &r, const Graphics::Surface *corner, const Graphics::Surface *top,
 							const Graphics::Surface *left, const Graphics::Surface *fill, int alpha,
 							OverlayColor start, OverlayColor end, uint factor, bool skipLastRow, bool skipTopRow) {
+	// Blending with alpha depends on what is below, everything else can be
+	// taken from the widget cache. Rects reaching over the screen edge are
+	// left to the clipping in drawSurfaceMasked.
+	const bool blended = (alpha >= 0 && alpha < 256) || alpha < -256;
+	const uint pixels = r.width() * r.height();
+	if (blended || r.left < 0 || r.top < 0 || r.right > _screen.w || r.bottom > _screen.h || pixels > kWidgetCachePixels) {
+		renderRectMasked(_screen, r, corner, top, left, fill, alpha, start, end, factor, skipLastRow, skipTopRow, 0);
+		return;
+	}
+
+	WidgetCacheKey key;
+	key.w = r.width();
+	key.h = r.height();
+	key.corner = corner;
+	key.top = top;
+	key.left = left;
+	key.fill = fill;
+	key.alpha = alpha;
+	key.start = start;
+	key.end = end;
+	key.factor = factor;
+	key.skipLastRow = skipLastRow;
+	key.skipTopRow = skipTopRow;
+
+	CachedWidget *entry = 0;
+	for (uint i = 0; i < _widgetCache.size(); ++i) {
+		if (_widgetCache[i]->key == key) {
+			entry = _widgetCache[i];
+			break;
+		}
+	}
+
+	if (!entry) {
+		// Make room by dropping the least recently used images
+		while (!_widgetCache.empty() && (_widgetCache.size() >= kWidgetCacheSize || _widgetCachePixels + pixels > kWidgetCachePixels)) {
+			int oldest = 0;
+			for (uint i = 1; i < _widgetCache.size(); ++i) {
+				if (_widgetCache[i]->lastUsed < _widgetCache[oldest]->lastUsed)
+					oldest = i;
+			}
+			CachedWidget *old = _widgetCache.remove_at(oldest);
+			_widgetCachePixels -= old->image.w * old->image.h;
+			old->image.free();
+			delete old;
+		}
+
+		entry = new CachedWidget;
+		entry->key = key;
+		entry->image.create(key.w, key.h, sizeof(OverlayColor));
+		renderRectMasked(entry->image, Common::Rect(key.w, key.h), corner, top, left, fill, alpha, start, end, factor,
+						skipLastRow, skipTopRow, &entry->spans);
+		_widgetCache.push_back(entry);
+		_widgetCachePixels += pixels;
+	}
+	entry->lastUsed = ++_widgetCacheClock;
+
+	for (Common::Array<DrawSpan>::const_iterator span = entry->spans.begin(); span != entry->spans.end(); ++span) {
+		memcpy(_screen.getBasePtr(r.left + span->x, r.top + span->y), entry->image.getBasePtr(span->x, span->y), span->len * sizeof(OverlayColor));
+	}
+}
+
+void ThemeModern::clearWidgetCache() {
+	for (uint i = 0; i < _widgetCache.size(); ++i) {
+		_widgetCache[i]->image.free();
+		delete _widgetCache[i];
+	}
+	_widgetCache.clear();
+	_widgetCachePixels = 0;
+}
+
+void ThemeModern::renderRectMasked(Graphics::Surface &target, const Common::Rect &r, const Graphics::Surface *corner, const Graphics::Surface *top,
+							const Graphics::Surface *left, const Graphics::Surface *fill, int alpha,
+							OverlayColor start, OverlayColor end, uint factor, bool skipLastRow, bool skipTopRow,
+							Common::Array<DrawSpan> *coverage) {
 	int drawWidth = MIN(corner->w, MIN(top->w, MIN(left->w, fill->w)));
 	int drawHeight = MIN(corner->h, MIN(top->h, MIN(left->h, fill->h)));
 	int partsH = r.height() / drawHeight;
@@ -863,6 +951,8 @@ void ThemeModern::drawRectMasked(const Common::Rect &r, const Graphics::Surface
 			++partsW;
 	}
 
+	Tile *tiles = new Tile[partsW];
+
 	for (int y = 0; y < partsH; ++y) {
 		int xPos = r.left;
 		bool upDown = (y == partsH - 1);
@@ -883,23 +973,35 @@ void ThemeModern::drawRectMasked(const Common::Rect &r, const Graphics::Surface
 				usedWidth = specialWidth;
 			}
 
+			Tile &tile = tiles[i];
+			tile.r = Common::Rect(xPos, yPos, xPos+usedWidth, yPos+usedHeight);
+
 			// draw the right surface
 			if (!i || i == partsW - 1) {
 				if ((!y && !skipTopRow) || (y == partsH - 1 && !skipLastRow)) {
-					drawSurfaceMasked(Common::Rect(xPos, yPos, xPos+usedWidth, yPos+usedHeight), corner, upDown, (i == partsW - 1), alpha, startCol, endCol);
+					tile.surf = corner;
 				} else {
-					drawSurfaceMasked(Common::Rect(xPos, yPos, xPos+usedWidth, yPos+usedHeight), left, upDown, (i == partsW - 1), alpha, startCol, endCol);
+					tile.surf = left;
 				}
+				tile.upDown = upDown;
+				tile.leftRight = (i == partsW - 1);
 			} else if (!y || (y == partsH - 1 && !skipLastRow)) {
-				drawSurfaceMasked(Common::Rect(xPos, yPos, xPos+usedWidth, yPos+usedHeight), top, upDown, false, alpha, startCol, endCol);
+				tile.surf = top;
+				tile.upDown = upDown;
+				tile.leftRight = false;
 			} else {
-				drawSurfaceMasked(Common::Rect(xPos, yPos, xPos+usedWidth, yPos+usedHeight), fill, false, false, alpha, startCol, endCol);
+				tile.surf = fill;
+				tile.upDown = false;
+				tile.leftRight = false;
 			}
 			xPos += usedWidth;
 		}
 
+		drawTileRow(target, tiles, partsW, alpha, startCol, endCol, coverage);
 		yPos += usedHeight;
 	}
+
+	delete[] tiles;
 }
 
 Common::Rect ThemeModern::shadowRect(const Common::Rect &r, uint32 shadowStyle) {
@@ -1018,6 +1120,8 @@ void ThemeModern::drawShadowRect(const Common::Rect &r, const Common::Rect &area
 	OverlayColor startCol = g_system->RGBToColor(0, 0, 0);
 	OverlayColor endCol = g_system->RGBToColor(0, 0, 0);
 
+	Tile *tiles = new Tile[partsW];
+
 	for (int y = 0; y < partsH; ++y) {
 		// calculate the correct drawing height
 		int usedHeight = drawHeight;
@@ -1027,6 +1131,7 @@ void ThemeModern::drawShadowRect(const Common::Rect &r, const Common::Rect &area
 
 		int xPos = r.left;
 		bool upDown = (y == partsH - 1);
+		int numTiles = 0;
 
 		for (int i = 0; i < partsW; ++i) {
 			// calculate the correct drawing width
@@ -1040,22 +1145,113 @@ void ThemeModern::drawShadowRect(const Common::Rect &r, const Common::Rect &area
 				continue;
 			}
 
+			Tile &tile = tiles[numTiles++];
+			tile.r = Common::Rect(xPos, yPos, xPos+usedWidth, yPos+usedHeight);
+			tile.upDown = upDown;
+			tile.leftRight = false;
+
 			// draw the right surface
 			if (!i || i == partsW - 1) {
 				if ((!y && !skipTopRow) || (y == partsH - 1 && !skipLastRow)) {
-					drawSurfaceMasked(Common::Rect(xPos, yPos, xPos+usedWidth, yPos+usedHeight), corner, upDown, (i == partsW - 1), alpha, startCol, endCol);
+					tile.surf = corner;
 				} else {
-					drawSurfaceMasked(Common::Rect(xPos, yPos, xPos+usedWidth, yPos+usedHeight), left, upDown, (i == partsW - 1), alpha, startCol, endCol);
+					tile.surf = left;
 				}
+				tile.leftRight = (i == partsW - 1);
 			} else if (!y || (y == partsH - 1 && !skipLastRow)) {
-				drawSurfaceMasked(Common::Rect(xPos, yPos, xPos+usedWidth, yPos+usedHeight), top, upDown, false, alpha, startCol, endCol);
+				tile.surf = top;
 			} else {
-				drawSurfaceMasked(Common::Rect(xPos, yPos, xPos+usedWidth, yPos+usedHeight), fill, upDown, false, alpha, startCol, endCol);
+				tile.surf = fill;
 			}
 			xPos += usedWidth;
 		}
+
+		if (numTiles)
+			drawTileRow(_screen, tiles, numTiles, alpha, startCol, endCol, 0);
 		yPos += usedHeight;
 	}
+
+	delete[] tiles;
+}
+
+void ThemeModern::drawTileRow(Graphics::Surface &target, const Tile *tiles, int numTiles, int alpha,
+						OverlayColor start, OverlayColor end, Common::Array<DrawSpan> *coverage) {
+	Common::Rect area = tiles[0].r;
+	for (int i = 1; i < numTiles; ++i)
+		area.extend(tiles[i].r);
+
+	if (area.left < 0 || area.top < 0 || area.right > target.w || area.bottom > target.h || alpha < -512) {
+		// Only the screen is drawn to partly
+		assert(&target == &_screen && !coverage);
+		for (int i = 0; i < numTiles; ++i)
+			drawSurfaceMasked(tiles[i].r, tiles[i].surf, tiles[i].upDown, tiles[i].leftRight, alpha, start, end);
+		return;
+	}
+
+	const OverlayColor transparency = _colors[kColorTransparency];
+	const int width = area.width();
+	const int height = area.height();
+	OverlayColor *line = getRowBuffer(width);
+
+	for (int y = 0; y < height; ++y) {
+		// Gather the image rows, leaving the gaps between the tiles and the
+		// parts wider than the images transparent
+		for (int x = 0; x < width; ++x)
+			line[x] = transparency;
+
+		for (int i = 0; i < numTiles; ++i) {
+			const Tile &tile = tiles[i];
+			const int drawWidth = MIN<int>(tile.r.width(), tile.surf->w);
+			const OverlayColor *src = (const OverlayColor *)tile.surf->pixels + (tile.upDown ? tile.surf->h - 1 - y : y) * tile.surf->w;
+			OverlayColor *dst = line + tile.r.left - area.left;
+			if (tile.leftRight) {
+				for (int x = 0; x < drawWidth; ++x)
+					dst[x] = src[drawWidth - x - 1];
+			} else {
+				memcpy(dst, src, drawWidth * sizeof(OverlayColor));
+			}
+		}
+
+		uint16 *dst = (uint16 *)target.getBasePtr(area.left, area.top + y);
+		const uint16 *src = (const uint16 *)line;
+		const uint16 key = (uint16)transparency;
+		const uint16 mask = (uint16)calcGradient(start, end, y, height - 1, 1);
+
+		if (alpha >= 256) {
+			Graphics::copyKeyedRow(dst, src, width, key, mask);
+		} else if (alpha < 0 && alpha >= -256) {
+			Graphics::mapKeyedRow(dst, src, width, key, mask, getDimMap(256 * (100 - (-alpha)) / 100));
+		} else if (alpha >= 0) {
+			Graphics::blendKeyedRow(dst, src, width, key, mask, alpha, false, gBitFormat);
+		} else {
+			Graphics::blendKeyedRow(dst, src, width, key, mask, -alpha - 256, true, gBitFormat);
+		}
+
+		if (coverage) {
+			for (int x = 0; x < width; ) {
+				if (line[x] == transparency) {
+					++x;
+					continue;
+				}
+				DrawSpan span;
+				span.x = (int16)(area.left + x);
+				span.y = (int16)(area.top + y);
+				while (x < width && line[x] != transparency)
+					++x;
+				span.len = (int16)(area.left + x - span.x);
+				coverage->push_back(span);
+			}
+		}
+	}
+}
+
+OverlayColor *ThemeModern::getRowBuffer(int width) {
+	if (width > _rowBufferSize) {
+		delete[] _rowBuffer;
+		_rowBufferSize = width;
+		_rowBuffer = new OverlayColor[width];
+	}
+	return _rowBuffer;
 }
 
 void ThemeModern::drawSurface(const Common::Rect &r, const Surface *surf, bool upDown, bool leftRight, int alpha) {
@@ -1171,6 +1367,8 @@ void ThemeModern::resetupGuiRenderer() {
 	}
 	
 	_lastUsedBitMask = gBitFormat;
+	clearWidgetCache();
+	_dimMapValue = -1;
 	
 	int i;
 	for (i = 0; i < kImageHandlesMax; ++i) {
@@ -1178,13 +1376,26 @@ void ThemeModern::resetupGuiRenderer() {
 	}
 	
 	for (i = 0; i < kImageHandlesMax; ++i) {
-		ImageMan.registerSurface(_imageHandles[i], 0);
+		registerImage(_imageHandles[i]);
 		_images[i] = ImageMan.getSurface(_imageHandles[i]);
 	}
 
 	setupColors();
 }
 
+void ThemeModern::registerImage(const Common::String &name) {
+	if (ImageMan.getSurface(name))
+		return;
+
+	// Prefer the already decoded image of a precompiled theme, otherwise
+	// let the ImageManager load it from a file or the theme archive
+	Graphics::Surface *surf = _bundle.loadImage(name);
+	if (!ImageMan.registerSurface(name, surf) && surf) {
+		surf->free();
+		delete surf;
+	}
+}
+
 void ThemeModern::setupColors() {
 	// load the colors from the config file
 	getColorFromConfig("main_dialog_start", _colors[kMainDialogStart]);
@@ -1378,7 +1589,7 @@ void ThemeModern::processExtraValues() {
 	_imageHandles[kGUICursor] = _evaluator->getStringVar("pix_cursor_image");
 
 	for (int i = 0; i < kImageHandlesMax; ++i) {
-		ImageMan.registerSurface(_imageHandles[i], 0);
+		registerImage(_imageHandles[i]);
 		_images[i] = ImageMan.getSurface(_imageHandles[i]);
 	}
 
@@ -1484,6 +1695,33 @@ OverlayColor ThemeModern::calcDimColor(OverlayColor col) {
 	return _system->RGBToColor(r, g, b);
 }
 
+const Graphics::ChannelMap &ThemeModern::getDimMap(int dimValue) {
+	if (dimValue == _dimMapValue && _dimMap.bitFormat == gBitFormat)
+		return _dimMap;
+
+	_dimMapValue = dimValue;
+	_dimMap.bitFormat = gBitFormat;
+
+	// calcDimColor treats the channels independently, so its result is the
+	// OR of the results for each channel alone
+	const int greenBits = (gBitFormat == 565) ? 6 : 5;
+	const int redShift = 5 + greenBits;
+	uint8 r, g, b;
+
+	for (int i = 0; i < 32; ++i) {
+		_system->colorToRGB((OverlayColor)(i << redShift), r, g, b);
+		_dimMap.red[i] = _system->RGBToColor((uint8)(r * dimValue >> 8), 0, 0);
+		_system->colorToRGB((OverlayColor)i, r, g, b);
+		_dimMap.blue[i] = _system->RGBToColor(0, 0, (uint8)(b * dimValue >> 8));
+	}
+	for (int i = 0; i < (1 << greenBits); ++i) {
+		_system->colorToRGB((OverlayColor)(i << 5), r, g, b);
+		_dimMap.green[i] = _system->RGBToColor(0, (uint8)(g * dimValue >> 8), 0);
+	}
+
+	return _dimMap;
+}
+
 #pragma mark -
 
 void ThemeModern::setUpCursor() {
@@ -28,6 +28,7 @@
 #ifndef DISABLE_FANCY_THEMES
 
 #include "gui/theme.h"
+#include "graphics/blend.h"
 
 namespace GUI {
 
@@ -94,6 +95,38 @@ private:
 	void drawSurfaceMasked(const Common::Rect &r, const Graphics::Surface *surf, bool upDown, bool leftRight, int alpha,
 							OverlayColor start, OverlayColor end, uint factor = 1);
 
+	/** A horizontal run of opaque pixels in a cached widget image. */
+	struct DrawSpan {
+		int16 x, y;
+		int16 len;
+	};
+
+	/** One image tile, as drawn by drawSurfaceMasked(). */
+	struct Tile {
+		Common::Rect r;
+		const Graphics::Surface *surf;
+		bool upDown, leftRight;
+	};
+
+	void renderRectMasked(Graphics::Surface &target, const Common::Rect &r, const Graphics::Surface *corner, const Graphics::Surface *top,
+						const Graphics::Surface *left, const Graphics::Surface *fill, int alpha,
+						OverlayColor start, OverlayColor end, uint factor, bool skipLastRow, bool skipTopRow,
+						Common::Array<DrawSpan> *coverage);
+
+	/**
+	 * Draw a row of tiles of the same height into target, one pixel row at
+	 * a time: the image rows are gathered into a line buffer, which is then
+	 * drawn with a single call of a blend kernel. The opaque pixels drawn
+	 * are added to coverage, unless it is 0.
+	 */
+	void drawTileRow(Graphics::Surface &target, const Tile *tiles, int numTiles, int alpha,
+						OverlayColor start, OverlayColor end, Common::Array<DrawSpan> *coverage);
+
+	OverlayColor *getRowBuffer(int width);
+
+	OverlayColor *_rowBuffer;
+	int _rowBufferSize;
+
 	enum ShadowStyles {
 		kShadowFull = 0,
 		kShadowSmall = 1,
@@ -123,6 +156,7 @@ private:
 
 	int _lastUsedBitMask;
 	void resetupGuiRenderer();
+	void registerImage(const Common::String &name);
 	void setupColors();
 
 	OverlayColor getColor(State state);
@@ -217,6 +251,15 @@ private:
 	OverlayColor calcLuminance(OverlayColor col);
 	OverlayColor calcDimColor(OverlayColor col);
 
+	/**
+	 * Return the lookup tables for calcDimColor() with the given dim value,
+	 * built from the backend's color conversion.
+	 */
+	const Graphics::ChannelMap &getDimMap(int dimValue);
+
+	Graphics::ChannelMap _dimMap;
+	int _dimMapValue;
+
 	bool _useCursor;
 	void setUpCursor();
 	void createCursor();
@@ -330,6 +373,49 @@ private:
 	};
 	
 	uint _gradientFactors[kMaxGradientFactors];
+
+private:
+	enum {
+		/** Maximal number of widget images in the cache */
+		kWidgetCacheSize = 32,
+		/** Maximal number of pixels of all widget images in the cache */
+		kWidgetCachePixels = 1024 * 1024
+	};
+
+	/** Everything the image drawRectMasked() draws depends on. */
+	struct WidgetCacheKey {
+		int16 w, h;
+		const Graphics::Surface *corner, *top, *left, *fill;
+		int alpha;
+		OverlayColor start, end;
+		uint factor;
+		bool skipLastRow, skipTopRow;
+
+		bool operator==(const WidgetCacheKey &k) const {
+			return w == k.w && h == k.h && corner == k.corner && top == k.top && left == k.left && fill == k.fill &&
+				alpha == k.alpha && start == k.start && end == k.end && factor == k.factor &&
+				skipLastRow == k.skipLastRow && skipTopRow == k.skipTopRow;
+		}
+	};
+
+	struct CachedWidget {
+		WidgetCacheKey key;
+		Graphics::Surface image;
+		Common::Array<DrawSpan> spans;
+		uint lastUsed;
+	};
+
+	/**
+	 * The images of recently drawn widget and dialog backgrounds, which do
+	 * not depend on what is drawn below them. Dialogs redraw all their
+	 * widgets whenever something changes, so most of them can be copied
+	 * from here instead of being composed from the theme images again.
+	 */
+	Common::Array<CachedWidget *> _widgetCache;
+	uint _widgetCacheClock;
+	uint _widgetCachePixels;
+
+	void clearWidgetCache();
 };
 
 } // end of namespace GUI
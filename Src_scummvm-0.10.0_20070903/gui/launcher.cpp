@@ -32,6 +32,7 @@
 #include "common/config-manager.h"
 #include "common/events.h"
 #include "common/fs.h"
+#include "common/md5cache.h"
 #include "common/util.h"
 #include "common/system.h"
 
@@ -654,6 +655,7 @@ void LauncherDialog::addGame() {
 		// ...so let's determine a list of candidates, games that
 		// could be contained in the specified directory.
 		GameList candidates(PluginManager::instance().detectGames(files));
+		MD5Man.flushToDisk();
 
 		int idx;
 		if (candidates.empty()) {
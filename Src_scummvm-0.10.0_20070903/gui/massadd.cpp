@@ -28,6 +28,8 @@
 #include "base/game.h"
 #include "base/plugins.h"
 
+#include "common/md5cache.h"
+
 #include "gui/launcher.h"	// For addGameToConf()
 #include "gui/massadd.h"
 #include "gui/newgui.h"
@@ -132,7 +134,10 @@ void MassAddDialog::handleTickle() {
 					dir.path().c_str());
 		}
 	
-		// Run the detector on the dir
+		// Run the detector on the dir. PluginManager::detectGames spreads
+		// the plugins over several threads; the directories themselves are
+		// scanned one at a time, so that we can stop after kMaxScanTime and
+		// keep the dialog responsive.
 		GameList candidates(PluginManager::instance().detectGames(files));
 		
 		if (candidates.size() >= 1) {
@@ -162,6 +167,9 @@ void MassAddDialog::handleTickle() {
 	char buf[256];
 
 	if (_scanStack.empty()) {
+		// Persist the MD5 sums the detectors computed during the scan
+		MD5Man.flushToDisk();
+
 		// Enable the OK button
 		_okButton->setEnabled(true);
 
@@ -23,6 +23,7 @@ MODULE_OBJS := \
 	themebrowser.o \
 	widget.o \
 	theme.o \
+	theme-bundle.o \
 	ThemeClassic.o \
 	ThemeModern.o \
 	theme-config.o
@@ -0,0 +1,337 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+#include "common/stdafx.h"
+#include "common/endian.h"
+#include "common/file.h"
+#include "common/system.h"
+
+#include "graphics/surface.h"
+
+#include "gui/theme-bundle.h"
+
+namespace GUI {
+
+static bool readString(Common::SeekableReadStream &stream, Common::String &str) {
+	char buf[256];
+	const uint16 len = stream.readUint16LE();
+	char *p = (len < sizeof(buf)) ? buf : new char[len];
+
+	const bool ok = (stream.read(p, len) == len);
+	if (ok) {
+		// A length of 0 would make the String constructor use strlen
+		if (len)
+			str = Common::String(p, len);
+		else
+			str.clear();
+	}
+
+	if (p != buf)
+		delete[] p;
+	return ok;
+}
+
+static bool skipString(Common::SeekableReadStream &stream) {
+	const uint16 len = stream.readUint16LE();
+	if (stream.pos() + len > stream.size())
+		return false;
+	stream.skip(len);
+	return true;
+}
+
+/**
+ * The bundle whose sources loadConfig() found to match last. The config of a
+ * theme is always read with loadConfig() right before the theme opens the
+ * bundle, so open() needn't check the sources of that bundle once more.
+ */
+static Common::String s_checkedBundle;
+
+ThemeBundle::ThemeBundle() : _data(0), _copy(0), _size(0), _configOffset(0), _entries() {
+	_masks[0] = _masks[1] = _masks[2] = 0;
+}
+
+ThemeBundle::~ThemeBundle() {
+	close();
+}
+
+bool ThemeBundle::readHeader(Common::SeekableReadStream &stream, uint16 masks[3]) {
+	if (stream.readUint32BE() != MKID_BE('STHB'))
+		return false;
+	if (stream.readUint16LE() != kVersion)
+		return false;
+
+	for (int i = 0; i < 3; ++i)
+		masks[i] = stream.readUint16LE();
+
+	return !stream.ioFailed() && !stream.eos();
+}
+
+bool ThemeBundle::sourcesMatch(Common::SeekableReadStream &stream, bool check) {
+	const uint16 numSources = stream.readUint16LE();
+
+	for (uint16 i = 0; i < numSources; ++i) {
+		Common::String name;
+
+		if (!readString(stream, name))
+			return false;
+		const uint32 size = stream.readUint32LE();
+		const uint32 mtime = stream.readUint32LE();
+		if (!check)
+			continue;
+
+		// Sources which are gone don't matter, only the bundle may have
+		// been installed
+		Common::File file;
+		if (!file.open(name))
+			continue;
+
+		// Without modification times, only the size can be compared
+		uint32 fileMTime;
+		if (size == 0 || file.size() != size ||
+			(file.getModificationTime(fileMTime) && fileMTime != mtime)) {
+			debug(1, "ThemeBundle: '%s' was added or changed since the bundle was created", name.c_str());
+			return false;
+		}
+	}
+
+	return !stream.ioFailed();
+}
+
+bool ThemeBundle::readConfig(Common::SeekableReadStream &stream, Common::ConfigFile *cfg) {
+	Common::ConfigFile::Section section;
+	Common::ConfigFile::KeyValue kv;
+	const uint32 numSections = stream.readUint32LE();
+
+	for (uint32 i = 0; i < numSections; ++i) {
+		if (!cfg) {
+			// Only skip over the section
+			if (!skipString(stream))
+				return false;
+			const uint32 numKeys = stream.readUint32LE();
+			for (uint32 j = 0; j < numKeys * 2; ++j) {
+				if (!skipString(stream))
+					return false;
+			}
+			continue;
+		}
+
+		if (!readString(stream, section.name))
+			return false;
+		section.keys.clear();
+
+		const uint32 numKeys = stream.readUint32LE();
+		for (uint32 j = 0; j < numKeys; ++j) {
+			if (!readString(stream, kv.key) || !readString(stream, kv.value))
+				return false;
+			section.keys.push_back(kv);
+		}
+
+		cfg->addSection(section);
+	}
+
+	return !stream.ioFailed();
+}
+
+bool ThemeBundle::loadConfig(const Common::String &filename, Common::ConfigFile &cfg) {
+	Common::File file;
+	uint16 masks[3];
+
+	s_checkedBundle.clear();
+	if (!file.open(filename))
+		return false;
+	if (!readHeader(file, masks) || !sourcesMatch(file))
+		return false;
+
+	if (!readConfig(file, &cfg))
+		return false;
+	s_checkedBundle = filename;
+	return true;
+}
+
+bool ThemeBundle::open(const Common::String &filename, bool map) {
+	close();
+
+	if (!_file.open(filename))
+		return false;
+
+	_size = _file.size();
+	if (map)
+		_data = _file.getData(0, _size);
+	if (!_data) {
+		// Mapping is not supported or failed; fall back to a copy
+		_copy = new byte[_size];
+		assert(_copy);
+		if (_file.read(_copy, _size) != _size) {
+			close();
+			return false;
+		}
+		_file.close();
+		_data = _copy;
+	}
+
+	Common::MemoryReadStream stream(_data, _size);
+	if (!readHeader(stream, _masks)) {
+		warning("'%s' is no theme bundle of version %d", filename.c_str(), kVersion);
+		close();
+		return false;
+	}
+	const bool checked = (filename == s_checkedBundle);
+	s_checkedBundle.clear();
+	if (!sourcesMatch(stream, !checked)) {
+		warning("Theme bundle '%s' is out of date, ignoring it", filename.c_str());
+		close();
+		return false;
+	}
+
+	_configOffset = stream.pos();
+	if (!readConfig(stream, 0)) {
+		close();
+		return false;
+	}
+
+	const uint32 numEntries = stream.readUint32LE();
+	for (uint32 i = 0; i < numEntries; ++i) {
+		Common::String name;
+		Entry entry;
+
+		if (!readString(stream, name)) {
+			close();
+			return false;
+		}
+
+		entry.type = stream.readUint16LE();
+		if (entry.type == kEntryImage) {
+			entry.width = stream.readUint16LE();
+			entry.height = stream.readUint16LE();
+			entry.size = entry.width * entry.height * 2;
+		} else {
+			entry.width = entry.height = 0;
+			entry.size = stream.readUint32LE();
+		}
+		entry.offset = stream.pos();
+
+		if (stream.ioFailed() || entry.offset + entry.size > _size) {
+			warning("Theme bundle '%s' is truncated", filename.c_str());
+			close();
+			return false;
+		}
+
+		_entries[name] = entry;
+		stream.seek(entry.size, SEEK_CUR);
+	}
+
+	return true;
+}
+
+void ThemeBundle::close() {
+	_file.close();
+	delete[] _copy;
+	_copy = 0;
+	_data = 0;
+	_size = 0;
+	_configOffset = 0;
+	_entries.clear();
+}
+
+bool ThemeBundle::getConfig(Common::ConfigFile &cfg) const {
+	if (!_data)
+		return false;
+
+	Common::MemoryReadStream stream(_data + _configOffset, _size - _configOffset);
+	return readConfig(stream, &cfg);
+}
+
+/**
+ * Widens a color component of the given mask to 8 bits, by repeating its
+ * upper bits in the new lower ones, so that for example 0x1F turns into 0xFF.
+ */
+static uint8 expandComponent(uint16 color, uint16 mask) {
+	if (!mask)
+		return 0;
+
+	int shift = 0, bits = 0;
+	while (!(mask & (1 << shift)))
+		++shift;
+	while (shift + bits < 16 && (mask & (1 << (shift + bits))))
+		++bits;
+
+	uint value = (color & mask) >> shift;
+	uint result = 0;
+	for (int filled = 0; filled < 8; filled += bits)
+		result |= (bits + filled <= 8) ? (value << (8 - bits - filled)) : (value >> (bits + filled - 8));
+	return (uint8)result;
+}
+
+Graphics::Surface *ThemeBundle::loadImage(const Common::String &name) const {
+	if (!_data || !_entries.contains(name))
+		return 0;
+
+	const Entry &entry = _entries[name];
+	if (entry.type != kEntryImage)
+		return 0;
+
+	Graphics::Surface *surf = new Graphics::Surface;
+	assert(surf);
+	surf->create(entry.width, entry.height, sizeof(OverlayColor));
+	assert(surf->pixels);
+
+	const byte *src = _data + entry.offset;
+	OverlayColor *dst = (OverlayColor *)surf->pixels;
+	const uint32 numPixels = entry.width * entry.height;
+
+	const bool sameFormat = (g_system->RGBToColor(255, 0, 0) == _masks[0] &&
+		g_system->RGBToColor(0, 255, 0) == _masks[1] &&
+		g_system->RGBToColor(0, 0, 255) == _masks[2]);
+
+	if (sameFormat) {
+#ifdef SCUMM_LITTLE_ENDIAN
+		memcpy(dst, src, entry.size);
+#else
+		for (uint32 i = 0; i < numPixels; ++i)
+			dst[i] = READ_LE_UINT16(src + i * 2);
+#endif
+	} else {
+		for (uint32 i = 0; i < numPixels; ++i) {
+			const uint16 color = READ_LE_UINT16(src + i * 2);
+			dst[i] = g_system->RGBToColor(expandComponent(color, _masks[0]),
+				expandComponent(color, _masks[1]), expandComponent(color, _masks[2]));
+		}
+	}
+
+	return surf;
+}
+
+Common::SeekableReadStream *ThemeBundle::openFile(const Common::String &name) const {
+	if (!_data || !_entries.contains(name))
+		return 0;
+
+	const Entry &entry = _entries[name];
+	if (entry.type != kEntryFile)
+		return 0;
+
+	return new Common::MemoryReadStream(_data + entry.offset, entry.size);
+}
+
+} // End of namespace GUI
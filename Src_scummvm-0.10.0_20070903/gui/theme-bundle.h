@@ -0,0 +1,160 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+#ifndef GUI_THEME_BUNDLE_H
+#define GUI_THEME_BUNDLE_H
+
+#include "common/stdafx.h"
+#include "common/scummsys.h"
+#include "common/config-file.h"
+#include "common/file.h"
+#include "common/hashmap.h"
+#include "common/hash-str.h"
+#include "common/str.h"
+#include "common/stream.h"
+
+namespace Graphics {
+struct Surface;
+}
+
+namespace GUI {
+
+/**
+ * A precompiled theme, as written by tools/create_themebundle. It contains
+ * the already parsed theme config, the images of the theme already decoded
+ * to 16 bit pixels, and the font caches (.fcc) of the theme, so that loading
+ * a theme needs neither the INI parser, nor the image decoders, nor zlib.
+ *
+ * Everything is little endian. Strings are stored as a 16 bit length
+ * followed by the characters, without a terminating zero.
+ *
+ *   uint32 BE  'STHB'
+ *   uint16     version (kVersion)
+ *   uint16     red, green and blue mask of the image pixels
+ *   uint16     number of theme source files, then for each of them:
+ *                string name, uint32 size, uint32 modification time in
+ *                seconds since the epoch; both are 0 if the file did
+ *                not exist
+ *   uint32     number of config sections, then for each of them:
+ *                string name, uint32 number of keys, string key/value pairs
+ *   uint32     number of entries, then for each of them:
+ *                string name, uint16 type,
+ *                for images: uint16 width, uint16 height, width*height pixels
+ *                for files:  uint32 size, size bytes
+ *
+ * The theme source files are the .ini and .zip file of the theme the bundle
+ * was created from. If any of them which can be found now differs in size or
+ * modification time from the recorded one, or did not exist back then, the
+ * bundle is out of date and is ignored, so that changes to the theme are
+ * never hidden by it. Copies of the sources must keep their timestamps.
+ * Platforms which can't tell the modification time only compare the sizes.
+ *
+ * The bundle is memory mapped if possible, or else read with one single
+ * read; the entries are only indexed and not copied until they are used.
+ * Images whose pixel format matches the overlay format are used as they
+ * are, otherwise they are converted with OSystem::RGBToColor.
+ */
+class ThemeBundle {
+public:
+	enum {
+		kVersion = 3
+	};
+
+	enum EntryType {
+		kEntryImage = 0,
+		kEntryFile = 1
+	};
+
+	ThemeBundle();
+	~ThemeBundle();
+
+	/**
+	 * Loads the bundle with the given filename.
+	 *
+	 * @param map	memory map the bundle if possible, instead of reading it
+	 *		into memory
+	 * @return true on success, false if the file does not exist, is not
+	 *         a valid theme bundle of this version or is out of date
+	 */
+	bool open(const Common::String &filename, bool map = true);
+	void close();
+	bool isOpen() const { return _data != 0; }
+
+	/**
+	 * Fills cfg with the theme config stored in the bundle.
+	 */
+	bool getConfig(Common::ConfigFile &cfg) const;
+
+	/**
+	 * Reads only the theme config from the bundle with the given filename,
+	 * without loading the rest of it. If open() is called on the same bundle
+	 * next, it doesn't check the theme sources again.
+	 */
+	static bool loadConfig(const Common::String &filename, Common::ConfigFile &cfg);
+
+	/**
+	 * Creates a surface in the overlay format for the image with the given
+	 * name. The caller has to free it.
+	 *
+	 * @return the new surface, or 0 if there is no such image in the bundle
+	 */
+	Graphics::Surface *loadImage(const Common::String &name) const;
+
+	/**
+	 * Opens a stream on a file stored in the bundle. The stream reads
+	 * straight from the bundle, so it must not be used after the bundle has
+	 * been closed. The caller has to delete it.
+	 *
+	 * @return the new stream, or 0 if there is no such file in the bundle
+	 */
+	Common::SeekableReadStream *openFile(const Common::String &name) const;
+
+private:
+	struct Entry {
+		uint16 type;
+		uint16 width, height;
+		uint32 offset, size;
+	};
+
+	typedef Common::HashMap<Common::String, Entry, Common::IgnoreCase_Hash, Common::IgnoreCase_EqualTo> EntryMap;
+
+	static bool readHeader(Common::SeekableReadStream &stream, uint16 masks[3]);
+	static bool sourcesMatch(Common::SeekableReadStream &stream, bool check = true);
+	static bool readConfig(Common::SeekableReadStream &stream, Common::ConfigFile *cfg);
+
+	Common::MappedFile _file;
+	/** The bundle contents, either mapped or in _copy. */
+	const byte *_data;
+	/** The bundle contents read into memory, if the file can't be mapped. */
+	byte *_copy;
+	uint32 _size;
+	uint16 _masks[3];
+	uint32 _configOffset;
+	EntryMap _entries;
+};
+
+} // End of namespace GUI
+
+#endif
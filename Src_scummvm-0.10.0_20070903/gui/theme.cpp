@@ -62,6 +62,14 @@ const Graphics::Font *Theme::loadFont(const char *filename) {
 	Common::File fontFile;
 
 	if (!cacheFilename.empty()) {
+		Common::SeekableReadStream *bundleFile = _bundle.openFile(cacheFilename);
+		if (bundleFile) {
+			font = Graphics::NewFont::loadFromCache(*bundleFile);
+			delete bundleFile;
+		}
+		if (font)
+			return font;
+
 		if (fontFile.open(cacheFilename))
 			font = Graphics::NewFont::loadFromCache(fontFile);
 		if (font)
@@ -157,6 +165,9 @@ bool Theme::loadConfigFile(const Common::String &stylefile) {
 	if (ConfMan.hasKey("extrapath"))
 		Common::File::addDefaultDirectoryRecursive(ConfMan.get("extrapath"));
 
+	if (_bundle.open(stylefile + ".thb") && _bundle.getConfig(_configFile))
+		return true;
+
 	if (!_configFile.loadFromFile(stylefile + ".ini")) {
 #ifdef USE_ZLIB
 		// Maybe find a nicer solution to this
@@ -206,7 +217,9 @@ bool Theme::themeConfigUseable(const Common::String &stylefile, const Common::St
 	if (!cfg && (cStyle || !style.empty()))
 		cfg = &configFile;
 
-	if (!file.open(stylefile + ".ini")) {
+	if (ThemeBundle::loadConfig(stylefile + ".thb", cfg ? *cfg : configFile)) {
+		// A precompiled theme, the config is read already
+	} else if (!file.open(stylefile + ".ini")) {
 #ifdef USE_ZLIB
 		// Maybe find a nicer solution to this
 		unzFile zipFile = unzOpen((stylefile + ".zip").c_str());
@@ -35,6 +35,8 @@
 #include "graphics/surface.h"
 #include "graphics/fontman.h"
 
+#include "gui/theme-bundle.h"
+
 #define THEME_VERSION 22
 
 namespace GUI {
@@ -240,6 +242,8 @@ protected:
 	Common::ConfigFile _configFile;
 	Common::ConfigFile _defaultConfig;
 
+	ThemeBundle _bundle;
+
 public:
 	bool needThemeReload() { return ((_loadedThemeX != g_system->getOverlayWidth()) ||
 									 (_loadedThemeY != g_system->getOverlayHeight())); }
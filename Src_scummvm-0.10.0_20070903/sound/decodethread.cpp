@@ -0,0 +1,340 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+#include "common/stdafx.h"
+#include "common/list.h"
+#include "common/mutex.h"
+#include "common/system.h"
+#include "common/thread.h"
+#include "common/util.h"
+
+#include "sound/audiostream.h"
+#include "sound/decodethread.h"
+
+namespace Audio {
+
+enum {
+	/** Number of samples the decode thread decodes for a stream in one go. */
+	kDecodeChunkSize = 2048,
+
+	/** How long the decode thread sleeps if all buffers are full (in ms). */
+	kDecodeIdleDelay = 5
+};
+
+static uint _decodeLookahead = 250;
+
+void setDecodeLookahead(uint msecs) {
+	_decodeLookahead = msecs;
+}
+
+#ifdef HAVE_MEMORY_BARRIER
+
+#pragma mark -
+#pragma mark --- Sample ring buffer ---
+#pragma mark -
+
+/**
+ * Ring buffer of samples with a single producer (the decode thread) and a
+ * single consumer (the mixer). No locking is needed: each side only ever
+ * modifies its own position, and only publishes it once the samples it
+ * covers have been written resp. read.
+ */
+class SampleRingBuffer {
+	int16 *_buffer;
+	uint32 _mask;
+
+	// Both positions are free running, i.e. not wrapped at the buffer size
+	volatile uint32 _readPos;
+	volatile uint32 _writePos;
+
+public:
+	SampleRingBuffer(uint32 minSize) : _readPos(0), _writePos(0) {
+		uint32 size = kDecodeChunkSize;
+		while (size < minSize)
+			size <<= 1;
+		_buffer = new int16[size];
+		_mask = size - 1;
+	}
+
+	~SampleRingBuffer() {
+		delete[] _buffer;
+	}
+
+	uint32 size() const { return _mask + 1; }
+	uint32 available() const { return _writePos - _readPos; }
+	uint32 space() const { return size() - available(); }
+
+	/**
+	 * Decode up to numSamples samples from input into the buffer. Must only
+	 * be called by the producer, and numSamples must not exceed space().
+	 */
+	int fill(AudioStream &input, int numSamples) {
+		const uint32 pos = _writePos;
+		int total = 0;
+
+		while (total < numSamples) {
+			const uint32 offset = (pos + total) & _mask;
+			const int len = MIN<int>(numSamples - total, size() - offset);
+			const int samples = input.readBuffer(_buffer + offset, len);
+			if (samples <= 0)
+				break;
+			total += samples;
+			if (samples < len)
+				break;
+		}
+
+		Common::memoryBarrier();
+		_writePos = pos + total;
+		return total;
+	}
+
+	/** Read up to numSamples samples. Must only be called by the consumer. */
+	int read(int16 *buffer, int numSamples) {
+		const uint32 pos = _readPos;
+		const int samples = MIN<int>(numSamples, _writePos - pos);
+		Common::memoryBarrier();
+
+		const uint32 offset = pos & _mask;
+		const int len = MIN<int>(samples, size() - offset);
+		memcpy(buffer, _buffer + offset, len * sizeof(int16));
+		memcpy(buffer + len, _buffer, (samples - len) * sizeof(int16));
+
+		Common::memoryBarrier();
+		_readPos = pos + samples;
+		return samples;
+	}
+};
+
+
+#pragma mark -
+#pragma mark --- Decode thread ---
+#pragma mark -
+
+/**
+ * The part of a ThreadedAudioStream shared with the decode thread.
+ */
+struct DecodeState {
+	AudioStream *input;
+	SampleRingBuffer ring;
+
+	/** Held by the decode thread while it uses this state. */
+	Common::Mutex mutex;
+
+	/** Set once the input has ended and all of it is in the ring buffer. */
+	volatile bool finished;
+
+	/** Whether the decode thread knows about this state. */
+	bool registered;
+
+	/** Set if the stream was deleted while the decode thread still knew about it. */
+	bool abandoned;
+
+	DecodeState(AudioStream *in, uint32 bufferSize) :
+		input(in), ring(bufferSize), finished(false), registered(false), abandoned(false) {
+	}
+};
+
+// These are all guarded by _decodeMutex
+static Common::Mutex *_decodeMutex = 0;
+static Common::List<DecodeState *> *_decodeStates = 0;
+static OSystem::ThreadRef _decodeThread = 0;
+static bool _decodeThreadRunning = false;
+
+/**
+ * Decode the next chunk of the input of the given state, if there is space
+ * for it. Returns true if any samples were decoded.
+ */
+static bool decodeChunk(DecodeState *state) {
+	const int len = MIN<int>(kDecodeChunkSize, state->ring.space());
+	if (len == 0)
+		return false;
+
+	const int samples = state->ring.fill(*state->input, len);
+	if (samples < len && state->input->endOfStream()) {
+		Common::memoryBarrier();
+		state->finished = true;
+	}
+	return samples > 0;
+}
+
+static int decodeThreadProc(void *param) {
+	while (true) {
+		bool busy = false;
+
+		{
+			Common::StackLock lock(*_decodeMutex);
+
+			Common::List<DecodeState *>::iterator i = _decodeStates->begin();
+			while (i != _decodeStates->end()) {
+				DecodeState *state = *i;
+
+				state->mutex.lock();
+				if (state->abandoned) {
+					state->mutex.unlock();
+					delete state;
+					i = _decodeStates->erase(i);
+					continue;
+				}
+
+				if (decodeChunk(state))
+					busy = true;
+
+				// Once the input is fully decoded, the stream no longer
+				// needs us, and cleans up after itself.
+				const bool done = state->finished;
+				if (done)
+					state->registered = false;
+				state->mutex.unlock();
+
+				if (done)
+					i = _decodeStates->erase(i);
+				else
+					++i;
+			}
+
+			if (_decodeStates->empty()) {
+				_decodeThreadRunning = false;
+				return 0;
+			}
+		}
+
+		if (!busy)
+			g_system->delayMillis(kDecodeIdleDelay);
+	}
+}
+
+/**
+ * Hand the given state over to the decode thread, starting the thread if
+ * necessary. Returns false if no thread could be started.
+ */
+static bool registerDecodeState(DecodeState *state) {
+	Common::StackLock lock(*_decodeMutex);
+
+	if (!_decodeThreadRunning) {
+		// Reap the previous decode thread, which has terminated (or is
+		// about to) since it found nothing left to do.
+		if (_decodeThread)
+			g_system->joinThread(_decodeThread);
+		_decodeThread = g_system->createThread(decodeThreadProc, 0);
+		if (!_decodeThread)
+			return false;
+		_decodeThreadRunning = true;
+	}
+
+	state->registered = true;
+	_decodeStates->push_back(state);
+	return true;
+}
+
+
+#pragma mark -
+#pragma mark --- Threaded audio stream ---
+#pragma mark -
+
+class ThreadedAudioStream : public AudioStream {
+	DecodeState *_state;
+	const bool _stereo;
+	const int _rate;
+
+	/** Set if no decode thread could be started; we then decode in readBuffer. */
+	bool _synchronous;
+
+public:
+	ThreadedAudioStream(AudioStream *input, uint32 bufferSize);
+	~ThreadedAudioStream();
+
+	int readBuffer(int16 *buffer, const int numSamples);
+	bool isStereo() const		{ return _stereo; }
+	bool endOfData() const		{ return _state->finished && _state->ring.available() == 0; }
+	int getRate() const			{ return _rate; }
+};
+
+ThreadedAudioStream::ThreadedAudioStream(AudioStream *input, uint32 bufferSize) :
+	_state(new DecodeState(input, bufferSize)),
+	_stereo(input->isStereo()),
+	_rate(input->getRate()),
+	_synchronous(false) {
+
+	// Decode the start right away, so that the mixer does not have to wait
+	// for the decode thread when playback begins. Short sounds are decoded
+	// completely here, and don't need the decode thread at all.
+	while (!_state->finished && _state->ring.available() < _state->ring.size() / 4) {
+		if (!decodeChunk(_state))
+			break;
+	}
+
+	if (!_state->finished && !registerDecodeState(_state))
+		_synchronous = true;
+}
+
+ThreadedAudioStream::~ThreadedAudioStream() {
+	_state->mutex.lock();
+	delete _state->input;
+	_state->input = 0;
+
+	if (_state->registered) {
+		// The decode thread frees the state the next time it looks at it
+		_state->abandoned = true;
+		_state->mutex.unlock();
+	} else {
+		_state->mutex.unlock();
+		delete _state;
+	}
+}
+
+int ThreadedAudioStream::readBuffer(int16 *buffer, const int numSamples) {
+	if (_synchronous) {
+		while (!_state->finished && _state->ring.available() < (uint32)numSamples) {
+			if (!decodeChunk(_state))
+				break;
+		}
+	}
+	return _state->ring.read(buffer, numSamples);
+}
+
+
+AudioStream *makeThreadedAudioStream(AudioStream *input) {
+	if (!input || _decodeLookahead == 0)
+		return input;
+
+	if (!_decodeMutex) {
+		_decodeMutex = new Common::Mutex();
+		_decodeStates = new Common::List<DecodeState *>();
+	}
+
+	const uint32 bufferSize = _decodeLookahead * input->getRate() / 1000 * (input->isStereo() ? 2 : 1);
+	return new ThreadedAudioStream(input, bufferSize);
+}
+
+#else
+
+AudioStream *makeThreadedAudioStream(AudioStream *input) {
+	// Without memory barriers the ring buffer can't be shared safely
+	return input;
+}
+
+#endif // HAVE_MEMORY_BARRIER
+
+} // End of namespace Audio
@@ -0,0 +1,63 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+#ifndef SOUND_DECODETHREAD_H
+#define SOUND_DECODETHREAD_H
+
+#include "common/stdafx.h"
+#include "common/scummsys.h"
+
+namespace Audio {
+
+class AudioStream;
+
+/**
+ * Wrap a (compressed) audio stream so that it is decoded ahead of time on a
+ * background thread, instead of on the mixer thread when the data is
+ * needed. The decoded samples are passed to the mixer through a lock-free
+ * ring buffer holding the configured lookahead; looping and start/end
+ * offsets are handled by the wrapped stream as before.
+ *
+ * If lookahead is disabled, or the platform lacks the memory barriers the
+ * ring buffer needs, the input stream is returned unchanged. Streams short
+ * enough to be decoded completely while they are wrapped never involve the
+ * thread, and if the backend can't create threads, the wrapper decodes on
+ * demand instead.
+ *
+ * @param input	the stream to wrap; it is owned by the returned stream
+ * @return	the wrapping stream, or input itself
+ */
+AudioStream *makeThreadedAudioStream(AudioStream *input);
+
+/**
+ * Set how many milliseconds of audio makeThreadedAudioStream decodes ahead.
+ * Streams which already exist are not affected. 0 disables background
+ * decoding.
+ */
+void setDecodeLookahead(uint msecs);
+
+} // End of namespace Audio
+
+#endif
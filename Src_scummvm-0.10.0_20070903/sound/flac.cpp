@@ -31,6 +31,8 @@
 #include "common/util.h"
 
 #include "sound/audiostream.h"
+#include "sound/decodethread.h"
+#include "sound/soundcache.h"
 #include "sound/audiocd.h"
 
 #define FLAC__NO_DLL // that MS-magic gave me headaches - just link the library you like
@@ -734,20 +736,7 @@ void FlacInputStream::callWrapError(const ::FLAC__SeekableStreamDecoder *decoder
 #pragma mark -
 
 
-AudioStream *makeFlacStream(File *file, uint32 size) {
-	assert(file);
-
-	// FIXME: For now, just read the whole data into memory, and be done
-	// with it. Of course this is in general *not* a nice thing to do...
-
-	// If no size was specified, read the whole remainder of the file
-	if (!size)
-		size = file->size() - file->pos();
-
-	// Read 'size' bytes of data into a MemoryReadStream
-	Common::MemoryReadStream *stream = file->readStream(size);
-
-	// .. and create an MP3InputStream from all this
+static AudioStream *makeFlacDecoder(Common::SeekableReadStream *stream) {
 	FlacInputStream *input = new FlacInputStream(stream, true);
 	if (!input->isStreamDecoderReady()) {
 		delete input;
@@ -756,6 +745,10 @@ AudioStream *makeFlacStream(File *file, uint32 size) {
 	return input;
 }
 
+AudioStream *makeFlacStream(File *file, uint32 size) {
+	return SoundCache.makeStream(file, size, makeFlacDecoder);
+}
+
 AudioStream *makeFlacStream(
 	Common::SeekableReadStream *stream,
 	bool disposeAfterUse,
@@ -770,7 +763,7 @@ AudioStream *makeFlacStream(
 		delete input;
 		return 0;
 	}
-	return input;
+	return makeThreadedAudioStream(input);
 }
 
 } // End of namespace Audio
@@ -40,12 +40,19 @@ enum {
 	FMOPL_EG_ENT_LQ = 128
 };
 
+/* rendering cores, both produce the same samples */
+enum {
+	FMOPL_CORE_SAMPLE = 0,	/* all channels one sample at a time */
+	FMOPL_CORE_BLOCK = 1	/* one channel a block of samples at a time, faster */
+};
+
 
 typedef void (*OPL_TIMERHANDLER)(int channel,double interval_Sec);
 typedef void (*OPL_IRQHANDLER)(int param,int irq);
 typedef void (*OPL_UPDATEHANDLER)(int param,int min_interval_us);
 
 #define OPL_TYPE_WAVESEL   0x01  /* waveform select    */
+#define OPL_TYPE_OPL3      0x02  /* second register array, 4-op, stereo */
 
 /* Saving is necessary for member of the 'R' mark for suspend/resume */
 /* ---------- OPL one of slot  ---------- */
@@ -95,8 +102,14 @@ typedef struct fm_opl_channel {
 	uint fc;			/* Freq. Increment base				*/
 	uint ksl_base;		/* KeyScaleLevel Base step			*/
 	uint8 keyon;		/* key on/off flag					*/
+
+	/* OPL3 */
+	uint8 pan;			/* Reg.C0 : output left(1)/right(2)	*/
+	uint8 op4;			/* 4-op : 0=off 1=first 2=second ch	*/
 } OPL_CH;
 
+struct fm_opl_rates;
+
 /* OPL state */
 typedef struct fm_opl_f {
 	uint8 type;			/* chip type                         */
@@ -104,7 +117,7 @@ typedef struct fm_opl_f {
 	int rate;			/* sampling rate (Hz)                */
 	double freqbase;	/* frequency base                    */
 	double TimerBase;	/* Timer base time (==sampling time) */
-	uint8 address;		/* address register                  */
+	uint16 address;		/* address register (OPL3: 9 bits)   */
 	uint8 status;		/* status flag                       */
 	uint8 statusmask;	/* status mask                       */
 	uint mode;			/* Reg.08 : CSM , notesel,etc.       */
@@ -120,10 +133,8 @@ typedef struct fm_opl_f {
 	/* Rythm sention */
 	uint8 rythm;		/* Rythm mode , key flag */
 
-	/* time tables */
-	int AR_TABLE[76];	/* atttack rate tables				*/
-	int DR_TABLE[76];	/* decay rate tables				*/
-	uint FN_TABLE[1024];/* fnumber -> increment counter		*/
+	/* time tables, shared by the chips with the same clock and rate */
+	struct fm_opl_rates *rates;
 
 	/* LFO */
 	int *ams_table;
@@ -136,6 +147,16 @@ typedef struct fm_opl_f {
 	/* wave selector enable flag */
 	uint8 wavesel;
 
+	/* OPL3 */
+	uint8 opl3;			/* Reg.105 : OPL3 mode (NEW)         */
+	uint8 connsel;		/* Reg.104 : 4-op connection select  */
+
+	/* rendering core (FMOPL_CORE_*) */
+	uint8 core;
+
+	/* white noise generator state */
+	uint32 noiseSeed;
+
 	/* external event callback handler */
 	OPL_TIMERHANDLER  TimerHandler;		/* TIMER handler   */
 	int TimerParam;						/* TIMER parameter */
@@ -148,11 +169,15 @@ typedef struct fm_opl_f {
 /* ---------- Generic interface section ---------- */
 #define OPL_TYPE_YM3526 (0)
 #define OPL_TYPE_YM3812 (OPL_TYPE_WAVESEL)
+#define OPL_TYPE_YMF262 (OPL_TYPE_WAVESEL | OPL_TYPE_OPL3)
 
 void OPLBuildTables(int ENV_BITS_PARAM, int EG_ENT_PARAM);
 
 FM_OPL *OPLCreate(int type, int clock, int rate);
 void OPLDestroy(FM_OPL *OPL);
+void OPLSetCore(FM_OPL *OPL, int core);
+void OPLSetNoiseSeed(FM_OPL *OPL, uint32 seed);
+void OPLGetMemoryUsage(FM_OPL *OPL, int *chipBytes, int *sharedBytes);
 void OPLSetTimerHandler(FM_OPL *OPL, OPL_TIMERHANDLER TimerHandler, int channelOffset);
 void OPLSetIRQHandler(FM_OPL *OPL, OPL_IRQHANDLER IRQHandler, int param);
 void OPLSetUpdateHandler(FM_OPL *OPL, OPL_UPDATEHANDLER UpdateHandler, int param);
@@ -163,8 +188,10 @@ unsigned char OPLRead(FM_OPL *OPL, int a);
 int OPLTimerOver(FM_OPL *OPL, int c);
 void OPLWriteReg(FM_OPL *OPL, int r, int v);
 void YM3812UpdateOne(FM_OPL *OPL, int16 *buffer, int length);
+void YMF262UpdateOne(FM_OPL *OPL, int16 *buffer, int length);
 
 #endif
 
-// Factory method
+// Factory methods
 FM_OPL *makeAdlibOPL(int rate);
+FM_OPL *makeAdlibOPL3(int rate);
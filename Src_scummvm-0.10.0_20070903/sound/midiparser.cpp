@@ -36,6 +36,12 @@
 
 MidiParser::MidiParser() :
 _hanging_notes_count(0),
+_index_track(0),
+_index(0),
+_index_count(0),
+_index_snapshots(0),
+_index_live(0),
+_index_fixed(0),
 _driver(0),
 _timer_rate(0x4A0000),
 _ppqn(96),
@@ -44,6 +50,7 @@ _psec_per_tick(5208), // 500000 / 96
 _autoLoop(false),
 _smartJump(false),
 _centerPitchWheelOnUnload(false),
+_indexEvents(false),
 _num_tracks(0),
 _active_track(255),
 _abort_parse(0) {
@@ -61,6 +68,10 @@ void MidiParser::property(int prop, int value) {
 	case mpCenterPitchWheelOnUnload:
 		_centerPitchWheelOnUnload = (value != 0);
 		break;
+	case mpIndexEvents:
+		_indexEvents = (value != 0);
+		freeIndex();
+		break;
 	}
 }
 
@@ -346,45 +357,58 @@ bool MidiParser::jumpToTick(uint32 tick, bool fireEvents) {
 	Tracker currentPos(_position);
 	EventInfo currentEvent(_next_event);
 
-	resetTracking();
-	_position._play_pos = _tracks[_active_track];
-	parseNextEvent(_next_event);
-	if (tick > 0) {
-		while (true) {
-			EventInfo &info = _next_event;
-			if (_position._last_event_tick + info.delta >= tick) {
-				_position._play_time += (tick - _position._last_event_tick) * _psec_per_tick;
-				_position._play_tick = tick;
-				break;
-			}
+	if (tick > 0 && _indexEvents && _ppqn) {
+		if (_index_track != _tracks[_active_track])
+			buildIndex();
+	}
 
-			_position._last_event_tick += info.delta;
-			_position._last_event_time += info.delta * _psec_per_tick;
-			_position._play_tick = _position._last_event_tick;
-			_position._play_time = _position._last_event_time;
+	if (tick > 0 && _index_count && _index_track == _tracks[_active_track]) {
+		if (!jumpIndexed(tick, fireEvents)) {
+			_position = currentPos;
+			_next_event = currentEvent;
+			return false;
+		}
+	} else {
+		resetTracking();
+		_position._play_pos = _tracks[_active_track];
+		parseNextEvent(_next_event);
+		if (tick > 0) {
+			while (true) {
+				EventInfo &info = _next_event;
+				if (_position._last_event_tick + info.delta >= tick) {
+					_position._play_time += (tick - _position._last_event_tick) * _psec_per_tick;
+					_position._play_tick = tick;
+					break;
+				}
 
-			if (info.event == 0xFF) {
-				if (info.ext.type == 0x2F) { // End of track
-					_position = currentPos;
-					_next_event = currentEvent;
-					return false;
-				} else {
-					if (info.ext.type == 0x51 && info.length >= 3) // Tempo
-						setTempo(info.ext.data[0] << 16 | info.ext.data[1] << 8 | info.ext.data[2]);
-					if (fireEvents)
-						_driver->metaEvent(info.ext.type, info.ext.data, (uint16) info.length);
+				_position._last_event_tick += info.delta;
+				_position._last_event_time += info.delta * _psec_per_tick;
+				_position._play_tick = _position._last_event_tick;
+				_position._play_time = _position._last_event_time;
+
+				if (info.event == 0xFF) {
+					if (info.ext.type == 0x2F) { // End of track
+						_position = currentPos;
+						_next_event = currentEvent;
+						return false;
+					} else {
+						if (info.ext.type == 0x51 && info.length >= 3) // Tempo
+							setTempo(info.ext.data[0] << 16 | info.ext.data[1] << 8 | info.ext.data[2]);
+						if (fireEvents)
+							_driver->metaEvent(info.ext.type, info.ext.data, (uint16) info.length);
+					}
+				} else if (fireEvents) {
+					if (info.event == 0xF0) {
+						if (info.ext.data[info.length-1] == 0xF7)
+							_driver->sysEx(info.ext.data, (uint16)info.length-1);
+						else
+							_driver->sysEx(info.ext.data, (uint16)info.length);
+					} else
+						_driver->send(info.event, info.basic.param1, info.basic.param2);
 				}
-			} else if (fireEvents) {
-				if (info.event == 0xF0) {
-					if (info.ext.data[info.length-1] == 0xF7)
-						_driver->sysEx(info.ext.data, (uint16)info.length-1);
-					else
-						_driver->sysEx(info.ext.data, (uint16)info.length);
-				} else
-					_driver->send(info.event, info.basic.param1, info.basic.param2);
-			}
 
-			parseNextEvent(_next_event);
+				parseNextEvent(_next_event);
+			}
 		}
 	}
 
@@ -406,7 +430,306 @@ bool MidiParser::jumpToTick(uint32 tick, bool fireEvents) {
 	return true;
 }
 
+//////////////////////////////////////////////////
+//
+// Event index
+//
+//////////////////////////////////////////////////
+
+enum {
+	kRegistersPerChannel = 259, // 128 notes, 128 controllers, program, pressure and pitch bend
+	kNoEvent = 0xFFFFFFFF,
+	kNoTempo = 0xFFFFFFFF
+};
+
+// Returns the piece of channel state an event sets, or -1 for events which
+// have to be fired whenever they are passed during a jump. Controllers only
+// count as channel state if their effect doesn't depend on the events sent
+// before them: bank select takes effect with the next program change, data
+// entry depends on the selected (N)RPN, mode messages act on the notes, and
+// controllers 110 to 127 are used by XMIDI for loops and callbacks.
+static int eventRegister(byte event, byte param1) {
+	const int base = (event & 0x0F) * kRegistersPerChannel;
+
+	switch (event >> 4) {
+	case 0x8: case 0x9:
+		return base + (param1 & 0x7F);
+	case 0xB:
+		if (param1 == 0 || param1 == 6 || param1 == 32 || param1 == 38 ||
+		    (param1 >= 96 && param1 <= 101) || param1 >= 110)
+			return -1;
+		return base + 128 + param1;
+	case 0xC:
+		return base + 256;
+	case 0xD:
+		return base + 257;
+	case 0xE:
+		return base + 258;
+	}
+	return -1;
+}
+
+static bool isTempoEvent(const IndexedEvent &event) {
+	return event.event == 0xFF && event.param1 == 0x51 && event.length >= 3;
+}
+
+void MidiParser::freeIndex() {
+	free(_index);
+	free(_index_live);
+	delete[] _index_snapshots;
+	delete[] _index_fixed;
+	_index_track = 0;
+	_index = 0;
+	_index_count = 0;
+	_index_snapshots = 0;
+	_index_live = 0;
+	_index_fixed = 0;
+}
+
+void MidiParser::buildIndex() {
+	freeIndex();
+	_index_track = _tracks[_active_track];
+
+	// Parse the whole track the way playback does, and
+	// record the state after every event.
+	Tracker currentPos(_position);
+	EventInfo currentEvent(_next_event);
+	EventInfo info;
+	uint32 capacity = 0;
+	uint32 tick = 0;
+	bool complete = false;
+
+	memset(&info, 0, sizeof(info));
+	resetTracking();
+	_position._play_pos = _index_track;
+	while (!complete) {
+		parseNextEvent(info);
+		if (info.event < 0x80)
+			break;
+
+		if (_index_count == capacity) {
+			capacity = capacity ? capacity * 2 : 1024;
+			_index = (IndexedEvent *)realloc(_index, capacity * sizeof(IndexedEvent));
+		}
+
+		IndexedEvent &event = _index[_index_count++];
+		tick += info.delta;
+		event.tick = tick;
+		event.start = (uint32)(info.start - _index_track);
+		event.next = (uint32)(_position._play_pos - _index_track);
+		event.length = info.length;
+		event.event = info.event;
+		event.param1 = info.basic.param1;
+		event.param2 = info.basic.param2;
+		event.running_status = _position._running_status;
+		complete = (info.event == 0xFF && info.ext.type == 0x2F);
+	}
+
+	resetTracking();
+	_position = currentPos;
+	_next_event = currentEvent;
+
+	if (!complete) {
+		// Bad command or running status. Leave the jumps to
+		// the parser, which stops where playback would stop.
+		byte *track = _index_track;
+		freeIndex();
+		_index_track = track;
+		return;
+	}
+
+	// Link every event that sets a piece of channel state to the next
+	// event that sets it again. For notes, that is the next Note On or
+	// Note Off of the same note on the same channel.
+	uint32 *latest = new uint32[16 * kRegistersPerChannel];
+	uint32 fixed_count = 0;
+	uint32 i, j;
+
+	for (i = 0; i < 16 * kRegistersPerChannel; ++i)
+		latest[i] = kNoEvent;
+	for (i = _index_count; i--; ) {
+		IndexedEvent &event = _index[i];
+		const int reg = eventRegister(event.event, event.param1);
+		if (reg < 0) {
+			event.override = kNoEvent;
+			++fixed_count;
+		} else {
+			event.override = latest[reg];
+			latest[reg] = i;
+		}
+	}
+	delete[] latest;
+
+	// Take a snapshot every kIndexInterval events. The channel state of a
+	// snapshot is what is left of the previous one, followed by the events
+	// in between that are not overridden yet, so it stays in event order.
+	const uint32 snapshot_count = (_index_count - 1) / kIndexInterval + 1;
+	IndexSnapshot *snapshot = 0;
+	uint32 tempo = kNoTempo;
+	uint32 psec = 0;
+	uint32 entry_ticks = 0;
+	uint32 time = 0;
+	uint32 last_tick = 0;
+	uint32 live_count = 0;
+	uint32 live_capacity = 0;
+
+	_index_snapshots = new IndexSnapshot[snapshot_count];
+	_index_fixed = new uint32[fixed_count];
+	fixed_count = 0;
+
+	for (i = 0; i < _index_count; ++i) {
+		const IndexedEvent &event = _index[i];
+
+		if (i % kIndexInterval == 0) {
+			const IndexSnapshot *previous = snapshot;
+			snapshot = &_index_snapshots[i / kIndexInterval];
+			snapshot->tempo = tempo;
+			snapshot->psec = psec;
+			snapshot->entry_ticks = entry_ticks;
+			snapshot->time = time;
+			snapshot->fixed = fixed_count;
+			snapshot->live = live_count;
+
+			if (previous) {
+				const uint32 needed = live_count + previous->live_count + kIndexInterval;
+				if (needed > live_capacity) {
+					live_capacity = MAX(needed, live_capacity * 2);
+					_index_live = (uint32 *)realloc(_index_live, live_capacity * sizeof(uint32));
+				}
+				for (j = previous->live; j < previous->live + previous->live_count; ++j) {
+					if (_index[_index_live[j]].override >= i)
+						_index_live[live_count++] = _index_live[j];
+				}
+				for (j = i - kIndexInterval; j < i; ++j) {
+					if (_index[j].override >= i && eventRegister(_index[j].event, _index[j].param1) >= 0)
+						_index_live[live_count++] = j;
+				}
+			}
+			snapshot->live_count = live_count - snapshot->live;
+		}
+
+		if (tempo == kNoTempo)
+			entry_ticks += event.tick - last_tick;
+		else
+			time += (event.tick - last_tick) * psec;
+		last_tick = event.tick;
+
+		if (eventRegister(event.event, event.param1) < 0)
+			_index_fixed[fixed_count++] = i;
+		if (isTempoEvent(event)) {
+			const byte *data = _index_track + event.next - event.length;
+			tempo = data[0] << 16 | data[1] << 8 | data[2];
+			psec = (tempo + (_ppqn >> 2)) / _ppqn;
+		}
+	}
+}
+
+void MidiParser::fireIndexedEvent(const IndexedEvent &event) {
+	byte *data = _index_track + event.next - event.length;
+
+	if (event.event == 0xFF) {
+		if (isTempoEvent(event))
+			setTempo(data[0] << 16 | data[1] << 8 | data[2]);
+		_driver->metaEvent(event.param1, data, (uint16)event.length);
+	} else if (event.event == 0xF0) {
+		if (data[event.length-1] == 0xF7)
+			_driver->sysEx(data, (uint16)event.length-1);
+		else
+			_driver->sysEx(data, (uint16)event.length);
+	} else {
+		_driver->send(event.event, event.param1, event.param2);
+	}
+}
+
+bool MidiParser::jumpIndexed(uint32 tick, bool fireEvents) {
+	// The first event at or after the target becomes the next event. If
+	// there is none, the jump fails after passing everything up to the
+	// End of Track, like the parsing jump does.
+	uint32 low = 0, high = _index_count;
+	while (low < high) {
+		const uint32 mid = (low + high) / 2;
+		if (_index[mid].tick < tick)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	const bool found = (low < _index_count);
+	const uint32 target = found ? low : _index_count - 1;
+	const uint32 first = target - target % kIndexInterval;
+	const IndexSnapshot &snapshot = _index_snapshots[target / kIndexInterval];
+	const uint32 entry_psec = _psec_per_tick;
+	uint32 i;
+
+	if (fireEvents) {
+		// Merge the channel state of the snapshot with the events that
+		// are always fired, then fire the events after the snapshot.
+		// Anything that is overridden before the target is skipped.
+		const uint32 *live = _index_live + snapshot.live;
+		const uint32 *live_end = live + snapshot.live_count;
+		const uint32 *fixed = _index_fixed;
+		const uint32 *fixed_end = fixed + snapshot.fixed;
+
+		while (live != live_end || fixed != fixed_end) {
+			if (fixed == fixed_end || (live != live_end && *live < *fixed)) {
+				if (_index[*live].override >= target)
+					fireIndexedEvent(_index[*live]);
+				++live;
+			} else {
+				fireIndexedEvent(_index[*fixed++]);
+			}
+		}
+		for (i = first; i < target; ++i) {
+			if (_index[i].override >= target)
+				fireIndexedEvent(_index[i]);
+		}
+	}
+
+	uint32 tempo = snapshot.tempo;
+	uint32 psec = (tempo == kNoTempo) ? entry_psec : snapshot.psec;
+	uint32 time = snapshot.entry_ticks * entry_psec + snapshot.time;
+	uint32 last_tick = first ? _index[first - 1].tick : 0;
+
+	for (i = first; i < target; ++i) {
+		const IndexedEvent &event = _index[i];
+		time += (event.tick - last_tick) * psec;
+		last_tick = event.tick;
+		if (isTempoEvent(event)) {
+			const byte *data = _index_track + event.next - event.length;
+			tempo = data[0] << 16 | data[1] << 8 | data[2];
+			psec = (tempo + (_ppqn >> 2)) / _ppqn;
+		}
+	}
+	if (tempo != kNoTempo)
+		setTempo(tempo);
+
+	resetTracking();
+	if (!found)
+		return false;
+
+	const IndexedEvent &event = _index[target];
+	_position._play_pos = _index_track + event.next;
+	_position._running_status = event.running_status;
+	_position._last_event_tick = last_tick;
+	_position._last_event_time = time;
+	_position._play_tick = tick;
+	_position._play_time = time + (tick - last_tick) * _psec_per_tick;
+
+	_next_event.start = _index_track + event.start;
+	_next_event.delta = event.tick - last_tick;
+	_next_event.event = event.event;
+	_next_event.length = event.length;
+	if (event.event == 0xF0 || event.event == 0xFF) {
+		_next_event.ext.type = event.param1;
+		_next_event.ext.data = _index_track + event.next - event.length;
+	} else {
+		_next_event.basic.param1 = event.param1;
+		_next_event.basic.param2 = event.param2;
+	}
+	return true;
+}
+
 void MidiParser::unloadMusic() {
+	freeIndex();
 	resetTracking();
 	allNotesOff();
 	_num_tracks = 0;
@@ -127,6 +127,45 @@ struct NoteTimer {
 	NoteTimer() : channel(0), note(0), time_left(0) {}
 };
 
+//! A pre-parsed event in the index of a track.
+/*! When the mpIndexEvents property is set, MidiParser decodes the
+ *  active track once into an array of IndexedEvent entries, so that
+ *  MidiParser::jumpToTick() can find its target with a binary search
+ *  instead of parsing the track from the start. Each entry holds what
+ *  is needed to restore the Tracker and EventInfo state that
+ *  parseNextEvent() produced for the event.
+ */
+
+struct IndexedEvent {
+	uint32 tick;     //!< The absolute tick at which the event occurs
+	uint32 start;    //!< Offset of EventInfo::start from the start of the track
+	uint32 next;     //!< Offset of the event following this one (Tracker::_play_pos after parsing)
+	uint32 length;   //!< EventInfo::length. The data of SysEx and META events ends at \a next.
+	uint32 override; //!< Index of the next event that sets the same channel state
+	                 //!< (e.g. the same controller on the same channel). 0xFFFFFFFF if
+	                 //!< there is none, or if the event has to be fired whenever it is passed.
+	byte   event;    //!< EventInfo::event
+	byte   param1;   //!< EventInfo::basic.param1, or EventInfo::ext.type for META events
+	byte   param2;   //!< EventInfo::basic.param2
+	byte   running_status; //!< Tracker::_running_status after parsing
+};
+
+//! Tempo and channel state at a regular interval in the index of a track.
+/*! Seeking with MidiParser::jumpToTick() replays the index from the
+ *  nearest snapshot before the target instead of from the start.
+ */
+
+struct IndexSnapshot {
+	uint32 tempo;       //!< The tempo in effect, or 0xFFFFFFFF if there was no tempo event yet
+	uint32 psec;        //!< Microseconds per tick for \a tempo
+	uint32 entry_ticks; //!< Ticks up to the first tempo event, which are timed with
+	                    //!< the tempo that was in effect when the jump was made
+	uint32 time;        //!< Microseconds for the ticks after the first tempo event
+	uint32 fixed;       //!< Number of events before the snapshot that are always fired
+	uint32 live;        //!< First entry of the snapshot in MidiParser::_index_live
+	uint32 live_count;  //!< Number of events whose channel state is still in effect
+};
+
 
 
 
@@ -273,6 +312,22 @@ private:
 	                                //!< Used for "Smart Jump" and MIDI formats that do not include explicit Note Off events.
 	byte      _hanging_notes_count; //!< Count of hanging notes, used to optimize expiration.
 
+	enum {
+		kIndexInterval = 256    //!< Number of events between two snapshots of the event index.
+	};
+
+	byte *         _index_track;     //!< The track the event index was built for, if any.
+	IndexedEvent * _index;           //!< Pre-parsed events of the indexed track, up to End of Track.
+	uint32         _index_count;     //!< Number of indexed events. 0 if the track could not be indexed.
+	IndexSnapshot *_index_snapshots; //!< One snapshot for every kIndexInterval events.
+	uint32 *       _index_live;      //!< The events holding the channel state of each snapshot, in order.
+	uint32 *       _index_fixed;     //!< The events that are always fired (SysEx, META etc.), in order.
+
+	void buildIndex();
+	void freeIndex();
+	bool jumpIndexed(uint32 tick, bool fireEvents);
+	void fireIndexedEvent(const IndexedEvent &event);
+
 protected:
 	MidiDriver *_driver;    //!< The device to which all events will be transmitted.
 	uint32 _timer_rate;     //!< The time in microseconds between onTimer() calls. Obtained from the MidiDriver.
@@ -282,6 +337,7 @@ protected:
 	bool   _autoLoop;       //!< For lightweight clients that don't provide their own flow control.
 	bool   _smartJump;      //!< Support smart expiration of hanging notes when jumping
 	bool   _centerPitchWheelOnUnload;  //!< Center the pitch wheels when unloading a song
+	bool   _indexEvents;    //!< Pre-parse the active track so that jumps don't have to parse it
 
 	// FIXME: ? Was 32 here, Kyra tracks use 120(!!!) which seems wrong. this is a hacky
 	// workaround until situation is investigated.
@@ -343,17 +399,29 @@ public:
 	 *  \b mpSmartJump - Sets smart jumping, which intelligently
 	 *  expires notes that are active when a jump is made, rather
 	 *  than just cutting them off.
+	 *
+	 *  \b mpIndexEvents - Decodes the active track into an event index
+	 *  the first time jumpToTick() is called for it, so that jumps find
+	 *  their target with a binary search and replay at most a few
+	 *  hundred pre-parsed events. Jumps that fire events send the
+	 *  channel state at the target (program, controllers, pitch bend,
+	 *  pressure and the last Note On or Note Off of every note) instead
+	 *  of every event on the way, but still send all SysEx and META
+	 *  events, in order. Only use this with parsers whose
+	 *  parseNextEvent() depends on nothing but the Tracker state,
+	 *  such as SMF and XMIDI.
 	 */
 	enum {
 		mpMalformedPitchBends = 1,
 		mpAutoLoop = 2,
 		mpSmartJump = 3,
-		mpCenterPitchWheelOnUnload = 4
+		mpCenterPitchWheelOnUnload = 4,
+		mpIndexEvents = 5
 	};
 
 public:
 	MidiParser();
-	virtual ~MidiParser() { allNotesOff(); }
+	virtual ~MidiParser() { allNotesOff(); freeIndex(); }
 
 	virtual bool loadMusic(byte *data, uint32 size) = 0;
 	virtual void unloadMusic();
@@ -74,7 +74,8 @@ public:
 		return _permanent;
 	}
 	bool isFinished() const {
-		return _input->endOfStream();
+		// The rate converter may still hold back the end of the sound
+		return _input->endOfStream() && !_converter->needsDrain();
 	}
 	void pause(bool paused) {
 		_paused = paused;
@@ -114,11 +115,15 @@ Mixer::Mixer() {
 		_channels[i] = 0;
 
 	_mixerReady = false;
+
+	initRateConverters();
 }
 
 Mixer::~Mixer() {
 	for (int i = 0; i != NUM_CHANNELS; i++)
 		delete _channels[i];
+
+	freeRateConverters();
 }
 
 uint Mixer::getOutputRate() const {
@@ -396,35 +401,37 @@ Channel::~Channel() {
  */
 void Channel::mix(int16 *data, uint len) {
 	assert(_input);
+	assert(_converter);
+
+	// From the channel balance/volume and the global volume, we compute
+	// the effective volume for the left and right channel. Note the
+	// slightly odd divisor: the 255 reflects the fact that the maximal
+	// value for _volume is 255, while the 127 is there because the
+	// balance value ranges from -127 to 127.  The mixer (music/sound)
+	// volume is in the range 0 - kMaxMixerVolume.
+	// Hence, the vol_l/vol_r values will be in that range, too
+
+	int vol = _mixer->getVolumeForSoundType(_type) * _volume;
+	st_volume_t vol_l, vol_r;
+
+	if (_balance == 0) {
+		vol_l = vol / Mixer::kMaxChannelVolume;
+		vol_r = vol / Mixer::kMaxChannelVolume;
+	} else if (_balance < 0) {
+		vol_l = vol / Mixer::kMaxChannelVolume;
+		vol_r = ((127 + _balance) * vol) / (Mixer::kMaxChannelVolume * 127);
+	} else {
+		vol_l = ((127 - _balance) * vol) / (Mixer::kMaxChannelVolume * 127);
+		vol_r = vol / Mixer::kMaxChannelVolume;
+	}
 
 	if (_input->endOfData()) {
-		// TODO: call drain method
-		printf("COP:Channel:Mix - endOfData() : endOfStream??? %s\n", _input->endOfStream() ? "TRUE" : "FALSE");
+		// Mix whatever the rate converter still holds back at the end
+		// of the stream; for a stream which is merely out of data for
+		// now there is nothing to do.
+		if (_input->endOfStream() && _converter->needsDrain())
+			_converter->drain(data, len, vol_l, vol_r);
 	} else {
-		assert(_converter);
-
-		// From the channel balance/volume and the global volume, we compute
-		// the effective volume for the left and right channel. Note the
-		// slightly odd divisor: the 255 reflects the fact that the maximal
-		// value for _volume is 255, while the 127 is there because the
-		// balance value ranges from -127 to 127.  The mixer (music/sound)
-		// volume is in the range 0 - kMaxMixerVolume.
-		// Hence, the vol_l/vol_r values will be in that range, too
-
-		int vol = _mixer->getVolumeForSoundType(_type) * _volume;
-		st_volume_t vol_l, vol_r;
-
-		if (_balance == 0) {
-			vol_l = vol / Mixer::kMaxChannelVolume;
-			vol_r = vol / Mixer::kMaxChannelVolume;
-		} else if (_balance < 0) {
-			vol_l = vol / Mixer::kMaxChannelVolume;
-			vol_r = ((127 + _balance) * vol) / (Mixer::kMaxChannelVolume * 127);
-		} else {
-			vol_l = ((127 - _balance) * vol) / (Mixer::kMaxChannelVolume * 127);
-			vol_r = vol / Mixer::kMaxChannelVolume;
-		}
-
 		_samplesConsumed = _samplesDecoded;
 		_mixerTimeStamp = g_system->getMillis();
 
@@ -5,6 +5,7 @@ MODULE_OBJS := \
 	aiff.o \
 	audiocd.o \
 	audiostream.o \
+	decodethread.o \
 	iff.o \
 	flac.o \
 	fmopl.o \
@@ -17,6 +18,7 @@ MODULE_OBJS := \
 	mpu401.o \
 	null.o \
 	rate.o \
+	soundcache.o \
 	voc.o \
 	vorbis.o \
 	wave.o \
@@ -32,6 +32,8 @@
 
 #include "sound/audiocd.h"
 #include "sound/audiostream.h"
+#include "sound/decodethread.h"
+#include "sound/soundcache.h"
 
 #include <mad.h>
 
@@ -302,23 +304,14 @@ int MP3InputStream::readBuffer(int16 *buffer, const int numSamples) {
 #pragma mark -
 
 
-AudioStream *makeMP3Stream(Common::File *file, uint32 size) {
-	assert(file);
-
-	// FIXME: For now, just read the whole data into memory, and be done
-	// with it. Of course this is in general *not* a nice thing to do...
-
-	// If no size was specified, read the whole remainder of the file
-	if (!size)
-		size = file->size() - file->pos();
-
-	// Read 'size' bytes of data into a MemoryReadStream
-	Common::MemoryReadStream *stream = file->readStream(size);
-
-	// .. and create an MP3InputStream from all this
+static AudioStream *makeMP3Decoder(Common::SeekableReadStream *stream) {
 	return new MP3InputStream(stream, true);
 }
 
+AudioStream *makeMP3Stream(Common::File *file, uint32 size) {
+	return SoundCache.makeStream(file, size, makeMP3Decoder);
+}
+
 AudioStream *makeMP3Stream(
 	Common::SeekableReadStream *stream,
 	bool disposeAfterUse,
@@ -339,7 +332,7 @@ AudioStream *makeMP3Stream(
 		mad_timer_set(&end, endTime / 1000, endTime % 1000, 1000);
 	}
 
-	return new MP3InputStream(stream, disposeAfterUse, start, end, numLoops);
+	return makeThreadedAudioStream(new MP3InputStream(stream, disposeAfterUse, start, end, numLoops));
 }
 
 } // End of namespace Audio
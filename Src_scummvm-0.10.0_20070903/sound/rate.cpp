@@ -35,8 +35,27 @@
 #include "sound/audiostream.h"
 #include "sound/rate.h"
 #include "sound/mixer.h"
+#include "common/system.h"
 #include "common/util.h"
 
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USE_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define USE_NEON
+#include <arm_neon.h>
+#endif
+
+// The vectorized mixing code relies on the saturating arithmetic of the
+// SIMD units matching clampedAdd, which is not the case for unsigned output.
+#if defined(USE_SSE2) && !defined(OUTPUT_UNSIGNED_AUDIO)
+#define USE_SSE2_MIXING
+#elif defined(USE_NEON) && !defined(OUTPUT_UNSIGNED_AUDIO)
+#define USE_NEON_MIXING
+#endif
+
 namespace Audio {
 
 /**
@@ -54,6 +73,141 @@ namespace Audio {
 #define INTERMEDIATE_BUFFER_SIZE 512
 
 
+#pragma mark -
+
+
+void mixStereoFramesScalar(st_sample_t *obuf, const st_sample_t *ibuf, st_size_t numFrames, st_volume_t vol_l, st_volume_t vol_r, bool reverseStereo) {
+	const int left = reverseStereo ? 1 : 0;
+	const int right = reverseStereo ? 0 : 1;
+
+	while (numFrames-- > 0) {
+		clampedAdd(*obuf++, (ibuf[left] * (int)vol_l) / Audio::Mixer::kMaxMixerVolume);
+		clampedAdd(*obuf++, (ibuf[right] * (int)vol_r) / Audio::Mixer::kMaxMixerVolume);
+		ibuf += 2;
+	}
+}
+
+void mixMonoSamplesScalar(st_sample_t *obuf, const st_sample_t *ibuf, st_size_t numSamples, st_volume_t vol_l, st_volume_t vol_r) {
+	while (numSamples-- > 0) {
+		const st_sample_t tmp = *ibuf++;
+		clampedAdd(*obuf++, (tmp * (int)vol_l) / Audio::Mixer::kMaxMixerVolume);
+		clampedAdd(*obuf++, (tmp * (int)vol_r) / Audio::Mixer::kMaxMixerVolume);
+	}
+}
+
+/*
+ * The vectorized versions below process four stereo frames at a time. The
+ * products of sample and volume are computed with 32 bits, then divided by
+ * kMaxMixerVolume (256) rounding towards zero, exactly like the integer
+ * division in the scalar code, and finally added to the output with signed
+ * saturation. The remaining frames are handed to the scalar code.
+ */
+
+#if defined(USE_SSE2_MIXING)
+
+static inline __m128i scaleFrames(__m128i in, __m128i vol) {
+	const __m128i lo = _mm_mullo_epi16(in, vol);
+	const __m128i hi = _mm_mulhi_epi16(in, vol);
+	__m128i p0 = _mm_unpacklo_epi16(lo, hi);
+	__m128i p1 = _mm_unpackhi_epi16(lo, hi);
+
+	// Add 255 to negative products so that the shift rounds towards zero
+	p0 = _mm_add_epi32(p0, _mm_srli_epi32(_mm_srai_epi32(p0, 31), 24));
+	p1 = _mm_add_epi32(p1, _mm_srli_epi32(_mm_srai_epi32(p1, 31), 24));
+	return _mm_packs_epi32(_mm_srai_epi32(p0, 8), _mm_srai_epi32(p1, 8));
+}
+
+static inline void addFrames(st_sample_t *obuf, __m128i frames) {
+	const __m128i out = _mm_loadu_si128((const __m128i *)obuf);
+	_mm_storeu_si128((__m128i *)obuf, _mm_adds_epi16(out, frames));
+}
+
+void mixStereoFrames(st_sample_t *obuf, const st_sample_t *ibuf, st_size_t numFrames, st_volume_t vol_l, st_volume_t vol_r, bool reverseStereo) {
+	const __m128i vol = _mm_set1_epi32((int)(((uint32)vol_r << 16) | vol_l));
+
+	for (; numFrames >= 4; numFrames -= 4) {
+		__m128i in = _mm_loadu_si128((const __m128i *)ibuf);
+		if (reverseStereo)
+			in = _mm_shufflehi_epi16(_mm_shufflelo_epi16(in, 0xB1), 0xB1);
+		addFrames(obuf, scaleFrames(in, vol));
+		ibuf += 8;
+		obuf += 8;
+	}
+	mixStereoFramesScalar(obuf, ibuf, numFrames, vol_l, vol_r, reverseStereo);
+}
+
+void mixMonoSamples(st_sample_t *obuf, const st_sample_t *ibuf, st_size_t numSamples, st_volume_t vol_l, st_volume_t vol_r) {
+	const __m128i vol = _mm_set1_epi32((int)(((uint32)vol_r << 16) | vol_l));
+
+	for (; numSamples >= 8; numSamples -= 8) {
+		const __m128i in = _mm_loadu_si128((const __m128i *)ibuf);
+		addFrames(obuf, scaleFrames(_mm_unpacklo_epi16(in, in), vol));
+		addFrames(obuf + 8, scaleFrames(_mm_unpackhi_epi16(in, in), vol));
+		ibuf += 8;
+		obuf += 16;
+	}
+	mixMonoSamplesScalar(obuf, ibuf, numSamples, vol_l, vol_r);
+}
+
+#elif defined(USE_NEON_MIXING)
+
+static inline int16x4_t scaleFrames(int16x4_t in, int16x4_t vol) {
+	int32x4_t p = vmull_s16(in, vol);
+
+	// Add 255 to negative products so that the shift rounds towards zero
+	p = vaddq_s32(p, vreinterpretq_s32_u32(vshrq_n_u32(vreinterpretq_u32_s32(vshrq_n_s32(p, 31)), 24)));
+	return vqmovn_s32(vshrq_n_s32(p, 8));
+}
+
+static inline void addFrames(st_sample_t *obuf, int16x8_t in, int16x4_t vol) {
+	const int16x8_t frames = vcombine_s16(scaleFrames(vget_low_s16(in), vol), scaleFrames(vget_high_s16(in), vol));
+	vst1q_s16(obuf, vqaddq_s16(vld1q_s16(obuf), frames));
+}
+
+void mixStereoFrames(st_sample_t *obuf, const st_sample_t *ibuf, st_size_t numFrames, st_volume_t vol_l, st_volume_t vol_r, bool reverseStereo) {
+	const int16x4_t vol = vreinterpret_s16_u32(vdup_n_u32(((uint32)vol_r << 16) | vol_l));
+
+	for (; numFrames >= 4; numFrames -= 4) {
+		int16x8_t in = vld1q_s16(ibuf);
+		if (reverseStereo)
+			in = vrev32q_s16(in);
+		addFrames(obuf, in, vol);
+		ibuf += 8;
+		obuf += 8;
+	}
+	mixStereoFramesScalar(obuf, ibuf, numFrames, vol_l, vol_r, reverseStereo);
+}
+
+void mixMonoSamples(st_sample_t *obuf, const st_sample_t *ibuf, st_size_t numSamples, st_volume_t vol_l, st_volume_t vol_r) {
+	const int16x4_t vol = vreinterpret_s16_u32(vdup_n_u32(((uint32)vol_r << 16) | vol_l));
+
+	for (; numSamples >= 8; numSamples -= 8) {
+		const int16x8_t in = vld1q_s16(ibuf);
+		const int16x8x2_t frames = vzipq_s16(in, in);
+		addFrames(obuf, frames.val[0], vol);
+		addFrames(obuf + 8, frames.val[1], vol);
+		ibuf += 8;
+		obuf += 16;
+	}
+	mixMonoSamplesScalar(obuf, ibuf, numSamples, vol_l, vol_r);
+}
+
+#else
+
+void mixStereoFrames(st_sample_t *obuf, const st_sample_t *ibuf, st_size_t numFrames, st_volume_t vol_l, st_volume_t vol_r, bool reverseStereo) {
+	mixStereoFramesScalar(obuf, ibuf, numFrames, vol_l, vol_r, reverseStereo);
+}
+
+void mixMonoSamples(st_sample_t *obuf, const st_sample_t *ibuf, st_size_t numSamples, st_volume_t vol_l, st_volume_t vol_r) {
+	mixMonoSamplesScalar(obuf, ibuf, numSamples, vol_l, vol_r);
+}
+
+#endif
+
+
+#pragma mark -
+
+
 /**
  * Audio rate converter based on simple linear Interpolation.
  *
@@ -86,12 +240,24 @@ protected:
 	/** current sample(s) in the input stream (left/right channel) */
 	st_sample_t icur[2];
 
+	/** interpolated stereo frames, waiting to be mixed into the output */
+	st_sample_t outBuf[INTERMEDIATE_BUFFER_SIZE * 2];
+
+	int generate(AudioStream *input, st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r);
+
 public:
 	LinearRateConverter(st_rate_t inrate, st_rate_t outrate);
-	int flow(AudioStream &input, st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r);
-	int drain(st_sample_t *obuf, st_size_t osamp, st_volume_t vol) {
+	int flow(AudioStream &input, st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r) {
+		generate(&input, obuf, osamp, vol_l, vol_r);
 		return (ST_SUCCESS);
 	}
+	int drain(st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r) {
+		return generate(0, obuf, osamp, vol_l, vol_r);
+	}
+	bool needsDrain() const {
+		// Input samples read ahead of the end of the stream
+		return inLen > 0;
+	}
 };
 
 
@@ -128,70 +294,476 @@ LinearRateConverter<stereo, reverseStereo>::LinearRateConverter(st_rate_t inrate
 }
 
 /*
- * Processed signed long samples from ibuf to obuf.
- * Return number of samples processed.
+ * Processed signed long samples from ibuf to obuf; without input, only the
+ * samples which are still buffered.
+ * Return number of frames processed.
  */
 template<bool stereo, bool reverseStereo>
-int LinearRateConverter<stereo, reverseStereo>::flow(AudioStream &input, st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r) {
-	st_sample_t *ostart, *oend;
-	st_sample_t out[2];
+int LinearRateConverter<stereo, reverseStereo>::generate(AudioStream *input, st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r) {
+	st_sample_t *ostart = obuf;
+	st_sample_t *oend = obuf + osamp * 2;
 
 	const int numChannels = stereo ? 2 : 1;
 	int i;
+	bool endOfInput = false;
+
+	while (obuf < oend && !endOfInput) {
+		// Interpolate as many frames as fit into outBuf, then scale them and
+		// mix them into the output buffer in one go.
+		st_sample_t *out = outBuf;
+		const st_sample_t *outEnd = outBuf + MIN<int>((int)(oend - obuf), ARRAYSIZE(outBuf));
+
+		while (out < outEnd) {
+
+			// read enough input samples so that ipos > opos
+			while (ipos <= opos) {
+				// Check if we have to refill the buffer
+				if (inLen == 0) {
+					inPtr = inBuf;
+					inLen = input ? input->readBuffer(inBuf, ARRAYSIZE(inBuf)) : 0;
+					if (inLen <= 0) {
+						endOfInput = true;
+						break;
+					}
+				}
+				for (i = 0; i < numChannels; i++) {
+					ilast[i] = icur[i];
+					icur[i] = *inPtr++;
+					inLen--;
+				}
+				ipos++;
+			}
+			if (endOfInput)
+				break;
 
-	ostart = obuf;
-	oend = obuf + osamp * 2;
-
-	while (obuf < oend) {
+			// Loop as long as the outpos trails behind, and as long as there is
+			// still space in the output buffer.
+			while (ipos > opos && out < outEnd) {
 
-		// read enough input samples so that ipos > opos
-		while (ipos <= opos) {
-			// Check if we have to refill the buffer
-			if (inLen == 0) {
-				inPtr = inBuf;
-				inLen = input.readBuffer(inBuf, ARRAYSIZE(inBuf));
-				if (inLen <= 0)
-					goto the_end;
+				// interpolate
+				out[0] = out[1] = (st_sample_t)(ilast[0] + (((icur[0] - ilast[0]) * opos_frac + (1UL << (FRAC_BITS-1))) >> FRAC_BITS));
+
+				if (stereo) {
+					// interpolate
+					out[reverseStereo ? 0 : 1] = (st_sample_t)(ilast[1] + (((icur[1] - ilast[1]) * opos_frac + (1UL << (FRAC_BITS-1))) >> FRAC_BITS));
+				}
+				out += 2;
+
+				// Increment output position
+				unsigned long tmp = opos_frac + opos_inc_frac;
+				opos += opos_inc + (tmp >> FRAC_BITS);
+				opos_frac = tmp & ((1UL << FRAC_BITS) - 1);
 			}
-			for (i = 0; i < numChannels; i++) {
-				ilast[i] = icur[i];
-				icur[i] = *inPtr++;
-				inLen--;
+		}
+
+		// output left and right channel
+		mixStereoFrames(obuf, outBuf, (st_size_t)(out - outBuf) / 2, vol_l, vol_r);
+		obuf += out - outBuf;
+	}
+
+	return (int)(obuf - ostart) / 2;
+}
+
+
+#pragma mark -
+
+
+/**
+ * Number of filter taps the SincRateConverter uses per output sample when
+ * upsampling. When downsampling, this is scaled by the resampling ratio to
+ * keep the transition band narrow. Must be a multiple of 8 because of the
+ * vectorized filter code.
+ */
+#define SINC_TAPS 32
+#define SINC_MAX_TAPS 128
+
+/**
+ * Number of phases of a filter bank. Ratios whose reduced output rate does
+ * not divide this use the nearest lower of SINC_PHASES evenly spaced phases.
+ */
+#define SINC_PHASES 512
+
+/** Passband of the filter, relative to the Nyquist frequency of the lower rate. */
+#define SINC_CUTOFF 0.90
+
+/**
+ * When downsampling, the resampling ratio is rounded down to a multiple of
+ * 1 / SINC_RATIO_STEPS (but at least that) before the cutoff and the number
+ * of taps are derived from it. This leaves at most SINC_RATIO_STEPS
+ * different filter banks, no matter how many different rates the streams
+ * have, at the price of a slightly lower passband.
+ */
+#define SINC_RATIO_STEPS 16
+
+/** Beta parameter of the Kaiser window; about 80 dB stopband attenuation. */
+#define SINC_KAISER_BETA 8.0
+
+/**
+ * A set of windowed sinc low pass filters, one per phase, i.e. per possible
+ * fractional offset between an output sample and the input samples.
+ */
+struct SincFilterBank {
+	int numPhases;
+	int numTaps;
+
+	/** numPhases * numTaps coefficients, in 1.15 fixed point */
+	st_sample_t *coeffs;
+};
+
+/**
+ * The filter banks computed so far, indexed by the rounded resampling ratio
+ * minus one; the last one is used for upsampling, too. The banks are created
+ * on demand, because each takes a few milliseconds to compute, and kept until
+ * freeRateConverters() is called. When the Mixer exists, the mutex guards
+ * their creation, as converters may be created on the mixer thread as well.
+ */
+static SincFilterBank *_sincFilterBanks[SINC_RATIO_STEPS];
+static Common::MutexRef _sincFilterBankMutex = 0;
+
+void initRateConverters() {
+	if (!_sincFilterBankMutex)
+		_sincFilterBankMutex = g_system->createMutex();
+}
+
+void freeRateConverters() {
+	for (int i = 0; i < SINC_RATIO_STEPS; i++) {
+		if (_sincFilterBanks[i]) {
+			delete[] _sincFilterBanks[i]->coeffs;
+			delete _sincFilterBanks[i];
+			_sincFilterBanks[i] = 0;
+		}
+	}
+
+	if (_sincFilterBankMutex) {
+		g_system->deleteMutex(_sincFilterBankMutex);
+		_sincFilterBankMutex = 0;
+	}
+}
+
+static double besselI0(double x) {
+	double sum = 1.0, term = 1.0;
+	for (int k = 1; k < 64; k++) {
+		term *= (x / (2 * k)) * (x / (2 * k));
+		sum += term;
+		if (term < sum * 1e-12)
+			break;
+	}
+	return sum;
+}
+
+static SincFilterBank *createSincFilterBank(int numPhases, int numTaps, double cutoff) {
+	SincFilterBank *bank = new SincFilterBank;
+	bank->numPhases = numPhases;
+	bank->numTaps = numTaps;
+	bank->coeffs = new st_sample_t[numPhases * numTaps];
+
+	const double halfWidth = numTaps / 2;
+	const double windowScale = 1.0 / besselI0(SINC_KAISER_BETA);
+	double *h = new double[numTaps];
+
+	for (int phase = 0; phase < numPhases; phase++) {
+		st_sample_t *coeffs = bank->coeffs + phase * numTaps;
+
+		// Tap k is applied to the input sample which lies t input samples
+		// away from the output sample.
+		double sum = 0.0;
+		for (int k = 0; k < numTaps; k++) {
+			const double t = k - halfWidth + 1 - (double)phase / numPhases;
+			const double x = t / halfWidth;
+			double value = 0.0;
+			if (x > -1.0 && x < 1.0) {
+				const double arg = PI * cutoff * t;
+				value = (t == 0.0) ? cutoff : cutoff * sin(arg) / arg;
+				value *= besselI0(SINC_KAISER_BETA * sqrt(1.0 - x * x)) * windowScale;
 			}
-			ipos++;
+			h[k] = value;
+			sum += value;
+		}
+
+		// Normalize every phase to unity gain, and put the rounding error
+		// into the largest tap, so that DC passes through unchanged.
+		int total = 0, largest = 0;
+		for (int k = 0; k < numTaps; k++) {
+			coeffs[k] = (st_sample_t)floor(h[k] / sum * 32768.0 + 0.5);
+			total += coeffs[k];
+			if (coeffs[k] > coeffs[largest])
+				largest = k;
 		}
+		coeffs[largest] = (st_sample_t)MIN(coeffs[largest] + 32768 - total, (int)ST_SAMPLE_MAX);
+	}
 
-		// Loop as long as the outpos trails behind, and as long as there is
-		// still space in the output buffer.
-		while (ipos > opos) {
+	delete[] h;
 
-			// interpolate
-			out[0] = out[1] = (st_sample_t)(ilast[0] + (((icur[0] - ilast[0]) * opos_frac + (1UL << (FRAC_BITS-1))) >> FRAC_BITS));
+	return bank;
+}
 
-			if (stereo) {
-				// interpolate
-				out[reverseStereo ? 0 : 1] = (st_sample_t)(ilast[1] + (((icur[1] - ilast[1]) * opos_frac + (1UL << (FRAC_BITS-1))) >> FRAC_BITS));
+/**
+ * Get the filter bank for resampling from inStep to outStep samples,
+ * creating it if necessary.
+ */
+static const SincFilterBank *getSincFilterBank(st_rate_t inStep, st_rate_t outStep) {
+	// When downsampling, the cutoff has to be lowered to the output Nyquist
+	// frequency, which widens the filter by the same factor.
+	int ratioStep = SINC_RATIO_STEPS;
+	if (inStep > outStep)
+		ratioStep = MAX<int>((int)((double)outStep * SINC_RATIO_STEPS / inStep), 1);
+
+	if (_sincFilterBankMutex)
+		g_system->lockMutex(_sincFilterBankMutex);
+
+	SincFilterBank *&bank = _sincFilterBanks[ratioStep - 1];
+	if (!bank) {
+		const double ratio = (double)ratioStep / SINC_RATIO_STEPS;
+		const int numTaps = MIN<int>((int)ceil(SINC_TAPS / ratio / 8) * 8, SINC_MAX_TAPS);
+		bank = createSincFilterBank(SINC_PHASES, numTaps, SINC_CUTOFF * ratio);
+	}
+
+	if (_sincFilterBankMutex)
+		g_system->unlockMutex(_sincFilterBankMutex);
+
+	return bank;
+}
+
+/**
+ * Apply one filter phase to the input samples starting at x, and return
+ * the clipped result.
+ */
+static inline st_sample_t sincFilter(const st_sample_t *x, const st_sample_t *coeffs, int numTaps) {
+	int sum;
+
+#if defined(USE_SSE2)
+	__m128i acc = _mm_setzero_si128();
+	for (int i = 0; i < numTaps; i += 8)
+		acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_loadu_si128((const __m128i *)(x + i)), _mm_loadu_si128((const __m128i *)(coeffs + i))));
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0x4E));
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0xB1));
+	sum = _mm_cvtsi128_si32(acc);
+#elif defined(USE_NEON)
+	int32x4_t acc = vdupq_n_s32(0);
+	for (int i = 0; i < numTaps; i += 8) {
+		const int16x8_t in = vld1q_s16(x + i);
+		const int16x8_t h = vld1q_s16(coeffs + i);
+		acc = vmlal_s16(acc, vget_low_s16(in), vget_low_s16(h));
+		acc = vmlal_s16(acc, vget_high_s16(in), vget_high_s16(h));
+	}
+	const int32x2_t acc2 = vadd_s32(vget_low_s32(acc), vget_high_s32(acc));
+	sum = vget_lane_s32(vpadd_s32(acc2, acc2), 0);
+#else
+	sum = 0;
+	for (int i = 0; i < numTaps; i++)
+		sum += x[i] * coeffs[i];
+#endif
+
+	sum = (sum + (1 << 14)) >> 15;
+	if (sum > ST_SAMPLE_MAX)
+		sum = ST_SAMPLE_MAX;
+	else if (sum < ST_SAMPLE_MIN)
+		sum = ST_SAMPLE_MIN;
+	return (st_sample_t)sum;
+}
+
+/**
+ * Audio rate converter based on band limited (windowed sinc) interpolation,
+ * implemented as a polyphase filter. Much better quality than the
+ * LinearRateConverter, especially when upsampling low rate sounds, at the
+ * cost of SINC_TAPS multiplications per output sample and channel.
+ *
+ * The input position is tracked exactly as a fraction with the reduced
+ * output rate as denominator, so there is no drift. Floating point is only
+ * used to compute the filter banks.
+ *
+ * Limited to sampling frequency <= 65535 Hz.
+ */
+template<bool stereo, bool reverseStereo>
+class SincRateConverter : public RateConverter {
+protected:
+	st_sample_t inBuf[INTERMEDIATE_BUFFER_SIZE];
+
+	/** de-interleaved input samples (left/right channel) */
+	st_sample_t hist[2][INTERMEDIATE_BUFFER_SIZE + SINC_MAX_TAPS];
+	/** number of valid samples in hist */
+	int histLen;
+	/** first input sample of the current filter window */
+	int histPos;
+	/**
+	 * Once the input has ended: end of the input samples in hist, which
+	 * are followed by silence for the rest of the filter. -1 before.
+	 */
+	int tailEnd;
+
+	/** interpolated stereo frames, waiting to be mixed into the output */
+	st_sample_t outBuf[INTERMEDIATE_BUFFER_SIZE * 2];
+
+	const SincFilterBank *bank;
+
+	/** the input/output rate ratio, reduced to lowest terms */
+	st_rate_t inStep, outStep;
+
+	/** fractional position of the output stream between two input samples, in 1/outStep units */
+	st_rate_t frac;
+
+	void discardHistory();
+	bool refill(AudioStream &input);
+	void padTail();
+	int generate(AudioStream *input, st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r);
+
+public:
+	SincRateConverter(st_rate_t inrate, st_rate_t outrate);
+	int flow(AudioStream &input, st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r) {
+		generate(&input, obuf, osamp, vol_l, vol_r);
+		return (ST_SUCCESS);
+	}
+	int drain(st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r) {
+		return generate(0, obuf, osamp, vol_l, vol_r);
+	}
+	bool needsDrain() const {
+		// Output is centered on the input sample numTaps / 2 - 1 into
+		// the filter window; anything up to the last input sample is due.
+		return histPos + bank->numTaps / 2 - 1 < (tailEnd < 0 ? histLen : tailEnd);
+	}
+};
+
+template<bool stereo, bool reverseStereo>
+SincRateConverter<stereo, reverseStereo>::SincRateConverter(st_rate_t inrate, st_rate_t outrate) {
+	if (inrate == outrate) {
+		error("Input and Output rates must be different to use rate effect");
+	}
+
+	if (inrate >= 65536 || outrate >= 65536) {
+		error("rate effect can only handle rates < 65536");
+	}
+
+	st_rate_t a = inrate, b = outrate;
+	while (b) {
+		st_rate_t tmp = a % b;
+		a = b;
+		b = tmp;
+	}
+	inStep = inrate / a;
+	outStep = outrate / a;
+
+	bank = getSincFilterBank(inStep, outStep);
+	const int numTaps = bank->numTaps;
+
+	// Start with enough silence that the first output sample is centered
+	// on the first input sample.
+	memset(hist, 0, sizeof(hist));
+	histLen = numTaps / 2 - 1;
+	histPos = 0;
+	tailEnd = -1;
+	frac = 0;
+}
+
+template<bool stereo, bool reverseStereo>
+void SincRateConverter<stereo, reverseStereo>::discardHistory() {
+	// Discard the samples before the current filter window. When
+	// downsampling, the window may already have moved past all buffered
+	// samples; the rest is then skipped by the next refill.
+	if (histPos >= histLen) {
+		histPos -= histLen;
+		histLen = 0;
+	} else {
+		for (int i = 0; i < (stereo ? 2 : 1); i++)
+			memmove(hist[i], hist[i] + histPos, (histLen - histPos) * sizeof(st_sample_t));
+		histLen -= histPos;
+		histPos = 0;
+	}
+}
+
+template<bool stereo, bool reverseStereo>
+bool SincRateConverter<stereo, reverseStereo>::refill(AudioStream &input) {
+	const int numChannels = stereo ? 2 : 1;
+	int i;
+
+	discardHistory();
+
+	const int frames = MIN<int>(INTERMEDIATE_BUFFER_SIZE / numChannels, ARRAYSIZE(hist[0]) - histLen);
+	const int len = input.readBuffer(inBuf, frames * numChannels);
+	if (len <= 0)
+		return false;
+
+	const st_sample_t *inPtr = inBuf;
+	for (i = 0; i < len / numChannels; i++) {
+		hist[0][histLen] = *inPtr++;
+		if (stereo)
+			hist[1][histLen] = *inPtr++;
+		histLen++;
+	}
+	return true;
+}
+
+template<bool stereo, bool reverseStereo>
+void SincRateConverter<stereo, reverseStereo>::padTail() {
+	// Follow the last input samples with enough silence that every
+	// output sample centered on one of them gets a full filter window.
+	discardHistory();
+	tailEnd = histLen;
+	for (int i = 0; i < (stereo ? 2 : 1); i++)
+		memset(hist[i] + histLen, 0, bank->numTaps / 2 * sizeof(st_sample_t));
+	histLen += bank->numTaps / 2;
+}
+
+/**
+ * Interpolate up to osamp frames and mix them into obuf. Reads more samples
+ * from input as needed; once the input stream has ended (or when draining,
+ * i.e. without input), the buffered samples are padded with silence and
+ * their remaining output is generated.
+ * Returns the number of frames mixed.
+ */
+template<bool stereo, bool reverseStereo>
+int SincRateConverter<stereo, reverseStereo>::generate(AudioStream *input, st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r) {
+	st_sample_t *ostart = obuf;
+	st_sample_t *oend = obuf + osamp * 2;
+
+	const int numTaps = bank->numTaps;
+	const bool exactPhases = (bank->numPhases == (int)outStep);
+	bool endOfInput = false;
+
+	while (obuf < oend && !endOfInput) {
+		st_sample_t *out = outBuf;
+		const st_sample_t *outEnd = outBuf + MIN<int>((int)(oend - obuf), ARRAYSIZE(outBuf));
+
+		while (out < outEnd) {
+			if (tailEnd >= 0) {
+				// The input has ended; stop after the last input sample
+				if (histPos + numTaps / 2 - 1 >= tailEnd) {
+					endOfInput = true;
+					break;
+				}
+			} else if (histPos + numTaps > histLen) {
+				// Make sure the whole filter window is available
+				if (!input || !refill(*input)) {
+					if (input && !input->endOfStream()) {
+						endOfInput = true;
+						break;
+					}
+					padTail();
+				}
+				continue;
 			}
 
-			// output left channel
-			clampedAdd(*obuf++, (out[0] * (int)vol_l) / Audio::Mixer::kMaxMixerVolume);
+			const int phase = exactPhases ? frac : (int)((frac * bank->numPhases) / outStep);
+			const st_sample_t *coeffs = bank->coeffs + phase * numTaps;
 
-			// output right channel
-			clampedAdd(*obuf++, (out[1] * (int)vol_r) / Audio::Mixer::kMaxMixerVolume);
+			out[0] = out[1] = sincFilter(hist[0] + histPos, coeffs, numTaps);
+			if (stereo)
+				out[reverseStereo ? 0 : 1] = sincFilter(hist[1] + histPos, coeffs, numTaps);
+			out += 2;
 
 			// Increment output position
-			unsigned long tmp = opos_frac + opos_inc_frac;
-			opos += opos_inc + (tmp >> FRAC_BITS);
-			opos_frac = tmp & ((1UL << FRAC_BITS) - 1);
-
-			// Abort if we reached the end of the output buffer
-			if (obuf >= oend)
-				goto the_end;
+			frac += inStep;
+			if (frac >= outStep) {
+				histPos += frac / outStep;
+				frac %= outStep;
+			}
 		}
+
+		// output left and right channel
+		mixStereoFrames(obuf, outBuf, (st_size_t)(out - outBuf) / 2, vol_l, vol_r);
+		obuf += out - outBuf;
 	}
 
-the_end:
-	return (ST_SUCCESS);
+	return (int)(obuf - ostart) / 2;
 }
 
 
@@ -214,7 +786,6 @@ public:
 	virtual int flow(AudioStream &input, st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r) {
 		assert(input.isStereo() == stereo);
 
-		st_sample_t *ptr;
 		st_size_t len;
 
 		if (stereo)
@@ -231,28 +802,14 @@ public:
 		len = input.readBuffer(_buffer, osamp);
 
 		// Mix the data into the output buffer
-		ptr = _buffer;
-		while (len-- > 0) {
-			st_sample_t tmp0, tmp1;
-			tmp0 = tmp1 = *ptr++;
-			if (stereo) {
-				if (reverseStereo)
-					tmp0 = *ptr++;
-				else
-					tmp1 = *ptr++;
-				len--;
-			}
-
-			// output left channel
-			clampedAdd(*obuf++, (tmp0 * (int)vol_l) / Audio::Mixer::kMaxMixerVolume);
-
-			// output right channel
-			clampedAdd(*obuf++, (tmp1 * (int)vol_r) / Audio::Mixer::kMaxMixerVolume);
-		}
+		if (stereo)
+			mixStereoFrames(obuf, _buffer, len / 2, vol_l, vol_r, reverseStereo);
+		else
+			mixMonoSamples(obuf, _buffer, len, vol_l, vol_r);
 		return (ST_SUCCESS);
 	}
-	virtual int drain(st_sample_t *obuf, st_size_t osamp, st_volume_t vol) {
-		return (ST_SUCCESS);
+	virtual int drain(st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r) {
+		return 0;
 	}
 };
 
@@ -260,11 +817,37 @@ public:
 #pragma mark -
 
 
+static RateConverterType _rateConverterType = kLinearRateConverter;
+
+void setRateConverterType(RateConverterType type) {
+	_rateConverterType = type;
+}
+
+RateConverterType getRateConverterType() {
+	return _rateConverterType;
+}
+
+RateConverterType parseRateConverterType(const char *name) {
+	if (!scumm_stricmp(name, "sinc"))
+		return kSincRateConverter;
+	if (*name && scumm_stricmp(name, "linear"))
+		warning("Unknown resampler '%s', using linear interpolation", name);
+	return kLinearRateConverter;
+}
+
 /**
  * Create and return a RateConverter object for the specified input and output rates.
  */
 RateConverter *makeRateConverter(st_rate_t inrate, st_rate_t outrate, bool stereo, bool reverseStereo) {
-	if (inrate != outrate) {
+	if (inrate != outrate && _rateConverterType == kSincRateConverter) {
+		if (stereo) {
+			if (reverseStereo)
+				return new SincRateConverter<true, true>(inrate, outrate);
+			else
+				return new SincRateConverter<true, false>(inrate, outrate);
+		} else
+			return new SincRateConverter<false, false>(inrate, outrate);
+	} else if (inrate != outrate) {
 		if (stereo) {
 			if (reverseStereo)
 				return new LinearRateConverter<true, true>(inrate, outrate);
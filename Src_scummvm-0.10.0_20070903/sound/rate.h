@@ -62,7 +62,7 @@ static inline void clampedAdd(int16& a, int b) {
 #ifdef OUTPUT_UNSIGNED_AUDIO
 	a = ((int16)val) ^ 0x8000;
 #else
-	a = val;
+	a = (int16)val;
 #endif
 }
 
@@ -77,11 +77,79 @@ public:
 	RateConverter() {}
 	virtual ~RateConverter() {}
 	virtual int flow(AudioStream &input, st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r) = 0;
-	virtual int drain(st_sample_t *obuf, st_size_t osamp, st_volume_t vol) = 0;
+
+	/**
+	 * Mix the output which the converter still holds back after the end of
+	 * the input stream into obuf, like flow() does.
+	 * @return the number of frames mixed
+	 */
+	virtual int drain(st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r) = 0;
+
+	/** Whether drain() still has output to mix. */
+	virtual bool needsDrain() const { return false; }
+};
+
+/**
+ * The kinds of rate converters makeRateConverter can create for streams
+ * whose rate differs from the output rate.
+ */
+enum RateConverterType {
+	kLinearRateConverter,	// linear interpolation; cheap, but aliases audibly
+	kSincRateConverter		// windowed sinc polyphase filter; high quality
 };
 
+/**
+ * Select the kind of rate converter created by all following calls of
+ * makeRateConverter. Converters which already exist are not affected.
+ */
+void setRateConverterType(RateConverterType type);
+RateConverterType getRateConverterType();
+
+/**
+ * Map the value of the "resampler" config key ("linear" or "sinc") to the
+ * corresponding RateConverterType. Unknown values select linear
+ * interpolation.
+ */
+RateConverterType parseRateConverterType(const char *name);
+
 RateConverter *makeRateConverter(st_rate_t inrate, st_rate_t outrate, bool stereo, bool reverseStereo = false);
 
+/**
+ * Set up the lock which allows creating rate converters on several threads
+ * at once, and free it again together with the filter banks shared by the
+ * converters. The Mixer calls these when it is created and destroyed;
+ * freeRateConverters() may only be called when no converter exists.
+ */
+void initRateConverters();
+void freeRateConverters();
+
+/**
+ * Scale interleaved stereo frames by the given left/right volumes (in the
+ * range 0 - Mixer::kMaxMixerVolume) and add them to obuf, clamping the
+ * results like clampedAdd does. Uses SSE2 or NEON where available.
+ *
+ * @param obuf			interleaved stereo output buffer
+ * @param ibuf			interleaved stereo input frames
+ * @param numFrames		number of frames (sample pairs) to mix
+ * @param reverseStereo	if true, the left input channel goes to the right output channel and vice versa
+ */
+void mixStereoFrames(st_sample_t *obuf, const st_sample_t *ibuf, st_size_t numFrames, st_volume_t vol_l, st_volume_t vol_r, bool reverseStereo = false);
+
+/**
+ * Like mixStereoFrames, but for mono input, which is sent to both output
+ * channels.
+ *
+ * @param numSamples	number of input samples, i.e. output frames
+ */
+void mixMonoSamples(st_sample_t *obuf, const st_sample_t *ibuf, st_size_t numSamples, st_volume_t vol_l, st_volume_t vol_r);
+
+/**
+ * Plain C versions of mixStereoFrames and mixMonoSamples. The vectorized
+ * versions must produce exactly the same output as these.
+ */
+void mixStereoFramesScalar(st_sample_t *obuf, const st_sample_t *ibuf, st_size_t numFrames, st_volume_t vol_l, st_volume_t vol_r, bool reverseStereo = false);
+void mixMonoSamplesScalar(st_sample_t *obuf, const st_sample_t *ibuf, st_size_t numSamples, st_volume_t vol_l, st_volume_t vol_r);
+
 } // End of namespace Audio
 
 #endif
@@ -35,7 +35,9 @@
 #include "common/config-manager.h"
 #include "common/events.h"
 #include "common/file.h"
+#include "common/mutex.h"
 #include "common/system.h"
+#include "common/thread.h"
 #include "common/util.h"
 
 #include "graphics/fontman.h"
@@ -55,11 +57,22 @@ private:
 
 	int _outputRate;
 
+	// Samples requested by generateSamples(), but not rendered yet. They
+	// point into the buffer readBuffer() fills, which renders them before
+	// it returns. MIDI messages may arrive from other threads in between
+	// and render them first; _mutex protects them and the synth.
+	int16 *_pendingData;
+	int _pendingLen;
+	Common::Mutex _mutex;
+
+	void renderPending();
+
 protected:
 	void generateSamples(int16 *buf, int len);
 
 public:
 	bool _initialising;
+	Common::WorkerPool _renderPool;
 
 	MidiDriver_MT32(Audio::Mixer *mixer);
 	virtual ~MidiDriver_MT32();
@@ -75,6 +88,7 @@ public:
 	MidiChannel *getPercussionChannel();
 
 	// AudioStream API
+	int readBuffer(int16 *data, const int numSamples);
 	bool isStereo() const { return true; }
 	int getRate() const { return _outputRate; }
 };
@@ -185,6 +199,10 @@ static void MT32_PrintDebug(void *userData, const char *fmt, va_list list) {
 	//vdebug(0, fmt, list); // FIXME: Use a higher debug level
 }
 
+static void MT32_RunParallel(void *userData, MT32Emu::ParallelJobProc job, void *jobParam, unsigned int numJobs) {
+	((MidiDriver_MT32 *)userData)->_renderPool.run(job, jobParam, numJobs);
+}
+
 static int MT32_Report(void *userData, MT32Emu::ReportType type, const void *reportData) {
 	switch(type) {
 	case MT32Emu::ReportType_lcdMessage:
@@ -242,6 +260,8 @@ MidiDriver_MT32::MidiDriver_MT32(Audio::Mixer *mixer) : MidiDriver_Emulated(mixe
 	// rely on Mixer to convert.
 	_outputRate = 32000; //_mixer->getOutputRate();
 	_initialising = false;
+	_pendingData = NULL;
+	_pendingLen = 0;
 }
 
 MidiDriver_MT32::~MidiDriver_MT32() {
@@ -268,6 +288,13 @@ int MidiDriver_MT32::open() {
 	prop.printDebug = MT32_PrintDebug;
 	prop.report = MT32_Report;
 	prop.openFile = MT32_OpenFile;
+
+	// Render the parts of the synth in parallel, unless only one thread is
+	// to be used. The threads are created here, so that the mixer thread
+	// never has to wait for that.
+	if (_renderPool.start((uint)MAX(ConfMan.getInt("mt32_threads"), 0)) > 1)
+		prop.runParallel = MT32_RunParallel;
+
 	_synth = new MT32Emu::Synth();
 	_initialising = true;
 	const byte dummy_palette[] = {
@@ -290,6 +317,8 @@ int MidiDriver_MT32::open() {
 }
 
 void MidiDriver_MT32::send(uint32 b) {
+	Common::StackLock lock(_mutex);
+	renderPending();
 	_synth->playMsg(b);
 }
 
@@ -311,6 +340,8 @@ void MidiDriver_MT32::setPitchBendRange(byte channel, uint range) {
 }
 
 void MidiDriver_MT32::sysEx(const byte *msg, uint16 length) {
+	Common::StackLock lock(_mutex);
+	renderPending();
 	if (msg[0] == 0xf0) {
 		_synth->playSysex(msg, length);
 	} else {
@@ -331,10 +362,41 @@ void MidiDriver_MT32::close() {
 	_synth->close();
 	delete _synth;
 	_synth = NULL;
+
+	_renderPool.stop();
 }
 
 void MidiDriver_MT32::generateSamples(int16 *data, int len) {
-	_synth->render(data, len);
+	// Because of the high timer frequency, this is called for a few samples at
+	// a time. Rendering is deferred until a MIDI event arrives or the mixer's
+	// buffer has been filled instead, so that the synth works on longer
+	// stretches, which are cheaper per sample and can be spread over several
+	// threads.
+	if (len <= 0)
+		return;
+	Common::StackLock lock(_mutex);
+	if (_pendingLen > 0 && data != _pendingData + _pendingLen * 2)
+		renderPending();
+	if (_pendingLen == 0)
+		_pendingData = data;
+	_pendingLen += len;
+}
+
+void MidiDriver_MT32::renderPending() {
+	if (_pendingLen == 0)
+		return;
+	_synth->render(_pendingData, _pendingLen);
+	_pendingData = NULL;
+	_pendingLen = 0;
+}
+
+int MidiDriver_MT32::readBuffer(int16 *data, const int numSamples) {
+	// The mutex is not held while the timer callbacks run, as they send
+	// MIDI messages, too
+	int result = MidiDriver_Emulated::readBuffer(data, numSamples);
+	Common::StackLock lock(_mutex);
+	renderPending();
+	return result;
 }
 
 uint32 MidiDriver_MT32::property(int prop, uint32 param) {
@@ -60,6 +60,7 @@
 
 #include "structures.h"
 #include "i386.h"
+#include "simd.h"
 #include "mt32_file.h"
 #include "tables.h"
 #include "partial.h"
@@ -454,7 +454,12 @@ Bit16s *Partial::mixBuffers(Bit16s * buf1, Bit16s *buf2, int len) {
 		return buf1;
 
 	Bit16s *outBuf = buf1;
-#if MT32EMU_USE_MMX >= 1
+#if defined(MT32EMU_HAVE_SIMD)
+	int donelen = simd_mixBuffers(buf1, buf2, len);
+	len -= donelen;
+	buf1 += donelen;
+	buf2 += donelen;
+#elif MT32EMU_USE_MMX >= 1
 	// KG: This seems to be fine
 	int donelen = i386_mixBuffers(buf1, buf2, len);
 	len -= donelen;
@@ -484,7 +489,12 @@ Bit16s *Partial::mixBuffersRingMix(Bit16s * buf1, Bit16s *buf2, int len) {
 	}
 
 	Bit16s *outBuf = buf1;
-#if MT32EMU_USE_MMX >= 1
+#if defined(MT32EMU_HAVE_SIMD)
+	int donelen = simd_mixBuffersRingMix(buf1, buf2, len);
+	len -= donelen;
+	buf1 += donelen;
+	buf2 += donelen;
+#elif MT32EMU_USE_MMX >= 1
 	// KG: This seems to be fine
 	int donelen = i386_mixBuffersRingMix(buf1, buf2, len);
 	len -= donelen;
@@ -517,7 +527,12 @@ Bit16s *Partial::mixBuffersRing(Bit16s * buf1, Bit16s *buf2, int len) {
 	}
 
 	Bit16s *outBuf = buf1;
-#if MT32EMU_USE_MMX >= 1
+#if defined(MT32EMU_HAVE_SIMD)
+	int donelen = simd_mixBuffersRing(buf1, buf2, len);
+	len -= donelen;
+	buf1 += donelen;
+	buf2 += donelen;
+#elif MT32EMU_USE_MMX >= 1
 	// FIXME:KG: Not really checked as working
 	int donelen = i386_mixBuffersRing(buf1, buf2, len);
 	len -= donelen;
@@ -577,6 +592,13 @@ bool Partial::produceOutput(Bit16s *partialBuf, long length) {
 	} else if (useNoisePair) {
 		// Generate noise for pairless ring mix
 		pairBuf = synth->tables.noiseBuf;
+		if (structurePosition != 0) {
+			// The noise ends up as the first buffer, which is mixed into in place.
+			// The shared noise table must stay intact, also because the parts may
+			// be rendered on several threads at once.
+			memcpy(noiseBuffer, pairBuf, length * sizeof(Bit16s));
+			pairBuf = noiseBuffer;
+		}
 	}
 
 	Bit16s *myBuf = generateSamples(length);
@@ -631,7 +653,12 @@ bool Partial::produceOutput(Bit16s *partialBuf, long length) {
 	leftvol = patchCache->pansetptr->leftvol;
 	rightvol = patchCache->pansetptr->rightvol;
 
-#if MT32EMU_USE_MMX >= 2
+#if defined(MT32EMU_HAVE_SIMD)
+	int donelen = simd_partialProductOutput((int)length, leftvol, rightvol, partialBuf, mixedBuf);
+	length -= donelen;
+	mixedBuf += donelen;
+	partialBuf += donelen * 2;
+#elif MT32EMU_USE_MMX >= 2
 	// FIXME:KG: This appears to introduce crackle
 	int donelen = i386_partialProductOutput(length, leftvol, rightvol, partialBuf, mixedBuf);
 	length -= donelen;
@@ -59,6 +59,8 @@ private:
 	bool useNoisePair;
 
 	Bit16s myBuffer[MAX_SAMPLE_OUTPUT];
+	// Private copy of the noise for a pairless ring mix, which modifies its first input
+	Bit16s noiseBuffer[MAX_SAMPLE_OUTPUT];
 
 	// Keyfollowed note value
 #if MT32EMU_ACCURATENOTES == 1
@@ -0,0 +1,534 @@
+/* Copyright (c) 2003-2005 Various contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "mt32emu.h"
+
+#if defined(MT32EMU_HAVE_SSE2)
+#include <emmintrin.h>
+#ifdef MT32EMU_HAVE_AVX2
+#include <immintrin.h>
+#endif
+#if defined(__GNUC__)
+#include <cpuid.h>
+#elif defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#elif defined(MT32EMU_HAVE_NEON)
+#include <arm_neon.h>
+#endif
+
+#if defined(MT32EMU_HAVE_AVX2) && defined(__GNUC__)
+#define MT32EMU_AVX2 __attribute__((target("avx2")))
+#else
+#define MT32EMU_AVX2
+#endif
+
+namespace MT32Emu {
+
+static SIMDType simdType = SIMDType_none;
+static bool simdTypeSet = false;
+
+#ifdef MT32EMU_HAVE_SSE2
+
+static bool cpuHasSSE2() {
+#if defined(__GNUC__)
+	unsigned int eax, ebx, ecx, edx;
+	return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (edx & (1 << 26));
+#elif defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	return (info[3] & (1 << 26)) != 0;
+#else
+	return true;
+#endif
+}
+
+static bool cpuHasAVX2() {
+#if defined(MT32EMU_HAVE_AVX2) && defined(__GNUC__)
+	unsigned int eax, ebx, ecx, edx;
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+		return false;
+	// The CPU must support AVX and the OS must save the AVX registers (checked with XGETBV)
+	if (!(ecx & (1 << 27)) || !(ecx & (1 << 28)))
+		return false;
+	unsigned int xcr0, xcr0High;
+	__asm__ __volatile__(".byte 0x0f, 0x01, 0xd0" : "=a"(xcr0), "=d"(xcr0High) : "c"(0));
+	if ((xcr0 & 6) != 6 || __get_cpuid_max(0, NULL) < 7)
+		return false;
+	__cpuid_count(7, 0, eax, ebx, ecx, edx);
+	return (ebx & (1 << 5)) != 0;
+#elif defined(MT32EMU_HAVE_AVX2) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	if (!(info[2] & (1 << 27)) || !(info[2] & (1 << 28)))
+		return false;
+	if ((_xgetbv(0) & 6) != 6)
+		return false;
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return false;
+#endif
+}
+
+// Sign-extends the low and high four samples of x to 32 bits and converts them to float
+static inline __m128 sse2_lowToFloat(__m128i x) {
+	return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16));
+}
+
+static inline __m128 sse2_highToFloat(__m128i x) {
+	return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16));
+}
+
+// Bits 0-15 of (a * b) >> 15, for each pair of signed 16-bit samples
+static inline __m128i sse2_mulShift15(__m128i a, __m128i b) {
+	__m128i high = _mm_mulhi_epi16(a, b);
+	__m128i low = _mm_mullo_epi16(a, b);
+	return _mm_or_si128(_mm_slli_epi16(high, 1), _mm_srli_epi16(low, 15));
+}
+
+// The ring modulation of Partial::mixBuffersRingMix() (withSignal) and mixBuffersRing()
+static inline __m128 sse2_ringMod(__m128 a, __m128 b, bool withSignal) {
+	const __m128 one = _mm_set1_ps(1.0f);
+	__m128 r = _mm_mul_ps(a, b);
+	if (withSignal)
+		r = _mm_add_ps(r, a);
+	return _mm_max_ps(_mm_min_ps(r, one), _mm_sub_ps(_mm_setzero_ps(), one));
+}
+
+static int sse2_mixBuffersRing(Bit16s *buf1, const Bit16s *buf2, int len, bool withSignal) {
+	const __m128 scale = _mm_set1_ps(1.0f / 8192.0f);
+	const __m128 unscale = _mm_set1_ps(8192.0f);
+	int done = len & ~7;
+	for (int i = 0; i < done; i += 8) {
+		__m128i x1 = _mm_loadu_si128((const __m128i *)(buf1 + i));
+		__m128i x2 = _mm_loadu_si128((const __m128i *)(buf2 + i));
+		__m128 low = sse2_ringMod(_mm_mul_ps(sse2_lowToFloat(x1), scale), _mm_mul_ps(sse2_lowToFloat(x2), scale), withSignal);
+		__m128 high = sse2_ringMod(_mm_mul_ps(sse2_highToFloat(x1), scale), _mm_mul_ps(sse2_highToFloat(x2), scale), withSignal);
+		__m128i out = _mm_packs_epi32(_mm_cvttps_epi32(_mm_mul_ps(low, unscale)), _mm_cvttps_epi32(_mm_mul_ps(high, unscale)));
+		_mm_storeu_si128((__m128i *)(buf1 + i), out);
+	}
+	return done;
+}
+
+static int sse2_mixBuffers(Bit16s *buf1, const Bit16s *buf2, int len) {
+	int done = len & ~7;
+	for (int i = 0; i < done; i += 8) {
+		__m128i x1 = _mm_loadu_si128((const __m128i *)(buf1 + i));
+		__m128i x2 = _mm_loadu_si128((const __m128i *)(buf2 + i));
+		_mm_storeu_si128((__m128i *)(buf1 + i), _mm_add_epi16(x1, x2));
+	}
+	return done;
+}
+
+static int sse2_partialProductOutput(int len, Bit16s leftvol, Bit16s rightvol, Bit16s *partialBuf, const Bit16s *mixedBuf) {
+	const __m128i left = _mm_set1_epi16(leftvol);
+	const __m128i right = _mm_set1_epi16(rightvol);
+	int done = len & ~7;
+	for (int i = 0; i < done; i += 8) {
+		__m128i x = _mm_loadu_si128((const __m128i *)(mixedBuf + i));
+		__m128i l = _mm_mulhi_epi16(x, left);
+		__m128i r = _mm_mulhi_epi16(x, right);
+		_mm_storeu_si128((__m128i *)(partialBuf + i * 2), _mm_unpacklo_epi16(l, r));
+		_mm_storeu_si128((__m128i *)(partialBuf + i * 2 + 8), _mm_unpackhi_epi16(l, r));
+	}
+	return done;
+}
+
+static int sse2_produceOutput1(const Bit16s *useBuf, Bit16s *stream, Bit32u len, Bit16s volume) {
+	const __m128i vol = _mm_set1_epi16(volume);
+	int done = (int)len & ~3;
+	for (int i = 0; i < done * 2; i += 8) {
+		__m128i x = _mm_loadu_si128((const __m128i *)(useBuf + i));
+		__m128i s = _mm_loadu_si128((const __m128i *)(stream + i));
+		_mm_storeu_si128((__m128i *)(stream + i), _mm_add_epi16(s, sse2_mulShift15(x, vol)));
+	}
+	return done;
+}
+
+static int sse2_convertToFloat(const Bit16s *stream, float *left, float *right, Bit32u len) {
+	const __m128 scale = _mm_set1_ps(32767.0f);
+	int done = (int)len & ~3;
+	for (int i = 0; i < done; i += 4) {
+		__m128i x = _mm_loadu_si128((const __m128i *)(stream + i * 2));
+		__m128i l = _mm_srai_epi32(_mm_slli_epi32(x, 16), 16);
+		__m128i r = _mm_srai_epi32(x, 16);
+		_mm_storeu_ps(left + i, _mm_div_ps(_mm_cvtepi32_ps(l), scale));
+		_mm_storeu_ps(right + i, _mm_div_ps(_mm_cvtepi32_ps(r), scale));
+	}
+	return done;
+}
+
+static int sse2_convertFromFloat(const float *left, const float *right, Bit16s *stream, Bit32u len) {
+	const __m128 scale = _mm_set1_ps(32767.0f);
+	int done = (int)len & ~3;
+	for (int i = 0; i < done; i += 4) {
+		__m128i l = _mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(left + i), scale));
+		__m128i r = _mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(right + i), scale));
+		// Wrap around like the conversion to Bit16s does, instead of saturating
+		l = _mm_srai_epi32(_mm_slli_epi32(l, 16), 16);
+		r = _mm_srai_epi32(_mm_slli_epi32(r, 16), 16);
+		_mm_storeu_si128((__m128i *)(stream + i * 2), _mm_packs_epi32(_mm_unpacklo_epi32(l, r), _mm_unpackhi_epi32(l, r)));
+	}
+	return done;
+}
+
+#ifdef MT32EMU_HAVE_AVX2
+
+static inline MT32EMU_AVX2 __m256 avx2_toFloat(__m128i x) {
+	return _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(x));
+}
+
+static MT32EMU_AVX2 int avx2_mixBuffersRing(Bit16s *buf1, const Bit16s *buf2, int len, bool withSignal) {
+	const __m256 scale = _mm256_set1_ps(1.0f / 8192.0f);
+	const __m256 unscale = _mm256_set1_ps(8192.0f);
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 minusOne = _mm256_set1_ps(-1.0f);
+	int done = len & ~7;
+	for (int i = 0; i < done; i += 8) {
+		__m256 a = _mm256_mul_ps(avx2_toFloat(_mm_loadu_si128((const __m128i *)(buf1 + i))), scale);
+		__m256 b = _mm256_mul_ps(avx2_toFloat(_mm_loadu_si128((const __m128i *)(buf2 + i))), scale);
+		__m256 r = _mm256_mul_ps(a, b);
+		if (withSignal)
+			r = _mm256_add_ps(r, a);
+		r = _mm256_max_ps(_mm256_min_ps(r, one), minusOne);
+		__m256i out = _mm256_cvttps_epi32(_mm256_mul_ps(r, unscale));
+		_mm_storeu_si128((__m128i *)(buf1 + i), _mm_packs_epi32(_mm256_castsi256_si128(out), _mm256_extracti128_si256(out, 1)));
+	}
+	return done;
+}
+
+static MT32EMU_AVX2 int avx2_mixBuffers(Bit16s *buf1, const Bit16s *buf2, int len) {
+	int done = len & ~15;
+	for (int i = 0; i < done; i += 16) {
+		__m256i x1 = _mm256_loadu_si256((const __m256i *)(buf1 + i));
+		__m256i x2 = _mm256_loadu_si256((const __m256i *)(buf2 + i));
+		_mm256_storeu_si256((__m256i *)(buf1 + i), _mm256_add_epi16(x1, x2));
+	}
+	return done;
+}
+
+static MT32EMU_AVX2 int avx2_partialProductOutput(int len, Bit16s leftvol, Bit16s rightvol, Bit16s *partialBuf, const Bit16s *mixedBuf) {
+	const __m256i left = _mm256_set1_epi16(leftvol);
+	const __m256i right = _mm256_set1_epi16(rightvol);
+	int done = len & ~15;
+	for (int i = 0; i < done; i += 16) {
+		__m256i x = _mm256_loadu_si256((const __m256i *)(mixedBuf + i));
+		__m256i l = _mm256_mulhi_epi16(x, left);
+		__m256i r = _mm256_mulhi_epi16(x, right);
+		// The unpacks work within each 128-bit lane, so the halves have to be swapped back in order
+		__m256i low = _mm256_unpacklo_epi16(l, r);
+		__m256i high = _mm256_unpackhi_epi16(l, r);
+		_mm256_storeu_si256((__m256i *)(partialBuf + i * 2), _mm256_permute2x128_si256(low, high, 0x20));
+		_mm256_storeu_si256((__m256i *)(partialBuf + i * 2 + 16), _mm256_permute2x128_si256(low, high, 0x31));
+	}
+	return done;
+}
+
+static MT32EMU_AVX2 int avx2_produceOutput1(const Bit16s *useBuf, Bit16s *stream, Bit32u len, Bit16s volume) {
+	const __m256i vol = _mm256_set1_epi16(volume);
+	int done = (int)len & ~7;
+	for (int i = 0; i < done * 2; i += 16) {
+		__m256i x = _mm256_loadu_si256((const __m256i *)(useBuf + i));
+		__m256i s = _mm256_loadu_si256((const __m256i *)(stream + i));
+		__m256i high = _mm256_mulhi_epi16(x, vol);
+		__m256i low = _mm256_mullo_epi16(x, vol);
+		__m256i product = _mm256_or_si256(_mm256_slli_epi16(high, 1), _mm256_srli_epi16(low, 15));
+		_mm256_storeu_si256((__m256i *)(stream + i), _mm256_add_epi16(s, product));
+	}
+	return done;
+}
+
+#endif // MT32EMU_HAVE_AVX2
+
+#endif // MT32EMU_HAVE_SSE2
+
+#ifdef MT32EMU_HAVE_NEON
+
+static inline float32x4_t neon_ringMod(float32x4_t a, float32x4_t b, bool withSignal) {
+	float32x4_t r = vmulq_f32(a, b);
+	if (withSignal)
+		r = vaddq_f32(r, a);
+	return vmaxq_f32(vminq_f32(r, vdupq_n_f32(1.0f)), vdupq_n_f32(-1.0f));
+}
+
+static int neon_mixBuffersRing(Bit16s *buf1, const Bit16s *buf2, int len, bool withSignal) {
+	const float scale = 1.0f / 8192.0f;
+	int done = len & ~7;
+	for (int i = 0; i < done; i += 8) {
+		int16x8_t x1 = vld1q_s16(buf1 + i);
+		int16x8_t x2 = vld1q_s16(buf2 + i);
+		float32x4_t a = vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x1))), scale);
+		float32x4_t b = vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x2))), scale);
+		int32x4_t low = vcvtq_s32_f32(vmulq_n_f32(neon_ringMod(a, b, withSignal), 8192.0f));
+		a = vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x1))), scale);
+		b = vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x2))), scale);
+		int32x4_t high = vcvtq_s32_f32(vmulq_n_f32(neon_ringMod(a, b, withSignal), 8192.0f));
+		vst1q_s16(buf1 + i, vcombine_s16(vmovn_s32(low), vmovn_s32(high)));
+	}
+	return done;
+}
+
+static int neon_mixBuffers(Bit16s *buf1, const Bit16s *buf2, int len) {
+	int done = len & ~7;
+	for (int i = 0; i < done; i += 8)
+		vst1q_s16(buf1 + i, vaddq_s16(vld1q_s16(buf1 + i), vld1q_s16(buf2 + i)));
+	return done;
+}
+
+static int neon_partialProductOutput(int len, Bit16s leftvol, Bit16s rightvol, Bit16s *partialBuf, const Bit16s *mixedBuf) {
+	int done = len & ~7;
+	for (int i = 0; i < done; i += 8) {
+		int16x8_t x = vld1q_s16(mixedBuf + i);
+		int16x8x2_t out;
+		out.val[0] = vcombine_s16(vshrn_n_s32(vmull_n_s16(vget_low_s16(x), leftvol), 16), vshrn_n_s32(vmull_n_s16(vget_high_s16(x), leftvol), 16));
+		out.val[1] = vcombine_s16(vshrn_n_s32(vmull_n_s16(vget_low_s16(x), rightvol), 16), vshrn_n_s32(vmull_n_s16(vget_high_s16(x), rightvol), 16));
+		vst2q_s16(partialBuf + i * 2, out);
+	}
+	return done;
+}
+
+static int neon_produceOutput1(const Bit16s *useBuf, Bit16s *stream, Bit32u len, Bit16s volume) {
+	int done = (int)len & ~3;
+	for (int i = 0; i < done * 2; i += 8) {
+		int16x8_t x = vld1q_s16(useBuf + i);
+		int16x4_t low = vmovn_s32(vshrq_n_s32(vmull_n_s16(vget_low_s16(x), volume), 15));
+		int16x4_t high = vmovn_s32(vshrq_n_s32(vmull_n_s16(vget_high_s16(x), volume), 15));
+		vst1q_s16(stream + i, vaddq_s16(vld1q_s16(stream + i), vcombine_s16(low, high)));
+	}
+	return done;
+}
+
+static int neon_convertToFloat(const Bit16s *stream, float *left, float *right, Bit32u len) {
+#ifdef __aarch64__
+	const float32x4_t scale = vdupq_n_f32(32767.0f);
+	int done = (int)len & ~7;
+	for (int i = 0; i < done; i += 8) {
+		int16x8x2_t x = vld2q_s16(stream + i * 2);
+		vst1q_f32(left + i, vdivq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x.val[0]))), scale));
+		vst1q_f32(left + i + 4, vdivq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x.val[0]))), scale));
+		vst1q_f32(right + i, vdivq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x.val[1]))), scale));
+		vst1q_f32(right + i + 4, vdivq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x.val[1]))), scale));
+	}
+	return done;
+#else
+	// 32-bit NEON has no division, and multiplying by the reciprocal isn't exact
+	return 0;
+#endif
+}
+
+static int neon_convertFromFloat(const float *left, const float *right, Bit16s *stream, Bit32u len) {
+	int done = (int)len & ~3;
+	for (int i = 0; i < done; i += 4) {
+		int16x4x2_t out;
+		// Saturate to 32 bits, then wrap around, like the conversion to Bit16s does
+		out.val[0] = vmovn_s32(vcvtq_s32_f32(vmulq_n_f32(vld1q_f32(left + i), 32767.0f)));
+		out.val[1] = vmovn_s32(vcvtq_s32_f32(vmulq_n_f32(vld1q_f32(right + i), 32767.0f)));
+		vst2_s16(stream + i * 2, out);
+	}
+	return done;
+}
+
+#endif // MT32EMU_HAVE_NEON
+
+SIMDType DetectSIMDType() {
+#if defined(MT32EMU_HAVE_SSE2)
+	if (cpuHasAVX2())
+		return SIMDType_AVX2;
+	if (cpuHasSSE2())
+		return SIMDType_SSE2;
+#elif defined(MT32EMU_HAVE_NEON)
+	// NEON is mandatory on AArch64. On 32-bit ARM there is no portable way
+	// to ask for it, so trust the compiler flags the build was made with.
+	return SIMDType_NEON;
+#endif
+	return SIMDType_none;
+}
+
+bool IsSIMDTypeSupported(SIMDType type) {
+	SIMDType best = DetectSIMDType();
+	switch (type) {
+	case SIMDType_none:
+		return true;
+	case SIMDType_SSE2:
+		return best == SIMDType_SSE2 || best == SIMDType_AVX2;
+	default:
+		return type == best;
+	}
+}
+
+void SetSIMDType(SIMDType type) {
+	simdType = type;
+	simdTypeSet = true;
+}
+
+SIMDType GetSIMDType() {
+	if (!simdTypeSet)
+		SetSIMDType(DetectSIMDType());
+	return simdType;
+}
+
+const char *GetSIMDTypeName(SIMDType type) {
+	switch (type) {
+	case SIMDType_SSE2:
+		return "SSE2";
+	case SIMDType_AVX2:
+		return "AVX2";
+	case SIMDType_NEON:
+		return "NEON";
+	default:
+		return "none";
+	}
+}
+
+int simd_mixBuffers(Bit16s *buf1, const Bit16s *buf2, int len) {
+	switch (simdType) {
+#ifdef MT32EMU_HAVE_SSE2
+#ifdef MT32EMU_HAVE_AVX2
+	case SIMDType_AVX2:
+		return avx2_mixBuffers(buf1, buf2, len);
+#endif
+	case SIMDType_SSE2:
+		return sse2_mixBuffers(buf1, buf2, len);
+#endif
+#ifdef MT32EMU_HAVE_NEON
+	case SIMDType_NEON:
+		return neon_mixBuffers(buf1, buf2, len);
+#endif
+	default:
+		return 0;
+	}
+}
+
+int simd_mixBuffersRingMix(Bit16s *buf1, const Bit16s *buf2, int len) {
+	switch (simdType) {
+#ifdef MT32EMU_HAVE_SSE2
+#ifdef MT32EMU_HAVE_AVX2
+	case SIMDType_AVX2:
+		return avx2_mixBuffersRing(buf1, buf2, len, true);
+#endif
+	case SIMDType_SSE2:
+		return sse2_mixBuffersRing(buf1, buf2, len, true);
+#endif
+#ifdef MT32EMU_HAVE_NEON
+	case SIMDType_NEON:
+		return neon_mixBuffersRing(buf1, buf2, len, true);
+#endif
+	default:
+		return 0;
+	}
+}
+
+int simd_mixBuffersRing(Bit16s *buf1, const Bit16s *buf2, int len) {
+	switch (simdType) {
+#ifdef MT32EMU_HAVE_SSE2
+#ifdef MT32EMU_HAVE_AVX2
+	case SIMDType_AVX2:
+		return avx2_mixBuffersRing(buf1, buf2, len, false);
+#endif
+	case SIMDType_SSE2:
+		return sse2_mixBuffersRing(buf1, buf2, len, false);
+#endif
+#ifdef MT32EMU_HAVE_NEON
+	case SIMDType_NEON:
+		return neon_mixBuffersRing(buf1, buf2, len, false);
+#endif
+	default:
+		return 0;
+	}
+}
+
+int simd_partialProductOutput(int len, Bit16s leftvol, Bit16s rightvol, Bit16s *partialBuf, const Bit16s *mixedBuf) {
+	switch (simdType) {
+#ifdef MT32EMU_HAVE_SSE2
+#ifdef MT32EMU_HAVE_AVX2
+	case SIMDType_AVX2:
+		return avx2_partialProductOutput(len, leftvol, rightvol, partialBuf, mixedBuf);
+#endif
+	case SIMDType_SSE2:
+		return sse2_partialProductOutput(len, leftvol, rightvol, partialBuf, mixedBuf);
+#endif
+#ifdef MT32EMU_HAVE_NEON
+	case SIMDType_NEON:
+		return neon_partialProductOutput(len, leftvol, rightvol, partialBuf, mixedBuf);
+#endif
+	default:
+		return 0;
+	}
+}
+
+int simd_produceOutput1(const Bit16s *useBuf, Bit16s *stream, Bit32u len, Bit16s volume) {
+	switch (simdType) {
+#ifdef MT32EMU_HAVE_SSE2
+#ifdef MT32EMU_HAVE_AVX2
+	case SIMDType_AVX2:
+		return avx2_produceOutput1(useBuf, stream, len, volume);
+#endif
+	case SIMDType_SSE2:
+		return sse2_produceOutput1(useBuf, stream, len, volume);
+#endif
+#ifdef MT32EMU_HAVE_NEON
+	case SIMDType_NEON:
+		return neon_produceOutput1(useBuf, stream, len, volume);
+#endif
+	default:
+		return 0;
+	}
+}
+
+// The conversions are limited by the division and the memory bandwidth, so AVX2 uses the SSE2 versions
+
+int simd_convertToFloat(const Bit16s *stream, float *left, float *right, Bit32u len) {
+	switch (simdType) {
+#ifdef MT32EMU_HAVE_SSE2
+	case SIMDType_AVX2:
+	case SIMDType_SSE2:
+		return sse2_convertToFloat(stream, left, right, len);
+#endif
+#ifdef MT32EMU_HAVE_NEON
+	case SIMDType_NEON:
+		return neon_convertToFloat(stream, left, right, len);
+#endif
+	default:
+		return 0;
+	}
+}
+
+int simd_convertFromFloat(const float *left, const float *right, Bit16s *stream, Bit32u len) {
+	switch (simdType) {
+#ifdef MT32EMU_HAVE_SSE2
+	case SIMDType_AVX2:
+	case SIMDType_SSE2:
+		return sse2_convertFromFloat(left, right, stream, len);
+#endif
+#ifdef MT32EMU_HAVE_NEON
+	case SIMDType_NEON:
+		return neon_convertFromFloat(left, right, stream, len);
+#endif
+	default:
+		return 0;
+	}
+}
+
+}
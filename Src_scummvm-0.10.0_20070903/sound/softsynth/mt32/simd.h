@@ -0,0 +1,87 @@
+/* Copyright (c) 2003-2005 Various contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef MT32EMU_SIMD_H
+#define MT32EMU_SIMD_H
+
+// Vector versions of the innermost mixing loops, written with compiler intrinsics instead of
+// inline assembly, so that they also work on x86-64 and ARM. Unlike the MMX code in i386.cpp,
+// they produce exactly the same samples as the plain C++ loops they stand in for (except that
+// the ring modulation kernels may differ by one where the compiler fuses the C++ version's
+// multiply and add).
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MT32EMU_HAVE_SSE2
+// AVX2 code is compiled with a target attribute and only run on CPUs that support it
+#if (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))) || defined(__clang__) || (defined(_MSC_VER) && _MSC_VER >= 1700)
+#define MT32EMU_HAVE_AVX2
+#endif
+#endif
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define MT32EMU_HAVE_NEON
+#endif
+
+#if defined(MT32EMU_HAVE_SSE2) || defined(MT32EMU_HAVE_NEON)
+#define MT32EMU_HAVE_SIMD
+#endif
+
+namespace MT32Emu {
+
+enum SIMDType {
+	SIMDType_none,
+	SIMDType_SSE2,
+	SIMDType_AVX2,
+	SIMDType_NEON
+};
+
+// Returns the best instruction set that both this build and the CPU support
+SIMDType DetectSIMDType();
+// Returns true if the kernels can be run with the given instruction set
+bool IsSIMDTypeSupported(SIMDType type);
+// Selects the instruction set used by all synths. Only meant to be changed while no synth is
+// rendering.
+void SetSIMDType(SIMDType type);
+// Returns the selected instruction set. Until one has been selected, the kernels do nothing,
+// and the first call (made by Synth::open()) selects the best one.
+SIMDType GetSIMDType();
+const char *GetSIMDTypeName(SIMDType type);
+
+// Each of these processes as much of the buffers as the selected instruction set allows and
+// returns the number of samples (frames for stereo buffers) it did. The caller does the rest.
+
+// buf1[i] += buf2[i]
+int simd_mixBuffers(Bit16s *buf1, const Bit16s *buf2, int len);
+// Ring modulation with (mixBuffersRingMix) and without (mixBuffersRing) the original signal,
+// see Partial
+int simd_mixBuffersRingMix(Bit16s *buf1, const Bit16s *buf2, int len);
+int simd_mixBuffersRing(Bit16s *buf1, const Bit16s *buf2, int len);
+// Pans the mono mixedBuf into the stereo partialBuf
+int simd_partialProductOutput(int len, Bit16s leftvol, Bit16s rightvol, Bit16s *partialBuf, const Bit16s *mixedBuf);
+// Adds the stereo useBuf at the given volume to stream
+int simd_produceOutput1(const Bit16s *useBuf, Bit16s *stream, Bit32u len, Bit16s volume);
+// Converts the stereo stream to and from the float buffers the reverb works on
+int simd_convertToFloat(const Bit16s *stream, float *left, float *right, Bit32u len);
+int simd_convertFromFloat(const float *left, const float *right, Bit16s *stream, Bit32u len);
+
+}
+
+#endif
@@ -91,6 +91,7 @@ Synth::Synth() {
 	isOpen = false;
 	reverbModel = NULL;
 	partialManager = NULL;
+	partRenderBuffers = NULL;
 	memset(parts, 0, sizeof(parts));
 }
 
@@ -515,6 +516,22 @@ bool Synth::open(SynthProperties &useProp) {
 	}
 #endif
 
+#if defined(MT32EMU_HAVE_SIMD)
+	printDebug("Using %s vector kernels", GetSIMDTypeName(GetSIMDType()));
+#endif
+
+	if (myProp.runParallel != NULL) {
+		// Each job needs a buffer for the partial being rendered, and one each
+		// for the accumulated output that does and doesn't go through the reverb
+		partRenderBuffers = new Bit16s[9 * 3 * MAX_SAMPLE_OUTPUT * 2];
+		for (int i = 0; i < 9; i++) {
+			Bit16s *buffers = partRenderBuffers + i * 3 * MAX_SAMPLE_OUTPUT * 2;
+			partRenderJobs[i].tmpBuffer = buffers;
+			partRenderJobs[i].reverbBuffer = buffers + MAX_SAMPLE_OUTPUT * 2;
+			partRenderJobs[i].dryBuffer = buffers + MAX_SAMPLE_OUTPUT * 4;
+		}
+	}
+
 	isOpen = true;
 	isEnabled = false;
 
@@ -550,6 +567,8 @@ void Synth::close(void) {
 
 	delete[] pcmWaves;
 	delete[] pcmROMData;
+	delete[] partRenderBuffers;
+	partRenderBuffers = NULL;
 	isOpen = false;
 }
 
@@ -1104,7 +1123,12 @@ int Synth::dumpTimbres(const char *filename, int start, int len) {
 }
 
 void ProduceOutput1(Bit16s *useBuf, Bit16s *stream, Bit32u len, Bit16s volume) {
-#if MT32EMU_USE_MMX > 2
+#if defined(MT32EMU_HAVE_SIMD)
+	int donelen = simd_produceOutput1(useBuf, stream, len, volume);
+	len -= donelen;
+	stream += donelen * 2;
+	useBuf += donelen * 2;
+#elif MT32EMU_USE_MMX > 2
 	//FIXME:KG: This appears to introduce crackle
 	int donelen = i386_produceOutput1(useBuf, stream, len, volume);
 	len -= donelen;
@@ -1130,9 +1154,47 @@ void Synth::render(Bit16s *stream, Bit32u len) {
 	}
 }
 
-void Synth::doRender(Bit16s *stream, Bit32u len) {
-	partialManager->ageAll();
+// Below this length, render() doesn't bother rendering the parts in parallel
+static const Bit32u MIN_PARALLEL_RENDER_LEN = 256;
 
+static void mixPartRenderBuffer(Bit16s *stream, const Bit16s *buf, Bit32u len) {
+	// Wrapping 16-bit additions, as in ProduceOutput1(), so that the sum doesn't
+	// depend on the order in which the partials have been added up
+	Bit32u i = 0, end = len * 2;
+#if defined(MT32EMU_HAVE_SIMD)
+	i = (Bit32u)simd_mixBuffers(stream, buf, (int)end);
+#endif
+	for (; i < end; i++)
+		stream[i] = (Bit16s)(stream[i] + buf[i]);
+}
+
+void Synth::applyReverb(Bit16s *stream, Bit32u len) {
+	unsigned int i = 0;
+#if defined(MT32EMU_HAVE_SIMD)
+	i = (unsigned int)simd_convertToFloat(stream, sndbufl, sndbufr, len);
+#endif
+	Bit32u m = i * 2;
+	for (; i < len; i++) {
+		sndbufl[i] = (float)stream[m] / 32767.0f;
+		m++;
+		sndbufr[i] = (float)stream[m] / 32767.0f;
+		m++;
+	}
+	reverbModel->processreplace(sndbufl, sndbufr, outbufl, outbufr, len, 1);
+	i = 0;
+#if defined(MT32EMU_HAVE_SIMD)
+	i = (unsigned int)simd_convertFromFloat(outbufl, outbufr, stream, len);
+#endif
+	m = i * 2;
+	for (; i < len; i++) {
+		stream[m] = (Bit16s)(outbufl[i] * 32767.0f);
+		m++;
+		stream[m] = (Bit16s)(outbufr[i] * 32767.0f);
+		m++;
+	}
+}
+
+void Synth::doRenderSerial(Bit16s *stream, Bit32u len) {
 	if (myProp.useReverb) {
 		for (unsigned int i = 0; i < MT32EMU_MAX_PARTIALS; i++) {
 			if (partialManager->shouldReverb(i)) {
@@ -1141,21 +1203,7 @@ void Synth::doRender(Bit16s *stream, Bit32u len) {
 				}
 			}
 		}
-		Bit32u m = 0;
-		for (unsigned int i = 0; i < len; i++) {
-			sndbufl[i] = (float)stream[m] / 32767.0f;
-			m++;
-			sndbufr[i] = (float)stream[m] / 32767.0f;
-			m++;
-		}
-		reverbModel->processreplace(sndbufl, sndbufr, outbufl, outbufr, len, 1);
-		m=0;
-		for (unsigned int i = 0; i < len; i++) {
-			stream[m] = (Bit16s)(outbufl[i] * 32767.0f);
-			m++;
-			stream[m] = (Bit16s)(outbufr[i] * 32767.0f);
-			m++;
-		}
+		applyReverb(stream, len);
 		for (unsigned int i = 0; i < MT32EMU_MAX_PARTIALS; i++) {
 			if (!partialManager->shouldReverb(i)) {
 				if (partialManager->produceOutput(i, &tmpBuffer[0], len)) {
@@ -1169,6 +1217,96 @@ void Synth::doRender(Bit16s *stream, Bit32u len) {
 				ProduceOutput1(&tmpBuffer[0], stream, len, masterVolume);
 		}
 	}
+}
+
+unsigned int Synth::assignPartRenderJobs() {
+	// Partials only ever interact with the other partials of their own part
+	// (ring modulation and deactivating the pair partial), so the parts can be
+	// rendered independently of each other
+	int partJob[9];
+	unsigned int numJobs = 0;
+	for (int i = 0; i < 9; i++)
+		partJob[i] = -1;
+	for (unsigned int i = 0; i < MT32EMU_MAX_PARTIALS; i++) {
+		int ownerPart = partialManager->getPartial(i)->getOwnerPart();
+		if (ownerPart < 0 || ownerPart > 8)
+			continue;
+		if (partJob[ownerPart] < 0) {
+			partJob[ownerPart] = numJobs;
+			partRenderJobs[numJobs].numPartials = 0;
+			numJobs++;
+		}
+		PartRenderJob *job = &partRenderJobs[partJob[ownerPart]];
+		job->partials[job->numPartials++] = i;
+	}
+	return numJobs;
+}
+
+static void addPartOutput(Bit16s *partialBuf, Bit16s *buf, bool *haveOutput, Bit32u len, Bit16s volume) {
+	if (!*haveOutput) {
+		memset(buf, 0, len * sizeof(Bit16s) * 2);
+		*haveOutput = true;
+	}
+	ProduceOutput1(partialBuf, buf, len, volume);
+}
+
+void Synth::renderPartJob(PartRenderJob *job, Bit32u len) {
+	// The same order as in doRenderSerial(), restricted to the partials of one part
+	job->haveReverbOutput = false;
+	job->haveDryOutput = false;
+	if (myProp.useReverb) {
+		for (unsigned int n = 0; n < job->numPartials; n++) {
+			unsigned int i = job->partials[n];
+			if (partialManager->shouldReverb(i) && partialManager->produceOutput(i, job->tmpBuffer, len))
+				addPartOutput(job->tmpBuffer, job->reverbBuffer, &job->haveReverbOutput, len, masterVolume);
+		}
+		for (unsigned int n = 0; n < job->numPartials; n++) {
+			unsigned int i = job->partials[n];
+			if (!partialManager->shouldReverb(i) && partialManager->produceOutput(i, job->tmpBuffer, len))
+				addPartOutput(job->tmpBuffer, job->dryBuffer, &job->haveDryOutput, len, masterVolume);
+		}
+	} else {
+		for (unsigned int n = 0; n < job->numPartials; n++) {
+			unsigned int i = job->partials[n];
+			if (partialManager->produceOutput(i, job->tmpBuffer, len))
+				addPartOutput(job->tmpBuffer, job->dryBuffer, &job->haveDryOutput, len, masterVolume);
+		}
+	}
+}
+
+void Synth::runPartRenderJob(void *jobParam, unsigned int job) {
+	Synth *synth = (Synth *)jobParam;
+	synth->renderPartJob(&synth->partRenderJobs[job], synth->partRenderLen);
+}
+
+void Synth::doRenderParallel(Bit16s *stream, Bit32u len, unsigned int numJobs) {
+	partRenderLen = len;
+	myProp.runParallel(myProp.userData, runPartRenderJob, this, numJobs);
+
+	for (unsigned int i = 0; i < numJobs; i++) {
+		if (partRenderJobs[i].haveReverbOutput)
+			mixPartRenderBuffer(stream, partRenderJobs[i].reverbBuffer, len);
+	}
+	if (myProp.useReverb)
+		applyReverb(stream, len);
+	for (unsigned int i = 0; i < numJobs; i++) {
+		if (partRenderJobs[i].haveDryOutput)
+			mixPartRenderBuffer(stream, partRenderJobs[i].dryBuffer, len);
+	}
+}
+
+void Synth::doRender(Bit16s *stream, Bit32u len) {
+	partialManager->ageAll();
+
+	// Starting the jobs costs more than it saves for the tiny chunks rendered
+	// between closely spaced MIDI events, and when there is only one part to render
+	unsigned int numJobs = 0;
+	if (partRenderBuffers != NULL && len >= MIN_PARALLEL_RENDER_LEN)
+		numJobs = assignPartRenderJobs();
+	if (numJobs > 1)
+		doRenderParallel(stream, len, numJobs);
+	else
+		doRenderSerial(stream, len);
 
 	partialManager->clearAlreadyOutputed();
 
@@ -58,6 +58,9 @@ enum ReportType {
 	ReportType_newReverbLevel
 };
 
+// A job passed to the runParallel callback, see SynthProperties
+typedef void (*ParallelJobProc)(void *jobParam, unsigned int job);
+
 struct SynthProperties {
 	// Sample rate to use in mixing
 	int sampleRate;
@@ -88,6 +91,11 @@ struct SynthProperties {
 	File *(*openFile)(void *userData, const char *filename, File::OpenMode mode);
 	// Callback for closing a File. May be NULL, in which case the File will automatically be close()d/deleted.
 	void (*closeFile)(void *userData, File *file);
+	// Callback for rendering the parts on several threads. It must call job(jobParam, n) once for
+	// every n from 0 to numJobs - 1, in any order and possibly from different threads at the same
+	// time, and only return when all of these calls are done. May be NULL, in which case all
+	// partials are rendered on the calling thread. The output is exactly the same either way.
+	void (*runParallel)(void *userData, ParallelJobProc job, void *jobParam, unsigned int numJobs);
 };
 
 // This is the specification of the Callback routine used when calling the RecalcWaveforms
@@ -230,11 +238,33 @@ private:
 	float outbufl[MAX_SAMPLE_OUTPUT];
 	float outbufr[MAX_SAMPLE_OUTPUT];
 
+	// The partials of one part, which are rendered by one job when rendering in parallel.
+	// Every job mixes its output into its own buffers, which are added up afterwards.
+	struct PartRenderJob {
+		unsigned int numPartials;
+		unsigned int partials[MT32EMU_MAX_PARTIALS];
+		bool haveReverbOutput;
+		bool haveDryOutput;
+		Bit16s *tmpBuffer;
+		Bit16s *reverbBuffer;
+		Bit16s *dryBuffer;
+	};
+
+	PartRenderJob partRenderJobs[9];
+	Bit16s *partRenderBuffers;
+	Bit32u partRenderLen;
+
 	SynthProperties myProp;
 
 	bool loadPreset(File *file);
 	void initReverb(Bit8u newRevMode, Bit8u newRevTime, Bit8u newRevLevel);
 	void doRender(Bit16s * stream, Bit32u len);
+	void doRenderSerial(Bit16s *stream, Bit32u len);
+	void doRenderParallel(Bit16s *stream, Bit32u len, unsigned int numJobs);
+	void applyReverb(Bit16s *stream, Bit32u len);
+	unsigned int assignPartRenderJobs();
+	void renderPartJob(PartRenderJob *job, Bit32u len);
+	static void runPartRenderJob(void *jobParam, unsigned int job);
 
 	void playAddressedSysex(unsigned char channel, const Bit8u *sysex, Bit32u len);
 	void readSysex(unsigned char channel, const Bit8u *sysex, Bit32u len);
@@ -0,0 +1,241 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+#include "common/stdafx.h"
+
+#include "sound/soundcache.h"
+#include "sound/audiostream.h"
+#include "sound/decodethread.h"
+#include "common/file.h"
+#include "common/util.h"
+
+DECLARE_SINGLETON(Audio::DecodedSoundCache);
+
+namespace Audio {
+
+enum {
+	/** Sounds with more compressed data than this are never cached. */
+	kMaxCachedSoundSize = 64 * 1024,
+	/** Number of samples decoded at a time while filling the cache. */
+	kDecodeChunkSize = 4096
+};
+
+/**
+ * Plays a cached sound straight from its decoded samples, which are shared
+ * by all streams playing the same sound.
+ */
+class CachedSoundStream : public AudioStream {
+	DecodedSoundCache::Sound *_sound;
+	uint32 _pos;
+
+public:
+	CachedSoundStream(DecodedSoundCache::Sound *sound) : _sound(sound), _pos(0) {}
+	~CachedSoundStream() { SoundCache.release(_sound); }
+
+	int readBuffer(int16 *buffer, const int numSamples) {
+		const int samples = MIN<int>(numSamples, _sound->numSamples - _pos);
+		memcpy(buffer, _sound->samples + _pos, samples * sizeof(int16));
+		_pos += samples;
+		return samples;
+	}
+
+	bool isStereo() const { return _sound->stereo; }
+	bool endOfData() const { return _pos >= _sound->numSamples; }
+	int getRate() const { return _sound->rate; }
+};
+
+/**
+ * Plays the samples of a sound which turned out to be too big for the cache
+ * while it was decoded, followed by the rest of the decoder's output.
+ */
+class PartiallyDecodedStream : public AudioStream {
+	int16 *_samples;
+	uint32 _numSamples;
+	uint32 _pos;
+	AudioStream *_input;
+
+public:
+	PartiallyDecodedStream(int16 *samples, uint32 numSamples, AudioStream *input)
+		: _samples(samples), _numSamples(numSamples), _pos(0), _input(input) {}
+	~PartiallyDecodedStream() {
+		free(_samples);
+		delete _input;
+	}
+
+	int readBuffer(int16 *buffer, const int numSamples) {
+		const int samples = MIN<int>(numSamples, _numSamples - _pos);
+		memcpy(buffer, _samples + _pos, samples * sizeof(int16));
+		_pos += samples;
+		if (samples == numSamples)
+			return samples;
+		return samples + _input->readBuffer(buffer + samples, numSamples - samples);
+	}
+
+	bool isStereo() const { return _input->isStereo(); }
+	bool endOfData() const { return _pos >= _numSamples && _input->endOfData(); }
+	bool endOfStream() const { return _pos >= _numSamples && _input->endOfStream(); }
+	int getRate() const { return _input->getRate(); }
+};
+
+DecodedSoundCache::DecodedSoundCache()
+	: _memoryBudget(0), _memoryUsage(0), _hits(0), _misses(0) {
+}
+
+void DecodedSoundCache::setMemoryBudget(uint32 bytes) {
+	Common::StackLock lock(_mutex);
+
+	_memoryBudget = bytes;
+	evict(bytes);
+}
+
+void DecodedSoundCache::clear() {
+	Common::StackLock lock(_mutex);
+
+	evict(0);
+}
+
+AudioStream *DecodedSoundCache::makeStream(Common::File *file, uint32 size, SoundDecoderProc decoder) {
+	assert(file);
+
+	// If no size was specified, read the whole remainder of the file
+	if (!size)
+		size = file->size() - file->pos();
+
+	if (_memoryBudget == 0 || size > kMaxCachedSoundSize) {
+		// FIXME: For now, just read the whole data into memory, and be done
+		// with it. Of course this is in general *not* a nice thing to do...
+		return makeThreadedAudioStream(decoder(file->readStream(size)));
+	}
+
+	char buf[32];
+	snprintf(buf, sizeof(buf), ":%u:%u", file->pos(), size);
+	const Common::String key = Common::String(file->name()) + buf;
+
+	// Don't let a single sound take up more than a quarter of the budget
+	uint32 maxBytes;
+
+	{
+		Common::StackLock lock(_mutex);
+		maxBytes = _memoryBudget / 4;
+		if (_sounds.contains(key)) {
+			Sound *sound = _sounds[key];
+			_lru.remove(sound);
+			_lru.push_back(sound);
+			_hits++;
+
+			file->seek(size, SEEK_CUR);
+			return createStream(sound);
+		}
+		_misses++;
+	}
+
+	// Decode the whole sound without holding the lock, so that sounds which
+	// are already cached can be started and stopped in the meantime.
+	AudioStream *input = decoder(file->readStream(size));
+	if (!input)
+		return 0;
+
+	Sound *sound = new Sound;
+	sound->key = key;
+	sound->rate = input->getRate();
+	sound->stereo = input->isStereo();
+	sound->refCount = 0;
+	sound->cached = false;
+
+	uint32 capacity = kDecodeChunkSize;
+	sound->samples = (int16 *)malloc(capacity * sizeof(int16));
+	sound->numSamples = 0;
+
+	while (!input->endOfData()) {
+		if (sound->numSamples + kDecodeChunkSize > capacity) {
+			capacity *= 2;
+			sound->samples = (int16 *)realloc(sound->samples, capacity * sizeof(int16));
+		}
+		const int samples = input->readBuffer(sound->samples + sound->numSamples, kDecodeChunkSize);
+		if (samples <= 0)
+			break;
+		sound->numSamples += samples;
+
+		if (sound->numSamples * sizeof(int16) > maxBytes && !input->endOfData()) {
+			// The sound is too big for the cache after all. Instead of
+			// decoding all of it up front, play what we have and decode
+			// the rest while it plays.
+			debug(3, "DecodedSoundCache: %s is too big to be cached", key.c_str());
+			AudioStream *stream = new PartiallyDecodedStream(sound->samples, sound->numSamples, input);
+			delete sound;
+			return makeThreadedAudioStream(stream);
+		}
+	}
+	delete input;
+
+	Common::StackLock lock(_mutex);
+
+	// Keep the first copy if another thread decoded the same sound, and
+	// check the budget again in case it was lowered in the meantime.
+	const uint32 bytes = (uint32)(sound->numSamples * sizeof(int16));
+	if (bytes <= _memoryBudget / 4 && !_sounds.contains(key)) {
+		evict(_memoryBudget - bytes);
+		sound->cached = true;
+		_sounds[key] = sound;
+		_lru.push_back(sound);
+		_memoryUsage += bytes;
+	}
+
+	debug(3, "DecodedSoundCache: decoded %s (%d bytes), %d hits, %d misses, %d bytes used",
+		key.c_str(), bytes, _hits, _misses, _memoryUsage);
+
+	return createStream(sound);
+}
+
+void DecodedSoundCache::evict(uint32 budget) {
+	while (_memoryUsage > budget && !_lru.empty()) {
+		Sound *sound = *_lru.begin();
+		_lru.erase(_lru.begin());
+		_sounds.erase(sound->key);
+		_memoryUsage -= (uint32)(sound->numSamples * sizeof(int16));
+
+		sound->cached = false;
+		if (sound->refCount == 0) {
+			free(sound->samples);
+			delete sound;
+		}
+	}
+}
+
+AudioStream *DecodedSoundCache::createStream(Sound *sound) {
+	sound->refCount++;
+	return new CachedSoundStream(sound);
+}
+
+void DecodedSoundCache::release(Sound *sound) {
+	Common::StackLock lock(_mutex);
+
+	if (--sound->refCount == 0 && !sound->cached) {
+		free(sound->samples);
+		delete sound;
+	}
+}
+
+} // End of namespace Audio
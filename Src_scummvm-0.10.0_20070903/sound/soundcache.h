@@ -0,0 +1,124 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+#ifndef SOUND_SOUNDCACHE_H
+#define SOUND_SOUNDCACHE_H
+
+#include "common/stdafx.h"
+#include "common/scummsys.h"
+#include "common/hashmap.h"
+#include "common/hash-str.h"
+#include "common/list.h"
+#include "common/mutex.h"
+#include "common/singleton.h"
+#include "common/str.h"
+
+namespace Common {
+	class File;
+	class SeekableReadStream;
+}
+
+namespace Audio {
+
+class AudioStream;
+
+/** A function creating a decoder for the compressed sound data in stream, which it takes ownership of. */
+typedef AudioStream *(*SoundDecoderProc)(Common::SeekableReadStream *stream);
+
+/**
+ * LRU cache of fully decoded short sounds, so that sound effects which are
+ * played over and over don't have to be read and decoded every time.
+ * Sounds are identified by the name of the file they are stored in, their
+ * offset in that file and their size. The decoded data of all cached sounds
+ * is bounded by a memory budget; sounds which are still playing stay in
+ * memory after they have been evicted, until their last stream is deleted.
+ */
+class DecodedSoundCache : public Common::Singleton<DecodedSoundCache> {
+public:
+	/**
+	 * Set the memory budget for decoded samples. Sounds are evicted as
+	 * needed to keep within the new budget. 0 disables caching.
+	 */
+	void setMemoryBudget(uint32 bytes);
+
+	/** Evict all sounds, e.g. because the files they were loaded from may change. */
+	void clear();
+
+	/**
+	 * Create a stream for the size bytes of compressed sound data starting at
+	 * the current position of file, which is advanced past the data. Short
+	 * sounds are taken from the cache, or decoded completely with the given
+	 * decoder and added to it; other sounds are decoded while they play.
+	 *
+	 * @return	a new AudioStream, or 0 if the decoder failed
+	 */
+	AudioStream *makeStream(Common::File *file, uint32 size, SoundDecoderProc decoder);
+
+	uint getHits() const { return _hits; }
+	uint getMisses() const { return _misses; }
+
+	/** Get the number of bytes used by the decoded samples of all cached sounds. */
+	uint32 getMemoryUsage() const { return _memoryUsage; }
+
+private:
+	friend class Singleton<SingletonBaseType>;
+	friend class CachedSoundStream;
+	DecodedSoundCache();
+
+	struct Sound {
+		Common::String key;
+		int16 *samples;
+		uint32 numSamples;
+		int rate;
+		bool stereo;
+
+		/** Number of streams playing this sound. */
+		int refCount;
+		/** False once the sound has been evicted. */
+		bool cached;
+	};
+
+	typedef Common::HashMap<Common::String, Sound *, Common::CaseSensitiveString_Hash, Common::CaseSensitiveString_EqualTo> SoundMap;
+
+	SoundMap _sounds;
+	/** The cached sounds, least recently used first. */
+	Common::List<Sound *> _lru;
+
+	Common::Mutex _mutex;
+	uint32 _memoryBudget;
+	uint32 _memoryUsage;
+	uint _hits, _misses;
+
+	void evict(uint32 budget);
+	AudioStream *createStream(Sound *sound);
+	void release(Sound *sound);
+};
+
+} // End of namespace Audio
+
+/** Shortcut for accessing the decoded sound cache. */
+#define SoundCache		Audio::DecodedSoundCache::instance()
+
+#endif
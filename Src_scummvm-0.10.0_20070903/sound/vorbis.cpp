@@ -31,6 +31,8 @@
 #include "common/util.h"
 
 #include "sound/audiostream.h"
+#include "sound/decodethread.h"
+#include "sound/soundcache.h"
 #include "sound/audiocd.h"
 
 #ifdef USE_TREMOR
@@ -266,23 +268,14 @@ void VorbisInputStream::refill() {
 #pragma mark -
 
 
-AudioStream *makeVorbisStream(Common::File *file, uint32 size) {
-	assert(file);
-
-	// FIXME: For now, just read the whole data into memory, and be done
-	// with it. Of course this is in general *not* a nice thing to do...
-
-	// If no size was specified, read the whole remainder of the file
-	if (!size)
-		size = file->size() - file->pos();
-
-	// Read 'size' bytes of data into a MemoryReadStream
-	Common::MemoryReadStream *stream = file->readStream(size);
-
-	// .. and create a VorbisInputStream from all this
+static AudioStream *makeVorbisDecoder(Common::SeekableReadStream *stream) {
 	return new VorbisInputStream(stream, true);
 }
 
+AudioStream *makeVorbisStream(Common::File *file, uint32 size) {
+	return SoundCache.makeStream(file, size, makeVorbisDecoder);
+}
+
 AudioStream *makeVorbisStream(
 	Common::SeekableReadStream *stream,
 	bool disposeAfterUse,
@@ -292,7 +285,7 @@ AudioStream *makeVorbisStream(
 
 	uint32 endTime = duration ? (startTime + duration) : 0;
 
-	return new VorbisInputStream(stream, disposeAfterUse, startTime, endTime, numLoops);
+	return makeThreadedAudioStream(new VorbisInputStream(stream, disposeAfterUse, startTime, endTime, numLoops));
 }
 
 
@@ -72,5 +72,92 @@ class HashMapTestSuite : public CxxTest::TestSuite
 		TS_ASSERT( container.begin() == container.end() );
 	}
 
-	// TODO: Add test cases for iterators, find, ...
+	void test_erase_keeps_probe_sequences( void )
+	{
+		Common::HashMap<int, int> container;
+		// Keys which are equal modulo the table size share their first
+		// bucket, so they end up in one probe sequence.
+		for (int i = 0; i < 10; ++i)
+			container[i * 64] = i;
+		TS_ASSERT_EQUALS( container.size(), 10u );
+
+		container.erase(0);
+		container.erase(3 * 64);
+		TS_ASSERT_EQUALS( container.size(), 8u );
+		TS_ASSERT( !container.contains(0) );
+		TS_ASSERT( !container.contains(3 * 64) );
+		for (int i = 1; i < 10; ++i) {
+			if (i != 3)
+				TS_ASSERT_EQUALS( container[i * 64], i );
+		}
+
+		// Erased buckets are reused by later insertions.
+		container[3 * 64] = 42;
+		TS_ASSERT_EQUALS( container[3 * 64], 42 );
+		TS_ASSERT_EQUALS( container.size(), 9u );
+	}
+
+	void test_iterator_skips_erased( void )
+	{
+		Common::HashMap<int, int> container;
+		for (int i = 0; i < 100; ++i)
+			container[i] = i;
+		for (int i = 0; i < 100; i += 2)
+			container.erase(i);
+
+		int count = 0;
+		Common::HashMap<int, int>::const_iterator iter;
+		for (iter = container.begin(); iter != container.end(); ++iter) {
+			TS_ASSERT( iter->_key % 2 == 1 );
+			TS_ASSERT_EQUALS( iter->_key, iter->_value );
+			++count;
+		}
+		TS_ASSERT_EQUALS( count, 50 );
+	}
+
+	void test_copy_with_erased( void )
+	{
+		Common::HashMap<int, int> container;
+		for (int i = 0; i < 20; ++i)
+			container[i * 16] = i;
+		container.erase(0);
+
+		Common::HashMap<int, int> copy(container);
+		TS_ASSERT_EQUALS( copy.size(), 19u );
+		TS_ASSERT( !copy.contains(0) );
+		for (int i = 1; i < 20; ++i)
+			TS_ASSERT_EQUALS( copy[i * 16], i );
+	}
+
+	void test_load_factor_and_stats( void )
+	{
+		Common::HashMap<int, int> container;
+		container.setMaxLoadFactor(50);
+		TS_ASSERT_EQUALS( container.getMaxLoadFactor(), 50u );
+
+		for (int i = 0; i < 1000; ++i)
+			container[i] = i;
+		for (int i = 0; i < 1000; i += 3)
+			container.erase(i);
+
+		Common::HashMapStats stats;
+		container.getStats(stats);
+		TS_ASSERT_EQUALS( stats.size, container.size() );
+		TS_ASSERT( (stats.capacity & (stats.capacity - 1)) == 0 );
+		TS_ASSERT( stats.load <= 50 );
+		TS_ASSERT_EQUALS( stats.maxLoad, 50u );
+		TS_ASSERT( stats.memoryUsage > stats.capacity * sizeof(void *) );
+
+		uint total = 0;
+		for (int i = 0; i < Common::HASHMAP_PROBE_HISTOGRAM_SIZE; ++i)
+			total += stats.probeHistogram[i];
+		TS_ASSERT_EQUALS( total, container.size() );
+		TS_ASSERT( stats.maxProbeLength >= 1 );
+
+		// Out of range load factors are clipped.
+		container.setMaxLoadFactor(200);
+		TS_ASSERT_EQUALS( container.getMaxLoadFactor(), (uint)Common::HASHMAP_MAX_LOAD_FACTOR );
+	}
+
+	// TODO: Add test cases for find, ...
 };
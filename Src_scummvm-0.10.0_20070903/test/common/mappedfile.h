@@ -0,0 +1,172 @@
+#include <cxxtest/TestSuite.h>
+
+#include "common/stdafx.h"
+#include "common/scummsys.h"
+#include "common/file.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Common::File reports errors through common/util.cpp, which refers to the
+// engine and the OSystem; the tests run without either.
+class Engine;
+Engine *g_engine = 0;
+class OSystem;
+OSystem *g_system = 0;
+
+/**
+ * A MappedFile which never maps the file, to test the buffered fallback
+ * used on platforms without mmap and for files which can't be mapped.
+ */
+class UnmappedFile : public Common::MappedFile {
+public:
+	bool open(const Common::String &filename, AccessMode mode = kFileReadMode) {
+		return File::open(filename, mode);
+	}
+};
+
+class MappedFileTestSuite : public CxxTest::TestSuite
+{
+	static const char *filename() { return "mappedfile_test.tmp"; }
+
+	static void createFile(uint32 size) {
+		Common::File out;
+		TS_ASSERT(out.open(filename(), Common::File::kFileWriteMode));
+		for (uint32 i = 0; i < size; i++)
+			out.writeByte((byte)(i * 7));
+		out.close();
+	}
+
+	// Checks the reading, seeking and eof behaviour common to the mapped
+	// file and the buffered fallback.
+	static void checkContents(Common::MappedFile &file, uint32 size) {
+		byte buf[100];
+
+		TS_ASSERT_EQUALS( file.size(), size );
+		TS_ASSERT_EQUALS( file.pos(), 0u );
+
+		TS_ASSERT_EQUALS( file.read(buf, 10), 10u );
+		for (uint32 i = 0; i < 10; i++)
+			TS_ASSERT_EQUALS( buf[i], (byte)(i * 7) );
+		TS_ASSERT_EQUALS( file.pos(), 10u );
+		TS_ASSERT( !file.eof() );
+
+		file.seek(-5, SEEK_END);
+		TS_ASSERT_EQUALS( file.pos(), size - 5 );
+		TS_ASSERT_EQUALS( file.readByte(), (byte)((size - 5) * 7) );
+		file.seek(-2, SEEK_CUR);
+		TS_ASSERT_EQUALS( file.pos(), size - 6 );
+
+		// Reading past the end returns what is left, and sets eof
+		TS_ASSERT_EQUALS( file.read(buf, sizeof(buf)), 6u );
+		TS_ASSERT_EQUALS( buf[5], (byte)((size - 1) * 7) );
+		TS_ASSERT( file.eof() );
+		TS_ASSERT( file.ioFailed() );
+
+		file.clearIOFailed();
+		file.seek(20);
+		TS_ASSERT( !file.eof() );
+		Common::MemoryReadStream *stream = file.readStreamAt(20, 30);
+		TS_ASSERT( stream != 0 );
+		if (stream) {
+			TS_ASSERT_EQUALS( stream->size(), 30u );
+			TS_ASSERT_EQUALS( stream->readByte(), (byte)(20 * 7) );
+			delete stream;
+		}
+		TS_ASSERT( file.readStreamAt(size - 10, 11) == 0 );
+	}
+
+	public:
+	void tearDown()
+	{
+		remove(filename());
+	}
+
+	void test_mapped( void )
+	{
+		createFile(1000);
+
+		Common::MappedFile file;
+		TS_ASSERT( !file.isOpen() );
+		TS_ASSERT( !file.isMapped() );
+		TS_ASSERT( file.open(filename()) );
+		TS_ASSERT( file.isOpen() );
+#ifdef UNIX
+		TS_ASSERT( file.isMapped() );
+#endif
+
+		if (file.isMapped()) {
+			const byte *data = file.getData(0, 1000);
+			TS_ASSERT( data != 0 );
+			TS_ASSERT_EQUALS( data[999], (byte)(999 * 7) );
+			TS_ASSERT_EQUALS( file.getData(990, 10), data + 990 );
+			TS_ASSERT( file.getData(990, 11) == 0 );
+			TS_ASSERT( file.getData(1001, 0) == 0 );
+		}
+
+		checkContents(file, 1000);
+
+		// Closing unmaps the file, and the object can be used again
+		file.close();
+		TS_ASSERT( !file.isOpen() );
+		TS_ASSERT( !file.isMapped() );
+		TS_ASSERT( file.getData(0, 1) == 0 );
+
+		TS_ASSERT( file.open(filename()) );
+		TS_ASSERT_EQUALS( file.size(), 1000u );
+		TS_ASSERT_EQUALS( file.pos(), 0u );
+	}
+
+	void test_unmapped( void )
+	{
+		createFile(1000);
+
+		UnmappedFile file;
+		TS_ASSERT( file.open(filename()) );
+		TS_ASSERT( !file.isMapped() );
+		TS_ASSERT( file.getData(0, 1) == 0 );
+
+		checkContents(file, 1000);
+		file.close();
+		TS_ASSERT( !file.isOpen() );
+	}
+
+	void test_empty( void )
+	{
+		// Empty files can't be mapped, and fall back to buffered reads
+		createFile(0);
+
+		Common::MappedFile file;
+		TS_ASSERT( file.open(filename()) );
+		TS_ASSERT( !file.isMapped() );
+		TS_ASSERT_EQUALS( file.size(), 0u );
+
+		byte buf[4];
+		TS_ASSERT_EQUALS( file.read(buf, sizeof(buf)), 0u );
+		TS_ASSERT( file.eof() );
+	}
+
+	void test_write( void )
+	{
+		// Files opened for writing are never mapped
+		Common::MappedFile file;
+		TS_ASSERT( file.open(filename(), Common::File::kFileWriteMode) );
+		TS_ASSERT( !file.isMapped() );
+		TS_ASSERT_EQUALS( file.write("data", 4), 4u );
+		file.close();
+
+		TS_ASSERT( file.open(filename()) );
+		TS_ASSERT_EQUALS( file.size(), 4u );
+		char buf[4];
+		TS_ASSERT_EQUALS( file.read(buf, 4), 4u );
+		TS_ASSERT( memcmp(buf, "data", 4) == 0 );
+	}
+
+	void test_missing( void )
+	{
+		Common::MappedFile file;
+		TS_ASSERT( !file.open("mappedfile_missing.tmp") );
+		TS_ASSERT( !file.isOpen() );
+		TS_ASSERT( !file.isMapped() );
+	}
+};
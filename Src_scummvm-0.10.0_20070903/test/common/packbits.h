@@ -0,0 +1,143 @@
+#include <cxxtest/TestSuite.h>
+
+#include "common/stdafx.h"
+#include "common/scummsys.h"
+#include "common/packbits.h"
+
+#include <string.h>
+
+class PackBitsTestSuite : public CxxTest::TestSuite
+{
+	// Decodes PackBits as described in common/packbits.h; returns the
+	// number of bytes written to dst, or -1 if the data is malformed.
+	static int unpack(const byte *src, uint32 size, byte *dst, uint32 dstSize) {
+		uint32 in = 0, out = 0;
+		while (in < size) {
+			const byte c = src[in++];
+			if (c == 128)
+				return -1;
+			if (c < 128) {
+				const uint32 len = c + 1;
+				if (in + len > size || out + len > dstSize)
+					return -1;
+				memcpy(dst + out, src + in, len);
+				in += len;
+				out += len;
+			} else {
+				const uint32 len = 257 - c;
+				if (in >= size || out + len > dstSize)
+					return -1;
+				memset(dst + out, src[in++], len);
+				out += len;
+			}
+		}
+		return (int)out;
+	}
+
+	// Packs and unpacks data, checks the result and the bound on the
+	// compressed size, and returns the compressed size.
+	static uint32 roundTrip(const byte *data, uint32 size) {
+		const uint32 maxPackedSize = size + (size + 127) / 128;
+		byte *packed = new byte[maxPackedSize + 1];
+		byte *unpacked = new byte[size + 1];
+
+		packed[maxPackedSize] = 0xAA;
+		const uint32 packedSize = Common::packBits(data, size, packed);
+		TS_ASSERT(packedSize <= maxPackedSize);
+		TS_ASSERT_EQUALS(packed[maxPackedSize], 0xAA);
+
+		TS_ASSERT_EQUALS(unpack(packed, packedSize, unpacked, size + 1), (int)size);
+		TS_ASSERT(size == 0 || memcmp(data, unpacked, size) == 0);
+
+		delete[] packed;
+		delete[] unpacked;
+		return packedSize;
+	}
+
+	public:
+	void test_empty( void )
+	{
+		byte data[1] = { 0 };
+		TS_ASSERT_EQUALS( roundTrip(data, 0), 0u );
+	}
+
+	void test_one_byte( void )
+	{
+		byte data[1] = { 42 };
+		byte packed[2];
+		TS_ASSERT_EQUALS( Common::packBits(data, 1, packed), 2u );
+		TS_ASSERT_EQUALS( packed[0], 0 );
+		TS_ASSERT_EQUALS( packed[1], 42 );
+		roundTrip(data, 1);
+	}
+
+	void test_runs( void )
+	{
+		byte data[600];
+		memset(data, 7, sizeof(data));
+
+		// A run of 128 bytes fits into one control byte, longer ones don't;
+		// a remainder of two bytes is stored literally
+		TS_ASSERT_EQUALS( roundTrip(data, 3), 2u );
+		TS_ASSERT_EQUALS( roundTrip(data, 127), 2u );
+		TS_ASSERT_EQUALS( roundTrip(data, 128), 2u );
+		TS_ASSERT_EQUALS( roundTrip(data, 129), 4u );
+		TS_ASSERT_EQUALS( roundTrip(data, 130), 5u );
+		TS_ASSERT_EQUALS( roundTrip(data, 256), 4u );
+		TS_ASSERT_EQUALS( roundTrip(data, 257), 6u );
+		TS_ASSERT_EQUALS( roundTrip(data, sizeof(data)), 10u );
+
+		byte packed[2];
+		Common::packBits(data, 128, packed);
+		TS_ASSERT_EQUALS( packed[0], 129 );
+	}
+
+	void test_literals( void )
+	{
+		byte data[600];
+		for (uint i = 0; i < sizeof(data); i++)
+			data[i] = (byte)(i * 7);
+
+		// Incompressible data costs one control byte per 128 bytes
+		TS_ASSERT_EQUALS( roundTrip(data, 2), 3u );
+		TS_ASSERT_EQUALS( roundTrip(data, 127), 128u );
+		TS_ASSERT_EQUALS( roundTrip(data, 128), 129u );
+		TS_ASSERT_EQUALS( roundTrip(data, 129), 131u );
+		TS_ASSERT_EQUALS( roundTrip(data, 256), 258u );
+		TS_ASSERT_EQUALS( roundTrip(data, 257), 260u );
+		TS_ASSERT_EQUALS( roundTrip(data, sizeof(data)), 605u );
+
+		byte packed[130];
+		Common::packBits(data, 128, packed);
+		TS_ASSERT_EQUALS( packed[0], 127 );
+	}
+
+	void test_mixed( void )
+	{
+		byte data[1000];
+		uint32 seed = 1;
+		for (uint i = 0; i < sizeof(data); ) {
+			seed = seed * 1103515245 + 12345;
+			const byte value = (byte)(seed >> 16);
+			uint len = 1 + (seed >> 24) % 200;
+			if (len > sizeof(data) - i)
+				len = sizeof(data) - i;
+			// Alternate between runs and single bytes
+			if ((seed >> 8) & 1) {
+				memset(data + i, value, len);
+			} else {
+				data[i] = value;
+				len = 1;
+			}
+			i += len;
+		}
+
+		for (uint32 size = 0; size <= sizeof(data); size += 37)
+			roundTrip(data, size);
+		roundTrip(data, sizeof(data));
+
+		// Pairs of equal bytes are cheaper as literals than as runs
+		const byte pairs[] = { 1, 1, 2, 2, 3, 3, 4, 4 };
+		TS_ASSERT_EQUALS( roundTrip(pairs, sizeof(pairs)), 9u );
+	}
+};
@@ -6,7 +6,7 @@
 ######################################################################
 
 TESTS        := test/common/*.h
-TEST_LIBS    := common/libcommon.a
+TEST_LIBS    := common/libcommon.a backends/libbackends.a common/libcommon.a
 
 #
 TEST_FLAGS   := --runner=StdioPrinter
@@ -0,0 +1,349 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+/*
+ * Bakes a GUI theme (its .ini file plus the images and font caches it
+ * references, taken from the theme directory or its .zip archive) into one
+ * precompiled theme bundle, which gui/theme-bundle.cpp can load without any
+ * parsing or decoding. See gui/theme-bundle.h for the file format.
+ *
+ * Usage: create_themebundle [--555] <theme> <output>
+ *
+ * <theme> is the theme without extension, e.g. gui/themes/modern. The images
+ * are stored in RGB565 (or RGB555 with --555); ScummVM converts them when it
+ * runs with a different overlay format, so this only affects the speed.
+ */
+
+#include "common/stdafx.h"
+#include "common/scummsys.h"
+#include "common/config-file.h"
+#include "common/system.h"
+#include "common/endian.h"
+#include "common/stream.h"
+#include "common/unzip.h"
+
+#include "gui/theme-bundle.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+/** The bundle being written, which is removed again if an error occurs. */
+static FILE *_outFile = 0;
+static const char *_outName = 0;
+
+// Replacements for the versions in common/util.cpp, which would pull in the
+// engine and GUI code. Common::File uses debug(), so it is needed as well.
+
+void CDECL error(const char *s, ...) {
+	va_list va;
+
+	va_start(va, s);
+	fprintf(stderr, "ERROR: ");
+	vfprintf(stderr, s, va);
+	fprintf(stderr, "!\n");
+	va_end(va);
+
+	// Don't leave a truncated bundle behind, which make would consider
+	// up to date
+	if (_outFile) {
+		fclose(_outFile);
+		remove(_outName);
+	}
+
+	exit(1);
+}
+
+void CDECL warning(const char *s, ...) {
+	va_list va;
+
+	va_start(va, s);
+	fprintf(stderr, "WARNING: ");
+	vfprintf(stderr, s, va);
+	fprintf(stderr, "!\n");
+	va_end(va);
+}
+
+void CDECL debug(int level, const char *s, ...) {
+}
+
+// ConfigFile can save to save files, which would pull in common/system.cpp
+// and with it the GUI code, too. There is no OSystem in this tool.
+OSystem *g_system = 0;
+
+static Common::String _themeDir;
+static Common::String _themeZip;
+static bool _rgb555 = false;
+
+/**
+ * Reads a file of the theme, from the theme directory or from the theme
+ * archive, in the same order ScummVM looks for them.
+ */
+static byte *readThemeFile(const Common::String &name, uint32 &size) {
+	FILE *in = fopen((_themeDir + name).c_str(), "rb");
+	if (in) {
+		fseek(in, 0, SEEK_END);
+		size = (uint32)ftell(in);
+		fseek(in, 0, SEEK_SET);
+		byte *data = new byte[size];
+		if (fread(data, 1, size, in) != size)
+			error("Could not read '%s'", (_themeDir + name).c_str());
+		fclose(in);
+		return data;
+	}
+
+#ifdef USE_ZLIB
+	unzFile zipFile = unzOpen(_themeZip.c_str());
+	if (zipFile && unzLocateFile(zipFile, name.c_str(), 2) == UNZ_OK) {
+		unz_file_info fileInfo;
+		unzOpenCurrentFile(zipFile);
+		unzGetCurrentFileInfo(zipFile, &fileInfo, NULL, 0, NULL, 0, NULL, 0);
+		size = (uint32)fileInfo.uncompressed_size;
+		byte *data = new byte[size];
+		if (unzReadCurrentFile(zipFile, data, size) != (int)size)
+			error("Could not read '%s' from '%s'", name.c_str(), _themeZip.c_str());
+		unzCloseCurrentFile(zipFile);
+		unzClose(zipFile);
+		return data;
+	}
+	if (zipFile)
+		unzClose(zipFile);
+#endif
+
+	return 0;
+}
+
+static void writeUint16(FILE *out, uint16 value) {
+	byte buf[2];
+	WRITE_LE_UINT16(buf, value);
+	fwrite(buf, 1, 2, out);
+}
+
+static void writeUint32(FILE *out, uint32 value) {
+	byte buf[4];
+	WRITE_LE_UINT32(buf, value);
+	fwrite(buf, 1, 4, out);
+}
+
+static void writeString(FILE *out, const Common::String &str) {
+	writeUint16(out, (uint16)str.size());
+	fwrite(str.c_str(), 1, str.size(), out);
+}
+
+/**
+ * Records the size and modification time of a theme source file, so that
+ * ScummVM can tell when the bundle is out of date. Missing files are
+ * recorded with size 0.
+ */
+static void writeSource(FILE *out, const Common::String &path, const Common::String &name) {
+	uint32 size = 0, mtime = 0;
+
+	struct stat st;
+	if (stat(path.c_str(), &st) == 0) {
+		size = (uint32)st.st_size;
+		mtime = (uint32)st.st_mtime;
+	}
+
+	writeString(out, name);
+	writeUint32(out, size);
+	writeUint32(out, mtime);
+}
+
+static bool hasExtension(const Common::String &name, const char *ext) {
+	const uint len = (uint)strlen(ext);
+	return name.size() > len && !scumm_stricmp(name.c_str() + name.size() - len, ext);
+}
+
+/**
+ * Converts an uncompressed 24 bit BMP file to the bundle's pixel format,
+ * just like Graphics::ImageDecoder does it with the overlay format.
+ */
+static bool writeImage(FILE *out, const Common::String &name, const byte *data, uint32 size) {
+	if (size < 54 || READ_BE_UINT16(data) != 'BM' || READ_LE_UINT16(data + 28) != 24)
+		return false;
+
+	const uint32 offset = READ_LE_UINT32(data + 10);
+	const uint32 w = READ_LE_UINT32(data + 18);
+	const uint32 h = READ_LE_UINT32(data + 22);
+	const uint32 pitch = w * 3 + w % 4;
+	if (w > 0xFFFF || h > 0xFFFF || offset + pitch * h > size)
+		return false;
+
+	writeString(out, name);
+	writeUint16(out, GUI::ThemeBundle::kEntryImage);
+	writeUint16(out, (uint16)w);
+	writeUint16(out, (uint16)h);
+
+	// BMP images are stored bottom up
+	for (uint32 y = 0; y < h; ++y) {
+		const byte *src = data + offset + (h - 1 - y) * pitch;
+		for (uint32 x = 0; x < w; ++x, src += 3) {
+			const byte b = src[0], g = src[1], r = src[2];
+			if (_rgb555)
+				writeUint16(out, (uint16)(((r >> 3) << 10) | ((g >> 3) << 5) | (b >> 3)));
+			else
+				writeUint16(out, (uint16)(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3)));
+		}
+	}
+
+	return true;
+}
+
+int main(int argc, char *argv[]) {
+	int arg = 1;
+	if (arg < argc && !strcmp(argv[arg], "--555")) {
+		_rgb555 = true;
+		++arg;
+	}
+
+	if (argc - arg != 2) {
+		printf("Usage: %s [--555] <theme> <output>\n", argv[0]);
+		printf("e.g. %s gui/themes/modern modern.thb\n", argv[0]);
+		return 1;
+	}
+
+	Common::String theme(argv[arg]);
+	_themeZip = theme + ".zip";
+
+	Common::String styleName(theme);
+	for (int i = theme.size() - 1; i >= 0; --i) {
+		if (theme[i] == '/' || theme[i] == '\\') {
+			_themeDir = Common::String(theme.c_str(), i + 1);
+			styleName = theme.c_str() + i + 1;
+			break;
+		}
+	}
+
+	// The theme config lies next to the archive or, just like in
+	// Theme::loadConfigFile, in the archive itself
+	uint32 size = 0;
+	byte *data = readThemeFile(styleName + ".ini", size);
+	if (!data)
+		error("Could not find the config of theme '%s'", theme.c_str());
+
+	Common::ConfigFile cfg;
+	Common::MemoryReadStream stream(data, size);
+	if (!cfg.loadFromStream(stream))
+		error("Could not parse the config of theme '%s'", theme.c_str());
+	delete[] data;
+
+	FILE *out = fopen(argv[arg + 1], "wb");
+	if (!out)
+		error("Could not create '%s'", argv[arg + 1]);
+	_outFile = out;
+	_outName = argv[arg + 1];
+
+	byte tag[4];
+	WRITE_BE_UINT32(tag, MKID_BE('STHB'));
+	fwrite(tag, 1, 4, out);
+	writeUint16(out, GUI::ThemeBundle::kVersion);
+	if (_rgb555) {
+		writeUint16(out, 0x7C00);
+		writeUint16(out, 0x03E0);
+	} else {
+		writeUint16(out, 0xF800);
+		writeUint16(out, 0x07E0);
+	}
+	writeUint16(out, 0x001F);
+
+	// The files Theme::loadConfigFile would read instead of the bundle
+	writeUint16(out, 2);
+	writeSource(out, _themeDir + styleName + ".ini", styleName + ".ini");
+	writeSource(out, _themeZip, styleName + ".zip");
+
+	// The config, without the comments, and the files it references. The
+	// values are still stored unevaluated, as they depend on the
+	// resolution ScummVM runs in.
+	const Common::ConfigFile::SectionList sections = cfg.getSections();
+	Common::StringMap files;
+	writeUint32(out, sections.size());
+	for (Common::ConfigFile::SectionList::const_iterator i = sections.begin(); i != sections.end(); ++i) {
+		writeString(out, i->name);
+		writeUint32(out, i->keys.size());
+		for (Common::ConfigFile::SectionKeyList::const_iterator j = i->keys.begin(); j != i->keys.end(); ++j) {
+			writeString(out, j->key);
+			writeString(out, j->value);
+
+			Common::String value(j->value);
+			if (value.size() >= 2 && value[0] == '"' && value.lastChar() == '"') {
+				value.deleteLastChar();
+				value = Common::String(value.c_str() + 1);
+			}
+
+			if (hasExtension(value, ".bmp")) {
+				files[value] = value;
+			} else if (hasExtension(value, ".bdf")) {
+				// Only the font cache is bundled, see Theme::genCacheFilename
+				Common::String cacheName(value);
+				for (int k = 0; k < 3; ++k)
+					cacheName.deleteLastChar();
+				files[cacheName + "fcc"] = cacheName + "fcc";
+			}
+		}
+	}
+
+	uint32 numEntries = 0;
+	const long countPos = ftell(out);
+	writeUint32(out, 0);
+
+	for (Common::StringMap::const_iterator i = files.begin(); i != files.end(); ++i) {
+		// A bundle without some of the images would make the theme look
+		// broken, while the font caches are created anew if they are missing
+		const bool isImage = hasExtension(i->_key, ".bmp");
+		data = readThemeFile(i->_key, size);
+		if (!data) {
+			if (isImage)
+				error("Could not find the image '%s'", i->_key.c_str());
+			warning("Could not find '%s', it is not included in the bundle", i->_key.c_str());
+			continue;
+		}
+
+		if (isImage) {
+			if (!writeImage(out, i->_key, data, size))
+				error("'%s' is no uncompressed 24 bit BMP file", i->_key.c_str());
+			++numEntries;
+		} else {
+			writeString(out, i->_key);
+			writeUint16(out, GUI::ThemeBundle::kEntryFile);
+			writeUint32(out, size);
+			fwrite(data, 1, size, out);
+			++numEntries;
+		}
+		delete[] data;
+	}
+
+	fseek(out, countPos, SEEK_SET);
+	writeUint32(out, numEntries);
+
+	_outFile = 0;
+	if (ferror(out) || fclose(out) != 0) {
+		remove(argv[arg + 1]);
+		error("Could not write '%s'", argv[arg + 1]);
+	}
+
+	printf("%s: %d config sections, %d images and files\n", argv[arg + 1], sections.size(), numEntries);
+	return 0;
+}
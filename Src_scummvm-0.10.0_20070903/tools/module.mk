@@ -8,7 +8,7 @@ MODULE_DIRS += \
 # Tools directory
 #######################################################################
 
-TOOLS := tools/convbdf$(EXEEXT) tools/md5table$(EXEEXT)
+TOOLS := tools/convbdf$(EXEEXT) tools/md5table$(EXEEXT) tools/create_themebundle$(EXEEXT)
 
 
 # Make sure the 'all' / 'clean' targets build/clean the tools, too
@@ -33,6 +33,10 @@ tools/md5table$(EXEEXT): $(srcdir)/tools/md5table.c
 	$(MKDIR) tools/$(DEPDIR)
 	$(CC) $(CFLAGS) -Wall -o $@ $<
 
+tools/create_themebundle$(EXEEXT): $(srcdir)/tools/create_themebundle.cpp common/libcommon.a backends/libbackends.a
+	$(MKDIR) tools/$(DEPDIR)
+	$(CXX) $(CXXFLAGS) $(CPPFLAGS) -o $@ $+ $(LIBS)
+
 #
 # Rules to explicitly rebuild the credits / MD5 tables.
 # The rules for the files in the "web" resp. "docs" modules
@@ -48,6 +52,15 @@ credits:
 	$(srcdir)/tools/credits.pl --html > ../../web/trunk/credits.inc
 	$(srcdir)/tools/credits.pl --xml > ../../docs/trunk/docbook/credits.xml
 
+#
+# Rule to bake the modern theme into a precompiled theme bundle, which
+# starts up faster than the .ini and .zip files. ScummVM ignores the
+# bundle once the theme changes, until it is rebuilt.
+#
+
+themebundles: tools/create_themebundle$(EXEEXT)
+	tools/create_themebundle$(EXEEXT) $(srcdir)/gui/themes/modern gui/themes/modern.thb
+
 md5scumm: tools/md5table$(EXEEXT)
 	tools/md5table$(EXEEXT) --c++ < $(srcdir)/tools/scumm-md5.txt > engines/scumm/scumm-md5.h
 	tools/md5table$(EXEEXT) --php < $(srcdir)/tools/scumm-md5.txt > ../../web/trunk/docs/md5.inc
@@ -73,4 +86,4 @@ md5scumm: tools/md5table$(EXEEXT)
 
 
 
-.PHONY: clean-tools tools credits md5scumm md5simon
+.PHONY: clean-tools tools themebundles credits md5scumm md5simon